@@ -23,13 +23,29 @@
 #include "Cambada.h"
 #include "Field.h"
 #include "Behaviour.h"
+#include "rtdb_replay.h"
+#include "AllocCounter.h"
+#include "pman.h"
 
 using namespace cambada;
 
 namespace cambada {
 
+/* Monotonic time in us, used for the stage timings. It is not affected by
+ * clock changes nor by the virtual clock of the replay tools */
+static long monotonicTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000000L + ts.tv_nsec/1000L;
+}
+
 Cambada::Cambada() {
 
+	recording = false;
+	lastVelA = 0.0;
+	memset(&cycleTimes, 0, sizeof(cycleTimes));
+
 	config = new ConfigXML();						// Create the config object of type ConfigXML
 	config->parse("../config/cambada.conf.xml");	// Parse xml configuration file
 
@@ -73,6 +89,9 @@ Cambada::Cambada() {
 
 Cambada::~Cambada()
 {
+	if( recording )
+		DB_record_close();
+
 	delete decision; decision = NULL;
 
 	delete Behaviour::cArc; Behaviour::cArc = NULL;
@@ -90,7 +109,8 @@ Cambada::~Cambada()
 void Cambada::printHelp()
 {
 	fprintf(stdout,"The Cambada Agent Help:\n\n");
-	fprintf(stdout,"\t-nc, --nocoach	\n\n");
+	fprintf(stdout,"\t-nc, --nocoach	\n");
+	fprintf(stdout,"\t-r, --record <file>	record the RTDB inputs of every cycle (see agent_replay)\n\n");
 }
 
 bool Cambada::parseArguments( int argc , char* argv[] )
@@ -108,6 +128,13 @@ bool Cambada::parseArguments( int argc , char* argv[] )
 			return false;
 		}else if( strcasecmp(argv[i] , "-nc") == 0 || strcasecmp(argv[i] , "--nocoach") == 0 ) {
 			me->coaching = false;
+		}else if( strcasecmp(argv[i] , "-r") == 0 || strcasecmp(argv[i] , "--record") == 0 ) {
+			if( i+1 >= argc || DB_record_open(argv[i+1]) != 0 ) {
+				fprintf(stderr,"Cambada: unable to record to %s\n", (i+1 < argc) ? argv[i+1] : "(missing file)");
+				return false;
+			}
+			recording = true;
+			i++;
 		}
 	}
 
@@ -116,15 +143,21 @@ bool Cambada::parseArguments( int argc , char* argv[] )
 
 void Cambada::thinkAndAct()
 {
-	struct timeval tv;
-	int time, t1, t2, t3, t4, t5;
-	gettimeofday(&tv,NULL);
-	time = tv.tv_sec*1000+tv.tv_usec/1000;
+	long time, t1, t2, t3, t4, t5;
+	unsigned long allocs = util::allocCount();
+
+	if( recording )
+		DB_record_frame();										// Snapshot the inputs of this cycle
+
+	time = monotonicTime();
 
+	PMAN_span_begin("integrate");								// Cycle phases on the PMAN trace (no-op without PMAN)
 	integrator->integrate();
+	PMAN_span_end("integrate");
 
-	gettimeofday(&tv,NULL);
-	t1 = tv.tv_sec*1000+tv.tv_usec/1000; // TIME 1
+	t1 = monotonicTime(); // TIME 1
+
+	PMAN_span_begin("strategy");
 
 	if (world->gameState == preOpponentKickOff || world->gameState == postOpponentKickOff
 			|| world->gameState == preOpponentGoalKick || world->gameState == postOpponentGoalKick
@@ -140,14 +173,18 @@ void Cambada::thinkAndAct()
 		strategy->updateFreePlay();
 	}
 
-	gettimeofday(&tv,NULL);
-	t2 = tv.tv_sec*1000+tv.tv_usec/1000; // TIME 2
+	PMAN_span_end("strategy");
+
+	t2 = monotonicTime(); // TIME 2
 
 	// Update Agent HeightMaps
+	PMAN_span_begin("maps");
 	world->calcMaps();
+	PMAN_span_end("maps");
 
-	gettimeofday(&tv,NULL);
-	t3 = tv.tv_sec*1000+tv.tv_usec/1000; // TIME 3
+	t3 = monotonicTime(); // TIME 3
+
+	PMAN_span_begin("decision");
 
 	//Initialize kickPower and grabberMode
 	dv->kickPower = 0;											// kickPower is 0 by default
@@ -166,8 +203,11 @@ void Cambada::thinkAndAct()
 
 	config->checkConpensators(); 								// reset all not used compensators
 
-	gettimeofday(&tv,NULL);
-	t4 = tv.tv_sec*1000+tv.tv_usec/1000; // TIME 4
+	PMAN_span_end("decision");
+
+	t4 = monotonicTime(); // TIME 4
+
+	PMAN_span_begin("command");
 
 	if (dv->grabber == GRABBER_DEFAULT)							// If grabber state was not set
 		dv->grabberControl();									// Call default grabberControl()
@@ -200,10 +240,20 @@ void Cambada::thinkAndAct()
 
 	world->updateEndCycle();
 
-	gettimeofday(&tv,NULL);
-	t5 = tv.tv_sec*1000+tv.tv_usec/1000; // TIME 5
+	PMAN_span_end("command");
+
+	t5 = monotonicTime(); // TIME 5
+
+	cycleTimes.integrate	= t1 - time;
+	cycleTimes.strategy		= t2 - t1;
+	cycleTimes.maps			= t3 - t2;
+	cycleTimes.decision		= t4 - t3;
+	cycleTimes.command		= t5 - t4;
+	cycleTimes.total		= t5 - time;
+	cycleTimes.allocs		= util::allocCount() - allocs;
 
-	fprintf(stderr, "Agent[%1d]: %3d ms (int %3d + strat %3d + maps %3d + dec %3d + CMD %3d)\n",world->me->number, t5 - time, t1-time, t2-t1, t3-t2, t4-t3, t5-t4);
+	fprintf(stderr, "Agent[%1d]: %3ld ms (int %3ld + strat %3ld + maps %3ld + dec %3ld + CMD %3ld)\n",world->me->number,
+			cycleTimes.total/1000, cycleTimes.integrate/1000, cycleTimes.strategy/1000, cycleTimes.maps/1000, cycleTimes.decision/1000, cycleTimes.command/1000);
 }
 
 bool Cambada::reconfigure()
@@ -50,6 +50,19 @@
 
 namespace cambada {
 
+/**
+ * \brief Duration (us) of each stage of the last thinkAndAct cycle
+ */
+struct CycleTimes {
+	long integrate;
+	long strategy;
+	long maps;
+	long decision;
+	long command;
+	long total;
+	long allocs;		// heap allocations (operator new) during the cycle
+};
+
 /**
  * \brief The top layer of the agent's Artificial Intelligence
  */
@@ -61,6 +74,7 @@ public:
 	void thinkAndAct();
 	bool reconfigure();
 	void rampVelA();
+	const CycleTimes& getCycleTimes() const { return cycleTimes; }
 
 private:
 	void printHelp();
@@ -78,6 +92,9 @@ private:
 	int		argc;
 
 	float lastVelA;
+
+	bool		recording;		// RTDB inputs are being recorded (--record)
+	CycleTimes	cycleTimes;
 };
 
 } /* namespace cambada */
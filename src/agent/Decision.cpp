@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "log.h"
+#include "KickCalibData.h"
 
 using namespace cambada::geom;
 
@@ -35,6 +36,7 @@ Decision::Decision(WorldState* world)
 
 	roleStop = new RoleStop();
 	roleStriker = new RoleStriker();
+	roleKickCalibrate = new RoleKickCalibrate();
 
 	roleActive = roleStop;
 }
@@ -44,6 +46,7 @@ Decision::~Decision()
 	roleActive = NULL;
 	delete roleStop;
 	delete roleStriker;
+	delete roleKickCalibrate;
 }
 
 void Decision::decide(DriveVector* dv)
@@ -84,6 +87,7 @@ Role* Decision::getRoleFromID(RoleID idx) {
 	{
 	case rStop: role = roleStop; break;
 	case rStriker: role = roleStriker; break;
+	case rKickCalibrate: role = roleKickCalibrate; break;
 	default: role = roleStop; break;
 	}
 
@@ -98,6 +102,12 @@ RoleID Decision::roleSelection()
 		return rStop;
 	}
 
+	// Kick calibration of this robot requested by kickcalib
+	KickCalibAppData calib;
+	int calibLife = DB_get( BASE_STATION , KICKCALIB_APP , &calib );
+	if( calibLife >= 0 && calibLife < 1000 && calib.active && calib.robotNumber == world->me->number )
+		return rKickCalibrate;
+
 	// Forced role from basestation
 	if( !world->me->roleAuto )
 		return (RoleID)world->me->role;
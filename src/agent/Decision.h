@@ -31,6 +31,7 @@
 
 #include "RoleStop.h"
 #include "RoleStriker.h"
+#include "RoleKickCalibrate.h"
 
 namespace cambada {
 
@@ -55,6 +56,7 @@ private:
 
 	RoleStop* roleStop;
 	RoleStriker* roleStriker;
+	RoleKickCalibrate* roleKickCalibrate;
 };
 
 }
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BKickCalibrate.h"
+
+namespace cambada {
+
+BKickCalibrate::BKickCalibrate() : Behaviour(bKickCalibrate), kicked(false) {}
+
+BKickCalibrate::~BKickCalibrate() {}
+
+void BKickCalibrate::loseControl() {
+	kicked = false;
+}
+
+void BKickCalibrate::calculate(DriveVector* dv) {
+	dv->motorsOff();
+	dv->grabber = GRABBER_ON;
+
+	KickCalibAppData app;
+	int life = DB_get( BASE_STATION , KICKCALIB_APP , &app );
+	bool request = life >= 0 && life < 1000 && app.active && app.robotNumber == world->me->number && app.kick;
+
+	if( !request )
+		kicked = false;					// ready for the next request
+	else if( !kicked && world->me->ball.engaged && app.power > 0 && app.power < 0x80 )
+	{
+		dv->kickPower = app.power;		// kick, not pass (bit 7)
+		kicked = true;
+	}
+
+	KickCalibRobData rob;
+	rob.stopped		= world->me->vel.length() < 0.05;
+	rob.kicked		= kicked;
+	rob.distance	= (field->theirGoal - world->me->pos).length();
+	rob.power		= (life >= 0) ? app.power : 0;
+	DB_put( KICKCALIB_ROB , (void*)&rob );
+}
+
+} /* namespace cambada */
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BKICKCALIBRATE_H_
+#define BKICKCALIBRATE_H_
+
+#include "Behaviour.h"
+#include "KickCalibData.h"
+
+namespace cambada {
+
+/**
+ * \brief Kicks on request of the kickcalib tool and reports the kick
+ *
+ * The robot stands still with the grabber on; each time KICKCALIB_APP asks
+ * for a kick (kick false->true) the engaged ball is kicked once with the
+ * requested power. KICKCALIB_ROB is published every cycle with the power
+ * and the distance to their goal, so kickcalib records one sample per kick.
+ */
+class BKickCalibrate: public cambada::Behaviour {
+public:
+	BKickCalibrate();
+	virtual ~BKickCalibrate();
+
+	virtual void calculate(DriveVector* dv);
+	virtual void loseControl();
+
+private:
+	bool kicked;		// kick done for the current request
+};
+
+} /* namespace cambada */
+#endif /* BKICKCALIBRATE_H_ */
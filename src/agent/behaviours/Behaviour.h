@@ -79,6 +79,12 @@ public:
 	 */
 	virtual bool checkInvocationCondition() { return true; }
 
+	/**
+	 * Utility of this action when its conditions are met (higher is better,
+	 * must be > 0). Only used by the UtilityArbitrator
+	 */
+	virtual float utility() { return 1.0; }
+
 	/**
      * notifies the command generator, that it is to gain control during the
      * present control cycle. May be implemented by deliberative command
@@ -25,6 +25,7 @@
 
 #include "Behaviour.h"
 #include "DriveVector.h"
+#include "BehaviourScores.h"
 
 namespace cambada {
 
@@ -44,13 +45,19 @@ public:
 	int size();
 	void clear();
 
-private:
+	/**
+	 * Scores of the options in the last decision (for debugging)
+	 * \return false if the arbitrator does not score its options
+	 */
+	virtual bool getScores (BehaviourScores& scores) const { (void)scores; return false; }
+
+protected:
 	std::vector<Behaviour*> options;
 	int currentBehIdx;
 	int nextBehIdx;
 	bool behFinished;
 
-	void updateIntention ();
+	virtual void updateIntention ();
 	bool checkConditions ();
 };
 
@@ -44,6 +44,11 @@ public:
 	 */
 	bool checkInvocationCondition();
 
+	/**
+	 * \brief stopping has precedence over any other action
+	 */
+	float utility() { return 100.0; }
+
 	/**
 	 * \brief calculates the DriveVector
 	 */
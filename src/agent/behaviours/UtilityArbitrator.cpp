@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UtilityArbitrator.h"
+
+namespace cambada {
+
+UtilityArbitrator::UtilityArbitrator(float hysteresis): CambadaArbitrator(){
+	this->hysteresis = hysteresis;
+}
+
+UtilityArbitrator::UtilityArbitrator(BehaviourID id, float hysteresis): CambadaArbitrator(id){
+	this->hysteresis = hysteresis;
+}
+
+UtilityArbitrator::~UtilityArbitrator() {
+}
+
+void UtilityArbitrator::updateIntention() {
+	nextBehIdx=options.size();  // Means no option selected
+	behFinished=true;
+
+	scores.assign(options.size(), 0.0);
+	float best = 0.0;
+	for (int i=0; i < (int)(options.size()); i++) {
+		bool present = (i == currentBehIdx);
+		if (present ? !options[i]->checkCommitmentCondition() : !options[i]->checkInvocationCondition())
+			continue;
+
+		scores[i] = options[i]->utility();
+		if (present) {
+			scores[i] += hysteresis;
+			behFinished = false;
+		}
+
+		if (scores[i] > best) {
+			best = scores[i];
+			nextBehIdx = i;
+		}
+	}
+}
+
+bool UtilityArbitrator::getScores(BehaviourScores& s) const {
+	s.chosen = (currentBehIdx >= 0 && currentBehIdx < (int)(options.size())) ? currentBehIdx : -1;
+	s.nOptions = 0;
+	for (unsigned int i=0; i < options.size() && i < scores.size() && i < MAX_BEHAVIOUR_SCORES; i++) {
+		s.behaviour[i] = options[i]->behaviourRtti;
+		s.score[i] = scores[i];
+		s.nOptions++;
+	}
+	return true;
+}
+
+void UtilityArbitrator::printHierarchy (unsigned int level) const {
+	for (unsigned int i=0; i<level; i++)
+		fprintf(stderr,"  ");
+	fprintf(stderr,"%s (Utility)\n",getName().c_str());
+	for (unsigned int i=0; i<options.size(); i++)
+		options[i]->printHierarchy (level+1);
+}
+
+} /* namespace cambada */
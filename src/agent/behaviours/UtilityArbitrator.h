@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_ARBITRATOR_H_
+#define UTILITY_ARBITRATOR_H_
+
+#include "CambadaArbitrator.h"
+
+namespace cambada {
+
+/**
+ * \brief Arbitrator that chooses the option with the highest utility
+ *
+ * All the options are evaluated in one pass: an option scores its utility()
+ * when its invocation condition (commitment condition for the present
+ * intention) holds, and 0 otherwise. The present intention gets a small
+ * bonus so that options with the same utility do not alternate. Ties are
+ * won by the option added first.
+ */
+class UtilityArbitrator: public CambadaArbitrator {
+public:
+	UtilityArbitrator(float hysteresis = 0.1);
+	UtilityArbitrator(BehaviourID id, float hysteresis = 0.1);
+	virtual ~UtilityArbitrator();
+
+	virtual void printHierarchy (unsigned int) const;
+	virtual bool getScores (BehaviourScores& scores) const;
+
+protected:
+	virtual void updateIntention ();
+
+private:
+	float hysteresis;
+	std::vector<float> scores;	// scores of the last evaluation
+};
+
+} /* namespace cambada */
+#endif /* UTILITY_ARBITRATOR_H_ */
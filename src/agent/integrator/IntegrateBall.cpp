@@ -53,7 +53,7 @@ IntegrateBall::~IntegrateBall()
 
 // TODO JLS: added YET ANOTHER parameter for letting this class now that the ball touched the grabber so the filter can be reset because the ball has bounced
 // TODO \todo Does it really make sense to have this so much separated from the world state??? I am more and more convinced that it is not worth it this way...
-void IntegrateBall::integrate(vector<Ball> ballsVision, vector<BallFrontSensor> ballsFrontVision, Ball* shareBall, struct timeval instant, bool ballHitFront)
+void IntegrateBall::integrate(const vector<Ball>& ballsVision, const vector<BallFrontSensor>& ballsFrontVision, Ball* shareBall, struct timeval instant, bool ballHitFront)
 {
 	// Select most probable ball by vision if exist
 	if(selectMostProbableVisionBall(ballsVision, instant, ballHitFront))
@@ -70,7 +70,7 @@ void IntegrateBall::integrate(vector<Ball> ballsVision, vector<BallFrontSensor>
 }
 
 // JLS: lets propagate the grabber hit flag to finally get it to the function that needs the flag :s
-bool IntegrateBall::selectMostProbableVisionBall(vector<Ball> ballsVision, struct timeval instant, bool ballHitFront)
+bool IntegrateBall::selectMostProbableVisionBall(const vector<Ball>& ballsVision, struct timeval instant, bool ballHitFront)
 {
 	if(ballsVision.empty())
 	{
@@ -111,7 +111,7 @@ bool IntegrateBall::selectMostProbableVisionBall(vector<Ball> ballsVision, struc
 	return true;
 }
 
-bool IntegrateBall::selectMostProbableFrontVisionBall(vector<BallFrontSensor> ballsFrontVision, struct timeval instant)
+bool IntegrateBall::selectMostProbableFrontVisionBall(const vector<BallFrontSensor>& ballsFrontVision, struct timeval instant)
 {
 	int	closerFrontID = -1;
 	float shorterFront = 1000.0;		//Used to keep the shorter value of two measures between cycles. USED BOTH FOR ANGLE AND FOR POSITION.
@@ -48,7 +48,7 @@ public:
 	~IntegrateBall();
 
 	// Virtual function to be implemented in each mode
-	void integrate(vector<Ball> ballsVision, vector<BallFrontSensor> ballsFrontVision, Ball* shareBall, struct timeval instant, bool ballHitFront);
+	void integrate(const vector<Ball>& ballsVision, const vector<BallFrontSensor>& ballsFrontVision, Ball* shareBall, struct timeval instant, bool ballHitFront);
 
 	// Function that return position
 	Vec getPosition(){ return this->ball->pos; }
@@ -75,8 +75,8 @@ private:
 	Field* field;
 
 	Ball* ball;
-	bool selectMostProbableVisionBall(vector<Ball> ballsVision, struct timeval instant, bool ballHitFront);
-	bool selectMostProbableFrontVisionBall(vector<BallFrontSensor> ballsFrontVision, struct timeval instant);
+	bool selectMostProbableVisionBall(const vector<Ball>& ballsVision, struct timeval instant, bool ballHitFront);
+	bool selectMostProbableFrontVisionBall(const vector<BallFrontSensor>& ballsFrontVision, struct timeval instant);
 	bool selectShareBall(Ball* shareBall, struct timeval instant);
 	void setBallNotVisible();
 };
@@ -49,7 +49,7 @@ IntegratePlayer::~IntegratePlayer()
 	localization->~Localization();
 }
 
-void IntegratePlayer::integrate(vector<Vec> vision_lines, float lowLevelDx, float lowLevelDy, PlayerInfo coachInfo, bool firstTime)
+void IntegratePlayer::integrate(vector<Vec>& vision_lines, float lowLevelDx, float lowLevelDy, PlayerInfo coachInfo, bool firstTime)
 {
 	if(firstTime)
 		egoMotion.reset();
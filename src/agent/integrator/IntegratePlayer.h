@@ -44,7 +44,7 @@ public:
 	~IntegratePlayer();
 
 	// Integrate function
-	void integrate(vector<Vec> vision_lines, float lowLevelDx, float lowLevelDy, PlayerInfo coachInfo, bool firstTime);
+	void integrate(vector<Vec>& vision_lines, float lowLevelDx, float lowLevelDy, PlayerInfo coachInfo, bool firstTime);
 
 	// Get function that return posicion
 	Vec getPosition(){ return this->robot->pos; }
@@ -48,6 +48,10 @@ Integrator::Integrator( ConfigXML* config, WorldState* world , Strategy* strateg
 	while( buffer.size() < ceil((config->getParam("delay")/1000.0)/(config->getParam("cycle_time")/1000.0)))
 		buffer.push_back(v);
 
+	lines.reserve(MAX_POINTS);
+	visionBalls.reserve(MAX_BALLS);
+	frontVisionBalls.reserve(MAX_BALLS);
+
 }
 
 Integrator::~Integrator()
@@ -108,7 +112,7 @@ void Integrator::integrate()
 	double minXY = 10;
 
 	// Filter lines to vision
-	vector<Vec> lines;
+	lines.clear();
 	loadVision(USE_FRONT_VISION);
 	for(int i = 0 ; i < vision.lines.nPoints ; i++)
 		if( fabs(vision.lines.point[i].x) <= maxXY && fabs(vision.lines.point[i].y) <= maxXY )
@@ -143,9 +147,6 @@ void Integrator::integrate()
 	// TODO this must be set by coach
 	//player.number		= coach.playerInfo[myID].number;
 
-	// Clear lines
-	lines.clear();
-
 
 /////////////////////////////////////////////////////////////////////////////////////////////// UPDATE OTHER ROBOTS INFO
 	for( int i = 0 ; i < N_CAMBADAS ; i++ )
@@ -173,7 +174,7 @@ void Integrator::integrate()
 
 	// Filter valid balls by Vision
 	Ball visionBall;
-	vector<Ball> visionBalls;
+	visionBalls.clear();
 	for (int i = 0; i < vision.nBalls; i++ )
 	{
 		visionBall.posRel = vision.ball[i].position;
@@ -183,11 +184,11 @@ void Integrator::integrate()
 	}
 
 	// Filter valid balls by Vision
-	vector<BallFrontSensor> frontVisionBalls;
+	frontVisionBalls.clear();
 
 	// Get share ball (if exist)
-	Ball* shareBall = new Ball();
-	GetMultiRobotBall(shareBall);
+	Ball shareBall;
+	GetMultiRobotBall(&shareBall);
 
 	/*Keep the original relative position of the used vision ball (Only true while inside ball_integrate candidate 0 is always selected)*/
 	if (!visionBalls.empty())
@@ -196,7 +197,7 @@ void Integrator::integrate()
 	}
 
 	// Integrate info
-	integrate_ball->integrate(visionBalls,frontVisionBalls, shareBall, instant, world->grabberTouched(true));
+	integrate_ball->integrate(visionBalls,frontVisionBalls, &shareBall, instant, world->grabberTouched(true));
 
 	world->me->ball.pos 		= integrate_ball->getPosition();
 	world->me->ball.vel 		= integrate_ball->getVelocity();
@@ -213,11 +214,6 @@ void Integrator::integrate()
 				&& fabs( world->me->ball.posRel.angleFromY().get_deg_180() ) < BALL_ENGAGED_DEG);
 
 
-	// Clear aux data
-	delete shareBall;
-	visionBalls.clear();
-	frontVisionBalls.clear();
-
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////// UPDATE OBSTACLES
  	world->obstacles.clear();
@@ -227,7 +223,7 @@ void Integrator::integrate()
 	handleObstacle.buildAndUpdateObstacles(vision.obstacles.point, vision.obstacles.nPoints);
 
 //	world->obstacles = handleObstacle.getObstacles();
-	world->obstacles = handleObstacle.getTrackedObstacles();
+	handleObstacle.getTrackedObstacles(world->obstacles);
 	world->sharedObstacles = handleObstacle.getSharedObstacles();
 
 
@@ -238,8 +234,10 @@ void Integrator::integrate()
 	// GET last velocity command (used latter for WorldState Prediction)
 	CMD_Vel v;
 	DB_get( Whoami(),LAST_CMD_VEL,&v);
-	buffer.pop_front();
-	buffer.push_back(v);
+	if( !buffer.empty() ) {
+		rotate(buffer.begin(), buffer.begin()+1, buffer.end());	// Drop the oldest
+		buffer.back() = v;
+	}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////// STUCK TESTS
 
@@ -252,6 +250,8 @@ void Integrator::integrate()
 //////////////////////////////////////////////////////////////////////////////////////////////////////////// Close Cycle
 	gettimeofday( &instant , NULL );
 	world->timeStamp = instant.tv_sec*1000 + instant.tv_usec/1000;
+
+	world->freeze();											// World is complete for this cycle
 }
 
 void Integrator::loadVision(bool use_front_vision)
@@ -531,7 +531,7 @@ void Integrator::updateGameState()
 
 			// TODO Review this part of code, receiver probably does not set the flag
 			bool receiverTimeout = false;
-			vector<int> receiverList = world->getRoleIndex(rReceiver,true);
+			RobotIdxList receiverList = world->getRoleIndex(rReceiver,true);
 			for(unsigned int i=0; i < receiverList.size(); i++)
 			{
 				if(world->robot[receiverList[i]].coordinationFlag[0] == Ready)
@@ -540,7 +540,7 @@ void Integrator::updateGameState()
 				}
 			}
 
-			vector<int> strikerList = world->getRoleIndex(rStriker,true);
+			RobotIdxList strikerList = world->getRoleIndex(rStriker,true);
 
 			static unsigned long grabberTouchedLastTime;
 			if(world->grabberTouched(true))
@@ -560,7 +560,7 @@ void Integrator::updateGameState()
 				world->gameState = freePlay;
 			}
 
-			vector<int> replacers = world->getRoleIndex(rReplacer, true);
+			RobotIdxList replacers = world->getRoleIndex(rReplacer, true);
 			bool abortPass = false;
 			int currentReplacerIdx = -1;
 			Line passLine = Line::def;
@@ -618,7 +618,7 @@ void Integrator::updateGameState()
 bool Integrator::setPieceBallInCorridor()
 {
 	//get the id of the replacer
-	vector<int> replacerList = world->getRoleIndex( rReplacer , true );
+	RobotIdxList replacerList = world->getRoleIndex( rReplacer , true );
 	static Vec corridorStart;
 	static Vec corridorEnd;
 
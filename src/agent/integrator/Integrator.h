@@ -35,7 +35,8 @@
 #include "Field.h"
 #include "Clock.h"
 #include "Vec.h"
-#include <deque>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 
 //definitions for prediction calculus
@@ -102,7 +103,10 @@ private:
 	IntegrateBall*		integrate_ball;
 	ObstacleHandler		handleObstacle;
 	unsigned int 		cambadaInfoTTL[N_CAMBADAS];
-	deque<CMD_Vel> 		buffer;
+	vector<CMD_Vel> 	buffer;					// Last velocity commands (oldest first)
+	vector<Vec>			lines;					// Per cycle scratch, reserved once (no allocation while running)
+	vector<Ball>		visionBalls;
+	vector<BallFrontSensor>	frontVisionBalls;
 	int 				receiverIdxForCorridor;
 
 	void loadVision(bool use_front_vision);
@@ -59,7 +59,7 @@ public:
 	virtual void mirror() =0;
 
 	// Virtual integrate
-	virtual void integrate(vector<Vec> vision_lines, float lowLevelDx, float lowLevelDy, WSColor goalColor, bool firstTime) =0;
+	virtual void integrate(vector<Vec>& vision_lines, float lowLevelDx, float lowLevelDy, WSColor goalColor, bool firstTime) =0;
 
 	// Get function that return stuct
 	DATA_LOCALIZATION getResult(){ return this->data; }
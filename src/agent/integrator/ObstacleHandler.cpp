@@ -45,21 +45,22 @@ void ObstacleHandler::defineRtdbTime(unsigned int infoAge[], int length)
 		rtdbInfoAge[i] = infoAge[i];
 }
 
-vector<Obstacle> ObstacleHandler::getObstacles()
+const vector<Obstacle>& ObstacleHandler::getObstacles() const
 {
 	return obstacles;
 }
 
-vector<Obstacle> ObstacleHandler::getSharedObstacles()
+const vector<Obstacle>& ObstacleHandler::getSharedObstacles() const
 {
 	return sharedObstacles;
 }
 
-vector<Obstacle> ObstacleHandler::getTrackedObstacles()
+void ObstacleHandler::getTrackedObstacles(vector<Obstacle>& returnVector)
 {
-	vector<Obstacle> returnVector;
 	Obstacle temp;
 
+	returnVector.clear();
+
 	for (unsigned int i=0; i<identifiedMates.size(); i++)
 	{
 		returnVector.push_back( *(identifiedMates.at(i)) );
@@ -77,8 +78,6 @@ vector<Obstacle> ObstacleHandler::getTrackedObstacles()
 		temp.leftPoint=limitCenter.rotate_quarter(); //90 degrees
 		returnVector.push_back(temp);
 	}
-
-	return returnVector;
 }
 
 
@@ -93,13 +92,13 @@ void ObstacleHandler::identifyObstacles()
 //	struct timeval initTime;
 //  gettimeofday( &initTime , NULL );
 
-	vector<Obstacle*> singleObstacles;
 	vector<Obstacle*>::iterator obstIterator;
 	double obstDist, obstCoord;
 	
 	//Clear the vector of ordered obstacles from last cycle
 	orderedObstacles.clear();
 	identifiedMates.clear();
+	singleObstacles.clear();
 
 	/* Keep original obstacles size, so the new ones created don't change the counting.*/
 	unsigned int originalSize = obstacles.size();
@@ -398,7 +397,7 @@ void ObstacleHandler::identifyObstacles()
 	trackObstacles();
 
 	/*Check how many obstacles fullfilled the requisites and fill the obstacles rtdb*/
-	vector<Obstacle> trackedObstacles = getTrackedObstacles();
+	getTrackedObstacles(trackedObstacles);
 	unsigned int num_shared = trackedObstacles.size();
 	if ( num_shared > MAX_SHARED_OBSTACLES )
 		num_shared = MAX_SHARED_OBSTACLES;
@@ -422,8 +421,9 @@ void ObstacleHandler::identifyObstacles()
 /////////////////////////////////////////////////////////////////////////////*/
 void ObstacleHandler::mergeObstacles()
 {
-	vector<Obstacle> unconfirmedObstacles;
 	Obstacle temp;
+
+	unconfirmedObstacles.clear();
 	double maxStd = getErrorMargin(OBSTACLE_MAX_DISTANCE);
 
 	for ( int i = 0; i < N_CAMBADAS; i++ )
@@ -530,6 +530,16 @@ void ObstacleHandler::buildAndUpdateObstacles(Vec points[], int nPoints)
 	#define MERGE_CENTERS 0
 	obstacles.clear();
 	sharedObstacles.clear();
+	if( obstacles.capacity() < MAX_POINTS )
+	{
+		// reserved here (not in the constructor, the handler is copied): no reallocations while running,
+		// which also keeps the Obstacle pointers of identifyObstacles valid
+		obstacles.reserve(MAX_POINTS);
+		sharedObstacles.reserve(MAX_SHARED_OBSTACLES * N_CAMBADAS);
+		singleObstacles.reserve(MAX_POINTS);
+		unconfirmedObstacles.reserve(MAX_SHARED_OBSTACLES * N_CAMBADAS);
+		trackedObstacles.reserve(MAX_POINTS);
+	}
 //	globalObstacles.clear();
 
 	if (nPoints<=1)		//if there's only one point (or none), there are no obstacles to consider: return
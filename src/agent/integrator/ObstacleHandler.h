@@ -51,9 +51,9 @@ class ObstacleHandler
 
 		void defineRtdbTime(unsigned int infoAge[], int length = N_CAMBADAS);
 		void buildAndUpdateObstacles(geom::Vec points[], int nPoints);
-		vector<Obstacle> getObstacles();
-		vector<Obstacle> getTrackedObstacles();
-		vector<Obstacle> getSharedObstacles();
+		const vector<Obstacle>& getObstacles() const;
+		void getTrackedObstacles(vector<Obstacle>& returnVector);	// fills the caller's vector (keeps its capacity)
+		const vector<Obstacle>& getSharedObstacles() const;
 
 	private:
 		struct timeval currentTime;
@@ -65,6 +65,11 @@ class ObstacleHandler
 		vector<Obstacle*> orderedObstacles;
 		vector<Obstacle*> identifiedMates;
 
+		// Per cycle scratch, kept as members so their storage is reused
+		vector<Obstacle*> singleObstacles;
+		vector<Obstacle> unconfirmedObstacles;
+		vector<Obstacle> trackedObstacles;
+
 //		vector<Obstacle> globalObstacles;
 		vector<ObstaclePositionKalman> tracksList;
 
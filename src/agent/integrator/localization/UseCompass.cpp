@@ -55,7 +55,7 @@ void UseCompass::mirror()
 }
 
 // Function integrate
-void UseCompass::integrate(vector<Vec> vision_lines, float lowLevelDx, float lowLevelDy, WSColor goalColor, bool firstTime)
+void UseCompass::integrate(vector<Vec>& vision_lines, float lowLevelDx, float lowLevelDy, WSColor goalColor, bool firstTime)
 {
 	// Update compass values
 	updateCompass(goalColor);
@@ -45,7 +45,7 @@ public:
 	void mirror();
 
 	// Implement integrate method
-	void integrate(vector<Vec> vision_lines, float lowLevelDx, float lowLevelDy, WSColor goalColor, bool firstTime);
+	void integrate(vector<Vec>& vision_lines, float lowLevelDx, float lowLevelDy, WSColor goalColor, bool firstTime);
 
 private:
 	loc::CambadaLoc* loc;
@@ -42,8 +42,9 @@ using namespace std;
 using namespace cambada;
 
 Cambada* agent = NULL;
-bool EXIT = false;
-bool		WAIT	= true;
+volatile sig_atomic_t	EXIT		= false;
+volatile sig_atomic_t	ACTIVATED	= false;	// PMAN_ACTIVATE_SIG received (no PMAN)
+volatile sig_atomic_t	RECONFIGURE	= false;	// SIGHUP received
 char		pname[64]	= "agent";
 
 sigset_t configControlLoopSignals(void);
@@ -98,6 +99,10 @@ int main( int argc , char* argv[] )
 		fprintf(stderr, "cambada_agent : [%s]: PMAN_attach failed (return code %d)\n",pname,pmanstat);
 		exit(EXIT_FAILURE);
 	}
+
+	// Lock step simulation: time only advances between activations (pman_vclock)
+	if( PMAN_vclock() )
+		fprintf(stderr, "cambada_agent : [%s]: running on the PMAN virtual clock\n",pname);
 #endif
 
 	if( !EXIT )
@@ -112,17 +117,54 @@ int main( int argc , char* argv[] )
 		}
 	}
 
-	WAIT = false;
+	// The agent runs in the main loop, the signal handler only sets flags
 	while( !EXIT )
 	{
-	   sigsuspend(&sig7mask);
+#if USE_PMAN
+		int waitstat = PMAN_wait_activation(pname);
+		bool activated = (waitstat == 0);
+
+		if( waitstat == -1 )
+		{
+			// The process table is gone, nothing will activate us again
+			fprintf(stderr, "cambada_agent : [%s]: PMAN process table lost, exiting\n",pname);
+			EXIT = true;
+		}
+		else if( waitstat == -2 )
+		{
+			// Detached: wait a second and attach again
+			fprintf(stderr, "cambada_agent : [%s]: not in the PMAN process table, attaching again in one sec\n",pname);
+			sleep(1);
+			if( !EXIT && (pmanstat = PMAN_attach(pname,getpid())) != 0 )
+				fprintf(stderr, "cambada_agent : [%s]: PMAN_attach failed (return code %d)\n",pname,pmanstat);
+		}
+#else
+		sigsuspend(&sig7mask);
+		bool activated = ACTIVATED;
+		ACTIVATED = false;
+#endif
+		if( RECONFIGURE )
+		{
+			RECONFIGURE = false;
+			if( agent->reconfigure() )
+				EXIT = false;
+		}
+
+		if( activated && !EXIT )
+		{
+			agent->thinkAndAct();
+#if USE_PMAN
+			PMAN_epilogue(pname);
+#endif
+		}
 	}
 
 	CMD_Vel_SET(0.0,0.0,0.0,false);
 	CMD_Grabber_SET(0);
 
 #if USE_PMAN
-	// Release PMAN resources
+	// Report deadline misses and response times, then release PMAN resources
+	PMAN_print_stats(stderr);
 	PMAN_close(PMAN_CLLEAVE);
 #endif
 
@@ -145,35 +187,12 @@ int main( int argc , char* argv[] )
 
 void controlLoop(int sig )
 {
-
-	if( sig == SIGINT ) {
-		EXIT = true;
-	} else if( sig == SIGTERM ) {
-		EXIT = true;
-	}
-
-	if( WAIT )
-		return;
-
 	if( sig == PMAN_ACTIVATE_SIG )
-	{
-		agent->thinkAndAct();
-
-#if USE_PMAN
-		PMAN_epilogue(pname);
-#endif
-	}
-	else
-	if( sig == SIGHUP )
-	{
-		if( agent->reconfigure() )
-			EXIT = false;
-	}
+		ACTIVATED = true;
+	else if( sig == SIGHUP )
+		RECONFIGURE = true;
 	else
-	{
 		EXIT = true;
-	}
-
 }
 
 
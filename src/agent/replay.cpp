@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Offline replay of the agent decision pipeline.
+ *
+ * Feeds an RTDB recording (made with "agent --record <file>") to the same
+ * Cambada object used in the robot, one thinkAndAct per recorded cycle, with
+ * the recorded clock and fixed random seeds. For every cycle it outputs the
+ * commands produced (CMD_VEL, CMD_KICKER, CMD_GRABBER), the stage timings and
+ * the heap allocations of the cycle (0 once the agent reached steady state),
+ * so that two builds can be compared for both behaviour and performance.
+ * No PMAN, shared memory or root permissions are needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "Cambada.h"
+#include "rtdb_replay.h"
+
+using namespace std;
+using namespace cambada;
+
+struct StageStats {
+	long min, max;
+	double sum;
+};
+
+static void printHelp()
+{
+	fprintf(stdout,"Usage: agent_replay <recording> [options] [agent options]\n\n");
+	fprintf(stdout,"\t-o, --output <file>	per cycle output (default stdout)\n");
+	fprintf(stdout,"\t-n, --cycles <n>	replay at most n cycles\n\n");
+	fprintf(stdout,"The random generators are seeded with MTRAND_SEED (default 1).\n\n");
+}
+
+static void statsAdd( StageStats& s , long v , int n )
+{
+	if( n == 0 || v < s.min ) s.min = v;
+	if( n == 0 || v > s.max ) s.max = v;
+	s.sum += v;
+}
+
+int main( int argc , char* argv[] )
+{
+	if( argc < 2 || strcasecmp(argv[1] , "-h") == 0 || strcasecmp(argv[1] , "--help") == 0 ) {
+		printHelp();
+		return EXIT_FAILURE;
+	}
+
+	// MTRand objects are seeded during static initialization, so a fixed
+	// seed must be in the environment before the process starts
+	if( getenv("MTRAND_SEED") == NULL ) {
+		setenv("MTRAND_SEED", "1", 1);
+		execv("/proc/self/exe", argv);
+		perror("agent_replay: execv");
+		return EXIT_FAILURE;
+	}
+	srand(1);
+	srandom(1);
+
+	FILE* out = stdout;
+	long maxCycles = -1;
+	int agentArgc = 0;
+	char** agentArgv = new char*[argc];
+
+	for( int i = 2 ; i < argc ; i++ ) {
+		if( (strcasecmp(argv[i] , "-o") == 0 || strcasecmp(argv[i] , "--output") == 0) && i+1 < argc ) {
+			if( (out = fopen(argv[++i], "w")) == NULL ) {
+				perror("agent_replay: fopen");
+				return EXIT_FAILURE;
+			}
+		} else if( (strcasecmp(argv[i] , "-n") == 0 || strcasecmp(argv[i] , "--cycles") == 0) && i+1 < argc ) {
+			maxCycles = atol(argv[++i]);
+		} else {
+			agentArgv[agentArgc++] = argv[i];
+		}
+	}
+
+	if( DB_replay_open(argv[1]) != 0 || DB_init() != 0 ) {
+		fprintf(stderr,"agent_replay: unable to open recording %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	Cambada* agent = new Cambada();
+	if( !agent->parseArguments( agentArgc , agentArgv ) ) {
+		fprintf(stderr,"agent_replay: error parsing arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	fprintf(out,"cycle,time,vx,vy,va,kick,grabber,t_int,t_strat,t_maps,t_dec,t_cmd,t_total,allocs\n");
+
+	StageStats stats[7];
+	memset(stats, 0, sizeof(stats));
+	long cycle = 0;
+	int rc = 0;
+
+	while( (maxCycles < 0 || cycle < maxCycles) && (rc = DB_replay_next()) == 1 )
+	{
+		agent->thinkAndAct();
+
+		CMD_Vel vel;
+		CMD_Kicker kicker;
+		CMD_Grabber grabber;
+		DB_get(Whoami(), CMD_VEL, (void*)&vel);
+		DB_get(Whoami(), CMD_KICKER, (void*)&kicker);
+		DB_get(Whoami(), CMD_GRABBER, (void*)&grabber);
+
+		fprintf(out, "%ld,%lld,", cycle, DB_replay_time());
+		if( DB_replay_written(CMD_VEL) )	fprintf(out, "%.4f,%.4f,%.4f,", vel.vx, vel.vy, vel.va);
+		else								fprintf(out, "-,-,-,");
+		if( DB_replay_written(CMD_KICKER) )	fprintf(out, "%d,", kicker.power);
+		else								fprintf(out, "-,");
+		if( DB_replay_written(CMD_GRABBER) )	fprintf(out, "%d,", grabber.mode);
+		else								fprintf(out, "-,");
+
+		const CycleTimes& t = agent->getCycleTimes();
+		long stages[7] = { t.integrate , t.strategy , t.maps , t.decision , t.command , t.total , t.allocs };
+		for( int s = 0 ; s < 7 ; s++ ) {
+			statsAdd(stats[s], stages[s], cycle);
+			fprintf(out, (s < 6) ? "%ld," : "%ld\n", stages[s]);
+		}
+
+		cycle++;
+	}
+
+	if( out != stdout )
+		fclose(out);
+
+	const char* names[7] = { "integrate" , "strategy" , "maps" , "decision" , "command" , "total" , "allocs" };
+	fprintf(stderr, "\nagent_replay: %ld cycles\n", cycle);
+	fprintf(stderr, "%-10s %10s %10s %10s (us, allocs in count)\n", "stage", "min", "avg", "max");
+	for( int s = 0 ; s < 7 && cycle > 0 ; s++ )
+		fprintf(stderr, "%-10s %10ld %10.1f %10ld\n", names[s], stats[s].min, stats[s].sum / cycle, stats[s].max);
+
+	delete agent;
+	DB_replay_close();
+	delete[] agentArgv;
+
+	return (rc < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -21,6 +21,7 @@
  */
 
 #include "Role.h"
+#include "UtilityArbitrator.h"
 
 namespace cambada {
 
@@ -32,18 +33,26 @@ Strategy*		Role::strategy = NULL;
 
 Role::Role() {
 	roleRtti = rNone;
-	options = new CambadaArbitrator();
+	options = createArbitrator();
 }
 
 Role::Role(RoleID roleRtti) {
 	this->roleRtti = roleRtti;
-	options = new CambadaArbitrator();
+	options = createArbitrator();
 }
 
 Role::~Role() {
 	delete options;
 }
 
+CambadaArbitrator* Role::createArbitrator()
+{
+	if( config != NULL && config->existParam("utility_arbitration") && config->getParam("utility_arbitration") > 0 )
+		return new UtilityArbitrator();
+
+	return new CambadaArbitrator();
+}
+
 RoleID Role::getRoleRtti()
 {
 	return roleRtti;
@@ -55,6 +64,12 @@ void Role::run(DriveVector* dv)
 	options->calculate(dv);							// Calculate DriveVector and return it
 
 	world->me->behaviour = options->getRtti();	// Update current behaviour
+
+	BehaviourScores scores;
+	if( options->getScores(scores) ) {				// Publish why the option was chosen
+		scores.role = roleRtti;
+		DB_put(BEHAVIOUR_SCORES, (void*)&scores);
+	}
 }
 
 } /* namespace cambada */
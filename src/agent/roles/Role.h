@@ -81,6 +81,12 @@ protected:
 
 	RoleID		roleRtti;
 
+	/**
+	 * \brief Arbitrator for the options, UtilityArbitrator if the
+	 * "utility_arbitration" parameter is set, CambadaArbitrator otherwise
+	 */
+	static CambadaArbitrator* createArbitrator();
+
 	virtual void determineNextState()=0;
 
 public:
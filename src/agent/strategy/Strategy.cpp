@@ -109,9 +109,9 @@ void Strategy::exchange()
 		}
 	}
 
-	vector<int> runningFieldAgents(world->getRunningFieldRobotsIdx());
+	RobotIdxList runningFieldAgents(world->getRunningFieldRobotsIdx());
 
-	vector<int> bestPermutation(runningFieldAgents);
+	RobotIdxList bestPermutation(runningFieldAgents);
 	double bestGlobalDist = 1000.0;
 	do
 	{
@@ -124,7 +124,7 @@ void Strategy::exchange()
 		if (distTmp < bestGlobalDist)
 		{
 			bestGlobalDist = distTmp;
-			bestPermutation = vector<int>(runningFieldAgents);
+			bestPermutation = runningFieldAgents;
 		}
 	} while (next_permutation(runningFieldAgents.begin(),
 			runningFieldAgents.end()));
@@ -165,7 +165,7 @@ void Strategy::exchange(vector<Vec> positions, int gready)
 		}
 	}
 
-	vector<int> runningFieldAgents(world->getRunningFieldRobotsIdx());
+	RobotIdxList runningFieldAgents(world->getRunningFieldRobotsIdx());
 
 	for (int pos = 0; pos < gready; pos++)
 	{
@@ -197,7 +197,7 @@ void Strategy::exchange(vector<Vec> positions, int gready)
 			}
 		}
 	}
-	vector<int> bestPermutation(runningFieldAgents);
+	RobotIdxList bestPermutation(runningFieldAgents);
 	double bestGlobalDist = 1000.0;
 	do
 	{
@@ -210,7 +210,7 @@ void Strategy::exchange(vector<Vec> positions, int gready)
 		if (distTmp < bestGlobalDist)
 		{
 			bestGlobalDist = distTmp;
-			bestPermutation = vector<int>(runningFieldAgents);
+			bestPermutation = runningFieldAgents;
 		}
 	} while (next_permutation(runningFieldAgents.begin(),
 			runningFieldAgents.end()));
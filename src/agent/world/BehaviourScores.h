@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BEHAVIOURSCORES_H_
+#define BEHAVIOURSCORES_H_
+
+#define MAX_BEHAVIOUR_SCORES 12
+
+namespace cambada {
+
+/**
+ * \brief Scores of the options of the active role, published in the RTDB
+ * (BEHAVIOUR_SCORES) to see why an option was chosen
+ */
+struct BehaviourScores
+{
+	int role;								// RoleID of the active role
+	int chosen;								// index of the chosen option (-1 if none)
+	int nOptions;							// number of valid entries
+	int behaviour[MAX_BEHAVIOUR_SCORES];	// BehaviourID of each option
+	float score[MAX_BEHAVIOUR_SCORES];		// 0 if the option conditions do not hold
+};
+
+} /* namespace cambada */
+#endif /* BEHAVIOURSCORES_H_ */
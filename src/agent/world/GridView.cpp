@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridView.h"
+#include <cmath>
+#include <cstring>
+
+namespace cambada {
+
+/* Run-length coding: runs of [count (1 byte, 1..255)][symbol (bits/8 bytes, little endian)] */
+
+GridViewEncoder::GridViewEncoder(int bits, bool delta, int keyPeriod)
+{
+	this->bits = (bits == 16) ? 16 : 8;
+	this->delta = delta;
+	this->keyPeriod = (keyPeriod < 1) ? 1 : keyPeriod;
+
+	frame = 0;
+	keyFrame = 0;
+	keyBits = 0;
+	keyMin = keyMax = 0.0;
+}
+
+bool GridViewEncoder::pack(const std::vector<unsigned short>& symbols, int bits, GridView& gv)
+{
+	const int n = symbols.size();
+	const int symSize = bits / 8;
+
+	// Run-length coding first, it is smaller for smooth maps and deltas
+	int used = 0;
+	bool fits = true;
+	for( int i = 0 ; i < n && fits ; )
+	{
+		int run = 1;
+		while( i + run < n && run < 255 && symbols[i + run] == symbols[i] )
+			run++;
+
+		if( used + 1 + symSize > GRIDVIEW_DATA_SIZE || used + 1 + symSize >= n * symSize ) {
+			fits = false;
+			break;
+		}
+		gv.data[used++] = run;
+		gv.data[used++] = symbols[i] & 0xFF;
+		if( symSize == 2 )
+			gv.data[used++] = symbols[i] >> 8;
+		i += run;
+	}
+
+	if( fits ) {
+		gv.flags |= GRIDVIEW_RLE;
+		gv.dataSize = used;
+		return true;
+	}
+
+	// Raw values
+	if( n * symSize > GRIDVIEW_DATA_SIZE )
+		return false;
+
+	used = 0;
+	for( int i = 0 ; i < n ; i++ ) {
+		gv.data[used++] = symbols[i] & 0xFF;
+		if( symSize == 2 )
+			gv.data[used++] = symbols[i] >> 8;
+	}
+	gv.flags &= ~GRIDVIEW_RLE;
+	gv.dataSize = used;
+	return true;
+}
+
+void GridViewEncoder::encode(const float* values, int width, int length, float originX, float originY, float scale, GridView& gv)
+{
+	int n = width * length;
+	if( n > GRIDVIEW_MAX_CELLS ) {			// clip the grid length to the record size
+		length = GRIDVIEW_MAX_CELLS / width;
+		n = width * length;
+	}
+
+	float vMin = values[0], vMax = values[0];
+	for( int i = 1 ; i < n ; i++ ) {
+		if( values[i] < vMin ) vMin = values[i];
+		if( values[i] > vMax ) vMax = values[i];
+	}
+
+	frame++;
+
+	// New key frame when the deltas would not be valid (or are not wanted)
+	bool isKey = !delta || keyBits != bits || (int)key.size() != n
+			|| frame - keyFrame >= (unsigned int)keyPeriod
+			|| vMin < keyMin || vMax > keyMax;
+
+	int qBits = bits;
+	float qMin = isKey ? vMin : keyMin;
+	float qMax = isKey ? vMax : keyMax;
+
+	gv.frame = frame;
+	gv.originX = originX;
+	gv.originY = originY;
+	gv.scale = scale;
+	gv.width = width;
+	gv.length = length;
+
+	for( int attempt = 0 ; attempt < 2 ; attempt++ )
+	{
+		const unsigned int maxQ = (1u << qBits) - 1;
+		const float step = (qMax > qMin) ? (qMax - qMin) / maxQ : 1.0;
+
+		quantized.resize(n);
+		symbols.resize(n);
+		for( int i = 0 ; i < n ; i++ ) {
+			float q = floor((values[i] - qMin) / step + 0.5);
+			if( q < 0 ) q = 0;
+			if( q > maxQ ) q = maxQ;
+			quantized[i] = (unsigned short)q;
+			symbols[i] = isKey ? quantized[i] : ((quantized[i] - key[i]) & maxQ);
+		}
+
+		gv.refFrame = isKey ? frame : keyFrame;
+		gv.valMin = qMin;
+		gv.valMax = qMax;
+		gv.bits = qBits;
+		gv.flags = isKey ? 0 : GRIDVIEW_DELTA;
+
+		if( pack(symbols, qBits, gv) )
+			break;
+
+		// 16 bit values that do not compress enough: fall back to an 8 bit key frame
+		isKey = true;
+		qBits = 8;
+		qMin = vMin;
+		qMax = vMax;
+	}
+
+	if( isKey ) {
+		key = quantized;
+		keyFrame = frame;
+		keyBits = qBits;
+		keyMin = qMin;
+		keyMax = qMax;
+		if( qBits != bits )
+			keyBits = 0;			// force a new key frame with the requested bits
+	}
+}
+
+GridViewDecoder::GridViewDecoder()
+{
+	frame = 0;
+	valid = false;
+	keyFrame = 0;
+	haveKey = false;
+	width = length = 0;
+	originX = originY = scale = 0.0;
+	minVal = maxVal = 0.0;
+}
+
+bool GridViewDecoder::check(const GridView& gv)
+{
+	if( gv.bits != 8 && gv.bits != 16 )
+		return false;
+	if( gv.count() <= 0 || gv.count() > GRIDVIEW_MAX_CELLS || gv.dataSize > GRIDVIEW_DATA_SIZE )
+		return false;
+
+	if( gv.flags & GRIDVIEW_RLE ) {
+		const int runSize = 1 + gv.bits / 8;
+		if( gv.dataSize % runSize != 0 )
+			return false;
+		int cells = 0;
+		for( int i = 0 ; i < gv.dataSize ; i += runSize ) {
+			if( gv.data[i] == 0 )
+				return false;
+			cells += gv.data[i];
+		}
+		return cells == gv.count();
+	}
+
+	return gv.dataSize == gv.count() * (gv.bits / 8);
+}
+
+bool GridViewDecoder::unpack(const GridView& gv, std::vector<unsigned short>& symbols)
+{
+	if( !check(gv) )
+		return false;
+
+	const int symSize = gv.bits / 8;
+	symbols.resize(gv.count());
+
+	if( gv.flags & GRIDVIEW_RLE ) {
+		int c = 0;
+		for( int i = 0 ; i < gv.dataSize ; i += 1 + symSize ) {
+			unsigned short s = gv.data[i + 1];
+			if( symSize == 2 )
+				s |= gv.data[i + 2] << 8;
+			for( int r = 0 ; r < gv.data[i] ; r++ )
+				symbols[c++] = s;
+		}
+	} else {
+		for( int c = 0 ; c < gv.count() ; c++ ) {
+			unsigned short s = gv.data[c * symSize];
+			if( symSize == 2 )
+				s |= gv.data[c * symSize + 1] << 8;
+			symbols[c] = s;
+		}
+	}
+
+	return true;
+}
+
+bool GridViewDecoder::decode(const GridView& gv)
+{
+	if( valid && gv.frame == frame )
+		return true;							// already decoded
+
+	if( !unpack(gv, symbols) )
+		return false;
+
+	const int n = gv.count();
+	const unsigned int maxQ = (1u << gv.bits) - 1;
+
+	if( gv.flags & GRIDVIEW_DELTA ) {
+		if( !haveKey || gv.refFrame != keyFrame || (int)key.size() != n )
+			return false;						// key frame lost, wait for the next one
+		for( int i = 0 ; i < n ; i++ )
+			symbols[i] = (key[i] + symbols[i]) & maxQ;
+	} else {
+		key = symbols;
+		keyFrame = gv.frame;
+		haveKey = true;
+	}
+
+	const float step = (gv.valMax > gv.valMin) ? (gv.valMax - gv.valMin) / maxQ : 0.0;
+	values.resize(n);
+	minVal = maxVal = gv.valMin + symbols[0] * step;
+	for( int i = 0 ; i < n ; i++ ) {
+		values[i] = gv.valMin + symbols[i] * step;
+		if( values[i] < minVal ) minVal = values[i];
+		if( values[i] > maxVal ) maxVal = values[i];
+	}
+
+	frame = gv.frame;
+	valid = true;
+	width = gv.width;
+	length = gv.length;
+	originX = gv.originX;
+	originY = gv.originY;
+	scale = gv.scale;
+
+	return true;
+}
+
+} /* namespace cambada */
@@ -23,22 +23,119 @@
 #ifndef GRIDVIEW_H_
 #define GRIDVIEW_H_
 
+#include <vector>
 #include "Vec.h"
 
+#define GRIDVIEW_MAX_CELLS	4620	// 57x81 cells of the agent heightmaps (rounded up)
+#define GRIDVIEW_DATA_SIZE	GRIDVIEW_MAX_CELLS	// one byte per cell, the 8 bit raw frame always fits
+
+#define GRIDVIEW_DELTA		0x01	// values are differences to the reference key frame
+#define GRIDVIEW_RLE		0x02	// data is run-length coded
+
 namespace cambada{
 
-class CellVal
+/**
+ * \brief Compact heightmap published in the RTDB
+ *
+ * The cell positions are implied by the grid geometry (origin, scale and
+ * dimensions), the values are quantized to 8 or 16 bits in [valMin, valMax]
+ * and may be coded as differences to the last key frame and/or run-length
+ * coded. Cells are stored x major (index = x*length + y).
+ * Use GridViewEncoder and GridViewDecoder to write and read it.
+ */
+class GridView
 {
 public:
-	geom::Vec pos;
-	float val;
+	unsigned int frame;				// frame sequence number
+	unsigned int refFrame;			// key frame the deltas refer to (frame itself on key frames)
+	float originX, originY;			// world position of the center of cell (0,0)
+	float scale;					// cell size (m)
+	float valMin, valMax;			// quantization range
+	unsigned short width, length;	// number of cells in x and y
+	unsigned char bits;				// bits per quantized value (8 or 16)
+	unsigned char flags;			// GRIDVIEW_DELTA | GRIDVIEW_RLE
+	unsigned short dataSize;		// used bytes of data
+	unsigned char data[GRIDVIEW_DATA_SIZE];
+
+	int count() const { return width * length; }
+	geom::Vec pos(int x, int y) const { return geom::Vec(originX + x*scale, originY + y*scale); }
 };
 
-class GridView
+/**
+ * \brief Writes GridView frames, keeping the key frame used for delta coding
+ */
+class GridViewEncoder
+{
+public:
+	/**
+	 * \param bits quantization bits (8 or 16)
+	 * \param delta code frames as differences to the last key frame
+	 * \param keyPeriod maximum number of frames between key frames
+	 */
+	GridViewEncoder(int bits = 8, bool delta = true, int keyPeriod = 10);
+
+	/**
+	 * Encode width*length values (x major) into gv
+	 */
+	void encode(const float* values, int width, int length, float originX, float originY, float scale, GridView& gv);
+
+private:
+	bool pack(const std::vector<unsigned short>& symbols, int bits, GridView& gv);
+
+	int bits;
+	bool delta;
+	int keyPeriod;
+
+	unsigned int frame;
+	unsigned int keyFrame;
+	int keyBits;
+	float keyMin, keyMax;
+	std::vector<unsigned short> key;			// quantized key frame
+	std::vector<unsigned short> quantized;		// work buffers
+	std::vector<unsigned short> symbols;
+};
+
+/**
+ * \brief Reads GridView frames of one publisher
+ */
+class GridViewDecoder
 {
 public:
-	int count;
-	CellVal grid[5000];
+	GridViewDecoder();
+
+	/**
+	 * Decode a frame
+	 * \return false if the frame is invalid or its key frame was not received
+	 */
+	bool decode(const GridView& gv);
+
+	/**
+	 * Check the frame header and coded data without decoding the values
+	 */
+	static bool check(const GridView& gv);
+
+	unsigned int getFrame() const { return frame; }
+	int getWidth() const { return width; }
+	int getLength() const { return length; }
+	int count() const { return width * length; }
+	float getVal(int i) const { return values[i]; }
+	geom::Vec pos(int i) const { return geom::Vec(originX + (i / length)*scale, originY + (i % length)*scale); }
+	float getMinVal() const { return minVal; }
+	float getMaxVal() const { return maxVal; }
+
+private:
+	static bool unpack(const GridView& gv, std::vector<unsigned short>& symbols);
+
+	unsigned int frame;
+	bool valid;
+	unsigned int keyFrame;
+	bool haveKey;
+	int width, length;
+	float originX, originY, scale;
+	float minVal, maxVal;
+	std::vector<unsigned short> key;
+	std::vector<unsigned short> symbols;
+	std::vector<float> values;
 };
 
 }
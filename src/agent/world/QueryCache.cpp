@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "QueryCache.h"
+#include <string.h>
+
+namespace cambada {
+
+QueryCache::QueryCache()
+{
+	memset(entries, 0, sizeof(entries));
+	generation = 1;
+	used = 0;
+	active = false;
+	hits = misses = 0;
+}
+
+void QueryCache::setActive(bool active)
+{
+	this->active = active;
+	generation++;					// drop every entry
+	used = 0;
+}
+
+QueryCache::Entry* QueryCache::find(int query, const float* args, int nArgs, bool& found)
+{
+	// FNV-1a hash of the query id and the arguments bits
+	unsigned int h = 2166136261u;
+	h = (h ^ query) * 16777619u;
+	for( int i = 0 ; i < nArgs ; i++ ) {
+		unsigned int bits;
+		memcpy(&bits, &args[i], sizeof(bits));
+		h = (h ^ bits) * 16777619u;
+	}
+
+	// Linear probing
+	for( int p = 0 ; p < QUERY_CACHE_SIZE ; p++ ) {
+		Entry* e = &entries[(h + p) & (QUERY_CACHE_SIZE - 1)];
+		if( e->generation != generation ) {
+			found = false;
+			return e;
+		}
+		if( e->query == query && e->nArgs == nArgs && memcmp(e->args, args, nArgs * sizeof(float)) == 0 ) {
+			found = true;
+			return e;
+		}
+	}
+
+	found = false;
+	return NULL;
+}
+
+bool QueryCache::lookup(int query, const float* args, int nArgs, float& result)
+{
+	if( !active || nArgs > QUERY_CACHE_MAX_ARGS )
+		return false;
+
+	bool found;
+	Entry* e = find(query, args, nArgs, found);
+	if( !found ) {
+		misses++;
+		return false;
+	}
+
+	hits++;
+	result = e->result;
+	return true;
+}
+
+void QueryCache::store(int query, const float* args, int nArgs, float result)
+{
+	// Keep the table at most half full so that the probes stay short
+	if( !active || nArgs > QUERY_CACHE_MAX_ARGS || used >= QUERY_CACHE_SIZE / 2 )
+		return;
+
+	bool found;
+	Entry* e = find(query, args, nArgs, found);
+	if( e == NULL )
+		return;
+
+	if( !found ) {
+		e->generation = generation;
+		e->query = query;
+		e->nArgs = nArgs;
+		memcpy(e->args, args, nArgs * sizeof(float));
+		used++;
+	}
+	e->result = result;
+}
+
+} /* namespace cambada */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA AGENT
+ *
+ * CAMBADA AGENT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA AGENT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUERYCACHE_H_
+#define QUERYCACHE_H_
+
+#define QUERY_CACHE_SIZE		512		// must be a power of 2
+#define QUERY_CACHE_MAX_ARGS	8
+
+namespace cambada {
+
+/**
+ * Ids of the WorldState queries that are memoized
+ */
+enum WorldQueryID
+{
+	qLineClear,
+	qObstaclesInFront,
+	qObstaclesToTheirGoal,
+	qTeamEngaged,
+	qBallVisible
+};
+
+/**
+ * \brief Per cycle memoization of WorldState queries
+ *
+ * Results are keyed by the query id and its arguments. The cache is only
+ * active while the world state is frozen (from the end of the integration
+ * until WorldState::updateEndCycle), and clearing it is O(1).
+ */
+class QueryCache
+{
+public:
+	QueryCache();
+
+	void setActive(bool active);
+	bool isActive() const { return active; }
+
+	/**
+	 * \return true and fills result if the query was already evaluated in this cycle
+	 */
+	bool lookup(int query, const float* args, int nArgs, float& result);
+	void store(int query, const float* args, int nArgs, float result);
+
+	unsigned int hits;				// statistics since the start
+	unsigned int misses;
+
+private:
+	struct Entry {
+		unsigned int generation;	// entry valid if equal to the cache generation
+		int query;
+		int nArgs;
+		float args[QUERY_CACHE_MAX_ARGS];
+		float result;
+	};
+
+	Entry* find(int query, const float* args, int nArgs, bool& found);
+
+	Entry entries[QUERY_CACHE_SIZE];
+	unsigned int generation;
+	int used;
+	bool active;
+};
+
+} /* namespace cambada */
+#endif /* QUERYCACHE_H_ */
@@ -153,7 +153,7 @@ Vec WorldState::getAvoidAdjustedPosition(Vec targetRel, bool moveFree, bool avBa
 	}
 
 	//WARNING WORKS WITH RELATIVE TARGET
-	vector<Vec> obstaclesToAvoid;
+	obstaclesToAvoid.clear();
 	double avObstBallDist = 1.0;
 	double maxSonarDist, robotCenterOffset;
 
@@ -209,7 +209,7 @@ Vec WorldState::getAvoidAdjustedPosition(Vec targetRel, bool moveFree, bool avBa
 
 		}
 
-		vector<int> runningFieldRobots = getRunningFieldRobotsIdx();
+		RobotIdxList runningFieldRobots = getRunningFieldRobotsIdx();
 		for( unsigned int i = 0 ; i < runningFieldRobots.size() ; i++ )
 		{
 			int tmpIdx = runningFieldRobots[i];
@@ -346,6 +346,17 @@ Vec WorldState::getBestBallAbs(bool restrictToVisible) const
 }
 
 bool WorldState::isBallVisible() const
+{
+	float visible;
+	if( queryCache.lookup(qBallVisible, NULL, 0, visible) )
+		return visible != 0.0;
+
+	bool result = calcBallVisible();
+	queryCache.store(qBallVisible, NULL, 0, result);
+	return result;
+}
+
+bool WorldState::calcBallVisible() const
 {
 	for (int i = 0; i < N_CAMBADAS; i++)
 		if (robot[i].ball.visible && robot[i].running)
@@ -353,9 +364,9 @@ bool WorldState::isBallVisible() const
 	return false;
 }
 
-vector<int> WorldState::getRunningFieldRobotsIdx()
+RobotIdxList WorldState::getRunningFieldRobotsIdx()
 {
-	vector<int> runningRobots;
+	RobotIdxList runningRobots;
 	for( int i = 0 ; i < N_CAMBADAS ; i++ )
 		if( robot[i].running  && robot[i].role != rGoalie )
 			runningRobots.push_back(i);
@@ -374,9 +385,9 @@ int WorldState::getNumberOfRunningFieldRobots()
 	return numberOfRunningFieldRobots;
 }
 
-vector<int> WorldState::getRoleIndex( RoleID role , bool meIncluded )
+RobotIdxList WorldState::getRoleIndex( RoleID role , bool meIncluded )
 {
-	vector<int> idxRole;
+	RobotIdxList idxRole;
 
 	for( int i = 0 ; i < N_CAMBADAS ; i++ ){
 		if( meIncluded  || (i+1 != me->number) ){
@@ -474,9 +485,26 @@ void WorldState::update()
 void WorldState::updateEndCycle() {
 	lastCycleEngaged = me->ball.engaged;
 	lastCycleVisible = me->ball.visible;
+
+	queryCache.setActive(false);		// the world will change, drop the memoized queries
+}
+
+void WorldState::freeze() {
+	queryCache.setActive(true);
 }
 
 bool WorldState::isTeamEngaged()
+{
+	float engaged;
+	if( queryCache.lookup(qTeamEngaged, NULL, 0, engaged) )
+		return engaged != 0.0;
+
+	bool result = calcTeamEngaged();
+	queryCache.store(qTeamEngaged, NULL, 0, result);
+	return result;
+}
+
+bool WorldState::calcTeamEngaged()
 {
 	for( int i = 1 ; i < N_CAMBADAS ; i++ )
 		if( robot[i].running && robot[i].ball.engaged )
@@ -486,6 +514,18 @@ bool WorldState::isTeamEngaged()
 }
 
 float WorldState::lineClear( Vec origin, Vec destination, int indexToIgnore, float obsIgnoreDist, int robotIdx)
+{
+	float args[7] = { origin.x, origin.y, destination.x, destination.y, (float)indexToIgnore, obsIgnoreDist, (float)robotIdx };
+	float clear;
+	if( queryCache.lookup(qLineClear, args, 7, clear) )
+		return clear;
+
+	clear = calcLineClear(origin, destination, indexToIgnore, obsIgnoreDist, robotIdx);
+	queryCache.store(qLineClear, args, 7, clear);
+	return clear;
+}
+
+float WorldState::calcLineClear( Vec origin, Vec destination, int indexToIgnore, float obsIgnoreDist, int robotIdx)
 {
 	Vec intersect;
 	destination = (destination - origin).setLength((destination - origin).length() + 0.4) + origin;
@@ -713,6 +753,16 @@ bool WorldState::isBallGoingInMyDirection(double angle)
 }
 
 bool WorldState::obstaclesInFront(float distance) {
+	float inFront;
+	if( queryCache.lookup(qObstaclesInFront, &distance, 1, inFront) )
+		return inFront != 0.0;
+
+	bool result = calcObstaclesInFront(distance);
+	queryCache.store(qObstaclesInFront, &distance, 1, result);
+	return result;
+}
+
+bool WorldState::calcObstaclesInFront(float distance) {
 
 	float robotCenter2grabber = 0.15; // not less than 10 cm
 
@@ -738,6 +788,17 @@ bool WorldState::obstaclesInFront(float distance) {
 }
 
 bool WorldState::obstaclesToTheirGoal(float distance, Vec position) {
+	float args[3] = { distance, position.x, position.y };
+	float toGoal;
+	if( queryCache.lookup(qObstaclesToTheirGoal, args, 3, toGoal) )
+		return toGoal != 0.0;
+
+	bool result = calcObstaclesToTheirGoal(distance, position);
+	queryCache.store(qObstaclesToTheirGoal, args, 3, result);
+	return result;
+}
+
+bool WorldState::calcObstaclesToTheirGoal(float distance, Vec position) {
 
 	float robotCenter2grabber = 0.15; // not less than 10 cm
 
@@ -799,7 +860,7 @@ void WorldState::calcMaps()
 
 	if(me->role == rStriker)
 	{
-		vector<int> receivers = getRoleIndex(rMidfielder,false);		// Get midfielder list
+		RobotIdxList receivers = getRoleIndex(rMidfielder,false);		// Get midfielder list
 		for(unsigned int i = 0; i < receivers.size(); i++)
 		{
 			if( robot[receivers.at(i)].coordinationFlag[0] == LineClear
@@ -1183,7 +1244,7 @@ bool WorldState::isBallPassedToMe()
 {
 	coordinationType search = (coordinationType)(BallPassed0 + getMyIdx());
 
-	vector<int> passers;
+	RobotIdxList passers;
 	if(me->role == rMidfielder)
 		passers = getRoleIndex(rStriker, false);
 	else
@@ -38,9 +38,13 @@
 #include "Field.h"
 #include "Robot.h"
 #include "Sonar.h"
+#include "QueryCache.h"
+#include "FixedVector.h"
 
 namespace cambada {
 
+typedef util::FixedVector<int, N_CAMBADAS> RobotIdxList;	// Robot indexes, filled without allocating
+
 /**
  * Class to maintain information on the state of the world,
  * either robot information (own and others), game state, obstacles,
@@ -154,9 +158,9 @@ public:
 
 	/**
 	 * Gets a vector of indexes for all running robots, excluding the goalie
-	 * \return a vector of robot's Idx (starting from 0)
+	 * \return a list of robot's Idx (starting from 0)
 	 */
-	vector<int> getRunningFieldRobotsIdx();
+	RobotIdxList getRunningFieldRobotsIdx();
 
 	/**
 	 * \return the number of running robots in field
@@ -166,9 +170,9 @@ public:
 	/** Checks for a teammate with a given role
 	 * \param role the role id we wish to search for
 	 * \param meIncluded if true include me in the list
-	 * \return a vector of indexes of teammates with the given role active (empty if none has the role)
+	 * \return a list of indexes of teammates with the given role active (empty if none has the role)
 	 */
-	vector<int> getRoleIndex(RoleID role, bool meIncluded=false);
+	RobotIdxList getRoleIndex(RoleID role, bool meIncluded=false);
 
 	/**
 	 * Returns a Robot object with specified number
@@ -224,6 +228,18 @@ public:
 	void update();
 	void updateEndCycle();
 
+	/**
+	 * Marks the end of the integration: the world state is not changed until
+	 * updateEndCycle(), so the queries (lineClear, obstaclesInFront, ...) are
+	 * memoized until then
+	 */
+	void freeze();
+
+	/**
+	 * Query cache statistics
+	 */
+	const QueryCache& getQueryCache() const { return queryCache; }
+
 	Vec getScalingFactor();
 
 	double getGoalSideOffset(double dist);
@@ -282,6 +298,14 @@ private:
 
 	void ok2kick_update();
 
+	mutable QueryCache queryCache;	/*!< Per cycle memoized queries, see freeze()*/
+	vector<Vec> obstaclesToAvoid;	/*!< getAvoidAdjustedPosition scratch, its storage is reused between calls*/
+
+	float calcLineClear( Vec origin, Vec destiny, int indexToIgnore, float obsIgnoreDist, int robotIdx);
+	bool calcObstaclesInFront(float distance);
+	bool calcObstaclesToTheirGoal(float distance, Vec position);
+	bool calcTeamEngaged();
+	bool calcBallVisible() const;
 };
 
 } /* namespace cambada */
@@ -343,10 +343,11 @@ enum BehaviourID
 	bBlock,
 	bRelieve,
 	bTour,
-	bTouchBall
+	bTouchBall,
+	bKickCalibrate
 };
 
-static const int num_behaviours = 25;
+static const int num_behaviours = 26;
 static const char behaviour_names [num_behaviours][16] = 
 {
 	"bNoBehaviour   ",
@@ -373,7 +374,8 @@ static const char behaviour_names [num_behaviours][16] =
 	"bBlock         ",
 	"bRelieve       ",
 	"bTour          ",
-	"bTouch         "
+	"bTouch         ",
+	"bKickCalibrate "
 };
 
 enum coordinationType
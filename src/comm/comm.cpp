@@ -39,6 +39,8 @@
 #include "multicast.h"
 
 #include "rtdb_comm.h"
+#include "pman.h"
+#include "pmandefs.h"
 
 #include "MersenneTwister.h"
 
@@ -85,6 +87,8 @@
 #define NO	0
 #define YES	1
 
+#define FRAGMENT_RECS	-1		// noRecs of a datagram carrying a fragment of one record
+
 int end;
 int timer;
 
@@ -93,6 +97,7 @@ int MAX_DELTA;
 struct timeval lastSendTimeStamp;
 int delay;
 int nosend;
+int pmanAttached;
 
 #ifdef DEBUF
 #endif
@@ -115,6 +120,29 @@ struct _frameHeader
 	int noRecs;						        // number of records
 };
 
+// Records that don't fit in the TDMA frame follow it in their own
+// datagrams, each with the frame header and a fragment of the record
+struct _fragmentHeader
+{
+	int id;								// record id
+	int size;							// record size
+	int life;							// record life time
+	int offset;							// position of the fragment in the record
+	int length;							// fragment bytes in this datagram
+};
+
+#define FRAGMENT_DATA (BUFFER_SIZE - (int)sizeof(struct _frameHeader) - (int)sizeof(struct _fragmentHeader))
+
+// Record being reassembled from the fragments of an agent
+struct _reassembly
+{
+	int id;
+	unsigned int counter;				// frame the fragments belong to
+	int received;						// bytes received
+	int capacity;
+	char *data;
+};
+
 struct _agent
 {
 	char state;							          // current state
@@ -134,6 +162,8 @@ struct _agent agent[MAX_AGENTS];
 
 int RUNNING_AGENTS;
 
+struct _reassembly reassembly[MAX_AGENTS];
+
 
 //	*************************
 //  Signal catch
@@ -282,6 +312,66 @@ void update_stateTable(void)
 
 
 
+// *************************
+//  Receive Fragment: add a fragment to the record being reassembled and
+//  write the record when it is complete
+//
+//  Input:
+//    int agentNumber = sender
+//    unsigned int counter = frame counter of the sender
+//    char *data = fragment header and data
+//    int len = bytes in data
+//
+void receiveFragment(int agentNumber, unsigned int counter, char *data, int len)
+{
+	struct _fragmentHeader fragment;
+	struct _reassembly *r = &reassembly[agentNumber];
+	int size;
+
+	if (len < (int)sizeof(fragment))
+		return;
+	memcpy(&fragment, data, sizeof(fragment));
+
+	if ((fragment.size <= 0) || (fragment.offset < 0) || (fragment.length <= 0)
+			|| (fragment.length > len - (int)sizeof(fragment)) || (fragment.offset + fragment.length > fragment.size))
+		return;
+
+	// a new record (or a lost fragment of the previous one)
+	if ((fragment.offset == 0) || (r->id != fragment.id) || (r->counter != counter))
+	{
+		if (fragment.offset != 0)
+			return;
+		if (r->capacity < fragment.size)
+		{
+			free(r->data);
+			r->data = (char*)malloc(fragment.size);
+			r->capacity = (r->data != NULL) ? fragment.size : 0;
+			if (r->data == NULL)
+				return;
+		}
+		r->id = fragment.id;
+		r->counter = counter;
+		r->received = 0;
+	}
+
+	// in order only
+	if (fragment.offset != r->received)
+		return;
+
+	memcpy(r->data + fragment.offset, data + sizeof(fragment), fragment.length);
+	r->received += fragment.length;
+
+	if (r->received == fragment.size)
+	{
+		if((size = DB_comm_put (agentNumber, fragment.id, fragment.size, r->data, fragment.life + COMM_DELAY_MS)) != fragment.size)
+			PERR("Error in fragment/rtdb: from = %d, item = %d, received size = %d, local size = %d", agentNumber, fragment.id, fragment.size, size);
+		r->received = 0;
+		r->id = -1;
+	}
+}
+
+
+
 // *************************
 //  Receive Thread
 //
@@ -315,6 +405,17 @@ void *receiveDataThread(void *arg)
 
 			agentNumber = frameHeader.number;
 
+			if ((agentNumber < 0) || (agentNumber >= MAX_AGENTS))
+				continue;
+
+			// fragments of large records don't take part in the TDMA
+			if (frameHeader.noRecs == FRAGMENT_RECS)
+			{
+				if (agentNumber != myNumber)
+					receiveFragment(agentNumber, frameHeader.counter, recvBuffer + indexBuffer, recvLen - indexBuffer);
+				continue;
+			}
+
       gettimeofday(&(agent[agentNumber].receiveTimeStamp), NULL);
 
       // receive from ourself
@@ -322,6 +423,8 @@ void *receiveDataThread(void *arg)
   		if ((agentNumber == myNumber) && (nosend == 0))
 				continue;
 
+			PMAN_span_begin("comm_recv");
+
 			// TODO
       // correction when frameCounter overflows
 			if ((agent[agentNumber].lastFrameCounter + 1) != frameHeader.counter)
@@ -363,6 +466,7 @@ void *receiveDataThread(void *arg)
 			sync_ratdma(agentNumber);
 #endif
 
+			PMAN_span_end("comm_recv");
 		}
 	}
 
@@ -389,6 +493,11 @@ int main(int argc, char *argv[])
 	int indexBuffer;
 	int sharedRecs;
 	RTDBconf_var rec[MAX_RECS];
+	int fragmented[MAX_RECS];
+	int noFragmented;
+	char *recordBuffer;
+	int recordSize;
+	struct _fragmentHeader fragment;
 	unsigned int frameCounter = 0;
 	int i, j;
 	int life;
@@ -469,6 +578,19 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	/* buffer of the records sent in fragments */
+	recordSize = 0;
+	for (i = 0; i < sharedRecs; i++)
+		if (rec[i].size > recordSize)
+			recordSize = rec[i].size;
+	if ((recordBuffer = (char*)malloc(recordSize)) == NULL)
+	{
+		PERRNO("malloc");
+		DB_free();
+		closeSocket(sckt);
+		return -1;
+	}
+
 #ifdef FILEDEBUG
 	if ((filedebug = fopen("log.txt", "w")) == NULL)
 	{
@@ -486,10 +608,19 @@ int main(int argc, char *argv[])
 		agent[i].lastFrameCounter = 0;
 		agent[i].state = NOT_RUNNING;
 		agent[i].removeCounter = 0;
+		reassembly[i].id = -1;
+		reassembly[i].counter = 0;
+		reassembly[i].received = 0;
+		reassembly[i].capacity = 0;
+		reassembly[i].data = NULL;
 	}
 	myNumber = Whoami();
 	agent[myNumber].state = RUNNING;
 
+	/* PMAN table of the agent, only for the trace spans (comm is not activated by PMAN) */
+	pmanAttached = (getenv("AGENT") != NULL
+			&& PMAN_init(SHMEM_OCAM_PMAN_KEY, SEM_OCAM_PMAN_KEY, NULL, 0, PMAN_ATTACH) == 0);
+
 	/* receive thread */
 	pthread_attr_init (&thread_attr);
 	pthread_attr_setinheritsched (&thread_attr, PTHREAD_INHERIT_SCHED);
@@ -541,6 +672,8 @@ int main(int argc, char *argv[])
 
 		timer = 0;
 
+		PMAN_span_begin("comm_send");
+
 		indexBuffer = 0;
 		bzero(sendBuffer, BUFFER_SIZE);
 
@@ -567,12 +700,20 @@ int main(int argc, char *argv[])
 		frameCounter ++;
 		for (i = 0; i < MAX_AGENTS; i++)
 			frameHeader.stateTable[i] = agent[myNumber].stateTable[i];
-		frameHeader.noRecs = sharedRecs;
-		memcpy(sendBuffer + indexBuffer, &frameHeader, sizeof(frameHeader));
+		frameHeader.noRecs = 0;
 		indexBuffer += sizeof(frameHeader);
+		noFragmented = 0;
 
 		for(i = 0; i < sharedRecs; i++)
 		{
+			// records that don't fit in what is left of the frame are sent apart
+			if (indexBuffer + (int)(sizeof(rec[i].id) + sizeof(rec[i].size) + sizeof(life)) + rec[i].size > BUFFER_SIZE)
+			{
+				fragmented[noFragmented++] = i;
+				continue;
+			}
+			frameHeader.noRecs++;
+
 			// id
 			memcpy(sendBuffer + indexBuffer, &rec[i].id, sizeof(rec[i].id));
 			indexBuffer += sizeof(rec[i].id);
@@ -586,20 +727,44 @@ int main(int argc, char *argv[])
 			memcpy(sendBuffer + indexBuffer, &life, sizeof(life));
 			indexBuffer = indexBuffer + sizeof(life) + rec[i].size;
 		}
-
-		if (indexBuffer > BUFFER_SIZE)
-		{
-			PERR("Pretended frame is bigger that the available buffer.");
-			PERR("Please increase the buffer size or reduce the number of disseminated records");
-			break;
-		}
+		memcpy(sendBuffer, &frameHeader, sizeof(frameHeader));
 	
 		if (nosend == 0) 
 		{
 			if (sendData(sckt, sendBuffer, indexBuffer) != indexBuffer)
 				PERRNO("Error sending data");
+
+			// large records, every period frames, right after the frame in our slot
+			frameHeader.noRecs = FRAGMENT_RECS;
+			for (j = 0; j < noFragmented; j++)
+			{
+				i = fragmented[j];
+				if ((rec[i].period > 1) && ((frameCounter - 1) % rec[i].period != 0))
+					continue;
+
+				fragment.id = rec[i].id;
+				fragment.size = rec[i].size;
+				fragment.life = DB_get(myNumber, rec[i].id, recordBuffer);
+
+				for (fragment.offset = 0; fragment.offset < fragment.size; fragment.offset += fragment.length)
+				{
+					fragment.length = fragment.size - fragment.offset;
+					if (fragment.length > FRAGMENT_DATA)
+						fragment.length = FRAGMENT_DATA;
+
+					memcpy(sendBuffer, &frameHeader, sizeof(frameHeader));
+					memcpy(sendBuffer + sizeof(frameHeader), &fragment, sizeof(fragment));
+					memcpy(sendBuffer + sizeof(frameHeader) + sizeof(fragment), recordBuffer + fragment.offset, fragment.length);
+					indexBuffer = sizeof(frameHeader) + sizeof(fragment) + fragment.length;
+
+					if (sendData(sckt, sendBuffer, indexBuffer) != indexBuffer)
+						PERRNO("Error sending data");
+				}
+			}
 		}
 
+		PMAN_span_end("comm_send");
+
 		gettimeofday (&tempTimeStamp, NULL);
 		lastSendTimeStamp.tv_sec = tempTimeStamp.tv_sec;
 		lastSendTimeStamp.tv_usec = tempTimeStamp.tv_usec;
@@ -627,6 +792,13 @@ int main(int argc, char *argv[])
 
 	pthread_join(recvThread, NULL);
 
+	free(recordBuffer);
+	for (i=0; i<MAX_AGENTS; i++)
+		free(reassembly[i].data);
+
+	if (pmanAttached)
+		PMAN_close(PMAN_CLLEAVE);
+
 	DB_free();
 
 	printf("communication: FINISHED.\n");
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdio.h> 
 #include <string.h>
+#include <limits.h>
 
 // For POSIX support flags
 #include <unistd.h>
@@ -38,10 +39,13 @@
 
 #include <signal.h>
 #include <sched.h>
+#include <pthread.h>
 
 #include <errno.h>
 
-#include <sem_utils.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
 #include <pman.h>
 
 #include <assert.h>
@@ -57,7 +61,7 @@
 /* 
  * Global vars
  */
-int pman_sem_id;                // Semaphore ID (mutual exclusion)
+int pman_sem_id = -1;           // Semaphore ID (unused, the table has its own mutex)
 int pman_shmem_id;              // Shared memory ID
 PROC_TABLE_TYPE * p_table; // Process table
 
@@ -65,21 +69,282 @@ int pamn_sem_id_LUT[ MAX_MASTER_INSTANCE ];                 // sempahore id look
 int pamn_shmem_id_LUT[ MAX_MASTER_INSTANCE ];               // shared memory id look up table
 PROC_TABLE_TYPE* pman_p_table_LUT[ MAX_MASTER_INSTANCE ];   // proc table address look up table
 
+/* Pending QoS update (PROC_qosupdflag) */
+#define PMAN_QOSUPD_NONE	0	// Nothing to apply
+#define PMAN_QOSUPD_ONACT	1	// Apply on the next activation
+#define PMAN_QOSUPD_ONTICK	2	// Apply on the next tick (immediate update requested outside the "manager")
+
+static int pman_act_index = PMAN_NOINDEX;   // Table index of this process (PMAN_wait_activation)
+static unsigned int pman_act_seen;          // Last activation consumed by this process
+
+
+/*
+ * Mutual exclusion on the process table. The mutex is robust: if a process
+ * dies holding it, the next locker recovers it instead of blocking forever
+ * (the SysV semaphore relied on SEM_UNDO for the same purpose).
+ */
+static void pman_lock(void)
+{
+	if(pthread_mutex_lock(&p_table->lock) == EOWNERDEAD)
+		pthread_mutex_consistent(&p_table->lock);
+}
+
+static void pman_unlock(void)
+{
+	pthread_mutex_unlock(&p_table->lock);
+}
+
+/*
+ * Deadline monitoring helpers
+ */
+static int pman_elapsed_us(const struct timeval *from, const struct timeval *to)
+{
+	return (to->tv_sec - from->tv_sec)*1000000 + (to->tv_usec - from->tv_usec);
+}
+
+static void pman_stats_reset(PROC_TYPE *proc)
+{
+	proc->PROC_ddln_policy = PMAN_DDLN_COUNT;
+	proc->PROC_ddln_flag = 0;
+	proc->PROC_ddln_pend = 0;
+	proc->PROC_skip = 0;
+	proc->PROC_nskip = 0;
+
+	proc->PROC_rt_last = 0;
+	proc->PROC_rt_min = 0;
+	proc->PROC_rt_max = 0;
+	proc->PROC_rt_sum = 0;
+	proc->PROC_rt_n = 0;
+	memset(proc->PROC_rt_hist, 0, sizeof(proc->PROC_rt_hist));
+}
+
+static int pman_futex(unsigned int *uaddr, int op, unsigned int val)
+{
+	/* not FUTEX_PRIVATE_FLAG: the word is in shared memory, mapped at different addresses */
+	return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+/*
+ * Wall clock. Not gettimeofday, which the clients running on the virtual
+ * clock override (pman_vclock.c): activation, response times and traces must
+ * be comparable between the "manager" and the clients in any case.
+ */
+static void pman_now(struct timeval *tv)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	tv->tv_sec = ts.tv_sec;
+	tv->tv_usec = ts.tv_nsec / 1000;
+}
+
+
+#ifdef PMAN_TRACE
+/*
+ * Trace helpers
+ */
+static __thread PROC_TABLE_TYPE *pman_span_table;  // Table of the cached span ring
+static __thread int pman_span_index = -1;           // Span ring owned by this thread
+
+static struct {
+	PROC_TABLE_TYPE *table;    // Table drained (NULL = free slot)
+	FILE *fout;
+	pthread_t thread;
+	volatile int run;
+} pman_writer[MAX_MASTER_INSTANCE];
+
+static void pman_trace_push(PROC_TRACE_RING *ring, PROC_TRACE_DATA *evt, unsigned int size, const PROC_TRACE_DATA *e)
+{
+	unsigned int h = ring->head;
+
+	if(h - ring->tail >= size) { // Full, the writer is not keeping up (or not running)
+		ring->lost++;
+		return;
+	}
+
+	evt[h & (size-1)] = *e;
+	__sync_synchronize(); // event visible before the new head
+	ring->head = h+1;
+}
+
+/* Scheduler event, must be called with the table locked (serializes the producers) */
+static void pman_trace_sched(int pindex, char etype, const struct timeval *etime)
+{
+	PROC_TRACE_DATA e;
+	struct timeval now;
+
+	if(etime == NULL) {
+		pman_now(&now);
+		etime = &now;
+	}
+
+	e.etime = (long long)etime->tv_sec*1000000 + etime->tv_usec;
+	e.pid = e.tid = p_table->proc[pindex].PROC_id;
+	e.pindex = pindex;
+	e.etype = etype;
+	e.pad = 0;
+	strncpy(e.name, p_table->proc[pindex].PROC_name, PMAN_TRACE_NAME_LEN-1);
+	e.name[PMAN_TRACE_NAME_LEN-1] = '\0';
+
+	pman_trace_push(&p_table->evt_ring, p_table->evt_trace, PMAN_TRACE_SIZE, &e);
+}
+
+/* Span ring owned by the calling thread, claimed on first use */
+static int pman_span_ring(void)
+{
+	int i, tid = syscall(SYS_gettid);
+	PROC_TRACE_RING *ring;
+
+	if(pman_span_table == p_table && pman_span_index >= 0
+			&& p_table->span_ring[pman_span_index].owner == tid)
+		return pman_span_index;
+
+	pman_span_table = p_table;
+	for(pman_span_index=0;pman_span_index<PMAN_TRACE_NSPAN;pman_span_index++)
+		if(p_table->span_ring[pman_span_index].owner == tid)
+			return pman_span_index;
+
+	pman_lock();
+
+	for(i=0;i<PMAN_TRACE_NSPAN;i++) {
+		ring = &p_table->span_ring[i];
+		/* Free, or left by a dead thread with nothing left to drain */
+		if(ring->owner == 0 || (ring->head == ring->tail && kill(ring->owner, 0) == -1 && errno == ESRCH)) {
+			ring->owner = tid;
+			ring->lost = 0;
+			break;
+		}
+	}
+
+	pman_unlock();
+
+	pman_span_index = (i == PMAN_TRACE_NSPAN) ? -1 : i;
+	return pman_span_index;
+}
+
+static int pman_trace_span(int pindex, char etype, const char *name)
+{
+	int r;
+	struct timeval now;
+	PROC_TRACE_DATA e;
+
+	if(p_table == NULL)
+		return -1;
+
+	if((r = pman_span_ring()) < 0)
+		return -2;
+
+	pman_now(&now);
+	e.etime = (long long)now.tv_sec*1000000 + now.tv_usec;
+	e.pid = getpid();
+	e.tid = p_table->span_ring[r].owner;
+	e.pindex = pindex;
+	e.etype = etype;
+	e.pad = 0;
+	strncpy(e.name, name, PMAN_TRACE_NAME_LEN-1);
+	e.name[PMAN_TRACE_NAME_LEN-1] = '\0';
+
+	pman_trace_push(&p_table->span_ring[r], p_table->span_trace[r], PMAN_TRACE_SPAN_SIZE, &e);
+	return 0;
+}
+
+/* Consumer side: moves the pending events of a ring to the trace file */
+static void pman_trace_drain(PROC_TRACE_RING *ring, PROC_TRACE_DATA *evt, unsigned int size, FILE *fout)
+{
+	unsigned int t = ring->tail, h = ring->head, i, n;
+
+	__sync_synchronize(); // events read after the head
+
+	while(t != h) {
+		i = t & (size-1);
+		n = (h - t < size - i) ? h - t : size - i;
+		fwrite(&evt[i], sizeof(PROC_TRACE_DATA), n, fout);
+		t += n;
+	}
+
+	__sync_synchronize(); // done reading before the slots are handed back
+	ring->tail = t;
+}
+
+static void pman_trace_drain_all(PROC_TABLE_TYPE *table, FILE *fout)
+{
+	int i;
+
+	pman_trace_drain(&table->evt_ring, table->evt_trace, PMAN_TRACE_SIZE, fout);
+	for(i=0;i<PMAN_TRACE_NSPAN;i++)
+		if(table->span_ring[i].head != table->span_ring[i].tail)
+			pman_trace_drain(&table->span_ring[i], table->span_trace[i], PMAN_TRACE_SPAN_SIZE, fout);
+}
+
+static void *pman_trace_thread(void *arg)
+{
+	int w = (long)arg;
+
+	while(pman_writer[w].run) {
+		pman_trace_drain_all(pman_writer[w].table, pman_writer[w].fout);
+		fflush(pman_writer[w].fout);
+		usleep(PMAN_TRACE_FLUSH_US);
+	}
+
+	return NULL;
+}
+
+/* A forked child has no writer threads, it must not touch (nor flush) the parent's ones */
+static void pman_trace_atfork_child(void)
+{
+	int w;
+
+	for(w=0;w<MAX_MASTER_INSTANCE;w++)
+		pman_writer[w].table = NULL;
+}
+
+/* Stops the writers of a table about to be detached */
+static void pman_trace_stop_table(PROC_TABLE_TYPE *table)
+{
+	int w;
+
+	for(w=0;w<MAX_MASTER_INSTANCE;w++)
+		if(pman_writer[w].table == table)
+			PMAN_trace_stop(w);
+}
+#endif
+
+
+/* Must be called with the table locked */
+static void pman_ddln_miss(PROC_TYPE *proc)
+{
+	if(proc->PROC_ddln_flag) // Instance already counted
+		return;
+
+	proc->PROC_ddln_flag = 1;
+	proc->PROC_ndm++;
+
+#ifdef PMAN_TRACE
+	pman_trace_sched(proc - p_table->proc, PMAN_EVT_MISS, NULL);
+#endif
+
+	if(proc->PROC_ddln_policy & PMAN_DDLN_SKIP)
+		proc->PROC_skip = 1;
+	if(proc->PROC_ddln_policy & (PMAN_DDLN_DEGRADE | PMAN_DDLN_NOTIFY))
+		proc->PROC_ddln_pend = 1; // hooks are only valid in the "manager" process
+}
+
+
 
 /*
  * Initializes the process table
  *
  *   Input args: (global var) *p_table : pointer to the process table data structure
- *               shmem_pman_key      : shared memory key
- *               sem_pman_key        : sempahore key (mutual exclusion)
+ *               shmem_pman_key      : shared memory key (plus the instance offset, PMAN_INSTANCE_ENV)
+ *               sem_pman_key        : sempahore key (unused, kept for compatibility)
  *               QoSfun                : pointer to QoS manager function (only "manager" process)
  *               QoSdata_sz            : size of QoS data structure
  *               create_flags          : PMAN_NEW    - Create a new process table 
  *                                       PMAN_ATTACH - Attach to an existing process table
  *
  *   Returns:    0 : Success
- *              -1 : Error creating shared memory region 
- *              -2 : Failed to create semaphore 
+ *              -1 : Error creating shared memory region (or process table not initialized, PMAN_ATTACH)
+ *              -2 : Failed to create the table mutex
  *              -3 : Error setting the priority
  *              -4 : Error allocating memory (QoS data)
  */
@@ -93,11 +358,17 @@ int PMAN_init(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSda
 
 int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSdata_sz, int create_flags)
 {
-	int i,j,sstat;
-	union dsemun sem_union;
+	int i,j;
+	pthread_mutexattr_t mattr;
 	struct sched_param proc_sched;
 	struct timeval tv;
 
+	(void)sem_pman_key;		// table mutex lives in the shared memory region
+
+	/* Instance namespace (several simulated matches on the same host) */
+	if(getenv(PMAN_INSTANCE_ENV) != NULL)
+		shmem_pman_key += atoi(getenv(PMAN_INSTANCE_ENV)) << PMAN_INSTANCE_SHIFT;
+
 	PMAN_DBG("\n [PMAN_init]: shmem_pman_key %x / sem_pman_key %x, QoSfun:%p, QoSdata_sz:%d, create_flags:%d",
 			shmem_pman_key, sem_pman_key, QoSfun, QoSdata_sz, create_flags);
 
@@ -116,6 +387,7 @@ int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSd
 
 		if(p_table == (void *)-1){
 			fprintf(stderr, "\n [PMAN_init (PMAN_NEW)]: PMAN shmat failed");
+			p_table = NULL;
 			return -12;
 		}
 
@@ -129,8 +401,16 @@ int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSd
 
 
 		/* Init process table */
+		p_table->initialized = 0;
+		p_table->manager = getpid();
+		p_table->qosdata_sz = QoSdata_sz;
+		p_table->tick_us = PMAN_TICK_US;
 		p_table->nprocs = 0;
 		p_table->ticks = 0;
+		p_table->vclock = 0;
+		p_table->vtime = 0;
+		p_table->epilog_seq = 0;
+		p_table->idle_waiters = 0;
 		p_table->QoSupd = QoSfun;
 		p_table->DdlnExcpt = NULL;
 
@@ -160,33 +440,45 @@ int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSd
 			p_table->proc[i].PROC_status = PROC_S_EMPTY;
 			p_table->proc[i].PROC_nact = 0;
 			p_table->proc[i].PROC_ndm = 0;
+			pman_stats_reset(&p_table->proc[i]);
+
+			p_table->proc[i].PROC_actmode = PMAN_ACT_SIGNAL;
+			p_table->proc[i].PROC_actseq = 0;
+			p_table->proc[i].PROC_act_lat = 0;
+			p_table->proc[i].PROC_act_lat_max = 0;
+		}
 
 #ifdef PMAN_TRACE
-			p_table->evt_firstindex = 0;
-			p_table->evt_lastindex = 0;
+		p_table->trace_writer = 0;
+		memset(&p_table->evt_ring, 0, sizeof(p_table->evt_ring));
+		memset(p_table->span_ring, 0, sizeof(p_table->span_ring));
 #endif
-		}
 
 
-		/* Create and init semaphore */
-		pman_sem_id = semget((key_t)sem_pman_key,1,0666 | IPC_CREAT);
-		if(pman_sem_id == -1)
+		/* Init the table mutex (shared by every attached process, recovered if its owner dies) */
+		if(pthread_mutexattr_init(&mattr) != 0
+				|| pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED) != 0
+				|| pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST) != 0)
 			return -13;
 
-		PMAN_DBG("\n     [PMAN_init CREATE flag]: semaphore id: %d",pman_sem_id);
-
-		sem_union.val=1;
-		sstat=semctl(pman_sem_id,0,SETVAL,sem_union);
-		if(sstat == -1)
+		if(pthread_mutex_init(&p_table->lock, &mattr) != 0)
 			return -14;
+		pthread_mutexattr_destroy(&mattr);
+
+		p_table->initialized = 1;
 
 #if _POSIX_PRIORITY_SCHEDULING > 0
 		/* Set the process priority and scheduling policy */
 		proc_sched.sched_priority=sched_get_priority_max(SCHED_FIFO);
 		if( sched_setscheduler(0,SCHED_FIFO,&proc_sched) == -1)
 		{
-			fprintf(stderr,"\n [PMAN_init (PMAN_NEW)]: Error setting the priority (sched_setscheduler)!");
-			return -15;
+			/* Unprivileged "manager" (simulator): the table works, without real-time priority */
+			if(errno == EPERM)
+				fprintf(stderr,"\n [PMAN_init (PMAN_NEW)]: Not allowed to set the priority, running as SCHED_OTHER");
+			else {
+				fprintf(stderr,"\n [PMAN_init (PMAN_NEW)]: Error setting the priority (sched_setscheduler)!");
+				return -15;
+			}
 		}
 #endif
 
@@ -195,8 +487,8 @@ int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSd
 
 	case PMAN_ATTACH:
 
-		/* Create shared memory region */
-		pman_shmem_id = shmget((key_t) shmem_pman_key, sizeof(PROC_TABLE_TYPE), 0666 | IPC_CREAT);
+		/* Get shared memory region (created by the "manager" process) */
+		pman_shmem_id = shmget((key_t) shmem_pman_key, sizeof(PROC_TABLE_TYPE), 0666);
 		if(pman_shmem_id == -1){
 			fprintf(stderr, "\n [PMAN_init (PMAN_ATTACH)]: PMAN shmget failed");
 			return -16;
@@ -205,17 +497,18 @@ int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSd
 		p_table=(PROC_TABLE_TYPE *)shmat(pman_shmem_id, (void *)0, 0);
 		if(p_table == (void *)-1){
 			fprintf(stderr, "\n [PMAN_init (PMAN_ATTACH)]: PMAN shmat failed");
+			p_table = NULL;
 			return -17;
 		}
 
 		PMAN_DBG("\n [PMAN_init (PMAN_ATTACH)]: PMAN shared memory attached at [%p,%x] (%d bytes)\n", p_table,(void*)p_table+sizeof(PROC_TABLE_TYPE),sizeof(PROC_TABLE_TYPE));
 
-		/* Get semaphore ID*/
-		pman_sem_id = semget((key_t)sem_pman_key,1,0666);
-		if(pman_sem_id == -1)
+		/* Table (and its mutex) must have been initialized by the "manager" process */
+		if(!p_table->initialized) {
+			shmdt((void *)p_table);
+			p_table = NULL;
 			return -18;
-
-		PMAN_DBG("\n     [PMAN_init ATTACH flag]: semaphore id: %d",pman_sem_id);
+		}
 
 		break;
 	}
@@ -231,41 +524,47 @@ int PMAN_init2(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSd
  *
  * Input args: (global var) *p_table : pointer to the process table data structure
  *             close_flags           : PMAN_CLFREE  - Completely removes all resources (shared mem,
- *                                                      semaphore) and kill all registered "client" processes 
+ *                                                      mutex) and kill all registered "client" processes 
  *                                   : PMAN_CLLEAVE - Just deattaches shared mem region 
  *              
  * Returns:     0 : success
  *             -1 : invalid process table pointer (null) 
  *             -2 : error removing shared memory
- *             -3 : error deleting semaphore
  *             -4 : invalid close flag
  */
 int PMAN_close(int close_flags)
 {
 	int i;
-	int sstat;
-	union dsemun sem_union;
 
 	PMAN_DBG("\n PMAN_close called (p_table:%p)", p_table);
 
 	if(p_table == NULL)
 		return -111;
 
+#ifdef PMAN_TRACE
+	/* Writers of this table must not outlive the mapping */
+	pman_trace_stop_table(p_table);
+#endif
+
 	switch(close_flags)
 	{
 	case PMAN_CLFREE:
 
 		/* Wait for any ongoing op */
-		sem_pwait(pman_sem_id);
+		pman_lock();
 
 		/* Kills every registered processes */
 		for(i=0;i<PROC_TABLE_SIZE;i++)
 			if(p_table->proc[i].PROC_id != PMAN_NOPID)
 			{
-				sstat=kill(p_table->proc[i].PROC_id, SIGINT);
+				kill(p_table->proc[i].PROC_id, SIGINT);
 				//printf(" \n INT signal sent to process %s ,pid=%d, returned %d",p_table->proc[i].PROC_name, p_table->proc[i].PROC_id, sstat);
 			}
 
+		/* Table no longer usable; late clients fail to attach */
+		p_table->initialized = 0;
+		pman_unlock();
+
 		/* Deletes shared mem */
 		if(shmdt((void *)p_table) == -1) {
 			fprintf(stderr,"[PMAN_close (PMAN_CLFREE)]: shmdt ptable failed!\n");
@@ -276,13 +575,6 @@ int PMAN_close(int close_flags)
 			return -113;
 		}
 
-		/* Deletes semaphore */
-		sstat=semctl(pman_sem_id,0,IPC_RMID,sem_union);
-		if(sstat == -1) {
-			fprintf(stderr,"[PMAN_close (PMAN_CLFREE)]: semctl (IPC_RMID) failed!\n");
-			return -114;
-		}
-
 		return 0;
 		break;
 
@@ -316,6 +608,7 @@ int PMAN_close(int close_flags)
  *              -1 : invalid process table pointer (null) 
  *              -2 : process table full
  *              -3 : duplicated process id
+ *              -4 : QoS data larger than the table entries
  */
 int PMAN_procadd(char * p_name, int p_id,int p_period, int p_phase, int p_deadline, void * p_QoSdata, int p_QoSdata_sz)
 {
@@ -336,7 +629,10 @@ int PMAN_procadd(char * p_name, int p_id,int p_period, int p_phase, int p_deadli
 	if(p_table->nprocs == PROC_TABLE_SIZE)
 		return -2;
 
-	sem_pwait(pman_sem_id);
+	if(p_QoSdata_sz > p_table->qosdata_sz)
+		return -4;
+
+	pman_lock();
 
 	/* Search for a free slot in the PT and check against duplicated process ids */
 	free_index = -1;
@@ -350,7 +646,7 @@ int PMAN_procadd(char * p_name, int p_id,int p_period, int p_phase, int p_deadli
 		{
 			if( strcmp(p_table->proc[i].PROC_name,p_name) == 0)
 			{
-				sem_psignal(pman_sem_id);
+				pman_unlock();
 				return -3;
 			}
 		}
@@ -358,7 +654,7 @@ int PMAN_procadd(char * p_name, int p_id,int p_period, int p_phase, int p_deadli
 
 	if(free_index == -1) // Shouldn't happen !
 	{
-		sem_psignal(pman_sem_id);
+		pman_unlock();
 		return -2;
 	}
 
@@ -372,18 +668,23 @@ int PMAN_procadd(char * p_name, int p_id,int p_period, int p_phase, int p_deadli
 
 	//printf("\n QoS address: %p QoS (priority):%d QoS size:%d ",p_QoSdata, *((int *)(p_QoSdata)), p_QoSdata_sz);
 	//printf("\n ptable address:%p  ptable index:%d ptable QoS address: %x ",p_table,free_index, p_table->proc[free_index].PROC_qosdata + (int)p_table);
-	memcpy((void *)(p_table->proc[free_index].PROC_qosdata+(void*)p_table),p_QoSdata,p_QoSdata_sz);
+	memcpy(PMAN_QOSDATA(free_index),p_QoSdata,p_QoSdata_sz);
 
-	p_table->proc[free_index].PROC_qosupdflag=1;
+	p_table->proc[free_index].PROC_qosupdflag=PMAN_QOSUPD_ONACT;
 
 	p_table->proc[free_index].PROC_status = PROC_S_IDLE;
 	p_table->proc[free_index].PROC_nact = 0;
 	p_table->proc[free_index].PROC_ndm = 0;
+	pman_stats_reset(&p_table->proc[free_index]);
+
+	p_table->proc[free_index].PROC_actmode = PMAN_ACT_SIGNAL;
+	p_table->proc[free_index].PROC_act_lat = 0;
+	p_table->proc[free_index].PROC_act_lat_max = 0;
 
 	(p_table->nprocs)++;
 
 
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return 0;
 }
 
@@ -406,7 +707,7 @@ int PMAN_procdel(char *p_name)
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	for(i=0;i<PROC_TABLE_SIZE;i++)
 
@@ -420,11 +721,11 @@ int PMAN_procdel(char *p_name)
 
 			(p_table->nprocs)--;
 
-			sem_psignal(pman_sem_id);
+			pman_unlock();
 			return 0;
 		}
 
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return -2;
 }
 
@@ -451,21 +752,22 @@ int PMAN_attach(char *p_name, pid_t p_id)
 		return -1;
 	}
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	for (i=0; i<PROC_TABLE_SIZE; i++)
 	{
 		if (strcmp(p_table->proc[i].PROC_name, p_name) == 0)
 		{
 			p_table->proc[i].PROC_id = p_id;
-			p_table->proc[i].PROC_qosupdflag=1; // Update process QoS on next activation
+			p_table->proc[i].PROC_qosupdflag=PMAN_QOSUPD_ONACT; // Update process QoS on next activation
+			p_table->proc[i].PROC_actmode = PMAN_ACT_SIGNAL; // Until it calls PMAN_wait_activation
 
-			sem_psignal(pman_sem_id);
+			pman_unlock();
 			return 0;
 		}
 	}
 
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return -2;
 }
 
@@ -490,7 +792,7 @@ int PMAN_deattach(char *p_name)
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	for(i=0;i<PROC_TABLE_SIZE;i++)
 
@@ -498,11 +800,11 @@ int PMAN_deattach(char *p_name)
 		{
 			p_table->proc[i].PROC_id = PMAN_NOPID;
 
-			sem_psignal(pman_sem_id);
+			pman_unlock();
 			return 0;
 		}
 
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return -2;
 }
 
@@ -529,7 +831,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	/* Look for sucessor position on PMAN table */
 	succ_index=PMAN_NOINDEX;
@@ -540,7 +842,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
 		}
 
 	if(succ_index==PMAN_NOINDEX) { // Successor process not found !
-		sem_psignal(pman_sem_id);
+		pman_unlock();
 		return -3;
 	}
 	/* Look for predecessor in PMAN table */
@@ -552,7 +854,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
 		}
 
 	if(pred_index==PMAN_NOINDEX) { // Predecessor process not found !
-		sem_psignal(pman_sem_id);
+		pman_unlock();
 		return -2;
 	}
 
@@ -564,7 +866,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
 		}
 
 	if(i >= PMAN_MAX_PRED) { // Did not found an empty entry to add the predecessor name
-		sem_psignal(pman_sem_id);
+		pman_unlock();
 		return -4;
 	}
 
@@ -575,7 +877,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
 		}
 
 	if(i >= PMAN_MAX_SUCC) { // Did not found an empty entry to add the successor index
-		sem_psignal(pman_sem_id);
+		pman_unlock();
 		return -4;
 	}
 
@@ -585,7 +887,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
 
 
 	/* Done */
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return -2;
 }
 
@@ -603,6 +905,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ)
  *             -1 : invalid process table pointer (null) 
  *             -2 : process not found
  *             -3 : invalid when_flag
+ *             -4 : QoS data larger than the table entries
  */
 int PMAN_QoSupd(char * p_name, void * QoSdata, int QoSdata_sz, char when_flag)
 {
@@ -614,35 +917,43 @@ int PMAN_QoSupd(char * p_name, void * QoSdata, int QoSdata_sz, char when_flag)
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	if(QoSdata_sz > p_table->qosdata_sz)
+		return -4;
+
+	pman_lock();
 
 	for(i=0;i<PROC_TABLE_SIZE;i++)
 
 		if( strcmp(p_table->proc[i].PROC_name,p_name) == 0)
 		{
-			memcpy((void *)(p_table->proc[i].PROC_qosdata+(void*)p_table),QoSdata,QoSdata_sz);
+			memcpy(PMAN_QOSDATA(i),QoSdata,QoSdata_sz);
 			switch(when_flag)
 			{
 			case  PMAN_UPD_IMEDIATE:
-				(*p_table->QoSupd)(i); // Update process's QoS
-				p_table->proc[i].PROC_qosupdflag=0;
+				if(getpid() == p_table->manager && p_table->proc[i].PROC_id != PMAN_NOPID) {
+					if(p_table->QoSupd != NULL)
+						(*p_table->QoSupd)(i); // Update process's QoS
+					p_table->proc[i].PROC_qosupdflag=PMAN_QOSUPD_NONE;
+				}
+				else // The hook is only valid in the "manager" (or the process is not attached yet)
+					p_table->proc[i].PROC_qosupdflag=PMAN_QOSUPD_ONTICK;
 				break;
 
 			case  PMAN_UPD_ONNEXTACT:
-				p_table->proc[i].PROC_qosupdflag=1; // Update process QoS on next activation
+				p_table->proc[i].PROC_qosupdflag=PMAN_QOSUPD_ONACT; // Update process QoS on next activation
 				break;
 
 			default:
-				sem_psignal(pman_sem_id);
+				pman_unlock();
 				return -3; // Invalid when_flag
 
 			}
 
-			sem_psignal(pman_sem_id);
+			pman_unlock();
 			return 0;
 		}
 
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return -2;
 }
 
@@ -673,7 +984,7 @@ int PMAN_msgupd(char * p_name, int p_period, int p_phase, int p_deadline, char w
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	for(i=0;i<PROC_TABLE_SIZE;i++)
 		if( strcmp(p_table->proc[i].PROC_name,p_name) == 0)
@@ -687,11 +998,11 @@ int PMAN_msgupd(char * p_name, int p_period, int p_phase, int p_deadline, char w
 			if((which_flag & PMAN_UPD_DEADLINE) && (p_deadline > 0))
 				p_table->proc[i].PROC_deadline = p_deadline;
 
-			sem_psignal(pman_sem_id);
+			pman_unlock();
 			return 0;
 		}
 
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return -2;
 
 }
@@ -711,29 +1022,42 @@ int PMAN_msgupd(char * p_name, int p_period, int p_phase, int p_deadline, char w
 int PMAN_epilogue(char *p_name)
 {
 	int i,j, succ_index, check_preced_flag=0;
+	int rt;
+	PROC_TYPE *proc;
 
 	PMAN_DBG("\n PMAN_epilogue called (p_table:%p  p_name:%s)", p_table, p_name);
 
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	for(i=0;i<PROC_TABLE_SIZE;i++)
 
 		if( strcmp(p_table->proc[i].PROC_name,p_name) == 0)
 		{
 			/* Update process status and finish time */
-			p_table->proc[i].PROC_status = PROC_S_IDLE; //
-			gettimeofday(&p_table->proc[i].PROC_last_finish, NULL);
+			proc = &p_table->proc[i];
+			proc->PROC_status = PROC_S_IDLE; //
+			pman_now(&proc->PROC_last_finish);
+
+			/* Response time statistics and deadline check */
+			rt = pman_elapsed_us(&proc->PROC_last_start, &proc->PROC_last_finish);
+			proc->PROC_rt_last = rt;
+			if(proc->PROC_rt_n == 0 || rt < proc->PROC_rt_min)
+				proc->PROC_rt_min = rt;
+			if(proc->PROC_rt_n == 0 || rt > proc->PROC_rt_max)
+				proc->PROC_rt_max = rt;
+			proc->PROC_rt_sum += rt;
+			proc->PROC_rt_n++;
+			j = rt / PMAN_RT_HIST_STEP;
+			proc->PROC_rt_hist[(j < 0) ? 0 : (j >= PMAN_RT_HIST_SIZE) ? PMAN_RT_HIST_SIZE-1 : j]++;
+
+			if(proc->PROC_deadline > 0 && rt > proc->PROC_deadline)
+				pman_ddln_miss(proc);
 
 #ifdef PMAN_TRACE
-			p_table->evt_trace[p_table->evt_lastindex].pindex=i;
-			p_table->evt_trace[p_table->evt_lastindex].etype='E';
-			p_table->evt_trace[p_table->evt_lastindex].etime=p_table->proc[i].PROC_last_finish;
-			p_table->evt_lastindex=(p_table->evt_lastindex+1) % PMAN_TRACE_SIZE;
-			if(p_table->evt_lastindex == p_table->evt_firstindex)
-				p_table->evt_firstindex+=1;
+			pman_trace_sched(i, PMAN_EVT_EPILOG, &proc->PROC_last_finish);
 #endif
 
 			/* Check for successors */
@@ -749,12 +1073,18 @@ int PMAN_epilogue(char *p_name)
 
 
 	/* Done */
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 
 	/* Check if successor processes can be released */
 	if(check_preced_flag)
 		PMAN_release();
 
+	/* Wake up the "manager" waiting in PMAN_wait_idle (after the successors were released) */
+	if(p_table->idle_waiters > 0) {
+		__sync_fetch_and_add(&p_table->epilog_seq, 1);
+		pman_futex(&p_table->epilog_seq, FUTEX_WAKE, INT_MAX);
+	}
+
 	if(i == PROC_TABLE_SIZE)
 		return -2; // Process not found
 	else
@@ -762,6 +1092,279 @@ int PMAN_epilogue(char *p_name)
 }
 
 
+/*
+ * Blocks the calling process until its next activation
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             p_name                : process name (string)
+ *
+ * Returns:     0 : activated
+ *             -1 : invalid process table pointer (null)
+ *             -2 : process not found
+ *             -3 : interrupted by a signal (no activation)
+ */
+int PMAN_wait_activation(char *p_name)
+{
+	int i, lat;
+	unsigned int seq;
+	struct timeval now;
+	PROC_TYPE *proc;
+
+	if(p_table == NULL)
+		return -1;
+
+	/* First call (or process re-attached): look up the entry and switch it to futex activation */
+	if(pman_act_index == PMAN_NOINDEX
+			|| strcmp(p_table->proc[pman_act_index].PROC_name, p_name) != 0
+			|| p_table->proc[pman_act_index].PROC_actmode != PMAN_ACT_FUTEX)
+	{
+		pman_lock();
+
+		for(i=0;i<PROC_TABLE_SIZE;i++)
+			if( strcmp(p_table->proc[i].PROC_name,p_name) == 0)
+				break;
+
+		if(i == PROC_TABLE_SIZE) {
+			pman_unlock();
+			return -2;
+		}
+
+		pman_act_index = i;
+		pman_act_seen = p_table->proc[i].PROC_actseq;
+		p_table->proc[i].PROC_actmode = PMAN_ACT_FUTEX;
+
+		pman_unlock();
+	}
+
+	proc = &p_table->proc[pman_act_index];
+
+	/* Sleep while no new activation was released (FUTEX_WAIT returns at once if the word changed) */
+	while((seq = *(volatile unsigned int *)&proc->PROC_actseq) == pman_act_seen)
+		if(pman_futex(&proc->PROC_actseq, FUTEX_WAIT, seq) == -1 && errno == EINTR)
+			return -3;
+
+	pman_act_seen = seq;
+
+	/* Activation latency, from PMAN_release to here */
+	pman_now(&now);
+	lat = (now.tv_sec - proc->PROC_last_start.tv_sec)*1000000 + (now.tv_usec - proc->PROC_last_start.tv_usec);
+	proc->PROC_act_lat = lat;
+	if(lat > proc->PROC_act_lat_max)
+		proc->PROC_act_lat_max = lat;
+
+#ifdef PMAN_TRACE
+	pman_trace_span(pman_act_index, PMAN_EVT_WAKEUP, proc->PROC_name);
+#endif
+
+	return 0;
+}
+
+
+/*
+ * Sets the deadline miss policy of a process
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             p_name                : process name (string)
+ *             policy                : PMAN_DDLN_* flags
+ *
+ * Returns:     0 : success
+ *             -1 : invalid process table pointer (null)
+ *             -2 : process not found
+ */
+int PMAN_ddln_policy(char *p_name, int policy)
+{
+	int i;
+
+	PMAN_DBG("\n PMAN_ddln_policy called (p_table:%p  p_name:%s policy:%x)", p_table, p_name, policy);
+
+	if(p_table == NULL)
+		return -1;
+
+	pman_lock();
+
+	for(i=0;i<PROC_TABLE_SIZE;i++)
+		if( strcmp(p_table->proc[i].PROC_name,p_name) == 0)
+		{
+			p_table->proc[i].PROC_ddln_policy = policy;
+
+			pman_unlock();
+			return 0;
+		}
+
+	pman_unlock();
+	return -2;
+}
+
+
+/*
+ * Installs the deadline exception hook (only "manager" process)
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             DdlnFun               : pointer to the deadline exception function
+ *
+ * Returns:     0 : success
+ *             -1 : invalid process table pointer (null)
+ */
+int PMAN_ddln_handler(void *DdlnFun)
+{
+	if(p_table == NULL)
+		return -1;
+
+	pman_lock();
+	p_table->DdlnExcpt = DdlnFun;
+	pman_unlock();
+
+	return 0;
+}
+
+
+/*
+ * Sets the tick length, used to convert PROC_period to time (only "manager" process)
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             tick_us               : time between PMAN_tick calls (us)
+ *
+ * Returns:     0 : success
+ *             -1 : invalid process table pointer (null)
+ *             -2 : invalid tick length
+ */
+int PMAN_tick_length(int tick_us)
+{
+	if(p_table == NULL)
+		return -1;
+
+	if(tick_us <= 0)
+		return -2;
+
+	p_table->tick_us = tick_us;
+	return 0;
+}
+
+
+/*
+ * Blocks until no activated process is left running (lock step "manager")
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             timeout_us            : maximum waiting time (us), <= 0 waits forever
+ *
+ * Returns:     0 : all processes idle
+ *             -1 : invalid process table pointer (null)
+ *             -2 : timeout
+ */
+int PMAN_wait_idle(int timeout_us)
+{
+	int i, busy, left;
+	unsigned int seq;
+	struct timeval start, now;
+	struct timespec ts;
+	PROC_TYPE *proc;
+
+	if(p_table == NULL)
+		return -1;
+
+	pman_now(&start);
+
+	/* Registered before the status scan: an epilogue after the scan always bumps epilog_seq */
+	__sync_fetch_and_add(&p_table->idle_waiters, 1);
+
+	for(;;)
+	{
+		seq = *(volatile unsigned int *)&p_table->epilog_seq;
+		busy = 0;
+
+		pman_lock();
+		for(i=0;i<PROC_TABLE_SIZE && !busy;i++)
+		{
+			proc = &p_table->proc[i];
+			/* PROC_S_PEND is not waited for: it runs once its predecessors finish, or never this tick */
+			if(proc->PROC_id == PMAN_NOPID
+					|| (proc->PROC_status != PROC_S_ACTIV && proc->PROC_status != PROC_S_READY))
+				continue;
+			if(kill(proc->PROC_id, 0) == -1 && errno == ESRCH) // Died before its epilogue
+				continue;
+			busy = 1;
+		}
+		pman_unlock();
+
+		if(!busy)
+			break;
+
+		if(timeout_us > 0)
+		{
+			pman_now(&now);
+			if((left = timeout_us - pman_elapsed_us(&start, &now)) <= 0)
+				break;
+			ts.tv_sec = left / 1000000;
+			ts.tv_nsec = (left % 1000000) * 1000;
+		}
+
+		/* relative timeout, returns at once if an epilogue already changed the word */
+		syscall(SYS_futex, &p_table->epilog_seq, FUTEX_WAIT, seq, (timeout_us > 0) ? &ts : NULL, NULL, 0);
+	}
+
+	__sync_fetch_and_sub(&p_table->idle_waiters, 1);
+
+	return busy ? -2 : 0;
+}
+
+
+/*
+ * Sets the virtual clock read by the clients linked with pman_vclock (only "manager" process)
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             vtime                 : virtual time (us), < 0 returns to the wall clock
+ *
+ * Returns:     0 : success
+ *             -1 : invalid process table pointer (null)
+ */
+int PMAN_vclock_set(long long vtime)
+{
+	if(p_table == NULL)
+		return -1;
+
+	if(vtime < 0) {
+		p_table->vclock = 0;
+		return 0;
+	}
+
+	/* Set before the clients are activated (PMAN_tick), which orders it with the table mutex */
+	p_table->vtime = vtime;
+	p_table->vclock = 1;
+	return 0;
+}
+
+
+/*
+ * Response time percentile of a process
+ *
+ * Input args: pdata : process data (from PMAN_query)
+ *             pct   : percentile (0..100)
+ *
+ * Returns:    upper bound of the percentile (us), -1 if no instance finished yet
+ */
+int PMAN_rt_percentile(const PROC_TYPE *pdata, int pct)
+{
+	int i;
+	unsigned int count, target;
+
+	if(pdata == NULL || pdata->PROC_rt_n == 0)
+		return -1;
+
+	target = (unsigned int)(((unsigned long long)pdata->PROC_rt_n * pct + 99) / 100);
+	if(target == 0)
+		target = 1;
+
+	for(i=0, count=0; i<PMAN_RT_HIST_SIZE-1; i++)
+	{
+		count += pdata->PROC_rt_hist[i];
+		if(count >= target)
+			return ((i+1) * PMAN_RT_HIST_STEP < pdata->PROC_rt_max) ? (i+1) * PMAN_RT_HIST_STEP : pdata->PROC_rt_max;
+	}
+
+	return pdata->PROC_rt_max; // Above the histogram range
+}
+
+
 /*
  * Queries the contents of the process table 
  * 
@@ -797,7 +1400,9 @@ int PMAN_query(PROC_TYPE *pdata, int reset_flag)
 		if( p_table->proc[i].PROC_name[0] != 0)
 		{
 			//printf("(found at %d)",i);
-			*pdata = p_table->proc[i];
+			pman_lock();
+			*pdata = p_table->proc[i]; // Includes deadline and response time statistics (see PMAN_rt_percentile)
+			pman_unlock();
 			pti=i+1;
 			return 0;
 
@@ -825,18 +1430,18 @@ int PMAN_print(void)
 	if(p_table == NULL)
 		return -1;
 
-	printf("\n         name    ID    Per   Ph     Ddln  *QoSdta    QoSflg Stat  #Act #Dmiss  Start       Finish");
+	printf("\n         name    ID    Per   Ph     Ddln  *QoSdta    QoSflg Stat  #Act #Dmiss  Start       Finish       Act  Lat(us)  Max");
 	for(i=0;i<PROC_TABLE_SIZE;i++)
 
 		if( p_table->proc[i].PROC_name[0] != 0)
 		{
-			printf("\n [%d] : %5s %5d  %5d %5d %9d %9p %5d %4x %5u %5u %5ld:%5ld %5ld:%5ld",i,\
+			printf("\n [%d] : %5s %5d  %5d %5d %9d %9p %5d %4x %5u %5u %5ld:%5ld %5ld:%5ld %5s %6d %6d",i,\
 					p_table->proc[i].PROC_name,\
 					p_table->proc[i].PROC_id,\
 					p_table->proc[i].PROC_period,\
 					p_table->proc[i].PROC_phase,\
 					p_table->proc[i].PROC_deadline,\
-					(void *)(p_table->proc[i].PROC_qosdata+(void*)p_table),\
+					PMAN_QOSDATA(i),\
 					p_table->proc[i].PROC_qosupdflag,\
 					p_table->proc[i].PROC_status,\
 					p_table->proc[i].PROC_nact,\
@@ -844,7 +1449,10 @@ int PMAN_print(void)
 					p_table->proc[i].PROC_last_start.tv_sec,\
 					p_table->proc[i].PROC_last_start.tv_usec,\
 					p_table->proc[i].PROC_last_finish.tv_sec,\
-					p_table->proc[i].PROC_last_finish.tv_usec);
+					p_table->proc[i].PROC_last_finish.tv_usec,\
+					(p_table->proc[i].PROC_actmode == PMAN_ACT_FUTEX) ? "futex" : "sig",\
+					p_table->proc[i].PROC_act_lat,\
+					p_table->proc[i].PROC_act_lat_max);
 		}
 		else
 			printf("\n [%d] : Free slot",i);
@@ -857,29 +1465,37 @@ int PMAN_print(void)
 
 #ifdef PMAN_TRACE
 /*
- * Saves the current trace data 
+ * Saves the pending scheduler events as text
  * 
  * Input args: (global var) *p_table : pointer to the process table data structure
  *              
  * Returns:     0 : success
  *             -1 : invalid process table pointer (null) 
  *             -2 : no tarce data to save
+ *             -3 : a trace writer is draining the rings
  */
 int PMAN_trace_save(void)
 {
-	int i, retval=0;
+	int retval=0;
+	unsigned int t;
 	char fname[80];
 	FILE *flog;
+	PROC_TRACE_DATA *e;
 
 	PMAN_DBG("\n PMAN_trace_save called (ptable: %p)",p_table);
 
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
+
+	if(p_table->trace_writer != 0) {
+		pman_unlock();
+		return -3;
+	}
 
 	/* Save trace buffer */
-	if(p_table->evt_firstindex != p_table->evt_lastindex) {
+	if(p_table->evt_ring.tail != p_table->evt_ring.head) {
 
 
 		sprintf(fname,"%ld-trace.txt",time(NULL));
@@ -890,31 +1506,173 @@ int PMAN_trace_save(void)
 		}
 		else {
 			fprintf(flog,"\n    PName , PInd,EVT,      Instant\n");
-			for(i=p_table->evt_firstindex;i != p_table->evt_lastindex;i=(i+1) % PMAN_TRACE_SIZE) {
-				fprintf(flog,"%10s,%5d, %c ,%5ld,%5ld\n",			\
-						p_table->proc[p_table->evt_trace[i].pindex].PROC_name,	\
-						p_table->evt_trace[i].pindex,				\
-						p_table->evt_trace[i].etype,				\
-						p_table->evt_trace[i].etime.tv_sec,
-						p_table->evt_trace[i].etime.tv_usec);
+			for(t=p_table->evt_ring.tail;t != p_table->evt_ring.head;t++) {
+				e = &p_table->evt_trace[t & (PMAN_TRACE_SIZE-1)];
+				fprintf(flog,"%10.*s,%5d, %c ,%5lld,%5lld\n",			\
+						PMAN_TRACE_NAME_LEN, e->name,				\
+						e->pindex,						\
+						e->etype,						\
+						e->etime / 1000000,
+						e->etime % 1000000);
 			}
 
 			fclose(flog);
 		}
 
-		/* Reset indexes */
-		p_table->evt_firstindex=0;
-		p_table->evt_lastindex=0;
+		/* Consume the saved events */
+		p_table->evt_ring.tail = p_table->evt_ring.head;
 	}
 	else
 		retval = -2;
 
 
 	/* Done */
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 	return retval;
 
 }
+
+
+/*
+ * Starts a thread that continuously drains the trace rings to a binary file
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             fname                 : trace file name
+ *
+ * Returns:  >= 0 : writer id
+ *             -1 : invalid process table pointer (null)
+ *             -2 : the table already has a trace writer
+ *             -3 : can't create the trace file
+ *             -4 : can't start the writer thread
+ *             -5 : no free writer slot (MAX_MASTER_INSTANCE writers running)
+ */
+int PMAN_trace_start(const char *fname)
+{
+	int i, w;
+	FILE *fout;
+	PROC_TRACE_HEADER hdr;
+	static int atfork_set = 0;
+
+	PMAN_DBG("\n PMAN_trace_start called (ptable: %p, fname: %s)",p_table,fname);
+
+	if(p_table == NULL)
+		return -1;
+
+	for(w=0;w<MAX_MASTER_INSTANCE;w++)
+		if(pman_writer[w].table == NULL)
+			break;
+	if(w == MAX_MASTER_INSTANCE)
+		return -5;
+
+	pman_lock();
+
+	/* One consumer per ring: refuse if a live writer is draining this table */
+	if(p_table->trace_writer != 0 && (kill(p_table->trace_writer, 0) == 0 || errno != ESRCH)) {
+		pman_unlock();
+		return -2;
+	}
+
+	if(!(fout = fopen(fname, "wb"))) {
+		pman_unlock();
+		return -3;
+	}
+
+	p_table->trace_writer = getpid();
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = PMAN_TRACE_MAGIC;
+	hdr.version = PMAN_TRACE_VERSION;
+	hdr.evt_size = sizeof(PROC_TRACE_DATA);
+	hdr.nprocs = PROC_TABLE_SIZE;
+	for(i=0;i<PROC_TABLE_SIZE;i++)
+		strcpy(hdr.pname[i], p_table->proc[i].PROC_name);
+
+	/* Drop the events recorded before the trace started */
+	p_table->evt_ring.tail = p_table->evt_ring.head;
+	for(i=0;i<PMAN_TRACE_NSPAN;i++)
+		p_table->span_ring[i].tail = p_table->span_ring[i].head;
+
+	pman_unlock();
+
+	fwrite(&hdr, sizeof(hdr), 1, fout);
+	fflush(fout);
+
+	if(!atfork_set) {
+		pthread_atfork(NULL, NULL, pman_trace_atfork_child);
+		atfork_set = 1;
+	}
+
+	pman_writer[w].table = p_table;
+	pman_writer[w].fout = fout;
+	pman_writer[w].run = 1;
+	if(pthread_create(&pman_writer[w].thread, NULL, pman_trace_thread, (void *)(long)w) != 0) {
+		fclose(fout);
+		pman_writer[w].table = NULL;
+		pman_lock();
+		p_table->trace_writer = 0;
+		pman_unlock();
+		return -4;
+	}
+
+	return w;
+}
+
+
+/*
+ * Stops a trace writer, draining the remaining events
+ *
+ * Input args: writer : writer id (PMAN_trace_start)
+ *
+ * Returns:     0 : success
+ *             -1 : invalid writer
+ */
+int PMAN_trace_stop(int writer)
+{
+	int i;
+	unsigned int lost;
+	PROC_TABLE_TYPE *table;
+
+	if(writer < 0 || writer >= MAX_MASTER_INSTANCE || (table = pman_writer[writer].table) == NULL)
+		return -1;
+
+	pman_writer[writer].run = 0;
+	pthread_join(pman_writer[writer].thread, NULL);
+
+	pman_trace_drain_all(table, pman_writer[writer].fout);
+	fclose(pman_writer[writer].fout);
+
+	lost = table->evt_ring.lost;
+	for(i=0;i<PMAN_TRACE_NSPAN;i++)
+		lost += table->span_ring[i].lost;
+	if(lost > 0)
+		fprintf(stderr, "[PMAN_trace_stop]: %u events lost (rings full)\n", lost);
+
+	table->trace_writer = 0;
+	pman_writer[writer].table = NULL;
+
+	return 0;
+}
+
+
+/*
+ * Marks the begin/end of a user span on the calling thread
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             name                  : span name
+ *
+ * Returns:     0 : success
+ *             -1 : invalid process table pointer (null)
+ *             -2 : no free span ring
+ */
+int PMAN_span_begin(const char *name)
+{
+	return pman_trace_span(pman_act_index, PMAN_EVT_BEGIN, name);
+}
+
+int PMAN_span_end(const char *name)
+{
+	return pman_trace_span(pman_act_index, PMAN_EVT_END, name);
+}
 #endif
 
 
@@ -974,10 +1732,60 @@ int PMAN_print_prec(void)
 }
 
 
+/*
+ * Prints the activation, deadline and response time statistics of the process table
+ * 
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             fout                  : output stream
+ *              
+ * Returns:     0 : success
+ *             -1 : invalid process table pointer (null) 
+ */
+int PMAN_print_stats(FILE *fout)
+{
+	int i;
+	PROC_TYPE proc;
+
+	PMAN_DBG("\n PMAN_print_stats called (ptable: %p)",p_table);
+
+	if(p_table == NULL)
+		return -1;
+
+	fprintf(fout,"\n         name  #Act #Dmiss #Skip   Ddln     Min     Avg     Max     P50     P95     P99  Lat  LatMax (us)");
+	for(i=0;i<PROC_TABLE_SIZE;i++)
+	{
+		pman_lock();
+		proc = p_table->proc[i];
+		pman_unlock();
+
+		if( proc.PROC_name[0] != 0)
+			fprintf(fout,"\n [%d] : %5s %5u %6u %5u %6d %7d %7.0f %7d %7d %7d %7d %4d %7d",i,\
+					proc.PROC_name,\
+					proc.PROC_nact,\
+					proc.PROC_ndm,\
+					proc.PROC_nskip,\
+					proc.PROC_deadline,\
+					proc.PROC_rt_min,\
+					(proc.PROC_rt_n > 0) ? (double)proc.PROC_rt_sum / proc.PROC_rt_n : 0.0,\
+					proc.PROC_rt_max,\
+					PMAN_rt_percentile(&proc, 50),\
+					PMAN_rt_percentile(&proc, 95),\
+					PMAN_rt_percentile(&proc, 99),\
+					proc.PROC_act_lat,\
+					proc.PROC_act_lat_max);
+	}
+
+	fprintf(fout,"\n");
+
+	return 0;
+}
+
+
 /*
  * "System tick". Should be called every basic time unit (whatever it is).
  *                Checks for process activations; sends activation signals
- *                Checks for missed deadlines (TODO)
+ *                Checks for missed deadlines (instances still running past their deadline)
+ *                and runs the miss policy hooks (this is the "manager" process)
  *
  * Input args: (global var) *p_table : pointer to the process table data structure
  *
@@ -987,13 +1795,48 @@ int PMAN_print_prec(void)
 int PMAN_tick(void)
 {
 	int i, check_release_flag=0;
+	struct timeval now;
+	PROC_TYPE *proc;
 
 	PMAN_DBG("\n PMAN_tick called (ptable: %p ). Activated processes:",p_table);
 
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_now(&now);
+
+	pman_lock();
+
+	/* Scans the process table for missed deadlines */
+	for(i=0;i<PROC_TABLE_SIZE;i++)
+	{
+		proc = &p_table->proc[i];
+		if(proc->PROC_id == PMAN_NOPID)
+			continue;
+
+		/* Instance not finished yet and already past its deadline */
+		if(proc->PROC_status == PROC_S_READY && proc->PROC_deadline > 0
+				&& pman_elapsed_us(&proc->PROC_last_start, &now) > proc->PROC_deadline)
+			pman_ddln_miss(proc);
+
+		/* Immediate QoS updates requested by other processes */
+		if(proc->PROC_qosupdflag == PMAN_QOSUPD_ONTICK)
+		{
+			if(p_table->QoSupd != NULL)
+				(*p_table->QoSupd)(i);
+			proc->PROC_qosupdflag = PMAN_QOSUPD_NONE;
+		}
+
+		/* Policy hooks of misses detected here or in the process epilogue */
+		if(proc->PROC_ddln_pend)
+		{
+			proc->PROC_ddln_pend = 0;
+			if((proc->PROC_ddln_policy & PMAN_DDLN_DEGRADE) && p_table->QoSupd != NULL)
+				(*p_table->QoSupd)(i);
+			if((proc->PROC_ddln_policy & PMAN_DDLN_NOTIFY) && p_table->DdlnExcpt != NULL)
+				(*p_table->DdlnExcpt)(i);
+		}
+	}
 
 	/* Scans the process table and activates processes*/
 	for(i=0;i<PROC_TABLE_SIZE;i++)
@@ -1002,10 +1845,21 @@ int PMAN_tick(void)
 		{ /* Filled PT slot: check if process ready */
 			if( ( (p_table->ticks - p_table->proc[i].PROC_phase) % p_table->proc[i].PROC_period) == 0)
 			{
+				if(p_table->proc[i].PROC_skip) // Activation dropped by the deadline miss policy
+				{
+					p_table->proc[i].PROC_skip = 0;
+					p_table->proc[i].PROC_nskip++;
+#ifdef PMAN_TRACE
+					pman_trace_sched(i, PMAN_EVT_SKIP, &now);
+#endif
+					continue;
+				}
+
 				if(p_table->proc[i].PROC_qosupdflag) // Check for pending QoS update requests with PMAN_ONNEXTACT flag
 				{
-					(*p_table->QoSupd)(i); // Update process's QoS
-					p_table->proc[i].PROC_qosupdflag=0; // Reset QoS update flag
+					if(p_table->QoSupd != NULL)
+						(*p_table->QoSupd)(i); // Update process's QoS
+					p_table->proc[i].PROC_qosupdflag=PMAN_QOSUPD_NONE; // Reset QoS update flag
 					PMAN_DBG("(QoS update on process %s)", p_table->proc[i].PROC_name);
 
 					//printf("**(QoS update on process %s)**", p_table->proc[i].PROC_name);
@@ -1013,6 +1867,9 @@ int PMAN_tick(void)
 
 				//printf("[PMAN_tick] process %s ACTIV");
 				p_table->proc[i].PROC_status = PROC_S_ACTIV;
+#ifdef PMAN_TRACE
+				pman_trace_sched(i, PMAN_EVT_ACTIV, &now);
+#endif
 				check_release_flag = 1; // Signals that processes have become ready
 			}
 		}
@@ -1022,7 +1879,7 @@ int PMAN_tick(void)
 	(p_table->ticks)++;
 
 	/* Release mutex region */
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 
 	/* Release processes that became ready */
 	if(check_release_flag)
@@ -1054,7 +1911,7 @@ int PMAN_release(void)
 	if(p_table == NULL)
 		return -1;
 
-	sem_pwait(pman_sem_id);
+	pman_lock();
 
 	/* Scans the process table and activates processes*/
 	for(i=0;i<PROC_TABLE_SIZE;i++)
@@ -1064,27 +1921,32 @@ int PMAN_release(void)
 				if( p_table->proc[i].PROC_pred_mask == p_table->proc[i].PROC_pred_met) {
 					p_table->proc[i].PROC_pred_met = 0; // Reset precedence bitmap
 
-					if(kill(p_table->proc[i].PROC_id, PMAN_ACTIVATE_SIG))
+					pman_now(&p_table->proc[i].PROC_last_start);
+
+					if(p_table->proc[i].PROC_actmode == PMAN_ACT_FUTEX) {
+						/* Process blocked (or about to block) in PMAN_wait_activation */
+						__sync_fetch_and_add(&p_table->proc[i].PROC_actseq, 1);
+						pman_futex(&p_table->proc[i].PROC_actseq, FUTEX_WAKE, 1);
+					}
+					else if(kill(p_table->proc[i].PROC_id, PMAN_ACTIVATE_SIG))
 						if(errno == ESRCH) /* Process no longer exists */
 							p_killed_index[npid_killed++] = i;
 
-					gettimeofday(&p_table->proc[i].PROC_last_start, NULL);
-
 #ifdef PMAN_TRACE
-					p_table->evt_trace[p_table->evt_lastindex].pindex=i;
-					p_table->evt_trace[p_table->evt_lastindex].etype='R';
-					p_table->evt_trace[p_table->evt_lastindex].etime=p_table->proc[i].PROC_last_start;
-					p_table->evt_lastindex=(p_table->evt_lastindex+1) % PMAN_TRACE_SIZE;
-					if(p_table->evt_lastindex == p_table->evt_firstindex)
-						p_table->evt_firstindex+=1;
+					pman_trace_sched(i, PMAN_EVT_RELEASE, &p_table->proc[i].PROC_last_start);
 #endif
 
 					p_table->proc[i].PROC_status = PROC_S_READY;
+					p_table->proc[i].PROC_ddln_flag = 0; // New instance
 					p_table->proc[i].PROC_nact++;
 
 					PMAN_DBG(" activated [%s (%d)] ",p_table->proc[i].PROC_name, p_table->proc[i].PROC_id);
 				}
 				else {
+#ifdef PMAN_TRACE
+					if(p_table->proc[i].PROC_status == PROC_S_ACTIV) // Blocked by its predecessors from now on
+						pman_trace_sched(i, PMAN_EVT_PEND, NULL);
+#endif
 					p_table->proc[i].PROC_status = PROC_S_PEND;
 					PMAN_DBG(" pending [%s (%d)] ",p_table->proc[i].PROC_name, p_table->proc[i].PROC_id);
 				}
@@ -1092,7 +1954,7 @@ int PMAN_release(void)
 			}
 
 	/* Exit mutex */
-	sem_psignal(pman_sem_id);
+	pman_unlock();
 
 	/* Detach killed processes */
 	for(i=0;i<npid_killed;i++)
@@ -1100,31 +1962,3 @@ int PMAN_release(void)
 
 	return 0;
 }
-
-int linux_sched_fifo(int pindex)
-{
-	struct sched_param proc_sched;
-	int prio;
-	pid_t pid;
-	PROC_TYPE procdata;
-
-	procdata=p_table->proc[pindex];
-	prio = *( (int *)((int)procdata.PROC_qosdata+(void*)p_table));
-	pid=procdata.PROC_id;
-
-	fprintf(stderr, "\nMaster : <QoS, pindex=%d pid=%d prio=%d>\n",pindex, pid, prio);
-
-#if _POSIX_PRIORITY_SCHEDULING > 0
-	// Set the process priority and scheduling policy
-	proc_sched.sched_priority=prio;
-	if( sched_setscheduler(pid,SCHED_FIFO,&proc_sched) == -1)
-	{
-		fprintf(stderr,"linux_cshed: [QoS]: Error setting the priority (sched_setscheduler)!");
-		return -3;
-	}
-#endif
-
-	return 0;
-}
-
-
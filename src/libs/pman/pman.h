@@ -25,16 +25,24 @@
 
 #include <sys/types.h>
 #include <sys/time.h>
+#include <pthread.h>
+#include <stdio.h>
 
 /*
  * Defines
  *
  */
-#define PMAN_ACTIVATE_SIG	SIGCONT		// Signal used to activate processes
+#define PMAN_ACTIVATE_SIG	SIGCONT		// Signal used to activate processes (PMAN_ACT_SIGNAL)
+
+#define PMAN_ACT_SIGNAL		0			// Process activated by PMAN_ACTIVATE_SIG (default)
+#define PMAN_ACT_FUTEX		1			// Process blocks in PMAN_wait_activation (futex word in the process table)
 
 #define PMAN_ATTACH			1			// PMAN_init option: attach to an existing process table
 #define PMAN_NEW			0			// PMAN_init option: initialize a new process table
 
+#define PMAN_INSTANCE_ENV	"CAMBADA_INSTANCE"	// Instance namespace: shared memory key offset by <instance> << PMAN_INSTANCE_SHIFT
+#define PMAN_INSTANCE_SHIFT	16					// (same rule as the RTDB keys)
+
 #define PMAN_CLFREE			0			// Flag for PMAN_close. Release resources. Called by "scheduler" process 
 										//    (shared mem, semaphore and kills active processes). 
 #define PMAN_CLLEAVE		1			// Flag for PMAN_close. Deattaches from shared mem, only. Called by "client" processes 
@@ -59,6 +67,24 @@
 #define PMAN_NOPENDACT             0    // No pending activation on process
 #define PMAN_PENDACT               1    // Pending activation on process
 
+/* QoS policies (PMAN_QOS_DATA policy field, applied by the linux_qos hook) */
+#define PMAN_QOS_FIFO           0       // SCHED_FIFO with a fixed priority
+#define PMAN_QOS_DEADLINE       1       // SCHED_DEADLINE reservation (runtime / PROC_deadline / PROC_period)
+#define PMAN_QOS_OTHER          2       // SCHED_OTHER, no real-time guarantee
+
+#define PMAN_TICK_US        33333       // Default tick length (us), converts PROC_period to time (PMAN_tick_length)
+#define PMAN_CGROUP_DIR  "/sys/fs/cgroup" // Mount point of the cgroup hierarchy holding the cpusets
+
+/* Deadline miss policy (PMAN_ddln_policy), flags can be combined */
+#define PMAN_DDLN_COUNT         0x00    // Only count the miss (PROC_ndm)
+#define PMAN_DDLN_SKIP          0x01    // Skip the next activation of the process
+#define PMAN_DDLN_DEGRADE       0x02    // Call the QoS update hook (QoSupd), which may lower the process QoS
+#define PMAN_DDLN_NOTIFY        0x04    // Call the deadline exception hook (DdlnExcpt)
+
+/* Response time histogram (percentiles) */
+#define PMAN_RT_HIST_SIZE         64    // Number of buckets, the last one holds everything above
+#define PMAN_RT_HIST_STEP       1000    // Bucket width (us)
+
 /* Process status */
 #define PROC_S_EMPTY            0       // Process entry not filled up  
 #define PROC_S_ACTIV            1       // Process was activated (but not yet released)
@@ -69,7 +95,25 @@
 
 /* TRACE parameters */
 #define PMAN_TRACE
-#define PMAN_TRACE_SIZE     10000     // Number of events to record during trace ( events/sec = FPS*SUM(1/Period_i)*2 )
+#define PMAN_TRACE_SIZE       8192    // Scheduler events ring, power of 2 ( events/sec = FPS*SUM(1/Period_i)*4 )
+#define PMAN_TRACE_NSPAN        16    // Number of user span rings (one per producing thread)
+#define PMAN_TRACE_SPAN_SIZE  1024    // User span events ring, power of 2
+#define PMAN_TRACE_NAME_LEN     20    // Event name length (truncated process or span name)
+#define PMAN_TRACE_FLUSH_US  10000    // Trace writer thread period (us)
+
+#define PMAN_TRACE_MAGIC    0x43525450 // "PTRC", binary trace file
+#define PMAN_TRACE_VERSION  1
+
+/* Trace event types */
+#define PMAN_EVT_ACTIV         'A'    // Activated at a tick
+#define PMAN_EVT_PEND          'P'    // Activated, waiting for its predecessors
+#define PMAN_EVT_RELEASE       'R'    // Released (signal sent or futex woken)
+#define PMAN_EVT_WAKEUP        'W'    // Returned from PMAN_wait_activation
+#define PMAN_EVT_EPILOG        'E'    // PMAN_epilogue
+#define PMAN_EVT_MISS          'M'    // Deadline miss
+#define PMAN_EVT_SKIP          'S'    // Activation skipped (PMAN_DDLN_SKIP)
+#define PMAN_EVT_BEGIN         'B'    // User span begin
+#define PMAN_EVT_END           'F'    // User span end
 
 
 /*
@@ -78,12 +122,49 @@
  */
 #ifdef PMAN_TRACE
 typedef struct {
-  int pindex;            // Process index within PMAN table
-  int etype;             // Event type {[R]elease;[E]pilog}
-  struct timeval etime;  // Event time 
+  long long etime;       // Event time (us, wall clock even when the process runs on the virtual clock)
+  int pid;               // Process id
+  int tid;               // Thread id (equal to pid for scheduler events)
+  short pindex;          // Process index within PMAN table (PMAN_NOINDEX if not registered)
+  char etype;            // Event type {PMAN_EVT_*}
+  char pad;
+  char name[PMAN_TRACE_NAME_LEN]; // Process or span name (truncated, not terminated if full)
 } PROC_TRACE_DATA;
+
+/*
+ * Single producer, single consumer ring. Scheduler events are produced with
+ * the table locked, span events by the thread owning the ring; the only
+ * consumer is the trace writer (or PMAN_trace_save).
+ */
+typedef struct {
+  volatile unsigned int head;  // Next slot to write (producer)
+  volatile unsigned int tail;  // Next slot to read (consumer)
+  volatile int owner;          // Thread id of the producer (span rings, 0 = free)
+  unsigned int lost;           // Events dropped because the ring was full
+} PROC_TRACE_RING;
+
+/* Binary trace file header, followed by PROC_TRACE_DATA records (not time ordered) */
+typedef struct {
+  int magic;             // PMAN_TRACE_MAGIC
+  int version;           // PMAN_TRACE_VERSION
+  int evt_size;          // sizeof(PROC_TRACE_DATA)
+  int nprocs;            // PROC_TABLE_SIZE
+  char pname[PROC_TABLE_SIZE][PNAME_LEN+1]; // Process names when the trace started
+} PROC_TRACE_HEADER;
 #endif
 
+/*
+ * QoS data understood by linux_qos (table created with QoSdata_sz = sizeof(PMAN_QOS_DATA)).
+ * Tables created with QoSdata_sz = sizeof(int) only hold the priority.
+ */
+typedef struct {
+  int  prio;                    // SCHED_FIFO priority (first, same layout as the plain int QoS data)
+  int  policy;                  // {PMAN_QOS_*}
+  int  runtime;                 // CPU budget per period (us, PMAN_QOS_DEADLINE)
+  unsigned int cpus;            // Allowed cores bitmap (0 = any), not used by PMAN_QOS_DEADLINE
+  char cpuset[PNAME_LEN+1];     // cpuset cgroup (under PMAN_CGROUP_DIR) to move the process to, "" = none
+} PMAN_QOS_DATA;
+
 typedef struct {
   char PROC_name[PNAME_LEN+1];  // Process id string
   pid_t PROC_id;                // Process id
@@ -111,19 +192,51 @@ typedef struct {
   
   unsigned int PROC_nact;      // Number of activations
   unsigned int PROC_ndm;       // Number of deadline misses
+
+  /* Deadline monitoring (PROC_deadline > 0) */
+  int  PROC_ddln_policy;       // What to do on a miss {PMAN_DDLN_*}
+  char PROC_ddln_flag;         // Current instance already counted as a miss
+  char PROC_ddln_pend;         // Miss waiting for the policy hooks (run by the "manager" in PMAN_tick)
+  char PROC_skip;              // Next activation is skipped (PMAN_DDLN_SKIP)
+  unsigned int PROC_nskip;     // Number of skipped activations
+
+  /* Response time statistics, activation to epilogue (us) */
+  int  PROC_rt_last;
+  int  PROC_rt_min;
+  int  PROC_rt_max;
+  long long PROC_rt_sum;
+  unsigned int PROC_rt_n;      // Number of finished instances
+  unsigned int PROC_rt_hist[PMAN_RT_HIST_SIZE];
+
+  /* Activation */
+  int  PROC_actmode;           // Activation mechanism {PMAN_ACT_SIGNAL, PMAN_ACT_FUTEX}
+  unsigned int PROC_actseq;    // Futex word, incremented on each activation
+  int  PROC_act_lat;           // Activation latency, release to wake up, last instance (us)
+  int  PROC_act_lat_max;       // Maximum activation latency (us)
  
 } PROC_TYPE;
 
 typedef struct {
+  pthread_mutex_t lock; // Robust process shared mutex (mutual exclusion on the table)
+  int initialized;   // Set by the "manager" process once the table is ready
+  pid_t manager;     // Pid of the "manager" process (the only one where the hooks are valid)
+  int qosdata_sz;    // Size of the QoS data of each process
+  int tick_us;       // Tick length (us), see PMAN_tick_length
   int nprocs;        // Number of active processes registered
   int ticks;         // System "tick" counter
+  volatile int vclock;          // Set by the "manager": clients run on the virtual clock (PMAN_vclock_set)
+  volatile long long vtime;     // Virtual clock (us), see pman_vclock.c
+  unsigned int epilog_seq;      // Futex word, incremented by PMAN_epilogue while idle_waiters > 0
+  volatile int idle_waiters;    // Processes blocked in PMAN_wait_idle
   int (*QoSupd)();   // QoS update function hook
   int (*DdlnExcpt)();// Deadline exception handling hook
   PROC_TYPE proc[PROC_TABLE_SIZE];
 #ifdef PMAN_TRACE
-  int evt_lastindex;  // Index of last event recorded
-  int evt_firstindex; // Index of first event recorded
-  PROC_TRACE_DATA evt_trace[PMAN_TRACE_SIZE]; // Trace data
+  int trace_writer;   // Pid of the process draining the trace rings (0 = none)
+  PROC_TRACE_RING evt_ring;                      // Scheduler events
+  PROC_TRACE_DATA evt_trace[PMAN_TRACE_SIZE];
+  PROC_TRACE_RING span_ring[PMAN_TRACE_NSPAN];   // User spans
+  PROC_TRACE_DATA span_trace[PMAN_TRACE_NSPAN][PMAN_TRACE_SPAN_SIZE];
 #endif
 } PROC_TABLE_TYPE;
 
@@ -132,10 +245,13 @@ typedef struct {
 /* 
  * Global vars
  */
-extern int pman_sem_id;                // Semaphore ID (mutual exclusion)
+extern int pman_sem_id;                // Semaphore ID (unused, the table has its own mutex)
 extern int pman_shmem_id;              // Shared memory ID
 extern PROC_TABLE_TYPE * p_table; // Process table
 
+/* QoS data of the process at table index i */
+#define PMAN_QOSDATA(i) ((void *)((char *)p_table + p_table->proc[i].PROC_qosdata))
+
 /************************************************************/
 /*    To be used when more than a master exists             */
 /************************************************************/
@@ -186,17 +302,17 @@ extern "C" {
 /**
  * \brief Initializes the process table
  *
- * \param shmem_pman_key shared memory key
- * \param sem_pman_key sempahore key (mutual exclusion)
+ * \param shmem_pman_key shared memory key (offset by the instance namespace, PMAN_INSTANCE_ENV)
+ * \param sem_pman_key sempahore key (kept for compatibility, the table is protected by a process shared mutex)
  * \param QoSfun pointer to QoS manager function (only "manager" process)
  * \param QoSdata_sz size of QoS data structure
  * \param create_flags PMAN_NEW - Create a new process table 
  *                     PMAN_ATTACH - Attach to an existing process table
  *
  * \return  0 : Success
- *         -1 : Error creating shared memory region 
- *         -2 : Failed to create semaphore 
- *         -3 : Error setting the priority
+ *         -1 : Error creating shared memory region (or process table not initialized, PMAN_ATTACH)
+ *         -2 : Failed to create the table mutex
+ *         -3 : Error setting the priority (not reported when not allowed to, e.g. not root)
  *         -4 : Error allocating memory (QoS data)
  */
 int PMAN_init(key_t shmem_pman_key, key_t sem_pman_key, void * QoSfun, int QoSdata_sz, int create_flags);
@@ -222,7 +338,8 @@ int PMAN_close(int close_flags);
 /**
  * \brief Process release
  *
- * Checks for process activations and precedences and sends activation signals when appropriate
+ * Checks for process activations and precedences and activates processes when appropriate
+ * (PMAN_ACTIVATE_SIG or futex wake up, see PMAN_wait_activation)
  *               
  * \return  0 : success
  *         -1 : invalid process table pointer (null) 
@@ -245,6 +362,7 @@ int PMAN_release(void);
  *         -1 : invalid process table pointer (null) 
  *         -2 : process table full
  *         -3 : duplicated process id
+ *         -4 : QoS data larger than the table entries
  */
 int PMAN_procadd(char * p_name, int p_id, int p_period, int p_phase, int p_deadline, void * p_QoSdata, int p_QoSdata_sz);
 
@@ -304,6 +422,9 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ);
 /**
  * \brief Updates the QoS data of a specified process 
  *
+ * The QoS hook only exists in the "manager" process: an immediate update
+ * requested by any other process is carried out on the next PMAN_tick.
+ *
  * \param p_name                : process name (string)
  * \param QoSdata               : pointer to QoS data structure
  * \param QoSdata_sz            : size of QoS data structure
@@ -313,6 +434,7 @@ int PMAN_prec_add(char *p_name_pred, char *p_name_succ);
  *         -1 : invalid process table pointer (null) 
  *         -2 : process not found
  *         -3 : invalid when_flag
+ *         -4 : QoS data larger than the table entries
  */
 int PMAN_QoSupd(char * p_name, void * QoSdata, int QoSdata_sz, char when_flag);
 
@@ -346,6 +468,65 @@ int PMAN_msgupd(char * p_name, int p_period, int p_phase, int p_deadline, char w
 int PMAN_epilogue(char *p_name);
 
 
+/**
+ * \brief Blocks the calling process until its next activation
+ *
+ * The first call switches the process from signal activation to futex
+ * activation (PMAN_ACT_FUTEX), so PMAN_release no longer sends it
+ * PMAN_ACTIVATE_SIG. Activations released while the process was busy are
+ * not queued: the call returns once for all of them.
+ *
+ * \param p_name                : process name (string)
+ *
+ * \return  0 : activated
+ *         -1 : invalid process table pointer (null)
+ *         -2 : process not found
+ *         -3 : interrupted by a signal (no activation)
+ */
+int PMAN_wait_activation(char *p_name);
+
+
+/**
+ * \brief Sets the deadline miss policy of a process
+ *
+ * Misses are detected at PMAN_epilogue (response time above PROC_deadline)
+ * and at PMAN_tick (instance still running past its deadline), and always
+ * counted in PROC_ndm. The hooks of PMAN_DDLN_DEGRADE and PMAN_DDLN_NOTIFY
+ * are called by the "manager" process on its next PMAN_tick.
+ *
+ * \param p_name                : process name (string)
+ * \param policy                : PMAN_DDLN_* flags
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null)
+ *         -2 : process not found
+ */
+int PMAN_ddln_policy(char *p_name, int policy);
+
+
+/**
+ * \brief Installs the deadline exception hook (only "manager" process)
+ *
+ * \param DdlnFun               : int DdlnFun(int pindex), called for misses with PMAN_DDLN_NOTIFY
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null)
+ */
+int PMAN_ddln_handler(void *DdlnFun);
+
+
+/**
+ * \brief Response time percentile of a process
+ *
+ * \param pdata                 : process data (from PMAN_query)
+ * \param pct                   : percentile (0..100)
+ *
+ * \return upper bound of the percentile (us, PMAN_RT_HIST_STEP resolution),
+ *         -1 if no instance finished yet
+ */
+int PMAN_rt_percentile(const PROC_TYPE *pdata, int pct);
+
+
 /**
  * \brief Queries the contents of the process table 
  * 
@@ -378,17 +559,125 @@ int PMAN_print(void);
 int PMAN_print_prec(void);
 
 
+/**
+ * \brief Prints the activation, deadline and response time statistics of the process table
+ * 
+ * \param fout : output stream
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null) 
+ */
+int PMAN_print_stats(FILE *fout);
+
+
 #ifdef PMAN_TRACE
-  int PMAN_trace_save(void);
+/**
+ * \brief Saves the pending scheduler events as text (<time>-trace.txt)
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null) 
+ *         -2 : no trace data to save
+ *         -3 : a trace writer is draining the rings
+ */
+int PMAN_trace_save(void);
+
+
+/**
+ * \brief Starts a thread that continuously drains the trace rings to a binary file
+ *
+ * Only one writer may drain a process table. The writer keeps working on the
+ * table that was current when it was started (see pman_switch_id), and is
+ * stopped by PMAN_trace_stop or PMAN_close.
+ *
+ * \param fname                 : trace file name
+ *
+ * \return >= 0 : writer id
+ *           -1 : invalid process table pointer (null)
+ *           -2 : the table already has a trace writer
+ *           -3 : can't create the trace file
+ *           -4 : can't start the writer thread
+ *           -5 : no free writer slot (MAX_MASTER_INSTANCE writers running)
+ */
+int PMAN_trace_start(const char *fname);
+
+
+/**
+ * \brief Stops a trace writer, draining the remaining events
+ *
+ * \param writer                : writer id (PMAN_trace_start)
+ *
+ * \return  0 : success
+ *         -1 : invalid writer
+ */
+int PMAN_trace_stop(int writer);
+
+
+/**
+ * \brief Marks the begin/end of a user span on the calling thread
+ *
+ * Lock free once the thread owns a span ring (claimed on the first call).
+ * Spans of the same thread must be properly nested.
+ *
+ * \param name                  : span name (truncated to PMAN_TRACE_NAME_LEN)
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null, span ignored)
+ *         -2 : no free span ring (span ignored)
+ */
+int PMAN_span_begin(const char *name);
+int PMAN_span_end(const char *name);
+#else
+#define PMAN_span_begin(name) (-1)
+#define PMAN_span_end(name) (-1)
 #endif
 
 
+/**
+ * \brief Blocks the calling process until no activated process is left running
+ *
+ * Used by a "manager" running in lock step with its clients: after PMAN_tick
+ * it waits for the PMAN_epilogue of every process that the tick (or its
+ * precedences) activated. Entries whose process no longer exists are ignored.
+ *
+ * \param timeout_us            : maximum waiting time (us, wall clock), <= 0 waits forever
+ *
+ * \return  0 : all processes idle
+ *         -1 : invalid process table pointer (null)
+ *         -2 : timeout
+ */
+int PMAN_wait_idle(int timeout_us);
+
+
+/**
+ * \brief Sets the virtual clock of the process table (only "manager" process)
+ *
+ * Clients linked with pman_vclock read gettimeofday from the table once a
+ * virtual time was set, so they follow the simulated time instead of the
+ * wall clock. The scheduler statistics and traces always use the wall clock.
+ *
+ * \param vtime                 : virtual time (us since the epoch), < 0 returns to the wall clock
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null)
+ */
+int PMAN_vclock_set(long long vtime);
+
+
+/**
+ * \brief Checks if the calling process runs on the virtual clock
+ *
+ * \return  1 : gettimeofday returns the virtual time (pman_vclock linked and clock set)
+ *          0 : wall clock
+ */
+int PMAN_vclock(void);
+
+
 /**
  * \brief "System tick". 
  *
  * Should be called every basic time unit (whatever it is).
  *  Checks for process activations; sends activation signals
- *  Checks for missed deadlines (TODO)
+ *  Checks for missed deadlines and runs the miss policy hooks
  *
  * \return  0 : success
  *         -1 : invalid process table pointer (null) 
@@ -396,8 +685,49 @@ int PMAN_print_prec(void);
 int PMAN_tick(void);  
 
 
-/** \todo Is function linux_sched_fifo public? */
+/**
+ * \brief Sets the tick length, used to convert PROC_period to time (only "manager" process)
+ *
+ * \param tick_us               : time between PMAN_tick calls (us)
+ *
+ * \return  0 : success
+ *         -1 : invalid process table pointer (null)
+ *         -2 : invalid tick length
+ */
+int PMAN_tick_length(int tick_us);
+
+
+/**
+ * \brief Adds the processes listed in a configuration file to the process table
+ *
+ * One process per line (# starts a comment):
+ *   name period phase deadline prio [policy runtime cpus [cpuset]]
+ * policy is fifo, deadline or other, runtime in us, cpus an allowed cores
+ * bitmap (e.g. 0x3, 0 = any). The optional fields need a table created with
+ * QoSdata_sz = sizeof(PMAN_QOS_DATA).
+ *
+ * \param fname                 : configuration file name
+ *
+ * \return >= 0 : number of processes added
+ *           -1 : invalid process table pointer (null)
+ *           -2 : can't open the file
+ *           -3 : syntax error (processes before the bad line were added)
+ *           -4 : PMAN_procadd failed
+ */
+int PMAN_conf_load(const char *fname);
+
+
+/*
+ * QoS hooks (PMAN_init QoSfun), called by the "manager" process with the
+ * table index of the process whose QoS data must be applied.
+ *
+ *   linux_sched_fifo : SCHED_FIFO with the priority in the QoS data
+ *   linux_qos        : applies PMAN_QOS_DATA (policy, cpuset and affinity)
+ *
+ * Return 0 on success, < 0 if the OS refused the setting (see stderr).
+ */
 int linux_sched_fifo(int pindex);
+int linux_qos(int pindex);
 
   
 #ifdef __cplusplus
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA PMAN
+ *
+ * CAMBADA PMAN is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA PMAN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * QoS policies (hooks called by the "manager" process, see PMAN_init) and
+ * the process configuration file loader.
+ */
+
+#define _GNU_SOURCE		// sched_setaffinity, cpu_set_t
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <pman.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE	6
+#endif
+
+/* sched_setattr argument (not wrapped by older glibc) */
+struct pman_sched_attr {
+	unsigned int size;
+	unsigned int sched_policy;
+	unsigned long long sched_flags;
+	int sched_nice;
+	unsigned int sched_priority;
+	unsigned long long sched_runtime;		// ns
+	unsigned long long sched_deadline;		// ns
+	unsigned long long sched_period;		// ns
+};
+
+
+/*
+ * Moves a process to a cpuset cgroup. The cpuset (its cores, and for
+ * SCHED_DEADLINE an exclusive partition) must have been created beforehand.
+ */
+static int pman_qos_cpuset(pid_t pid, const char *cpuset)
+{
+	char fname[256];
+	FILE *f;
+
+	/* cgroup v2, then the v1 cpuset hierarchy */
+	snprintf(fname, sizeof(fname), "%s/%s/cgroup.procs", PMAN_CGROUP_DIR, cpuset);
+	if(!(f = fopen(fname, "w"))) {
+		snprintf(fname, sizeof(fname), "%s/cpuset/%s/cgroup.procs", PMAN_CGROUP_DIR, cpuset);
+		if(!(f = fopen(fname, "w")))
+			return -1;
+	}
+
+	fprintf(f, "%d\n", pid);
+	if(fclose(f) != 0)
+		return -1;
+
+	return 0;
+}
+
+/* Restricts a process to the cores in a bitmap (0 = any core) */
+static int pman_qos_affinity(pid_t pid, unsigned int cpus)
+{
+	cpu_set_t mask;
+	unsigned int c;
+
+	CPU_ZERO(&mask);
+	for(c=0;c<CPU_SETSIZE;c++)
+		if(cpus == 0 || (c < 8*sizeof(cpus) && (cpus & (1u << c))))
+			CPU_SET(c, &mask);
+
+	return sched_setaffinity(pid, sizeof(mask), &mask);
+}
+
+static int pman_qos_deadline(int pindex, const PMAN_QOS_DATA *qos)
+{
+#ifdef SYS_sched_setattr
+	struct pman_sched_attr attr;
+	PROC_TYPE *proc = &p_table->proc[pindex];
+	long long period, deadline, runtime;
+
+	/* runtime <= deadline <= period, in ns */
+	period = (long long)proc->PROC_period * p_table->tick_us * 1000;
+	deadline = (proc->PROC_deadline > 0) ? (long long)proc->PROC_deadline * 1000 : period;
+	if(deadline > period)
+		deadline = period;
+	runtime = (long long)qos->runtime * 1000;
+	if(runtime <= 0 || runtime > deadline) {
+		fprintf(stderr, "linux_qos: [%s]: invalid SCHED_DEADLINE runtime %d us (deadline %lld us)\n",
+				proc->PROC_name, qos->runtime, deadline/1000);
+		return -2;
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.sched_policy = SCHED_DEADLINE;
+	attr.sched_runtime = runtime;
+	attr.sched_deadline = deadline;
+	attr.sched_period = period;
+
+	/* Deadline tasks can't have a reduced affinity: undo a previous pinning (the cpuset still applies) */
+	pman_qos_affinity(proc->PROC_id, 0);
+
+	if(syscall(SYS_sched_setattr, proc->PROC_id, &attr, 0) == -1) {
+		fprintf(stderr, "linux_qos: [%s]: SCHED_DEADLINE %lld/%lld/%lld us refused (%s)\n",
+				proc->PROC_name, runtime/1000, deadline/1000, period/1000, strerror(errno));
+		return -3;
+	}
+
+	return 0;
+#else
+	(void)qos;
+	fprintf(stderr, "linux_qos: [%s]: SCHED_DEADLINE not supported\n", p_table->proc[pindex].PROC_name);
+	return -3;
+#endif
+}
+
+
+/*
+ * Sets SCHED_FIFO with the priority in the QoS data (int or PMAN_QOS_DATA)
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             pindex                : process index
+ *
+ * Returns:     0 : success
+ *             -3 : error setting the priority
+ */
+int linux_sched_fifo(int pindex)
+{
+	struct sched_param proc_sched;
+	int prio;
+	pid_t pid;
+
+	prio = *(int *)PMAN_QOSDATA(pindex);
+	pid = p_table->proc[pindex].PROC_id;
+
+	fprintf(stderr, "\nMaster : <QoS, pindex=%d pid=%d prio=%d>\n",pindex, pid, prio);
+
+#if _POSIX_PRIORITY_SCHEDULING > 0
+	// Set the process priority and scheduling policy
+	proc_sched.sched_priority=prio;
+	if( sched_setscheduler(pid,SCHED_FIFO,&proc_sched) == -1)
+	{
+		fprintf(stderr,"linux_cshed: [QoS]: Error setting the priority (sched_setscheduler)!");
+		return -3;
+	}
+#endif
+
+	return 0;
+}
+
+
+/*
+ * Applies the PMAN_QOS_DATA of a process: cpuset, affinity and scheduling policy
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             pindex                : process index
+ *
+ * Returns:     0 : success
+ *             -1 : error moving the process to its cpuset
+ *             -2 : invalid QoS data
+ *             -3 : error setting the scheduling policy
+ *             -4 : error setting the affinity
+ */
+int linux_qos(int pindex)
+{
+	PMAN_QOS_DATA qos;
+	struct sched_param proc_sched;
+	pid_t pid = p_table->proc[pindex].PROC_id;
+
+	/* Table holding only the priority */
+	if(p_table->qosdata_sz < (int)sizeof(PMAN_QOS_DATA))
+		return linux_sched_fifo(pindex);
+
+	memcpy(&qos, PMAN_QOSDATA(pindex), sizeof(qos));
+	qos.cpuset[PNAME_LEN] = 0;
+
+	fprintf(stderr, "\nMaster : <QoS, pindex=%d pid=%d policy=%d prio=%d runtime=%d cpus=%x cpuset=%s>\n",
+			pindex, pid, qos.policy, qos.prio, qos.runtime, qos.cpus, qos.cpuset);
+
+	if(qos.cpuset[0] != 0 && pman_qos_cpuset(pid, qos.cpuset) == -1) {
+		fprintf(stderr, "linux_qos: [%s]: can't move to cpuset %s (%s)\n",
+				p_table->proc[pindex].PROC_name, qos.cpuset, strerror(errno));
+		return -1;
+	}
+
+	switch(qos.policy)
+	{
+	case PMAN_QOS_DEADLINE:
+		return pman_qos_deadline(pindex, &qos);
+
+	case PMAN_QOS_FIFO:
+	case PMAN_QOS_OTHER:
+		/* Also leaves SCHED_DEADLINE, which would refuse the new affinity */
+		proc_sched.sched_priority = (qos.policy == PMAN_QOS_FIFO) ? qos.prio : 0;
+		if(sched_setscheduler(pid, (qos.policy == PMAN_QOS_FIFO) ? SCHED_FIFO : SCHED_OTHER, &proc_sched) == -1) {
+			fprintf(stderr, "linux_qos: [%s]: sched_setscheduler refused (%s)\n",
+					p_table->proc[pindex].PROC_name, strerror(errno));
+			return -3;
+		}
+		if(pman_qos_affinity(pid, qos.cpus) == -1) {
+			fprintf(stderr, "linux_qos: [%s]: sched_setaffinity(%x) refused (%s)\n",
+					p_table->proc[pindex].PROC_name, qos.cpus, strerror(errno));
+			return -4;
+		}
+		return 0;
+	}
+
+	return -2;
+}
+
+
+/*
+ * Adds the processes listed in a configuration file to the process table
+ *
+ * Input args: (global var) *p_table : pointer to the process table data structure
+ *             fname                 : configuration file name
+ *
+ * Returns:  >= 0 : number of processes added
+ *             -1 : invalid process table pointer (null)
+ *             -2 : can't open the file
+ *             -3 : syntax error
+ *             -4 : PMAN_procadd failed
+ */
+int PMAN_conf_load(const char *fname)
+{
+	FILE *f;
+	char line[256], pname[PNAME_LEN+1], policy[16];
+	int nv, n = 0, retval = 0;
+	int pper, ppha, pddln;
+	PMAN_QOS_DATA qos;
+
+	if(p_table == NULL)
+		return -1;
+
+	if(!(f = fopen(fname, "r")))
+		return -2;
+
+	while(retval == 0 && fgets(line, sizeof(line), f)) {
+		memset(&qos, 0, sizeof(qos));
+		policy[0] = 0;
+
+		if(line[strspn(line, " \t")] == '#')
+			continue;
+
+		// process- {name, period, phase, deadline, priority [, policy, runtime, cpus [, cpuset]]}
+		nv = sscanf(line, "%32s %d %d %d %d %15s %d %i %32s", pname, &pper, &ppha, &pddln, &qos.prio,
+				policy, &qos.runtime, (int *)&qos.cpus, qos.cpuset);
+		if(nv <= 0)
+			continue;	// blank line
+
+		if(nv < 5 || (nv > 5 && nv < 8)) {
+			fprintf(stderr, "[PMAN_conf_load]: %s: bad line: %s", fname, line);
+			retval = -3;
+			break;
+		}
+
+		if(nv == 5 || strcmp(policy, "fifo") == 0)
+			qos.policy = PMAN_QOS_FIFO;
+		else if(strcmp(policy, "deadline") == 0)
+			qos.policy = PMAN_QOS_DEADLINE;
+		else if(strcmp(policy, "other") == 0)
+			qos.policy = PMAN_QOS_OTHER;
+		else {
+			fprintf(stderr, "[PMAN_conf_load]: %s: unknown policy %s\n", fname, policy);
+			retval = -3;
+			break;
+		}
+
+		/* Tables created for the priority only keep that (the extra fields are ignored) */
+		if(PMAN_procadd(pname, PMAN_NOPID, pper, ppha, pddln, &qos,
+				(p_table->qosdata_sz < (int)sizeof(qos)) ? p_table->qosdata_sz : (int)sizeof(qos)) != 0)
+			retval = -4;
+		else
+			n++;
+	}
+
+	fclose(f);
+	return (retval < 0) ? retval : n;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA PMAN
+ *
+ * CAMBADA PMAN is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA PMAN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Virtual clock for the processes managed by a lock step "manager" (the
+// simulator, see PMAN_wait_idle). Linking this file into a client overrides
+// gettimeofday: once the "manager" set a virtual time (PMAN_vclock_set) every
+// timer, RTDB record life and timeout of the client follows the simulated time,
+// which only advances between activations. Otherwise it is the wall clock.
+
+// hide the libc prototype, gettimeofday is redefined below
+#define gettimeofday __pman_vclock_libc_gettimeofday
+#include <sys/time.h>
+#undef gettimeofday
+
+#include <time.h>
+
+#include <pman.h>
+
+
+int gettimeofday (struct timeval *tv, void *tz)
+{
+	struct timespec ts;
+	long long vtime;
+
+	(void)tz;
+	if (tv == NULL)
+		return 0;
+
+	if (PMAN_vclock())
+	{
+		vtime = p_table->vtime;
+		tv->tv_sec = vtime / 1000000LL;
+		tv->tv_usec = vtime % 1000000LL;
+	}
+	else
+	{
+		// not the syscall: the vDSO clock is as cheap as the libc gettimeofday
+		clock_gettime(CLOCK_REALTIME, &ts);
+		tv->tv_sec = ts.tv_sec;
+		tv->tv_usec = ts.tv_nsec / 1000;
+	}
+	return 0;
+}
+
+
+int PMAN_vclock (void)
+{
+	return (p_table != NULL && p_table->vclock);
+}
@@ -32,6 +32,7 @@
 
 
 #include "rtdbdefs.h"
+#include "rtdb_replay.h"
 
 
 //#define DEBUG
@@ -121,6 +122,35 @@ void DB_set_config_file(const char* cf){
   return;
 }
 
+// Record timestamps clock (us), NULL = gettimeofday
+static long long (*rtdbClock)(void) = NULL;
+
+/**
+ *  Change the clock used to timestamp and age the records, so a process
+ *  that can't replace gettimeofday (the lock step simulator) agrees with
+ *  the agents running on its virtual clock.
+ *
+ *  @param clock Current time (us), NULL restores gettimeofday
+*/
+void DB_set_clock(long long (*clock)(void)){
+  rtdbClock = clock;
+}
+
+static void rtdb_gettime(struct timeval *time)
+{
+	long long now;
+
+	if (rtdbClock == NULL)
+	{
+		gettimeofday(time, NULL);
+		return;
+	}
+
+	now = rtdbClock();
+	time->tv_sec = now / 1000000LL;
+	time->tv_usec = now % 1000000LL;
+}
+
 //	*************************
 //	read_configuration: CONFIG_FILE parser
 //
@@ -287,6 +317,21 @@ void DB_free_all (int _second_rtdb)
 
 
 
+//	*************************
+//	rtdb_instance_key: offset of the shared memory keys of this instance
+//		(INSTANCE_ENV, 0 when not set)
+//
+static int rtdb_instance_key (void)
+{
+	char *environment;
+
+	if ((environment = getenv(INSTANCE_ENV)) == NULL)
+		return 0;
+	return atoi(environment) << INSTANCE_KEY_SHIFT;
+}
+
+
+
 //	*************************
 //	DB_initialization: RTDB init
 //
@@ -310,7 +355,7 @@ int DB_initialization (int _agent, int _second_rtdb)
 	RTDBconf_agents rtdb_conf[MAX_AGENTS];
 
 	// malloc
-  key = SHMEM_KEY + (_agent * MAX_AGENTS * 4);
+  key = SHMEM_KEY + rtdb_instance_key() + (_agent * MAX_AGENTS * 4);
   
 	def_shmid[_agent] = shmget(key, sizeof(RTDBdef), 0644 | IPC_CREAT);
 	if (def_shmid[_agent] == -1)
@@ -564,7 +609,7 @@ int DB_put_in (int _agent, int _to_agent, int _id, void *_value, int life)
 	p_data = (void*)((char*)(p_rec) + p_rec->offset + write_bank * p_rec->size);
 	memcpy(p_data, _value, p_rec->size);
 
-	gettimeofday(&time, NULL);
+	rtdb_gettime(&time);
 	p_rec->timestamp[write_bank].tv_sec = time.tv_sec - life / 1000;
 	p_rec->timestamp[write_bank].tv_usec = time.tv_usec - (life % 1000) * 1000;
 
@@ -671,7 +716,7 @@ int DB_get_from (int _agent, int _from_agent, int _id, void *_value)
 
 	memcpy(_value, (char *)p_data + (p_rec->read_bank * p_rec->size), p_rec->size);
 
-	gettimeofday(&time, NULL);
+	rtdb_gettime(&time);
 	life = (int)(((time.tv_sec - (p_rec->timestamp[p_rec->read_bank]).tv_sec) * 1E3) + ((time.tv_usec - (p_rec->timestamp[p_rec->read_bank]).tv_usec) / 1E3));
 
 	PDEBUG("agent: %d, from_agent: %d, id: %d, read_bank: %d, life: %umsec", _agent, _from_agent, p_rec->id, p_rec->read_bank, life);
@@ -745,3 +790,168 @@ int DB_comm_ini(RTDBconf_var *rec)
 
 	return n_shared_recs;
 }
+
+
+
+//	*************************
+//	Recording of the RTDB contents (see rtdb_replay.h for the file layout)
+//
+static FILE *rec_file = NULL;
+
+
+//	*************************
+//	rec_find: pointer to the record of the running agent
+//
+//	output:
+//		pointer to the record
+//		NULL = unknown record
+//
+static TRec *rec_find (int _from_agent, int _id)
+{
+	int lut;
+
+	if ((lut = p_def[__agent]->rec_lut[_from_agent][_id]) == -1)
+		return NULL;
+
+	if (lut < MAX_RECS)
+		return (TRec*)((char*)(p_shared_mem[__agent][_from_agent]) + lut * sizeof(TRec));
+	else
+		return (TRec*)((char*)(p_local_mem[__agent]) + (lut - MAX_RECS) * sizeof(TRec));
+}
+
+
+
+//	*************************
+//	DB_record_open: start recording the RTDB contents seen by the running agent
+//
+//	input:
+//		const char *file = recording file name
+//	output:
+//		0 = OK
+//		-1 = error
+//
+int DB_record_open (const char *file)
+{
+	int i, j;
+	TRec *p_rec;
+	RTDBrec_header header;
+	RTDBrec_schema schema;
+
+	if (__agent == -1)
+	{
+		PERR("RTDB not initialized");
+		return -1;
+	}
+
+	DB_record_close();
+
+	if ((rec_file = fopen(file, "wb")) == NULL)
+	{
+		PERRNO("fopen");
+		return -1;
+	}
+
+	header.magic = RTDB_REC_MAGIC;
+	header.version = RTDB_REC_VERSION;
+	header.self_agent = __agent;
+	header.n_schema = 0;
+	for (i = 0; i < p_def[__agent]->n_agents; i++)
+		for (j = 0; j < MAX_RECS; j++)
+			if (p_def[__agent]->rec_lut[i][j] != -1)
+				header.n_schema ++;
+
+	fwrite(&header, sizeof(header), 1, rec_file);
+
+	for (i = 0; i < p_def[__agent]->n_agents; i++)
+		for (j = 0; j < MAX_RECS; j++)
+		{
+			if ((p_rec = rec_find(i, j)) == NULL)
+				continue;
+			schema.agent = i;
+			schema.id = j;
+			schema.size = p_rec->size;
+			fwrite(&schema, sizeof(schema), 1, rec_file);
+		}
+
+	if (ferror(rec_file))
+	{
+		PERR("Error writing the recording header");
+		DB_record_close();
+		return -1;
+	}
+
+	return 0;
+}
+
+
+
+//	*************************
+//	DB_record_frame: append a snapshot of every readable record to the recording
+//
+//	output:
+//		0 = OK
+//		-1 = error (or not recording)
+//
+int DB_record_frame (void)
+{
+	int i, j;
+	TRec *p_rec;
+	RTDBrec_frame frame;
+	RTDBrec_item item;
+	struct timeval time;
+	char *p_data;
+
+	if (rec_file == NULL)
+		return -1;
+
+	rtdb_gettime(&time);
+
+	frame.magic = RTDB_REC_FRAME;
+	frame.n_items = 0;
+	frame.time = (long long)time.tv_sec * 1000000LL + time.tv_usec;
+	for (i = 0; i < p_def[__agent]->n_agents; i++)
+		for (j = 0; j < MAX_RECS; j++)
+			if (p_def[__agent]->rec_lut[i][j] != -1)
+				frame.n_items ++;
+
+	fwrite(&frame, sizeof(frame), 1, rec_file);
+
+	for (i = 0; i < p_def[__agent]->n_agents; i++)
+		for (j = 0; j < MAX_RECS; j++)
+		{
+			if ((p_rec = rec_find(i, j)) == NULL)
+				continue;
+
+			// read bank and timestamp are taken together, as in DB_get_from
+			p_data = (char*)(p_rec) + p_rec->offset + p_rec->read_bank * p_rec->size;
+			item.agent = i;
+			item.id = j;
+			item.life = (int)(((time.tv_sec - (p_rec->timestamp[p_rec->read_bank]).tv_sec) * 1E3) + ((time.tv_usec - (p_rec->timestamp[p_rec->read_bank]).tv_usec) / 1E3));
+
+			fwrite(&item, sizeof(item), 1, rec_file);
+			fwrite(p_data, p_rec->size, 1, rec_file);
+		}
+
+	if (ferror(rec_file))
+	{
+		PERR("Error writing the recording, stopping");
+		DB_record_close();
+		return -1;
+	}
+
+	return 0;
+}
+
+
+
+//	*************************
+//	DB_record_close: stop recording
+//
+void DB_record_close (void)
+{
+	if (rec_file == NULL)
+		return;
+
+	fclose(rec_file);
+	rec_file = NULL;
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA RTDB
+ *
+ * CAMBADA RTDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA RTDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// In-process RTDB fed from a recording made with DB_record_open/DB_record_frame.
+// It implements the same API as rtdb_api.c, so the agent code runs unchanged,
+// and it provides a virtual clock: gettimeofday returns the time of the
+// recorded frame, so every timer, record life and timeout in the agent sees
+// exactly what it saw when the recording was made.
+
+// hide the libc prototype, gettimeofday is redefined below
+#define gettimeofday __rtdb_replay_libc_gettimeofday
+#include <sys/time.h>
+#undef gettimeofday
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rtdbdefs.h"
+#include "rtdb_replay.h"
+
+
+#define PERRNO(txt) \
+	printf("ERROR: (%s / %s): " txt ": %s\n", __FILE__, __FUNCTION__, strerror(errno))
+
+#define PERR(txt, par...) \
+	printf("ERROR: (%s / %s): " txt "\n", __FILE__, __FUNCTION__, ## par)
+
+
+typedef struct
+{
+	int size;						// 0 if the record is unknown
+	void *data;
+	long long timestamp;			// virtual clock when the record was written (us)
+	int written;					// written by the agent since the last frame
+} TReplayRec;
+
+
+static FILE *replay_file = NULL;
+static TReplayRec replay_recs[MAX_AGENTS][MAX_RECS];
+static int replay_agent = -1;
+static long long replay_clock = 0;
+static int replay_pending = 0;		// first frame loaded by DB_replay_open
+static int replay_frames = 0;		// frames loaded so far
+
+
+int gettimeofday (struct timeval *tv, void *tz)
+{
+	(void)tz;
+	if (tv != NULL)
+	{
+		tv->tv_sec = replay_clock / 1000000LL;
+		tv->tv_usec = replay_clock % 1000000LL;
+	}
+	return 0;
+}
+
+
+
+//	*************************
+//	replay_read_frame: load one frame of the recording
+//
+//	output:
+//		1 = frame loaded
+//		0 = end of recording
+//		-1 = error (or truncated frame)
+//
+static int replay_read_frame (void)
+{
+	int i;
+	size_t n;
+	long offset;
+	RTDBrec_frame frame;
+	RTDBrec_item item;
+	TReplayRec *p_rec;
+
+	// only a recording ending exactly at a frame boundary ends cleanly
+	offset = ftell(replay_file);
+	n = fread(&frame, 1, sizeof(frame), replay_file);
+	if ((n == 0) && feof(replay_file))
+		return 0;
+	if (n != sizeof(frame))
+		goto truncated;
+
+	if (frame.magic != RTDB_REC_FRAME)
+	{
+		PERR("Corrupted recording");
+		return -1;
+	}
+
+	replay_clock = frame.time;
+
+	for (i = 0; i < frame.n_items; i++)
+	{
+		if (fread(&item, sizeof(item), 1, replay_file) != 1)
+			goto truncated;
+
+		if ((item.agent < 0) || (item.agent >= MAX_AGENTS) || (item.id < 0) || (item.id >= MAX_RECS)
+				|| (replay_recs[item.agent][item.id].size == 0))
+		{
+			PERR("Record %d for agent %d not in the recording schema", item.id, item.agent);
+			return -1;
+		}
+
+		p_rec = &replay_recs[item.agent][item.id];
+		if (fread(p_rec->data, p_rec->size, 1, replay_file) != 1)
+			goto truncated;
+		p_rec->timestamp = replay_clock - (long long)item.life * 1000LL;
+	}
+
+	for (i = 0; i < MAX_RECS; i++)
+		replay_recs[replay_agent][i].written = 0;
+
+	replay_frames++;
+	return 1;
+
+truncated:
+	PERR("Truncated recording: frame %d at byte offset %ld is incomplete", replay_frames, offset);
+	return -1;
+}
+
+
+
+//	*************************
+//	DB_replay_open: replace the shared memory RTDB by an in-process one
+//		fed from a recording
+//
+//	output:
+//		0 = OK
+//		-1 = error
+//
+int DB_replay_open (const char *file)
+{
+	int i;
+	RTDBrec_header header;
+	RTDBrec_schema schema;
+
+	DB_replay_close();
+
+	if ((replay_file = fopen(file, "rb")) == NULL)
+	{
+		PERRNO("fopen");
+		return -1;
+	}
+
+	if ((fread(&header, sizeof(header), 1, replay_file) != 1) || (header.magic != RTDB_REC_MAGIC))
+	{
+		PERR("%s is not an RTDB recording", file);
+		DB_replay_close();
+		return -1;
+	}
+
+	if (header.version != RTDB_REC_VERSION)
+	{
+		PERR("Unsupported recording version %d", header.version);
+		DB_replay_close();
+		return -1;
+	}
+
+	if ((header.self_agent < 0) || (header.self_agent >= MAX_AGENTS))
+	{
+		PERR("Invalid agent %d in the recording", header.self_agent);
+		DB_replay_close();
+		return -1;
+	}
+
+	for (i = 0; i < header.n_schema; i++)
+	{
+		if (fread(&schema, sizeof(schema), 1, replay_file) != 1)
+		{
+			PERR("Truncated recording schema");
+			DB_replay_close();
+			return -1;
+		}
+		if ((schema.agent < 0) || (schema.agent >= MAX_AGENTS) || (schema.id < 0) || (schema.id >= MAX_RECS) || (schema.size <= 0))
+		{
+			PERR("Invalid schema entry %d", i);
+			DB_replay_close();
+			return -1;
+		}
+		replay_recs[schema.agent][schema.id].size = schema.size;
+		replay_recs[schema.agent][schema.id].data = calloc(1, schema.size);
+		replay_recs[schema.agent][schema.id].timestamp = 0;
+	}
+
+	replay_agent = header.self_agent;
+	replay_frames = 0;
+
+	// the first frame sets the clock before the agent is built
+	if ((i = replay_read_frame()) != 1)
+	{
+		if (i == 0)
+			PERR("Empty recording");
+		DB_replay_close();
+		return -1;
+	}
+	replay_pending = 1;
+
+	return 0;
+}
+
+
+
+//	*************************
+//	DB_replay_next: load the next recorded frame and advance the virtual clock
+//
+//	output:
+//		1 = frame loaded
+//		0 = end of recording
+//		-1 = error (or truncated frame)
+//
+int DB_replay_next (void)
+{
+	if (replay_file == NULL)
+		return -1;
+
+	if (replay_pending)
+	{
+		replay_pending = 0;
+		return 1;
+	}
+
+	return replay_read_frame();
+}
+
+
+
+int DB_replay_written (int _id)
+{
+	if ((replay_agent == -1) || (_id < 0) || (_id >= MAX_RECS))
+		return 0;
+	return replay_recs[replay_agent][_id].written;
+}
+
+
+
+long long DB_replay_time (void)
+{
+	return replay_clock;
+}
+
+
+
+void DB_replay_close (void)
+{
+	int i, j;
+
+	if (replay_file != NULL)
+		fclose(replay_file);
+	replay_file = NULL;
+
+	for (i = 0; i < MAX_AGENTS; i++)
+		for (j = 0; j < MAX_RECS; j++)
+		{
+			free(replay_recs[i][j].data);
+			replay_recs[i][j].data = NULL;
+			replay_recs[i][j].size = 0;
+		}
+
+	replay_agent = -1;
+	replay_pending = 0;
+	replay_frames = 0;
+}
+
+
+
+//	*************************
+//	RTDB API on top of the recording
+//
+int DB_init (void)
+{
+	if (replay_agent == -1)
+	{
+		PERR("DB_replay_open must be called before DB_init");
+		return -1;
+	}
+	return 0;
+}
+
+
+
+void DB_free (void)
+{
+}
+
+
+
+void DB_set_config_file (const char* cf)
+{
+	(void)cf;		// the records are defined by the recording schema
+}
+
+
+
+int DB_put_in (int _agent, int _to_agent, int _id, void *_value, int life)
+{
+	TReplayRec *p_rec;
+
+	(void)_agent;
+
+	if (_to_agent == SELF)
+		_to_agent = replay_agent;
+
+	if ((_to_agent < 0) || (_to_agent >= MAX_AGENTS) || (_id < 0) || (_id >= MAX_RECS)
+			|| (replay_recs[_to_agent][_id].size == 0))
+	{
+		PERR("Unknown record %d for agent %d", _id, _to_agent);
+		return -1;
+	}
+
+	p_rec = &replay_recs[_to_agent][_id];
+	memcpy(p_rec->data, _value, p_rec->size);
+	p_rec->timestamp = replay_clock - (long long)life * 1000LL;
+	p_rec->written = 1;
+
+	return p_rec->size;
+}
+
+
+
+int DB_comm_put (int _to_agent, int _id, int _size, void *_value, int _life)
+{
+	(void)_size;
+
+	if ((_to_agent == SELF) || (_to_agent == replay_agent))
+	{
+		PERR("Impossible to write in the running agent!");
+		return -1;
+	}
+
+	return DB_put_in(replay_agent, _to_agent, _id, _value, _life);
+}
+
+
+
+int DB_put (int _id, void *_value)
+{
+	if (replay_agent == -1)
+		return (-1);
+	return DB_put_in(replay_agent, replay_agent, _id, _value, 0);
+}
+
+
+
+int DB_get_from (int _agent, int _from_agent, int _id, void *_value)
+{
+	TReplayRec *p_rec;
+
+	(void)_agent;
+
+	if (_from_agent == SELF)
+		_from_agent = replay_agent;
+
+	if ((_from_agent < 0) || (_from_agent >= MAX_AGENTS) || (_id < 0) || (_id >= MAX_RECS)
+			|| (replay_recs[_from_agent][_id].size == 0))
+	{
+		PERR("Unknown record %d for agent %d", _id, _from_agent);
+		return -1;
+	}
+
+	p_rec = &replay_recs[_from_agent][_id];
+	memcpy(_value, p_rec->data, p_rec->size);
+
+	return (int)((replay_clock - p_rec->timestamp) / 1000LL);
+}
+
+
+
+int DB_get (int _from_agent, int _id, void *_value)
+{
+	if (replay_agent == -1)
+		return (-1);
+	return DB_get_from(replay_agent, _from_agent, _id, _value);
+}
+
+
+
+int Whoami (void)
+{
+	return (replay_agent);
+}
+
+
+
+//	*************************
+//	Recording is not possible while replaying
+//
+int DB_record_open (const char *file)
+{
+	PERR("Cannot record %s while replaying", file);
+	return -1;
+}
+
+
+
+int DB_record_frame (void)
+{
+	return -1;
+}
+
+
+
+void DB_record_close (void)
+{
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA RTDB
+ *
+ * CAMBADA RTDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA RTDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RTDB_REPLAY_H
+#define __RTDB_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rtdbdefs.h"
+
+// Recording file layout:
+//	RTDBrec_header
+//	RTDBrec_schema[n_schema]	(every record known by the recording agent)
+//	repeated frames:
+//		RTDBrec_frame
+//		RTDBrec_item + record data (size bytes), n_items times
+
+#define RTDB_REC_MAGIC		0x43455252		// "RREC"
+#define RTDB_REC_FRAME		0x4d415246		// "FRAM"
+#define RTDB_REC_VERSION	1
+
+typedef struct
+{
+	int magic;
+	int version;
+	int self_agent;			// agent where the recording was made
+	int n_schema;			// number of schema entries following the header
+} RTDBrec_header;
+
+typedef struct
+{
+	int agent;				// owner of the record
+	int id;					// record id
+	int size;				// record size
+} RTDBrec_schema;
+
+typedef struct
+{
+	int magic;
+	int n_items;			// number of records in the frame
+	long long time;			// agent clock at the start of the cycle (us)
+} RTDBrec_frame;
+
+typedef struct
+{
+	int agent;
+	int id;
+	int life;				// record life time when it was recorded (ms)
+} RTDBrec_item;
+
+
+//	*************************
+//	DB_record_open: start recording the RTDB contents seen by the running agent
+//
+//	input:
+//		const char *file = recording file name
+//	output:
+//		0 = OK
+//		-1 = error
+//
+int DB_record_open (const char *file);
+
+
+//	*************************
+//	DB_record_frame: append a snapshot of every readable record to the recording
+//
+//	output:
+//		0 = OK
+//		-1 = error (or not recording)
+//
+int DB_record_frame (void);
+
+
+//	*************************
+//	DB_record_close: stop recording
+//
+void DB_record_close (void);
+
+
+//	*************************
+//	DB_replay_open: replace the shared memory RTDB by an in-process one
+//		fed from a recording (only available in the rtdb_replay library)
+//
+//	output:
+//		0 = OK
+//		-1 = error
+//
+int DB_replay_open (const char *file);
+
+
+//	*************************
+//	DB_replay_next: load the next recorded frame and advance the virtual clock
+//
+//	output:
+//		1 = frame loaded
+//		0 = end of recording
+//		-1 = error (or truncated final frame, reported with its index
+//			and byte offset)
+//
+int DB_replay_next (void);
+
+
+//	*************************
+//	DB_replay_written: check if the running agent wrote a record since the
+//		last DB_replay_next
+//
+//	output:
+//		1 = written
+//		0 = not written
+//
+int DB_replay_written (int _id);
+
+
+//	*************************
+//	DB_replay_time: current value of the virtual clock (us)
+//
+long long DB_replay_time (void);
+
+
+//	*************************
+//	DB_replay_close: release the replay resources
+//
+void DB_replay_close (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -46,6 +46,11 @@ int DB_get_from (int _agent, int _from_agent, int _id, void *_value);
 
 void DB_set_config_file(const char* cf);
 
+//	*************************
+//	DB_set_clock: clock used for the record timestamps (us), NULL = gettimeofday
+//
+void DB_set_clock(long long (*clock)(void));
+
 #ifdef __cplusplus
 }
 #endif
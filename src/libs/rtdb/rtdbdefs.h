@@ -36,6 +36,11 @@ extern "C" {
 #define SHMEM_KEY 0x2000
 #define SHMEM_SECOND_TEAM_KEY 0x3000
 
+// Instance namespace: several simulated matches on the same host.
+// Every key is offset by <instance> << INSTANCE_KEY_SHIFT (same rule in PMAN)
+#define INSTANCE_ENV "CAMBADA_INSTANCE"
+#define INSTANCE_KEY_SHIFT 16
+
 // definicoes hard-coded
 // alterar de acordo com a utilizacao pretendida
 
@@ -320,6 +320,15 @@ FieldWidget3D::FieldWidget3D(QWidget *parent) :
     taxiLine->SetMapper(followLineMapper);
     taxiLine->SetPosition(1000,1000,1000);
     renderer->AddActor(taxiLine);
+
+    // Obstacles and debug points
+    initGlyphSet(obstacleGlyphs, createObstacle());
+    initGlyphSet(debugGlyphs, createDebugPt());
+    debugGlyphs.actor->GetProperty()->SetAmbient(1.0);
+    debugGlyphs.actor->GetProperty()->SetDiffuse(0.0);
+    debugGlyphs.actor->GetProperty()->SetSpecular(0.0);
+    textPool.used = 0;
+    linePool.used = 0;
     //renderer->AddLight();
 
     // Score board
@@ -391,13 +400,9 @@ void FieldWidget3D::update_robot_info(void)
     if(DB_Info == NULL)
         return;
 
-    // Remove all actors that need to be deleted
-    for(unsigned int i = 0; i < toDeleteActors.size(); i++)
-    {
-        renderer->RemoveActor(toDeleteActors.at(i));
-        toDeleteActors.at(i)->Delete();
-    }
-    toDeleteActors.clear();
+    // Labels and lines are taken again from the start of the pools
+    textPool.used = 0;
+    linePool.used = 0;
 
     int countFreePlay=0;
     int countOther=0;
@@ -506,16 +511,9 @@ void FieldWidget3D::update_robot_info(void)
                 }
 
 
-                vtkActor* dbgPt = createDebugPt();
-                dbgPt->SetPosition(flipVal*xPos, flipVal*yPos, 0.02);
-                dbgPt->GetProperty()->SetAmbient(1.0);
-                dbgPt->GetProperty()->SetDiffuse(0.0);
-                dbgPt->GetProperty()->SetSpecular(0.0);
-                dbgPt->GetProperty()->SetColor(robotsColorR[i],robotsColorG[i],robotsColorB[i]);
-                renderer->AddActor(dbgPt);
-                toDeleteActors.push_back(dbgPt);
+                addGlyph(debugGlyphs, flipVal*xPos, flipVal*yPos, 0.02, robotsColorR[i],robotsColorG[i],robotsColorB[i]);
 
-                vtkActor* dbgText = createText(QString().sprintf("%d",dp));
+                vtkActor* dbgText = nextText(QString().sprintf("%d",dp));
                 dbgText->GetProperty()->SetColor(1,1,1);
                 dbgText->SetScale(0.25);
                 dbgText->GetProperty()->SetAmbient(1.0);
@@ -529,9 +527,6 @@ void FieldWidget3D::update_robot_info(void)
                     dbgText->SetOrientation(0,0,-90);
                     dbgText->SetPosition(flipVal*(xPos - 0.4), flipVal*(yPos + 0.14), 0.04);
                 }
-
-                renderer->AddActor(dbgText);
-                toDeleteActors.push_back(dbgText);
             }
         }
 
@@ -544,22 +539,16 @@ void FieldWidget3D::update_robot_info(void)
 
 				if ( option_draw_obstacles[i] || (nowObs.id == nowRobot.opponentDribbling) )
 				{
-					vtkActor* obstacle = createObstacle();
-                    obstacle->SetPosition(flipVal*nowObs.absCenter.x, flipVal*nowObs.absCenter.y, OBSTACLE_HEIGHT/2);
-
 					bool draw = option_draw_obstacles[i];
 					bool dribbling = nowObs.id == nowRobot.opponentDribbling;
 					// Set color according to the situation
 					if ( (!draw && dribbling) || (draw && !dribbling) )
-						obstacle->GetProperty()->SetColor(robotsColorR[i],robotsColorG[i],robotsColorB[i]);
+						addGlyph(obstacleGlyphs, flipVal*nowObs.absCenter.x, flipVal*nowObs.absCenter.y, OBSTACLE_HEIGHT/2, robotsColorR[i],robotsColorG[i],robotsColorB[i]);
 					else
-						obstacle->GetProperty()->SetColor(0,0,0);
-
-					renderer->AddActor(obstacle);
-					toDeleteActors.push_back(obstacle);
+						addGlyph(obstacleGlyphs, flipVal*nowObs.absCenter.x, flipVal*nowObs.absCenter.y, OBSTACLE_HEIGHT/2, 0,0,0);
 
 					//JLS: DRAW OBSTACLE TEXT
-					vtkActor* dbgText = createText(QString().sprintf("%d",nowObs.id));
+					vtkActor* dbgText = nextText(QString().sprintf("%d",nowObs.id));
 					dbgText->GetProperty()->SetColor(1,1,1);
 					dbgText->SetScale(0.15);
 					dbgText->GetProperty()->SetAmbient(1.0);
@@ -573,9 +562,6 @@ void FieldWidget3D::update_robot_info(void)
 						dbgText->SetOrientation(0,0,-90);
                         dbgText->SetPosition(flipVal*(nowObs.absCenter.x - 0.1), flipVal*(nowObs.absCenter.y + 0.15), 0.3);
 					}
-
-					renderer->AddActor(dbgText);
-					toDeleteActors.push_back(dbgText);
 				}
 			}
 		}
@@ -644,9 +630,9 @@ void FieldWidget3D::update_robot_info(void)
                             DB_Info->Robot_info[i].coordinationFlag[0] == (int)NotClear)
                     {
                         fprintf(stderr,"DBG aki 4\n");
-                        vtkActor* line = createDashedLine(
+                        vtkActor* line = nextLine(
                                     flipVal*DB_Info->Robot_info[i].coordinationVec.x, flipVal*DB_Info->Robot_info[i].coordinationVec.y, 0.05,
-                                    flipVal*DB_Info->Robot_info[strikers.at(str)].pos.x, flipVal*DB_Info->Robot_info[strikers.at(str)].pos.y, 0.05);
+                                    flipVal*DB_Info->Robot_info[strikers.at(str)].pos.x, flipVal*DB_Info->Robot_info[strikers.at(str)].pos.y, 0.05, true);
 
                         if (DB_Info->Robot_info[i].coordinationFlag[0] == (int)LineClear)
                         {
@@ -656,9 +642,6 @@ void FieldWidget3D::update_robot_info(void)
                         {
                             line->GetProperty()->SetColor(1,0,0); // red
                         }
-
-                        renderer->AddActor(line);
-                        toDeleteActors.push_back(line);
                     }
                 }
             }
@@ -671,20 +654,11 @@ void FieldWidget3D::update_robot_info(void)
                     // Ignore default line
                     if(DB_Info->Robot_info[i].passLine.p1 != Line::def.p1 && DB_Info->Robot_info[i].passLine.p2 != Line::def.p2 )
                     {
-                        vtkSmartPointer<vtkLineSource> line = vtkSmartPointer<vtkLineSource>::New();
-                        vtkSmartPointer<vtkPolyDataMapper> lineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-                        vtkActor* lineActor = vtkActor::New();
-
-                        line->SetPoint1(flipVal*DB_Info->Robot_info[i].passLine.p1.x, flipVal*DB_Info->Robot_info[i].passLine.p1.y, 0.05);
-                        line->SetPoint2(flipVal*DB_Info->Robot_info[i].passLine.p2.x, flipVal*DB_Info->Robot_info[i].passLine.p2.y, 0.05);
-                        lineMapper->SetInputConnection(line->GetOutputPort());
-                        lineActor->SetMapper(lineMapper);
-                        lineActor->GetProperty()->SetLineWidth(3);
-                        lineActor->GetProperty()->SetColor(0,0,0); // black line
+                        vtkActor* lineActor = nextLine(
+                                    flipVal*DB_Info->Robot_info[i].passLine.p1.x, flipVal*DB_Info->Robot_info[i].passLine.p1.y, 0.05,
+                                    flipVal*DB_Info->Robot_info[i].passLine.p2.x, flipVal*DB_Info->Robot_info[i].passLine.p2.y, 0.05, false);
 
                         lineActor->GetProperty()->SetColor(0.3,0.3,1); // red
-                        renderer->AddActor(lineActor);
-                        toDeleteActors.push_back(lineActor);
                     }
                 }
             }
@@ -728,9 +702,9 @@ void FieldWidget3D::update_robot_info(void)
                 {
                     for (unsigned int rep=0; rep<replacers.size(); rep++)
                     {
-                        vtkActor* line = createDashedLine(
+                        vtkActor* line = nextLine(
                                     flipVal*DB_Info->Robot_info[i].coordinationVec.x, flipVal*DB_Info->Robot_info[i].coordinationVec.y, 0.05,
-                                    flipVal*DB_Info->Robot_info[replacers.at(rep)].ball.pos.x, flipVal*DB_Info->Robot_info[replacers.at(rep)].ball.pos.y, 0.05);
+                                    flipVal*DB_Info->Robot_info[replacers.at(rep)].ball.pos.x, flipVal*DB_Info->Robot_info[replacers.at(rep)].ball.pos.y, 0.05, true);
                         if (DB_Info->Robot_info[i].coordinationFlag[0] == (int)LineClear)
                         {
                             line->GetProperty()->SetColor(0,0.5,0); // green
@@ -739,9 +713,6 @@ void FieldWidget3D::update_robot_info(void)
                         {
                             line->GetProperty()->SetColor(1,0,0); // red
                         }
-
-                        renderer->AddActor(line);
-                        toDeleteActors.push_back(line);
                     }
                 }
             }
@@ -757,19 +728,10 @@ void FieldWidget3D::update_robot_info(void)
                     int receiverIdx = (DB_Info->Robot_info[i].coordinationFlag[0]-TryingToPass0);
                     if (receiverIdx >=0 && receiverIdx <=5)
                     {
-                        vtkSmartPointer<vtkLineSource> line = vtkSmartPointer<vtkLineSource>::New();
-                        vtkSmartPointer<vtkPolyDataMapper> lineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-                        vtkActor* lineActor = vtkActor::New();
-
-                        line->SetPoint1(flipVal*DB_Info->Robot_info[i].ball.pos.x, flipVal*DB_Info->Robot_info[i].ball.pos.y, 0.05);
-                        line->SetPoint2(flipVal*DB_Info->Robot_info[receiverIdx].coordinationVec.x, flipVal*DB_Info->Robot_info[receiverIdx].coordinationVec.y, 0.05);
-                        lineMapper->SetInputConnection(line->GetOutputPort());
-                        lineActor->SetMapper(lineMapper);
-                        lineActor->GetProperty()->SetLineWidth(3);
+                        vtkActor* lineActor = nextLine(
+                                    flipVal*DB_Info->Robot_info[i].ball.pos.x, flipVal*DB_Info->Robot_info[i].ball.pos.y, 0.05,
+                                    flipVal*DB_Info->Robot_info[receiverIdx].coordinationVec.x, flipVal*DB_Info->Robot_info[receiverIdx].coordinationVec.y, 0.05, false);
                         lineActor->GetProperty()->SetColor(0,0,0); // black line
-
-                        renderer->AddActor(lineActor);
-                        toDeleteActors.push_back(lineActor);
                     }
                 }
             }
@@ -777,6 +739,11 @@ void FieldWidget3D::update_robot_info(void)
         }
     }
 
+    // Only the changed shapes go down the pipeline
+    flushGlyphSet(obstacleGlyphs);
+    flushGlyphSet(debugGlyphs);
+    hideUnusedActors();
+
     updateGridView();
 
     // Score board update
@@ -856,20 +823,30 @@ void FieldWidget3D::debug_point_flip_all (bool on_off)
         debug_point_flip (i, on_off);
 }
 
-vtkActor* FieldWidget3D::createDashedLine(float x1, float y1, float z1, float x2, float y2, float z2)
+vtkActor* FieldWidget3D::nextLine(float x1, float y1, float z1, float x2, float y2, float z2, bool dashed)
 {
-    vtkSmartPointer<vtkLineSource> line = vtkSmartPointer<vtkLineSource>::New();
-    vtkSmartPointer<vtkPolyDataMapper> lineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    vtkActor* lineActor = vtkActor::New();
+    if(linePool.used == linePool.actors.size())
+    {
+        vtkLineSource* line = vtkLineSource::New();
+        vtkSmartPointer<vtkPolyDataMapper> lineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        vtkActor* lineActor = vtkActor::New();
+        lineMapper->SetInputConnection(line->GetOutputPort());
+        lineActor->SetMapper(lineMapper);
+        lineActor->GetProperty()->SetLineStippleRepeatFactor(1);
+        lineActor->GetProperty()->SetPointSize(1);
+        lineActor->GetProperty()->SetLineWidth(3);
+        renderer->AddActor(lineActor);
+
+        linePool.lines.push_back(line);
+        linePool.actors.push_back(lineActor);
+    }
+
+    vtkLineSource* line = linePool.lines[linePool.used];
+    vtkActor* lineActor = linePool.actors[linePool.used++];
     line->SetPoint1(x1, y1, z1);
     line->SetPoint2(x2, y2, z2);
-    lineMapper->SetInputConnection(line->GetOutputPort());
-    lineActor->SetMapper(lineMapper);
-    lineActor->GetProperty()->SetLineWidth(3);
-    lineActor->GetProperty()->SetLineStipplePattern(0xf0f0);
-    lineActor->GetProperty()->SetLineStippleRepeatFactor(1);
-    lineActor->GetProperty()->SetPointSize(1);
-    lineActor->GetProperty()->SetLineWidth(3);
+    lineActor->GetProperty()->SetLineStipplePattern(dashed ? 0xf0f0 : 0xffff);
+    lineActor->SetVisibility(1);
     return lineActor;
 }
 
@@ -1056,38 +1033,59 @@ void FieldWidget3D::initBalls(vtkRenderer* renderer)
     }
 }
 
-vtkActor* FieldWidget3D::createText(QString text){
-    vtkActor* actor = vtkActor::New();
-    vtkSmartPointer<vtkVectorText> txt = vtkSmartPointer<vtkVectorText>::New();
-    txt->SetText(text.toStdString().c_str());
-    vtkSmartPointer<vtkPolyDataMapper> txtRobotMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    txtRobotMapper->SetInput(txt->GetOutput());
-    actor->SetMapper(txtRobotMapper);
+vtkActor* FieldWidget3D::nextText(QString text){
+    if(textPool.used == textPool.actors.size())
+    {
+        vtkActor* actor = vtkActor::New();
+        vtkVectorText* txt = vtkVectorText::New();
+        vtkSmartPointer<vtkPolyDataMapper> txtRobotMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        txtRobotMapper->SetInput(txt->GetOutput());
+        actor->SetMapper(txtRobotMapper);
+        renderer->AddActor(actor);
+
+        textPool.texts.push_back(txt);
+        textPool.actors.push_back(actor);
+    }
+
+    // The text is only triangulated again when it changes
+    vtkActor* actor = textPool.actors[textPool.used];
+    textPool.texts[textPool.used++]->SetText(text.toStdString().c_str());
     actor->GetProperty()->SetColor(0.0,0.0,0.0);
     actor->GetProperty()->SetAmbient(1.0);
     actor->SetOrientation(0,0,90);
+    actor->SetVisibility(1);
     return actor;
 }
 
-vtkActor* FieldWidget3D::createObstacle(){
-    // Obstacle actors
+void FieldWidget3D::hideUnusedActors()
+{
+    for(unsigned int i = textPool.used; i < textPool.actors.size(); i++)
+        textPool.actors[i]->SetVisibility(0);
+
+    for(unsigned int i = linePool.used; i < linePool.actors.size(); i++)
+        linePool.actors[i]->SetVisibility(0);
+}
+
+vtkSmartPointer<vtkPolyData> FieldWidget3D::createObstacle(){
+    // Obstacle shape, standing on the field
     vtkSmartPointer<vtkCylinderSource> cylinder = vtkSmartPointer<vtkCylinderSource>::New();
     cylinder->SetRadius(0.25);
     cylinder->SetHeight(OBSTACLE_HEIGHT);
     cylinder->SetResolution(12);
-    vtkSmartPointer<vtkPolyDataMapper> cylinderMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    cylinderMapper->SetInput(cylinder->GetOutput());
 
-    vtkActor* obstacleActor = vtkActor::New();
-    obstacleActor->SetMapper(cylinderMapper);
-    obstacleActor->GetProperty()->SetColor(0,0,0);
-    //obstacleActor->GetProperty()->SetRepresentationToWireframe();
-    obstacleActor->RotateX(90); // Rotate 90 degrees in XX axis
+    vtkSmartPointer<vtkTransform> rotation = vtkSmartPointer<vtkTransform>::New();
+    rotation->RotateX(90); // Rotate 90 degrees in XX axis
+    vtkSmartPointer<vtkTransformPolyDataFilter> transform = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+    transform->SetInputConnection(cylinder->GetOutputPort());
+    transform->SetTransform(rotation);
+    transform->Update();
 
-    return obstacleActor;
+    vtkSmartPointer<vtkPolyData> shape = vtkSmartPointer<vtkPolyData>::New();
+    shape->DeepCopy(transform->GetOutput());
+    return shape;
 }
 
-vtkActor* FieldWidget3D::createDebugPt(){
+vtkSmartPointer<vtkPolyData> FieldWidget3D::createDebugPt(){
     // Setup four points
       vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
       float zz = 0.00;
@@ -1122,15 +1120,83 @@ vtkActor* FieldWidget3D::createDebugPt(){
       polygonPolyData->SetPoints(points);
       polygonPolyData->SetPolys(polygons);
 
-      // Create a mapper and actor
-      vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-      mapper->SetInput(polygonPolyData);
+      // Turned into a cross
+      vtkSmartPointer<vtkTransform> rotation = vtkSmartPointer<vtkTransform>::New();
+      rotation->RotateZ(45);
+      vtkSmartPointer<vtkTransformPolyDataFilter> transform = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+      transform->SetInput(polygonPolyData);
+      transform->SetTransform(rotation);
+      transform->Update();
+
+      vtkSmartPointer<vtkPolyData> shape = vtkSmartPointer<vtkPolyData>::New();
+      shape->DeepCopy(transform->GetOutput());
+      return shape;
+}
+
+void FieldWidget3D::initGlyphSet(GlyphSet& set, vtkPolyData* shape)
+{
+    set.points = vtkPoints::New();
+    set.colors = vtkUnsignedCharArray::New();
+    set.colors->SetNumberOfComponents(3);
+    set.data = vtkPolyData::New();
+    set.data->SetPoints(set.points);
+    set.data->GetPointData()->SetScalars(set.colors);
+
+    // One copy of the shape on each point, with the color of the point
+    vtkSmartPointer<vtkGlyph3D> glyphs = vtkSmartPointer<vtkGlyph3D>::New();
+    glyphs->SetInput(set.data);
+    glyphs->SetSource(shape);
+    glyphs->ScalingOff();
+    glyphs->OrientOff();
+    glyphs->SetColorModeToColorByScalar();
+
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputConnection(glyphs->GetOutputPort());
+    mapper->SetScalarModeToUsePointData();
+    mapper->SetColorModeToDefault();
+
+    set.actor = vtkActor::New();
+    set.actor->SetMapper(mapper);
+    set.actor->SetVisibility(0);
+    renderer->AddActor(set.actor);
+}
+
+void FieldWidget3D::addGlyph(GlyphSet& set, float x, float y, float z, float r, float g, float b)
+{
+    set.staged.push_back(x);
+    set.staged.push_back(y);
+    set.staged.push_back(z);
+    set.staged.push_back(r);
+    set.staged.push_back(g);
+    set.staged.push_back(b);
+}
+
+void FieldWidget3D::flushGlyphSet(GlyphSet& set)
+{
+    // Same glyphs as drawn, the pipeline is left untouched
+    if(set.staged == set.drawn)
+    {
+        set.staged.clear();
+        return;
+    }
 
-      vtkActor* actor = vtkActor::New();
-      actor->SetMapper(mapper);
-      actor->RotateZ(45);
+    int n = set.staged.size() / 6;
+    set.points->SetNumberOfPoints(n);
+    set.colors->SetNumberOfTuples(n);
+    for(int i = 0; i < n; i++)
+    {
+        const float* glyph = &set.staged[6*i];
+        set.points->SetPoint(i, glyph[0], glyph[1], glyph[2]);
+        for(int j = 0; j < 3; j++)
+            set.colors->SetComponent(i, j, static_cast<unsigned char>(255.0 * glyph[3+j]));
+    }
+    set.points->Modified();
+    set.colors->Modified();
+    set.data->Modified();
+    set.actor->SetVisibility(n > 0);
 
-      return actor;
+    set.drawn.swap(set.staged);
+    set.staged.clear();
 }
 
 void FieldWidget3D::updateGridView()
@@ -1146,143 +1212,120 @@ void FieldWidget3D::updateGridView()
         initGridView();
     }
 
-    heightActor->SetVisibility(1);
-    heightActor->GetProperty()->SetOpacity(0.8);
-
-    // GRID SIZE: 81x57
-
-    //int sizeL = 81;
-    //int sizeW = 57;
-    //double resolution = 0.25;
-    double xx, yy, zz;
-    double minz = 2010.0;
-    double maxz = -2010.0;
-    int i = 0;
-
-    //addtions
+    // Heightmap source: the base station map when it is fresh, otherwise
+    // the first robot streaming its map
     GridView grid;
-    DB_get(0,GRIDVIEW, &grid);
-    if(grid.count > 0)
+    int source = -1;
+    for(int ag = 0; ag <= NROBOTS && source < 0; ag++)
+    {
+        int life = DB_get(ag, GRIDVIEW, &grid);
+        if(life >= 0 && life < 1000 && gridDecoders[ag].decode(grid) && gridDecoders[ag].count() > 0)
+            source = ag;
+    }
+
+    if(source < 0)
     {
+        heightActor->SetVisibility(0);
+        heightSource = -1;
+        return;
+    }
 
-    	for(int i=0;i<grid.count;i++)
-    	{
-    		xx=grid.grid[i].pos.x;
-    		yy=grid.grid[i].pos.y;
-    		float realVal = grid.grid[i].val;
-
-    		if(!height3D)
-    			zz = -0.01;
-    		else
-    			zz = realVal;
-    		heightPoints->SetPoint(i, xx,yy,zz);
-
-    		if(i==0)
-    		{
-    			minz = realVal;
-    			maxz = realVal;
-    		}else{
-    			if(realVal < minz)
-    				minz = realVal;
-    			if(realVal > maxz)
-    				maxz = realVal;
-    		}
-    		//cout<<"XX="<<xx<<" YY="<<yy<<" ZZ="<<zz<<" I="<<i<<endl;
-
-    	}
+    // Same frame drawn the same way, nothing to do
+    GridViewDecoder* decoder = &gridDecoders[source];
+    if(source == heightSource && decoder->getFrame() == heightFrame
+            && height3D == heightDrawn3D && heightColor == heightDrawnColor)
+        return;
 
-    }else{
-    	minz = 0.0;
-    	maxz = 0.0;
+    // GRID SIZE: 81x57, cells are x major so y is the fastest grid axis
+    int count = decoder->count();
+    int* dims = heightGrid->GetDimensions();
+    if(dims[0] != decoder->getLength() || dims[1] != decoder->getWidth())
+    {
+        heightGrid->SetDimensions(decoder->getLength(), decoder->getWidth(), 1);
+        heightPoints->SetNumberOfPoints(count);
+        heightValues->SetNumberOfTuples(count);
     }
 
-    if(height3D)
+    float minz = decoder->getMinVal();
+    float maxz = decoder->getMaxVal();
+
+    float* p = static_cast<float*>(heightPoints->GetVoidPointer(0));
+    float* val = heightValues->GetPointer(0);
+    for(int i = 0; i < count; i++)
     {
-        for(int j = 0; j < i; j++)
-        {
-            heightPoints->SetPoint(j, heightPoints->GetPoint(j)[0],heightPoints->GetPoint(j)[1],heightPoints->GetPoint(j)[2] - minz);
-        }
+        Vec pos = decoder->pos(i);
+        val[i] = decoder->getVal(i);
+        p[3*i]   = pos.x;
+        p[3*i+1] = pos.y;
+        p[3*i+2] = height3D ? val[i] - minz : -0.01;
     }
+    heightPoints->Modified();
+    heightValues->Modified();
 
-    heightPolyData->SetPoints(heightPoints);
-    heightDelaunay->SetInput(heightPolyData);
-    heightDelaunay->Update();
-    heightPolyDataAfterInterp  = heightDelaunay->GetOutput();
+    if(heightColor != heightDrawnColor)
+        setGridViewColor();
+    heightMapper->SetScalarRange(minz, maxz);
 
-    // Create the color map
-    vtkSmartPointer<vtkLookupTable> colorLookupTable = vtkSmartPointer<vtkLookupTable>::New();
-    colorLookupTable->SetTableRange(minz, maxz);
+    heightActor->SetVisibility(1);
+
+    heightSource = source;
+    heightFrame = decoder->getFrame();
+    heightDrawn3D = height3D;
+}
 
+void FieldWidget3D::setGridViewColor()
+{
     if(heightColor)
     {
-        colorLookupTable->SetValueRange(1, 1);
-        colorLookupTable->SetSaturationRange(1, 1);
-        //colorLookupTable->SetHueRange(0, 1);
+        heightLut->SetValueRange(1, 1);
+        heightLut->SetSaturationRange(1, 1);
     }
     else
     {
-        colorLookupTable->SetValueRange(0, 1);
-        colorLookupTable->SetSaturationRange(0, 0);
-        //colorLookupTable->SetHueRange(0, 0);
-    }
-    colorLookupTable->Build();
-
-    // Generate the colors for each point based on the color map
-    vtkSmartPointer<vtkUnsignedCharArray> colors = vtkSmartPointer<vtkUnsignedCharArray>::New();
-    colors->SetNumberOfComponents(3);
-
-    for(int i = 0; i < heightPolyDataAfterInterp->GetNumberOfPoints(); i++)
-    {
-        double p[3];
-        heightPolyDataAfterInterp->GetPoint(i,p);
-
-        double dcolor[3];
-        colorLookupTable->GetColor(grid.grid[i].val, dcolor);
-        unsigned char color[3];
-        for(unsigned int j = 0; j < 3; j++)
-        {
-            color[j] = static_cast<unsigned char>(255.0 * dcolor[j]);
-        }
-        colors->InsertNextTupleValue(color);
+        heightLut->SetValueRange(0, 1);
+        heightLut->SetSaturationRange(0, 0);
     }
+    heightLut->ForceBuild();
 
-    heightPolyDataAfterInterp->GetPointData()->SetScalars(colors);
+    heightDrawnColor = heightColor;
 }
 
 void FieldWidget3D::initGridView(){
 
-    heightPoints = vtkPoints::New(); // Create a grid of points (height/terrian map)
-    heightPolyData = vtkPolyData::New();
-    heightDelaunay = vtkDelaunay2D::New();
-
-    int sizeL = 81;
-    int sizeW = 57;
-    float resolution = 0.25;
-    for(int x = -sizeW/2; x <= sizeW/2; x++)
-    {
-        for(int y = -sizeL/2; y <= sizeL/2; y++)
-        {
-            heightPoints->InsertNextPoint(x*resolution, y*resolution, x*resolution*y*resolution);
-        }
-    }
+    // Points and values are sized by the first frame
+    heightPoints = vtkPoints::New();
+    heightPoints->SetDataTypeToFloat();
+    heightValues = vtkFloatArray::New();
+    heightValues->SetNumberOfComponents(1);
 
-    heightPolyData->SetPoints(heightPoints); // Add the grid points to a polydata object
-    heightDelaunay->SetInput(heightPolyData);
+    heightGrid = vtkStructuredGrid::New();
+    heightGrid->SetDimensions(0, 0, 1);
+    heightGrid->SetPoints(heightPoints);
+    heightGrid->GetPointData()->SetScalars(heightValues);
 
-    // Triangulate the grid points
-    heightDelaunay->Update();
-    heightPolyDataAfterInterp = heightDelaunay->GetOutput();
+    // Color map, the range follows the values of each frame
+    heightLut = vtkLookupTable::New();
+    setGridViewColor();
 
     // Create a mapper and actor
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputConnection(heightPolyDataAfterInterp->GetProducerPort());
+    heightMapper = vtkDataSetMapper::New();
+    heightMapper->SetInput(heightGrid);
+    heightMapper->SetLookupTable(heightLut);
+    heightMapper->SetScalarModeToUsePointData();
+    heightMapper->ScalarVisibilityOn();
+
     heightActor = vtkActor::New();
-    heightActor->SetMapper(mapper);
+    heightActor->SetMapper(heightMapper);
     heightActor->SetVisibility(0);
+    heightActor->GetProperty()->SetOpacity(0.8);
     heightActor->GetProperty()->SetAmbient(1);
     heightActor->GetProperty()->SetSpecular(0);
     heightActor->GetProperty()->SetDiffuse(0);
 
+    heightSource = -1;
+    heightFrame = 0;
+    heightDrawn3D = height3D;
+
     // Add the actor to the scene
     renderer->AddActor(heightActor);
 }
@@ -1293,15 +1336,18 @@ void FieldWidget3D::deleteGridView(){
 
     renderer->RemoveActor(heightActor);
 
-    heightDelaunay->Delete();
-    heightPolyDataAfterInterp->Delete();
-    heightPolyData->Delete();
+    heightActor->Delete();
+    heightMapper->Delete();
+    heightLut->Delete();
+    heightGrid->Delete();
+    heightValues->Delete();
     heightPoints->Delete();
 
     heightActor = NULL;
-    heightDelaunay = NULL;
-    heightPolyDataAfterInterp = NULL;
-    heightPolyData = NULL;
+    heightMapper = NULL;
+    heightLut = NULL;
+    heightGrid = NULL;
+    heightValues = NULL;
     heightPoints = NULL;
 
 }
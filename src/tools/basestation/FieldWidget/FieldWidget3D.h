@@ -65,10 +65,12 @@
 #include <vtkObjectFactory.h>
 #include <vtkPlaneSource.h>
 #include <vtkPropCollection.h>
-#include <vtkDelaunay2D.h>
+#include <vtkStructuredGrid.h>
 #include <vtkLookupTable.h>
 #include <vtkMath.h>
 #include <vtkPointData.h>
+#include <vtkGlyph3D.h>
+#include <vtkUnsignedCharArray.h>
 
 #include <QVTKInteractor.h>
 
@@ -79,6 +81,32 @@
 
 #define OBSTACLE_HEIGHT 0.2
 
+// Many shapes drawn by one actor, a glyph per point
+struct GlyphSet
+{
+    vtkPoints* points;
+    vtkUnsignedCharArray* colors;
+    vtkPolyData* data;
+    vtkActor* actor;
+    vector<float> staged;       // x, y, z, r, g, b of the glyphs of this update
+    vector<float> drawn;        // ... and of the drawn ones
+};
+
+// Reused actors, the ones not used in an update are hidden
+struct TextPool
+{
+    vector<vtkActor*> actors;
+    vector<vtkVectorText*> texts;
+    unsigned int used;
+};
+
+struct LinePool
+{
+    vector<vtkActor*> actors;
+    vector<vtkLineSource*> lines;
+    unsigned int used;
+};
+
 class FieldWidget3D : public QVTKWidget
 {
     Q_OBJECT
@@ -134,12 +162,17 @@ private:
     void initBalls(vtkRenderer* renderer);
     void initGridView();
     void updateGridView();
+    void setGridViewColor();
     void deleteGridView();
 
-    vtkActor* createText(QString text);
-    vtkActor* createObstacle();
-    vtkActor* createDebugPt();
-    vtkActor* createDashedLine(float x1, float y1, float z1, float x2, float y2, float z2);
+    vtkSmartPointer<vtkPolyData> createObstacle();
+    vtkSmartPointer<vtkPolyData> createDebugPt();
+    void initGlyphSet(GlyphSet& set, vtkPolyData* shape);
+    void addGlyph(GlyphSet& set, float x, float y, float z, float r, float g, float b);
+    void flushGlyphSet(GlyphSet& set);
+    vtkActor* nextText(QString text);
+    vtkActor* nextLine(float x1, float y1, float z1, float x2, float y2, float z2, bool dashed);
+    void hideUnusedActors();
     void createDot(vtkRenderer* renderer, float x, float y, bool black, float radius=0.05);
 
 
@@ -154,13 +187,26 @@ private:
     vtkLineSource* velocityLineSrc;
     vtkActor* velocityLine;
 
-    vector<vtkActor*> toDeleteActors;
+    // Per update shapes: obstacles and debug points are glyphs, labels and
+    // lines come from pools, nothing is created once the pools are big enough
+    GlyphSet obstacleGlyphs;
+    GlyphSet debugGlyphs;
+    TextPool textPool;
+    LinePool linePool;
 
+    // Heightmap: grid topology and color map are built once, the points
+    // and values are rewritten in place when a new frame arrives
     vtkPoints* heightPoints;
-    vtkPolyData* heightPolyData;
-    vtkDelaunay2D* heightDelaunay;
-    vtkPolyData* heightPolyDataAfterInterp;
+    vtkFloatArray* heightValues;
+    vtkStructuredGrid* heightGrid;
+    vtkLookupTable* heightLut;
+    vtkDataSetMapper* heightMapper;
     vtkActor* heightActor;
+    int heightSource;               // drawn frame: publisher (-1 none), frame number and options
+    unsigned int heightFrame;
+    bool heightDrawn3D;
+    bool heightDrawnColor;
+    GridViewDecoder gridDecoders[NROBOTS+1];    // heightmap streams (0 is the base station)
 
     float robotsColorR[6];
     float robotsColorG[6];
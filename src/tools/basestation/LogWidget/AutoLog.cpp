@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA BASESTATION
+ *
+ * CAMBADA BASESTATION is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA BASESTATION is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AutoLog.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define AUTOLOG_IDLE_MS		50		// writer sleep when the queue is empty
+
+AutoLogWriter::AutoLogWriter()
+	: blockFrames(0), segments(0), head(0), tail(0), stopping(false), drops(0), errors(0), fd(-1), slot(0)
+{
+}
+
+AutoLogWriter::~AutoLogWriter()
+{
+	close();
+}
+
+void AutoLogWriter::open(const char* filename, unsigned int blockFrames, unsigned int segments)
+{
+	close();
+
+	this->filename = filename;
+	this->blockFrames = (blockFrames > 0) ? blockFrames : MATCHLOG_BLOCK_FRAMES;
+	this->segments = (segments > 0) ? segments : 1;
+
+	queue.resize(AUTOLOG_QUEUE_FRAMES);
+	head = 0;
+	tail = 0;
+	stopping = false;
+	drops = 0;
+	errors = 0;
+
+	start(QThread::LowPriority);
+}
+
+bool AutoLogWriter::push(const Log_Information& frame)
+{
+	unsigned int h = head;
+
+	if (h - tail >= queue.size())
+	{
+		drops++;
+		return false;
+	}
+
+	queue[h % queue.size()] = frame;
+
+	// The frame is complete before the writer can see it
+	__sync_synchronize();
+	head = h + 1;
+	return true;
+}
+
+void AutoLogWriter::close()
+{
+	if (!isRunning())
+		return;
+
+	stopping = true;
+	wait();
+
+	if (drops > 0)
+		fprintf(stderr,"AutoLog :: %u frames dropped, the disk didn't keep up\n", drops);
+	if (errors > 0)
+		fprintf(stderr,"AutoLog :: %u writes to %s failed\n", errors, filename.c_str());
+}
+
+void AutoLogWriter::run()
+{
+	if (!create())
+		fprintf(stderr,"AutoLog :: Can't create %s, the match isn't logged\n", filename.c_str());
+
+	while (true)
+	{
+		// Read before draining, the frames pushed before close are written
+		bool stop = stopping;
+		bool written = false;
+
+		while (tail != head)
+		{
+			__sync_synchronize();
+			// Without a file (already reported) the frames are only drained
+			if (!writeFrame(queue[tail % queue.size()]) && fd >= 0)
+				errors++;
+
+			// The slot is free once the frame is written
+			__sync_synchronize();
+			tail = tail + 1;
+			written = true;
+		}
+
+		if (written && fd >= 0 && !writeFooter())
+			errors++;
+
+		if (stop)
+			break;
+
+		msleep(AUTOLOG_IDLE_MS);
+	}
+
+	if (fd >= 0)
+	{
+		::close(fd);
+		fd = -1;
+	}
+}
+
+bool AutoLogWriter::create()
+{
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, MATCHLOG_MAGIC);
+	header.schema = MATCHLOG_SCHEMA;
+	header.frameSize = sizeof(Log_Information);
+	header.blockFrames = blockFrames;
+	header.flags = MATCHLOG_SEGMENTED;
+	header.blocks = segments;
+	header.segmentSize = blockFrames * header.frameSize + sizeof(MatchLogFooter);
+
+	memset(&footer, 0, sizeof(footer));
+	strcpy(footer.magic, MATCHLOG_FOOTER_MAGIC);
+	footer.sequence = 1;
+	footer.checksum = crc32(0, Z_NULL, 0);
+	slot = 0;
+
+	fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	// The whole ring is allocated (and zeroed) now, so a full disk shows
+	// up here and not in the middle of a match
+	off_t size = sizeof(header) + (off_t)segments * header.segmentSize;
+	if (posix_fallocate(fd, 0, size) != 0 && ftruncate(fd, size) != 0)
+	{
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+
+	if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+	{
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool AutoLogWriter::writeFrame(const Log_Information& frame)
+{
+	if (fd < 0)
+		return false;
+
+	if (footer.frames == blockFrames)
+	{
+		// Seal the full segment, then take the next one of the ring; its old
+		// footer is replaced by an empty one before any frame is overwritten
+		if (!writeFooter())
+			return false;
+		fdatasync(fd);
+
+		slot = (slot + 1) % segments;
+		footer.sequence++;
+		footer.frames = 0;
+		footer.checksum = crc32(0, Z_NULL, 0);
+		if (!writeFooter())
+			return false;
+	}
+
+	off_t offset = sizeof(header) + (off_t)slot * header.segmentSize + (off_t)footer.frames * header.frameSize;
+	if (pwrite(fd, &frame, header.frameSize, offset) != (ssize_t)header.frameSize)
+		return false;
+
+	footer.checksum = crc32(footer.checksum, (const Bytef*)&frame, header.frameSize);
+	footer.frames++;
+	return true;
+}
+
+bool AutoLogWriter::writeFooter()
+{
+	if (fd < 0)
+		return false;
+
+	off_t offset = sizeof(header) + (off_t)slot * header.segmentSize + (off_t)blockFrames * header.frameSize;
+	return pwrite(fd, &footer, sizeof(footer), offset) == (ssize_t)sizeof(footer);
+}
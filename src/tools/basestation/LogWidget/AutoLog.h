@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA BASESTATION
+ *
+ * CAMBADA BASESTATION is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA BASESTATION is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AUTOLOG_H
+#define __AUTOLOG_H
+
+#include <QThread>
+#include <string>
+#include <vector>
+
+#include "MatchLog.h"
+
+#define AUTOLOG_QUEUE_FRAMES	64		// frames the GUI can be ahead of the writer (6.4 s)
+
+/**
+ * \brief Writes the autolog from its own thread
+ *
+ * The GUI thread pushes frames in a lock-free single producer, single
+ * consumer ring; the writer thread drains it into a segmented match log
+ * (MATCHLOG_SEGMENTED), preallocated when it is created. Each segment's
+ * footer is rewritten after its frames, so the file on disk is always a
+ * valid log and closing it only has to stop the thread.
+ */
+class AutoLogWriter : public QThread
+{
+public:
+	AutoLogWriter();
+	virtual ~AutoLogWriter();
+
+	/**
+	 * Start the writer thread, which creates the log (truncating it)
+	 * \param blockFrames frames per segment
+	 * \param segments segments in the ring, the oldest one is overwritten
+	 */
+	void open(const char* filename, unsigned int blockFrames, unsigned int segments);
+
+	/**
+	 * Queue a frame, never blocks (GUI thread)
+	 * \return false if the queue is full and the frame is dropped
+	 */
+	bool push(const Log_Information& frame);
+
+	/**
+	 * Write the queued frames and stop the thread
+	 */
+	void close();
+
+	unsigned int dropped() const { return drops; }
+	unsigned int failedWrites() const { return errors; }
+
+protected:
+	virtual void run();
+
+private:
+	bool create();
+	bool writeFrame(const Log_Information& frame);
+	bool writeFooter();
+
+	std::string filename;
+	unsigned int blockFrames;
+	unsigned int segments;
+
+	// Ring, head is only written by push and tail by the writer thread
+	std::vector<Log_Information> queue;
+	volatile unsigned int head;
+	volatile unsigned int tail;
+	volatile bool stopping;
+	unsigned int drops;
+
+	// Writer thread state
+	unsigned int errors;			// frames or footers not written
+	int fd;
+	MatchLogHeader header;
+	MatchLogFooter footer;
+	unsigned int slot;				// segment being written
+};
+
+#endif
@@ -29,27 +29,20 @@
 #include <vector>
 #include <deque>
 
-#include <fstream>
-
 #include "DB_Robot_info.h"
 #include "CoachLogModeInfo.h"
+#include "MatchLog.h"
+#include "AutoLog.h"
 
 #define LOG_STOPED 0
 #define LOG_PLAYING 1
 #define MAX_AUTOLOG_REGISTERS 36000	//maximum number of registers (frames) on auto log (36000 is 1 hour)	100 for 10 seconds
 #define FILE_DUMP_FREQUENCY 600		//number of frames accumulated before dumping to the file (600 is 1 minute)		10 for each second
-#define N_FILES MAX_AUTOLOG_REGISTERS / FILE_DUMP_FREQUENCY
+#define AUTOLOG_FILE "../logs/autoLog.cblog"
+#define AUTOLOG_SEGMENTS (MAX_AUTOLOG_REGISTERS / FILE_DUMP_FREQUENCY)	//segments of FILE_DUMP_FREQUENCY frames kept in the auto log file
 
 using namespace cambada;
 
-class Log_Information
-{
-	public:
-	FormationInfo finfo;
-	CoachInfo coach;
-	Robot robot[NROBOTS];
-};
-
 class LogWidget: public QWidget, public Ui::LogWG
 {
 	Q_OBJECT
@@ -66,9 +59,9 @@ private:
 	CoachLogRobotsInfo *coachLogRobots;
 	CoachLogModeFlag *coachLogFlag;
 
-	std::deque<Log_Information> LogInfo;
+	std::deque<Log_Information> LogInfo;	// recent frames of the running match
+	MatchLogReader LoadedLog;				// log file being viewed
 
-	FILE *LoadLogFile;
 	bool ReadyToRead;
 	unsigned int currentFrame;
 	unsigned int PlayerStatus;
@@ -76,20 +69,10 @@ private:
 
 	//Auto logger variables
 	QTimer *saveTimer;		//Timer for the frequency of log data saving
-	QString initialMessage;
-	QString finalMessage;
-	QString logLine;
-	std::ofstream autoLogFile;
-
-	unsigned int frameCounter;
-	long oneLogEntrySize;
-
-	unsigned int firstFile;
-	unsigned int lastFile;
-	unsigned int nextFileToWrite;
+	AutoLogWriter autoLog;
 
-	void concatAutoLog();
-	bool removeDir(const QString dirName);
+	unsigned int frameCount();
+	const Log_Information* getFrame(unsigned int frame_number);
 
 
 public slots:
@@ -0,0 +1,544 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA BASESTATION
+ *
+ * CAMBADA BASESTATION is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA BASESTATION is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MatchLog.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+// Footer of a segment and its position in the ring
+struct SegmentOrder
+{
+	MatchLogFooter footer;
+	unsigned int slot;
+
+	bool operator<(const SegmentOrder& other) const { return footer.sequence < other.footer.sequence; }
+};
+
+MatchLogWriter::MatchLogWriter()
+{
+	file = NULL;
+	blockUsed = 0;
+	offset = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+MatchLogWriter::~MatchLogWriter()
+{
+	close();
+}
+
+bool MatchLogWriter::open(const char* filename, bool compress, unsigned int blockFrames)
+{
+	close();
+
+	file = fopen(filename, "wb");
+	if (file == NULL)
+		return false;
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, MATCHLOG_MAGIC);
+	header.schema = MATCHLOG_SCHEMA;
+	header.frameSize = sizeof(Log_Information);
+	header.blockFrames = (blockFrames > 0) ? blockFrames : MATCHLOG_BLOCK_FRAMES;
+	header.flags = compress ? MATCHLOG_COMPRESSED : 0;
+
+	// Header of an open log, no index yet
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+
+	offset = sizeof(header);
+	index.clear();
+	block.resize(header.blockFrames * header.frameSize);
+	blockUsed = 0;
+	return true;
+}
+
+bool MatchLogWriter::write(const Log_Information& frame)
+{
+	if (file == NULL)
+		return false;
+
+	memcpy(&block[blockUsed * header.frameSize], &frame, header.frameSize);
+	blockUsed++;
+	header.frames++;
+
+	if (blockUsed == header.blockFrames)
+		return writeBlock();
+
+	return true;
+}
+
+bool MatchLogWriter::writeBlock()
+{
+	if (blockUsed == 0)
+		return true;
+
+	const unsigned char* data = &block[0];
+	uLongf size = blockUsed * header.frameSize;
+
+	if (header.flags & MATCHLOG_COMPRESSED)
+	{
+		packed.resize(compressBound(size));
+		uLongf packedSize = packed.size();
+		if (compress2(&packed[0], &packedSize, data, size, Z_BEST_SPEED) != Z_OK)
+			return false;
+		data = &packed[0];
+		size = packedSize;
+	}
+
+	if (fwrite(data, 1, size, file) != size)
+		return false;
+
+	MatchLogBlock entry;
+	entry.offset = offset;
+	entry.size = size;
+	entry.frames = blockUsed;
+	index.push_back(entry);
+
+	offset += size;
+	blockUsed = 0;
+	return true;
+}
+
+bool MatchLogWriter::close()
+{
+	if (file == NULL)
+		return false;
+
+	bool ok = writeBlock();
+
+	// The index after the blocks, then the header that points to it
+	header.blocks = index.size();
+	header.indexOffset = offset;
+	if (!index.empty() && fwrite(&index[0], sizeof(MatchLogBlock), index.size(), file) != index.size())
+		ok = false;
+
+	if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1)
+		ok = false;
+
+	if (fclose(file) != 0)
+		ok = false;
+
+	file = NULL;
+	index.clear();
+	return ok;
+}
+
+MatchLogReader::MatchLogReader()
+{
+	map = NULL;
+	mapSize = 0;
+	cachedBlock = -1;
+	memset(&header, 0, sizeof(header));
+}
+
+MatchLogReader::~MatchLogReader()
+{
+	close();
+}
+
+bool MatchLogReader::open(const char* filename)
+{
+	close();
+
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MatchLogHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	// The pages are only read when a frame of theirs is accessed
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED)
+		return false;
+
+	map = (unsigned char*)addr;
+	mapSize = st.st_size;
+	memcpy(&header, map, sizeof(header));
+
+	if (strncmp(header.magic, MATCHLOG_MAGIC, sizeof(header.magic)) != 0
+			|| header.schema != MATCHLOG_SCHEMA || header.frameSize != sizeof(Log_Information)
+			|| header.blockFrames == 0)
+	{
+		cerr << "MatchLog: " << filename << " is not a match log of schema " << MATCHLOG_SCHEMA << endl;
+		close();
+		return false;
+	}
+
+	if (header.flags & MATCHLOG_SEGMENTED)
+	{
+		if (!openSegments())
+		{
+			cerr << "MatchLog: " << filename << " has broken segments" << endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	if (header.indexOffset < sizeof(header)
+			|| header.indexOffset + (unsigned long long)header.blocks * sizeof(MatchLogBlock) > mapSize)
+	{
+		cerr << "MatchLog: " << filename << " is not a closed match log of schema " << MATCHLOG_SCHEMA << endl;
+		close();
+		return false;
+	}
+
+	index.resize(header.blocks);
+	if (header.blocks > 0)
+		memcpy(&index[0], map + header.indexOffset, header.blocks * sizeof(MatchLogBlock));
+
+	unsigned int frames = 0;
+	for (unsigned int b = 0; b < header.blocks; b++)
+	{
+		if (index[b].offset + index[b].size > header.indexOffset || index[b].frames > header.blockFrames
+				|| (b + 1 < header.blocks && index[b].frames != header.blockFrames))
+		{
+			cerr << "MatchLog: " << filename << " has a broken block index" << endl;
+			close();
+			return false;
+		}
+		frames += index[b].frames;
+	}
+	header.frames = frames;
+
+	return true;
+}
+
+bool MatchLogReader::openSegments()
+{
+	unsigned long long dataSize = (unsigned long long)header.blockFrames * header.frameSize;
+	if (header.segmentSize != dataSize + sizeof(MatchLogFooter) || (header.flags & MATCHLOG_COMPRESSED)
+			|| sizeof(header) + (unsigned long long)header.blocks * header.segmentSize > mapSize)
+		return false;
+
+	// Valid footers, a segment being started has none
+	std::vector<SegmentOrder> segments;
+	for (unsigned int s = 0; s < header.blocks; s++)
+	{
+		SegmentOrder seg;
+		memcpy(&seg.footer, map + sizeof(header) + (unsigned long long)s * header.segmentSize + dataSize, sizeof(MatchLogFooter));
+		seg.slot = s;
+
+		if (strncmp(seg.footer.magic, MATCHLOG_FOOTER_MAGIC, sizeof(seg.footer.magic)) == 0
+				&& seg.footer.sequence > 0 && seg.footer.frames > 0 && seg.footer.frames <= header.blockFrames)
+			segments.push_back(seg);
+	}
+	std::sort(segments.begin(), segments.end());
+
+	// The run of consecutive segments ending at the newest one, all full
+	// but the newest
+	unsigned int first = segments.size();
+	while (first > 0)
+	{
+		const MatchLogFooter& f = segments[first-1].footer;
+		if (first < segments.size() && (f.sequence + 1 != segments[first].footer.sequence || f.frames != header.blockFrames))
+			break;
+		first--;
+	}
+
+	header.frames = 0;
+	for (unsigned int i = first; i < segments.size(); i++)
+	{
+		MatchLogBlock entry;
+		entry.offset = sizeof(header) + (unsigned long long)segments[i].slot * header.segmentSize;
+		entry.size = segments[i].footer.frames * header.frameSize;
+		entry.frames = segments[i].footer.frames;
+		index.push_back(entry);
+		checksums.push_back(segments[i].footer.checksum);
+		sequences.push_back(segments[i].footer.sequence);
+		header.frames += entry.frames;
+	}
+	header.blocks = index.size();
+
+	return true;
+}
+
+void MatchLogReader::close()
+{
+	if (map != NULL)
+		munmap(map, mapSize);
+
+	map = NULL;
+	mapSize = 0;
+	index.clear();
+	checksums.clear();
+	sequences.clear();
+	cachedBlock = -1;
+	memset(&header, 0, sizeof(header));
+}
+
+const Log_Information* MatchLogReader::frame(unsigned int n)
+{
+	if (map == NULL || n >= header.frames)
+		return NULL;
+
+	unsigned int b = n / header.blockFrames;
+	unsigned int pos = (n % header.blockFrames) * header.frameSize;
+	const MatchLogBlock& entry = index[b];
+
+	if (header.flags & MATCHLOG_SEGMENTED)
+	{
+		if ((int)b != cachedBlock)
+		{
+			// The writer may be reusing the segment: copy it, then check that
+			// its footer is still the one seen on open and the copy its checksum
+			MatchLogFooter footer;
+			cache.resize(entry.size);
+			memcpy(&cache[0], map + entry.offset, entry.size);
+			__sync_synchronize();
+			memcpy(&footer, map + entry.offset + (unsigned long long)header.blockFrames * header.frameSize, sizeof(footer));
+
+			if (footer.sequence != sequences[b] || crc32(crc32(0, Z_NULL, 0), &cache[0], entry.size) != checksums[b])
+			{
+				cachedBlock = -1;
+				return NULL;
+			}
+			cachedBlock = b;
+		}
+		return (const Log_Information*)&cache[pos];
+	}
+
+	if (!(header.flags & MATCHLOG_COMPRESSED))
+		return (const Log_Information*)(map + entry.offset + pos);
+
+	if ((int)b != cachedBlock)
+	{
+		uLongf size = entry.frames * header.frameSize;
+		cache.resize(size);
+		if (uncompress(&cache[0], &size, map + entry.offset, entry.size) != Z_OK
+				|| size != entry.frames * header.frameSize)
+		{
+			cachedBlock = -1;
+			return NULL;
+		}
+		cachedBlock = b;
+	}
+
+	return (const Log_Information*)&cache[pos];
+}
+
+bool readXMLLogFrame(FILE* file, Log_Information& LI)
+{
+	int nItems=0;
+
+	//FIXME protection that should not exist if the file never got corrupted
+	int nTries = 0;
+
+	while( true )
+	{
+		nItems = fscanf(file, "<Instance gametime=\"%d\" gamestate=\"%d\" cambada=\"%d\" mf=\"%d\" formation=\"%d\">\n",
+				&(LI.coach.time) , &(LI.coach.gameState), &(LI.coach.ourGoals), &(LI.coach.theirGoals), &(LI.finfo.formationIdFreePlay));//FIXME need to add new formationIdSP
+
+		if(nItems == 5)
+			break;
+
+		if (nItems!=EOF) {
+			//FIXME protection that should not exist if the file never got corrupted
+			char dummy[5000];
+			if (fgets(dummy, 5000, file) == NULL)
+				return false;
+			nTries++;
+			cerr << "LOGPLAYER ERROR loading header - Try " << nTries << endl;
+			continue;
+		} else {
+			return false;
+		}
+	}
+
+	for( int i = 0 ; i < NROBOTS ; i++ )
+	{
+		int id, running, rAuto, coaching, oppDribbling, visible, engaged, airborne, own, nObst;
+		int nRole, nBehavior, nTeamColor, nGoalColor, nGameState;
+		unsigned int nIt;
+
+		char currentLine[2048];
+
+		if (fgets(currentLine, 2048, file) == NULL)
+			return false;
+
+		nIt = sscanf(currentLine, "<Agent id=\"%d\" running=\"%d\" robotx=\"%f\" roboty=\"%f\" orientation=\"%f\""
+							  " velx=\"%f\" vely=\"%f\" vela=\"%f\" role=\"%d\" behavior=\"%d\" stuck=\"%c\""
+							  " sposid=\"%d\" nobst=\"%d\" visible=\"%d\" own=\"%d\" engaged=\"%d\" airborne=\"%d\""
+							  " absx=\"%f\" absy=\"%f\" relx=\"%f\" rely=\"%f\" z=\"%f\" ballvelx=\"%f\" ballvely=\"%f\""
+							  " bat1=\"%f\" bat2=\"%f\""
+							  " bat3=\"%f\" oppDribbling=\"%d\" coaching=\"%d\" roleAuto=\"%d\" teamColor=\"%d\""
+							  " goalColor=\"%d\" gameState=\"%d\" coordFlag1=\"%d\" coordFlag2=\"%d\" cVecx=\"%f\""
+							  " cVecy=\"%f\" dPoint0x=\"%f\" dPoint0y=\"%f\" dPoint1x=\"%f\" dPoint1y=\"%f\""
+							  " dPoint2x=\"%f\" dPoint2y=\"%f\" dPoint3x=\"%f\" dPoint3y=\"%f\">\n",
+					&id, &running, &(LI.robot[i].pos.x), &(LI.robot[i].pos.y),
+					&(LI.robot[i].orientation), &(LI.robot[i].vel.x), &(LI.robot[i].vel.y),
+					&(LI.robot[i].angVelocity), &nRole, &nBehavior,
+					&(LI.robot[i].stuck), &(LI.finfo.posId[i]), &nObst,
+					&visible, &own, &engaged, &airborne, &(LI.robot[i].ball.pos.x), &(LI.robot[i].ball.pos.y),
+					&(LI.robot[i].ball.posRel.x), &(LI.robot[i].ball.posRel.y),
+					&(LI.robot[i].ball.height), &(LI.robot[i].ball.vel.x), &(LI.robot[i].ball.vel.y),
+					&(LI.robot[i].battery[0]), &(LI.robot[i].battery[1]), &(LI.robot[i].battery[2]), &oppDribbling,
+					&coaching, &rAuto, &nTeamColor, &nGoalColor,
+					&nGameState, &(LI.robot[i].coordinationFlag[0]),
+					&(LI.robot[i].coordinationFlag[1]), &(LI.robot[i].coordinationVec.x),
+					&(LI.robot[i].coordinationVec.y), &(LI.robot[i].debugPoints[0].x), &(LI.robot[i].debugPoints[0].y),
+					&(LI.robot[i].debugPoints[1].x), &(LI.robot[i].debugPoints[1].y), &(LI.robot[i].debugPoints[2].x),
+					&(LI.robot[i].debugPoints[2].y), &(LI.robot[i].debugPoints[3].x), &(LI.robot[i].debugPoints[3].y) );
+
+
+		if(nIt!=45)
+		{
+			cerr << "LOGPLAYER ERROR loading record with " << nIt << " items." << endl;
+			return false;
+		}
+
+		// nobst and oppDribbling are bytes, read as int
+		if( nObst < 0 || nObst > MAX_SHARED_OBSTACLES )
+		{
+			cerr << "LOGPLAYER ERROR loading record with " << nObst << " obstacles." << endl;
+			return false;
+		}
+		LI.robot[i].nObst = nObst;
+		LI.robot[i].opponentDribbling = oppDribbling;
+
+		nIt = 0;
+
+		for( unsigned int oo = 0 ; oo < LI.robot[i].nObst ; oo++ )
+		{
+			float trash;
+			fgets(currentLine, 2048, file);
+
+			nIt += sscanf(currentLine, "<Obst obstx=\"%f\" obsty=\"%f\" size=\"%f\" teammate=\"%d\"/>\n",
+					&(LI.robot[i].obstacles[oo].absCenter.x),&(LI.robot[i].obstacles[oo].absCenter.y), &trash,
+					&(LI.robot[i].obstacles[oo].id));
+		}
+
+		if( nIt !=  (4 * LI.robot[i].nObst) )
+		{
+			cerr << "LOGPLAYER ERROR loading obst: AGENT "<< i <<" has "<< LI.robot[i].nObst << "obs, total items "<< nIt << endl;
+			return false;
+		}
+
+		LI.robot[i].role = (RoleID)nRole;
+		LI.robot[i].behaviour = (BehaviourID)nBehavior;
+		LI.robot[i].teamColor = (WSColor)nTeamColor;
+		LI.robot[i].goalColor = (WSColor)nGoalColor;
+		LI.robot[i].currentGameState = (WSGameState)nGameState;
+
+		if(running != 0)
+			LI.robot[i].running = true;
+		else
+			LI.robot[i].running = false;
+
+		if(rAuto != 0)
+			LI.robot[i].roleAuto = true;
+		else
+			LI.robot[i].roleAuto = false;
+
+		if(coaching != 0)
+			LI.robot[i].coaching = true;
+		else
+			LI.robot[i].coaching = false;
+
+//			if(oppDribbling != 0)
+//				LI.robot[i].opponentDribbling = true;
+//			else
+//				LI.robot[i].opponentDribbling = false;
+
+
+		if(visible != 0)
+			LI.robot[i].ball.visible = true;
+		else
+			LI.robot[i].ball.visible = false;
+
+		if(engaged != 0)
+			LI.robot[i].ball.engaged = true;
+		else
+			LI.robot[i].ball.engaged = false;
+
+		if(airborne != 0)
+			LI.robot[i].ball.airborne = true;
+		else
+			LI.robot[i].ball.airborne = false;
+
+		if (own != 0)
+			LI.robot[i].ball.own=true;
+		else
+			LI.robot[i].ball.own=false;
+
+
+		//Vec rel = LI.robot[i].ball.posAbs - LI.robot[i].me.position;
+		//rel.s_rotate( Angle(-LI.robot[i].me.orientation) );
+
+		//LI.robot[i].ball.position = rel;
+
+		fgets(currentLine, 2048, file);
+//			fscanf(file, "</Agent>\n");
+	}
+
+	fscanf(file, "</Instance>\n");
+	return true;
+}
+
+int convertXMLLog(const char* xmlFile, const char* logFile, bool compress)
+{
+	FILE* file = fopen(xmlFile, "r");
+	if (file == NULL)
+		return -1;
+
+	MatchLogWriter writer;
+	if (!writer.open(logFile, compress))
+	{
+		fclose(file);
+		return -1;
+	}
+
+	fscanf(file, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n<Root>\n");
+
+	// One frame in memory at a time
+	Log_Information LI;
+	while (readXMLLogFrame(file, LI))
+		writer.write(LI);
+
+	fclose(file);
+
+	int frames = writer.frames();
+	if (!writer.close())
+		return -1;
+
+	return frames;
+}
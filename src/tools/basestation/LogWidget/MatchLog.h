@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA BASESTATION
+ *
+ * CAMBADA BASESTATION is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA BASESTATION is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MATCHLOG_H
+#define __MATCHLOG_H
+
+#include <stdio.h>
+#include <vector>
+
+#include "DB_Robot_info.h"
+
+#define MATCHLOG_MAGIC			"CBDLOG1"	// 8 bytes with the terminator
+#define MATCHLOG_SCHEMA			1			// layout of Log_Information, increase when it changes
+#define MATCHLOG_BLOCK_FRAMES	100			// default frames per block (10 s)
+#define MATCHLOG_COMPRESSED		0x01		// blocks are zlib compressed
+#define MATCHLOG_SEGMENTED		0x02		// ring of fixed size segments with footers, no index
+#define MATCHLOG_FOOTER_MAGIC	"CBDSEG1"
+
+using namespace cambada;
+
+/**
+ * \brief One frame of a match log
+ */
+class Log_Information
+{
+	public:
+	FormationInfo finfo;
+	CoachInfo coach;
+	Robot robot[NROBOTS];
+};
+
+/**
+ * \brief Match log file header
+ *
+ * The file is the header, the blocks of frames and the block index. A
+ * block holds blockFrames raw Log_Information frames (the last one may
+ * have less), zlib compressed when MATCHLOG_COMPRESSED is set. All the
+ * blocks but the last have the same number of frames, so the block of a
+ * frame is found without searching.
+ *
+ * A segmented log (MATCHLOG_SEGMENTED, the autolog) has no index: the
+ * file is preallocated to blocks segments of segmentSize bytes, each one
+ * holding up to blockFrames raw frames and a MatchLogFooter at its end.
+ * The segments are rewritten in turn and ordered by their footers.
+ */
+struct MatchLogHeader
+{
+	char magic[8];					// MATCHLOG_MAGIC
+	unsigned int schema;			// MATCHLOG_SCHEMA
+	unsigned int frameSize;			// sizeof(Log_Information)
+	unsigned int blockFrames;		// frames per block
+	unsigned int flags;				// MATCHLOG_COMPRESSED | MATCHLOG_SEGMENTED
+	unsigned int frames;			// number of frames
+	unsigned int blocks;			// number of blocks
+	unsigned long long indexOffset;	// file offset of the block index, 0 until the log is closed
+	unsigned int segmentSize;		// bytes per segment (segmented log)
+	char reserved[20];
+};
+
+/**
+ * \brief Last bytes of a segment, rewritten after the frames it counts,
+ * so a segment read after a crash is either valid or rejected
+ */
+struct MatchLogFooter
+{
+	char magic[8];					// MATCHLOG_FOOTER_MAGIC
+	unsigned int sequence;			// segment number in the log, from 1
+	unsigned int frames;			// frames in the segment
+	unsigned int checksum;			// crc32 of the frames
+	unsigned int reserved;
+};
+
+/**
+ * \brief Block index entry
+ */
+struct MatchLogBlock
+{
+	unsigned long long offset;		// file offset of the block
+	unsigned int size;				// stored bytes
+	unsigned int frames;			// frames in the block
+};
+
+/**
+ * \brief Writes a match log, frame by frame
+ */
+class MatchLogWriter
+{
+public:
+	MatchLogWriter();
+	~MatchLogWriter();
+
+	/**
+	 * Create the log (truncating it)
+	 * \param compress zlib compress the blocks
+	 * \param blockFrames frames per block
+	 */
+	bool open(const char* filename, bool compress = false, unsigned int blockFrames = MATCHLOG_BLOCK_FRAMES);
+
+	/**
+	 * Add a frame, the block is written when it is full
+	 */
+	bool write(const Log_Information& frame);
+
+	/**
+	 * Write the last block, the index and the final header
+	 */
+	bool close();
+
+	bool isOpen() const { return file != NULL; }
+	unsigned int frames() const { return header.frames; }
+
+private:
+	bool writeBlock();
+
+	FILE* file;
+	MatchLogHeader header;
+	std::vector<MatchLogBlock> index;
+	std::vector<unsigned char> block;		// frames of the block being filled
+	std::vector<unsigned char> packed;		// compressed block
+	unsigned int blockUsed;
+	unsigned long long offset;
+};
+
+/**
+ * \brief Reads a match log mapped in memory, the frames are only read
+ * (and the blocks decompressed) when they are accessed
+ *
+ * The segments of a segmented log may be rewritten while it is open (the
+ * autolog being recorded), so each one is copied when it is accessed and
+ * only used if it still is the segment seen when the log was opened.
+ */
+class MatchLogReader
+{
+public:
+	MatchLogReader();
+	~MatchLogReader();
+
+	/**
+	 * Map a closed log or a segmented log (even one still being written)
+	 * \return false if it isn't a match log of this schema or is truncated
+	 */
+	bool open(const char* filename);
+	void close();
+
+	bool isOpen() const { return map != NULL; }
+	unsigned int frames() const { return header.frames; }
+
+	/**
+	 * Frame n (from 0), valid until the next call
+	 * \return NULL if out of range or the block is corrupt
+	 */
+	const Log_Information* frame(unsigned int n);
+
+private:
+	bool openSegments();
+
+	unsigned char* map;
+	size_t mapSize;
+	MatchLogHeader header;
+	std::vector<MatchLogBlock> index;
+	std::vector<unsigned int> checksums;	// of the segments, checked when they are copied
+	std::vector<unsigned int> sequences;	// footer sequence of the segments when the log was opened
+	std::vector<unsigned char> cache;		// decompressed block
+	int cachedBlock;
+};
+
+/**
+ * \brief Read the next frame of an XML log (the old autolog format)
+ * \return false at the end of the file or on a broken record
+ */
+bool readXMLLogFrame(FILE* file, Log_Information& LI);
+
+/**
+ * \brief Convert an XML log to a match log
+ * \return number of frames converted, -1 if a file can't be opened
+ */
+int convertXMLLog(const char* xmlFile, const char* logFile, bool compress = true);
+
+#endif
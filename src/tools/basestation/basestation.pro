@@ -30,7 +30,9 @@ INCLUDEPATH += . \
 HEADERS += FieldWidget/FieldWidget.h \
            FullInfoWindow/FullInfoWindow.h \
            FullWindow/FullWindow.h \
+		   LogWidget/AutoLog.h \
 		   LogWidget/LogWidget.h \
+		   LogWidget/MatchLog.h \
            MainWindow/MainWindow.h \
            RefBoxWidget/RefBoxDialog.h \
            RefBoxWidget/RefBoxWidget.h \
@@ -54,7 +56,9 @@ SOURCES += main.cpp \
            FieldWidget/FieldWidget.cpp \
            FullInfoWindow/FullInfoWindow.cpp \
            FullWindow/FullWindow.cpp \
+           LogWidget/AutoLog.cpp \
            LogWidget/LogWidget.cpp \
+           LogWidget/MatchLog.cpp \
            MainWindow/MainWindow.cpp \
            RefBoxWidget/RefBoxDialog.cpp \
            RefBoxWidget/RefBoxWidget.cpp \
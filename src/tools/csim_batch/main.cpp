@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA TOOLS
+ *
+ * CAMBADA TOOLS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA TOOLS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Batch match runner:
+ *   run      plays the matches of a scenario, headless and in lock step
+ *            (csim -L), several at once in separate instance namespaces
+ *            (CAMBADA_INSTANCE), and appends one row per match to a
+ *            tab separated results file: outcome metrics (csim -o) and
+ *            performance metrics (step time, agent cycle times, comm)
+ *   compare  per scenario summary of two results files (e.g. two builds):
+ *            mean and deviation of every metric, relative change, and a
+ *            mark where the change is significant (Welch t > 2)
+ *
+ * Scenario file, one "key value" per line, '#' comments:
+ *   name        scenario name (results column)
+ *   runs        number of matches
+ *   jobs        matches played at the same time
+ *   duration    simulated time of each match (s)
+ *   seed        seed of the first match, the next ones count up
+ *   obstacles   number of obstacles in the field
+ *   agents      robot ids, e.g. "1 2 3 4 5"
+ *   comm        simulated comm link, the comm map of sim.conf.yaml,
+ *               e.g. "{latency: 5, jitter: 3, loss: 0.05}"
+ *   config      team configuration tree (cambada.conf.xml gives the field size)
+ *   bin         directory of csim and agent (default .)
+ *   lib         LD_LIBRARY_PATH of csim (default <bin>/../lib)
+ *   models      world models (default <bin>/../src/tools/simulator/csim-0.1.0/worlds)
+ *   generator   world generator (default <bin>/../src/tools/simulator/tools/gen/generator.rb)
+ *   workdir     where the matches run (default batch_<name>)
+ *   instance    first instance namespace (default 1)
+ *   walltimeout wall time limit of a match (s, default 4*duration + 60)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rtdbdefs.h"
+
+using namespace std;
+
+volatile sig_atomic_t EXIT = false;
+
+void closeMe(int sig)
+{
+	if( sig == SIGINT || sig == SIGTERM )
+		EXIT = true;
+}
+
+void printHelp()
+{
+	fprintf(stderr,"Usage: csim_batch run <scenario> <results.tsv>\n");
+	fprintf(stderr,"       csim_batch compare <base.tsv> <new.tsv>\n");
+}
+
+// Match statistics written by csim -o, in column order
+static const char *STATS[] = {
+	"sim_time", "real_time",
+	"goals_north", "goals_south", "ball_out",
+	"possession_magenta", "possession_cyan",
+	"passes", "passes_lost", "pass_success",
+	"time_to_ball_magenta", "time_to_ball_cyan",
+	"steps", "step_mean_us", "step_max_us", "agent_wait_mean_us", "agent_wait_max_us",
+	"comm_relays", "comm_age_mean_ms", "comm_lost",
+	"agent_cycles", "agent_cycle_mean_us", "agent_cycle_max_us", "agent_cycle_p95_us",
+	"agent_activations", "agent_deadline_misses",
+	NULL
+};
+
+static double wallTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// -----------------------------------------------------------------------------
+// Scenario
+
+struct Scenario
+{
+	string name;
+	int runs, jobs;
+	double duration;
+	unsigned int seed;
+	int obstacles;
+	vector<int> agents;
+	string comm;
+	string config, bin, lib, models, generator, workdir;
+	int instance;
+	double walltimeout;
+
+	bool load( const char *file )
+	{
+		ifstream in(file);
+		string line, key;
+
+		if( !in ) {
+			fprintf(stderr,"csim_batch: can't open %s\n", file);
+			return false;
+		}
+
+		name = "scenario";
+		runs = 1; jobs = 1;
+		duration = 300;
+		seed = 1;
+		obstacles = 5;
+		config = "../config";
+		bin = ".";
+		instance = 1;
+		walltimeout = 0;
+
+		while( getline(in, line) ) {
+			if( line.find('#') != string::npos )
+				line.erase(line.find('#'));
+			istringstream ls(line);
+			if( !(ls >> key) )
+				continue;
+
+			if( key == "name" ) ls >> name;
+			else if( key == "runs" ) ls >> runs;
+			else if( key == "jobs" ) ls >> jobs;
+			else if( key == "duration" ) ls >> duration;
+			else if( key == "seed" ) ls >> seed;
+			else if( key == "obstacles" ) ls >> obstacles;
+			else if( key == "agents" ) { int a; agents.clear(); while( ls >> a ) agents.push_back(a); }
+			else if( key == "comm" ) { getline(ls, comm); comm.erase(0, comm.find_first_not_of(" \t")); }
+			else if( key == "config" ) ls >> config;
+			else if( key == "bin" ) ls >> bin;
+			else if( key == "lib" ) ls >> lib;
+			else if( key == "models" ) ls >> models;
+			else if( key == "generator" ) ls >> generator;
+			else if( key == "workdir" ) ls >> workdir;
+			else if( key == "instance" ) ls >> instance;
+			else if( key == "walltimeout" ) ls >> walltimeout;
+			else {
+				fprintf(stderr,"csim_batch: %s: unknown key '%s'\n", file, key.c_str());
+				return false;
+			}
+		}
+
+		if( agents.empty() )
+			for( int a = 1; a <= 5; a++ )
+				agents.push_back(a);
+		if( lib.empty() ) lib = bin + "/../lib";
+		if( models.empty() ) models = bin + "/../src/tools/simulator/csim-0.1.0/worlds";
+		if( generator.empty() ) generator = bin + "/../src/tools/simulator/tools/gen/generator.rb";
+		if( workdir.empty() ) workdir = "batch_" + name;
+		if( walltimeout <= 0 ) walltimeout = 4*duration + 60;
+		if( jobs < 1 ) jobs = 1;
+
+		// every path is used from the match directories
+		config = absPath(config); bin = absPath(bin); lib = absPath(lib);
+		models = absPath(models); generator = absPath(generator); workdir = absPath(workdir);
+		return true;
+	}
+
+	static string absPath( const string& path )
+	{
+		char cwd[4096];
+		if( path.empty() || path[0] == '/' || getcwd(cwd, sizeof(cwd)) == NULL )
+			return path;
+		return string(cwd) + "/" + path;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// Match directory: <workdir>/run_<k>/{bin,config}, the processes run in bin
+// and find their configuration in ../config like in the source tree
+
+static bool makeDir( const string& dir )
+{
+	return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// Links every entry of src into dst, except the ones in skip
+static bool linkEntries( const string& src, const string& dst, const char *skip1, const char *skip2 )
+{
+	DIR *d = opendir(src.c_str());
+	struct dirent *e;
+
+	if( d == NULL ) {
+		fprintf(stderr,"csim_batch: can't read %s\n", src.c_str());
+		return false;
+	}
+	while( (e = readdir(d)) != NULL ) {
+		if( e->d_name[0] == '.' || (skip1 && strcmp(e->d_name, skip1) == 0) || (skip2 && strcmp(e->d_name, skip2) == 0) )
+			continue;
+		string target = dst + "/" + e->d_name;
+		unlink(target.c_str());
+		if( symlink((src + "/" + e->d_name).c_str(), target.c_str()) != 0 ) {
+			fprintf(stderr,"csim_batch: can't link %s\n", target.c_str());
+			closedir(d);
+			return false;
+		}
+	}
+	closedir(d);
+	return true;
+}
+
+// sim.conf.yaml of the team (or the simulator default) with the obstacles, agents and comm of the scenario
+static bool writeSimConf( const Scenario& sc, const string& file )
+{
+	string src = sc.config + "/sim.conf.yaml";
+	ifstream in(src.c_str());
+	if( !in ) {
+		src = sc.models + "/sim.conf.yaml";
+		in.open(src.c_str());
+	}
+	ofstream out(file.c_str());
+	string line;
+
+	if( !in || !out ) {
+		fprintf(stderr,"csim_batch: can't write %s from %s\n", file.c_str(), src.c_str());
+		return false;
+	}
+	while( getline(in, line) ) {
+		if( line.compare(0, 10, "obstacles:") == 0 )
+			out << "obstacles: " << sc.obstacles << "\n";
+		else if( line.compare(0, 7, "agents:") == 0 ) {
+			out << "agents: [";
+			for( unsigned int i = 0; i < sc.agents.size(); i++ )
+				out << (i ? ", " : "") << sc.agents[i];
+			out << "]\n";
+		}
+		else if( line.compare(0, 5, "comm:") == 0 && !sc.comm.empty() )
+			continue;
+		else
+			out << line << "\n";
+	}
+	if( !sc.comm.empty() )
+		out << "comm: " << sc.comm << "\n";
+	return true;
+}
+
+static pid_t spawn( const string& cwd, const string& log, const vector<string>& env, const vector<string>& argv )
+{
+	pid_t pid = fork();
+
+	if( pid != 0 )
+		return pid;
+
+	vector<char*> args;
+	for( unsigned int i = 0; i < argv.size(); i++ )
+		args.push_back((char*)argv[i].c_str());
+	args.push_back(NULL);
+
+	for( unsigned int i = 0; i < env.size(); i++ )
+		putenv((char*)env[i].c_str());
+
+	int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd >= 0 ) {
+		dup2(fd, 1);
+		dup2(fd, 2);
+		close(fd);
+	}
+	setpgid(0, 0);		// not interrupted by the ^C of the batch
+	if( chdir(cwd.c_str()) == 0 )
+		execv(args[0], &args[0]);
+	fprintf(stderr,"csim_batch: can't run %s: %s\n", args[0], strerror(errno));
+	_exit(127);
+}
+
+struct Match
+{
+	int run;
+	unsigned int seed;
+	int instance;
+	string dir;
+	pid_t csim;
+	vector<pid_t> agents;
+	double start;
+	bool timedOut;
+	double stopped;			// wall time csim was asked to stop, 0 while it runs
+	bool killed;
+};
+
+// Time a stopped csim gets to write its statistics before it is killed (s)
+static const double CSIM_STOP_GRACE = 10.0;
+
+static bool startMatch( const Scenario& sc, int run, int instance, Match& m )
+{
+	ostringstream s;
+	s << sc.workdir << "/run_" << run;
+
+	m.run = run;
+	m.seed = sc.seed + run;
+	m.instance = instance;
+	m.dir = s.str();
+	m.agents.clear();
+	m.timedOut = false;
+	m.stopped = 0;
+	m.killed = false;
+
+	string conf = m.dir + "/config";
+	if( !makeDir(sc.workdir) || !makeDir(m.dir) || !makeDir(m.dir + "/bin") || !makeDir(conf)
+			|| !makeDir(conf + "/worlds")
+			|| !linkEntries(sc.config, conf, "worlds", "sim.conf.yaml")
+			|| !linkEntries(sc.models, conf + "/worlds", "sim.conf.yaml", NULL)
+			|| !writeSimConf(sc, conf + "/sim.conf.yaml") )
+		return false;
+
+	// CAMBADA.world of this match
+	unlink((conf + "/worlds/CAMBADA.world").c_str());
+	string gen = "ruby '" + sc.generator + "' '" + conf + "' > '" + m.dir + "/generator.log' 2>&1";
+	if( system(gen.c_str()) != 0 ) {
+		fprintf(stderr,"csim_batch: world generation failed, see %s/generator.log\n", m.dir.c_str());
+		return false;
+	}
+
+	ostringstream inst, seed, dur;
+	inst << instance;
+	seed << m.seed;
+	dur << sc.duration;
+
+	vector<string> env;
+	env.push_back(string(INSTANCE_ENV) + "=" + inst.str());
+	env.push_back("MTRAND_SEED=" + seed.str());
+
+	vector<string> argv;
+	argv.push_back(sc.bin + "/csim");
+	argv.push_back("-L");
+	argv.push_back("-t"); argv.push_back(dur.str());
+	argv.push_back("-R"); argv.push_back(seed.str());
+	argv.push_back("-i"); argv.push_back(inst.str());
+	argv.push_back("-o"); argv.push_back(m.dir + "/match.stats");
+	argv.push_back(conf + "/worlds/CAMBADA.world");
+
+	vector<string> simEnv(env);
+	simEnv.push_back("LD_LIBRARY_PATH=" + sc.lib);
+
+	unlink((m.dir + "/match.stats").c_str());
+	m.start = wallTime();
+	m.csim = spawn(m.dir + "/bin", m.dir + "/csim.log", simEnv, argv);
+
+	// The simulator holds the first step until every agent is attached to PMAN
+	for( unsigned int i = 0; i < sc.agents.size(); i++ ) {
+		ostringstream a, log;
+		a << "AGENT=" << sc.agents[i];
+		log << m.dir << "/agent" << sc.agents[i] << ".log";
+
+		vector<string> agentEnv(env);
+		agentEnv.push_back(a.str());
+		vector<string> agentArgv(1, sc.bin + "/agent");
+		m.agents.push_back(spawn(m.dir + "/bin", log.str(), agentEnv, agentArgv));
+	}
+
+	printf("run %d: instance %d, seed %u\n", run, instance, m.seed);
+	fflush(stdout);
+	return true;
+}
+
+// Stops the agents of a finished match, waiting at most 5 s before killing them
+static void stopAgents( Match& m )
+{
+	for( unsigned int i = 0; i < m.agents.size(); i++ )
+		kill(m.agents[i], SIGINT);
+
+	for( int t = 0; t < 50; t++ ) {
+		bool alive = false;
+		for( unsigned int i = 0; i < m.agents.size(); i++ )
+			if( m.agents[i] > 0 ) {
+				if( waitpid(m.agents[i], NULL, WNOHANG) == 0 )
+					alive = true;
+				else
+					m.agents[i] = 0;
+			}
+		if( !alive )
+			return;
+		usleep(100000);
+	}
+
+	for( unsigned int i = 0; i < m.agents.size(); i++ )
+		if( m.agents[i] > 0 ) {
+			kill(m.agents[i], SIGKILL);
+			waitpid(m.agents[i], NULL, 0);
+		}
+}
+
+static void writeRow( FILE *out, const Scenario& sc, const Match& m, int status, double wall )
+{
+	map<string,string> stats;
+	ifstream in((m.dir + "/match.stats").c_str());
+	string key, value;
+
+	while( in >> key >> value )
+		stats[key] = value;
+
+	const char *res = m.timedOut ? "timeout"
+			: (WIFEXITED(status) && WEXITSTATUS(status) == 0 && !stats.empty()) ? "ok" : "failed";
+
+	fprintf(out, "%s\t%d\t%u\t%s\t%.3f", sc.name.c_str(), m.run, m.seed, res, wall);
+	for( int i = 0; STATS[i] != NULL; i++ )
+		fprintf(out, "\t%s", stats.count(STATS[i]) ? stats[STATS[i]].c_str() : "nan");
+	fprintf(out, "\n");
+	fflush(out);
+
+	printf("run %d: %s (%.1f s)\n", m.run, res, wall);
+	fflush(stdout);
+}
+
+int run( const char *scenarioFile, const char *resultsFile )
+{
+	Scenario sc;
+	if( !sc.load(scenarioFile) )
+		return 1;
+
+	bool header = (access(resultsFile, F_OK) != 0);
+	FILE *out = fopen(resultsFile, "a");
+	if( out == NULL ) {
+		fprintf(stderr,"csim_batch: can't open %s\n", resultsFile);
+		return 1;
+	}
+	if( header ) {
+		fprintf(out, "scenario\trun\tseed\tresult\twall_time");
+		for( int i = 0; STATS[i] != NULL; i++ )
+			fprintf(out, "\t%s", STATS[i]);
+		fprintf(out, "\n");
+	}
+
+	vector<Match> slot(sc.jobs);
+	vector<bool> busy(sc.jobs, false);
+	int next = 0, running = 0, failed = 0;
+
+	while( (next < sc.runs && !EXIT) || running > 0 ) {
+
+		// Fill the free slots, one instance namespace each
+		for( int s = 0; s < sc.jobs && next < sc.runs && !EXIT; s++ )
+			if( !busy[s] ) {
+				if( startMatch(sc, next, sc.instance + s, slot[s]) ) {
+					busy[s] = true;
+					running++;
+				}
+				else
+					failed++;
+				next++;
+			}
+
+		usleep(100000);
+
+		for( int s = 0; s < sc.jobs; s++ ) {
+			if( !busy[s] )
+				continue;
+
+			Match& m = slot[s];
+			int status = 0;
+			double wall = wallTime() - m.start;
+
+			if( (EXIT || wall > sc.walltimeout) && m.stopped == 0 ) {
+				m.timedOut = !EXIT;
+				m.stopped = wallTime();
+				kill(m.csim, SIGINT);		// csim still writes its statistics
+			}
+			else if( m.stopped > 0 && !m.killed && wallTime() - m.stopped > CSIM_STOP_GRACE ) {
+				fprintf(stderr,"csim_batch: run %d: csim didn't stop, killing it\n", m.run);
+				kill(m.csim, SIGKILL);
+				m.killed = true;
+			}
+
+			if( waitpid(m.csim, &status, WNOHANG) != m.csim )
+				continue;
+
+			stopAgents(m);
+			writeRow(out, sc, m, status, wall);
+			busy[s] = false;
+			running--;
+		}
+	}
+
+	fclose(out);
+	return failed ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Comparison report
+
+struct Results
+{
+	vector<string> cols;
+	map< string, vector< vector<double> > > rows;	// per scenario, per column
+
+	bool load( const char *file )
+	{
+		ifstream in(file);
+		string line, field;
+
+		if( !in || !getline(in, line) ) {
+			fprintf(stderr,"csim_batch: can't read %s\n", file);
+			return false;
+		}
+		istringstream hs(line);
+		while( getline(hs, field, '\t') )
+			cols.push_back(field);
+
+		while( getline(in, line) ) {
+			istringstream ls(line);
+			vector<string> f;
+			while( getline(ls, field, '\t') )
+				f.push_back(field);
+			if( f.size() != cols.size() || f[3] != "ok" )	// failed matches are left out
+				continue;
+
+			vector< vector<double> >& r = rows[f[0]];
+			r.resize(cols.size());
+			for( unsigned int i = 0; i < f.size(); i++ )
+				r[i].push_back(strtod(f[i].c_str(), NULL));
+		}
+		return true;
+	}
+};
+
+// returns the number of valid samples
+static unsigned int meanSd( const vector<double>& v, double& mean, double& sd )
+{
+	unsigned int n = 0;
+	double sum = 0, sq = 0;
+
+	for( unsigned int i = 0; i < v.size(); i++ )
+		if( !isnan(v[i]) && v[i] >= 0 ) {	// -1 = never happened (time to ball)
+			sum += v[i];
+			n++;
+		}
+	mean = n ? sum / n : NAN;
+	for( unsigned int i = 0; i < v.size(); i++ )
+		if( !isnan(v[i]) && v[i] >= 0 )
+			sq += (v[i] - mean) * (v[i] - mean);
+	sd = (n > 1) ? sqrt(sq / (n - 1)) : 0;
+	return n;
+}
+
+int compare( const char *baseFile, const char *newFile )
+{
+	Results base, cur;
+
+	if( !base.load(baseFile) || !cur.load(newFile) )
+		return 1;
+
+	map< string, vector< vector<double> > >::iterator it;
+	for( it = base.rows.begin(); it != base.rows.end(); it++ ) {
+		if( cur.rows.count(it->first) == 0 )
+			continue;
+
+		vector< vector<double> >& a = it->second;
+		vector< vector<double> >& b = cur.rows[it->first];
+
+		printf("scenario %s: %u vs %u matches\n", it->first.c_str(),
+				(unsigned int)a[0].size(), (unsigned int)b[0].size());
+		printf("  %-24s %14s %12s %14s %12s %9s\n", "metric", "base", "sd", "new", "sd", "change");
+
+		// skip scenario, run, seed and result
+		for( unsigned int c = 4; c < base.cols.size(); c++ ) {
+			unsigned int j;
+			for( j = 0; j < cur.cols.size() && cur.cols[j] != base.cols[c]; j++ )
+				;
+			if( j == cur.cols.size() )
+				continue;
+
+			double ma, sa, mb, sb;
+			unsigned int na = meanSd(a[c], ma, sa);
+			unsigned int nb = meanSd(b[j], mb, sb);
+
+			// standard error over the runs that count (not NaN nor -1)
+			double change = (ma != 0) ? (mb - ma) / fabs(ma) * 100 : 0;
+			double se = sqrt((na ? sa*sa / na : 0) + (nb ? sb*sb / nb : 0));
+			bool significant = (se > 0) ? fabs(mb - ma) / se > 2 : mb != ma;
+
+			printf("  %-24s %14.3f %12.3f %14.3f %12.3f %+8.1f%% %s\n", base.cols[c].c_str(),
+					ma, sa, mb, sb, change, significant ? "*" : "");
+		}
+		printf("\n");
+	}
+	printf("* change larger than twice its standard error\n");
+	return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+	signal(SIGINT, closeMe);
+	signal(SIGTERM, closeMe);
+
+	if( argc == 4 && strcmp(argv[1], "run") == 0 )
+		return run(argv[2], argv[3]);
+	if( argc == 4 && strcmp(argv[1], "compare") == 0 )
+		return compare(argv[2], argv[3]);
+
+	printHelp();
+	return 1;
+}
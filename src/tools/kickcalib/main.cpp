@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA TOOLS
+ *
+ * CAMBADA TOOLS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA TOOLS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Kick calibration recorder: runs on the base station (AGENT=0), watches the
+ * KICKCALIB_ROB record of every robot and appends a sample to kicker.calib
+ * each time a robot kicks. The kick model cache of that robot is rebuilt
+ * right away, so the next agent start uses the new calibration.
+ *
+ * With -r the robot is put in the KickCalibrate role through KICKCALIB_APP;
+ * each line typed on stdin asks it for a kick (a number sets the power
+ * first), and the agent publishes KICKCALIB_ROB (see BKickCalibrate).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include "rtdb.h"
+#include "KickCalibData.h"
+#include "KickerConf.h"
+
+using namespace cambada;
+
+volatile sig_atomic_t EXIT = 0;
+
+void closeMe(int sig)
+{
+	if( sig == SIGINT )
+		EXIT = 1;
+}
+
+void printHelp()
+{
+	fprintf(stderr,"Usage: kickcalib [options]\n");
+	fprintf(stderr,"  -c <file>    calibration samples file (default ../config/kicker.calib)\n");
+	fprintf(stderr,"  -H <height>  height (m) of the recorded kicks at the measured distance (default 0)\n");
+	fprintf(stderr,"  -r <robot>   calibrate this robot, each line on stdin asks for a kick\n");
+	fprintf(stderr,"  -p <power>   kick power of the -r kicks (default 30)\n");
+	fprintf(stderr,"  -b           only rebuild the kick model caches and exit\n");
+}
+
+void rebuild(int robot, const char* calibFile)
+{
+	// rebuilds the model cache if the samples changed (exits if it can't)
+	KickerConf conf(robot, (char*)"../config/kicker.conf", calibFile);
+
+	const cambada::util::KickModel& model = conf.getModel();
+	fprintf(stderr,"R%d:", robot);
+	for( int d = 2; d <= 12; d += 2 )
+		fprintf(stderr," %dm=%d", d, model.getPower(d, 0.0));
+	fprintf(stderr,"\n");
+}
+
+int main( int argc , char* argv[] )
+{
+	const char* calibFile = "../config/kicker.calib";
+	float height = 0.0;
+	bool onlyBuild = false;
+	int calibRobot = 0;
+	int power = 30;
+
+	int opt;
+	while( (opt = getopt(argc, argv, "c:H:r:p:bh")) != -1 )
+	{
+		switch( opt )
+		{
+		case 'c': calibFile = optarg; break;
+		case 'H': height = atof(optarg); break;
+		case 'r': calibRobot = atoi(optarg); break;
+		case 'p': power = atoi(optarg); break;
+		case 'b': onlyBuild = true; break;
+		default: printHelp(); return 1;
+		}
+	}
+
+	if( onlyBuild )
+	{
+		for( int r = 1; r <= 6; r++ )
+			rebuild(r, calibFile);
+		return 0;
+	}
+
+	if( DB_init() == -1 )
+	{
+		fprintf(stderr,"kickcalib: DB_init failed\n");
+		return 1;
+	}
+
+	signal(SIGINT, closeMe);
+
+	bool kicked[N_AGENTS];
+	memset(kicked, 0, sizeof(kicked));
+
+	KickCalibAppData app;
+	memset(&app, 0, sizeof(app));
+	app.robotNumber = calibRobot;
+	app.power = power;
+	app.active = (calibRobot > 0 && calibRobot < N_AGENTS);
+	if( app.active )
+		fprintf(stderr,"R%d: press enter to kick with power %d (or type another power)\n", calibRobot, power);
+
+	while( !EXIT )
+	{
+		if( app.active )
+		{
+			DB_put(KICKCALIB_APP, &app);
+
+			// waits for the operator instead of sleeping
+			struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+			if( poll(&pfd, 1, 50) > 0 )
+			{
+				char line[64];
+				if( fgets(line, sizeof(line), stdin) == NULL )
+					break;
+				if( atoi(line) > 0 )
+					app.power = atoi(line);
+				app.kick = true;
+			}
+		}
+		else
+			usleep(50000);
+
+		for( int r = 1; r < N_AGENTS; r++ )
+		{
+			KickCalibRobData data;
+			int life = DB_get(r, KICKCALIB_ROB, &data);
+			if( life < 0 || life > 1000 )
+				continue;
+
+			// a new sample on each kicked false->true transition
+			if( data.kicked && !kicked[r] )
+			{
+				FILE* fp = fopen(calibFile, "a");
+				if( fp == NULL )
+				{
+					fprintf(stderr,"kickcalib: could not open %s\n", calibFile);
+				}
+				else
+				{
+					fprintf(fp, "R%d %.3f %.3f %d\n", r, data.distance, height, data.power);
+					fclose(fp);
+					fprintf(stderr,"R%d sample: distance %.3f height %.3f power %d\n", r, data.distance, height, data.power);
+					rebuild(r, calibFile);
+				}
+			}
+			// the requested kick is done, the next one needs a new line
+			if( r == calibRobot && data.kicked && !kicked[r] )
+				app.kick = false;
+
+			kicked[r] = data.kicked;
+		}
+	}
+
+	if( app.active )
+	{
+		app.active = false;
+		app.kick = false;
+		DB_put(KICKCALIB_APP, &app);
+	}
+
+	DB_free();
+
+	return 0;
+}
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA TOOLS
+ *
+ * CAMBADA TOOLS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA TOOLS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * PMAN trace tool:
+ *   record  attaches to the process table of an agent and drains its trace
+ *           rings to a binary file until interrupted (when the "manager"
+ *           process does not run a trace writer itself)
+ *   json    converts a binary trace to the Chrome trace event format, which
+ *           chrome://tracing and the Perfetto UI open directly
+ *   stats   per process response times, release jitter, activation latency
+ *           and precedence induced blocking, per span durations
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <math.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pman.h"
+#include "pmandefs.h"
+
+using namespace std;
+
+bool EXIT = false;
+
+void closeMe(int sig)
+{
+	if( sig == SIGINT || sig == SIGTERM )
+		EXIT = true;
+}
+
+void printHelp()
+{
+	fprintf(stderr,"Usage: pmantrace record [-a <agent>] <trace>\n");
+	fprintf(stderr,"       pmantrace json <trace> <out.json>\n");
+	fprintf(stderr,"       pmantrace stats <trace>\n");
+	fprintf(stderr,"  -a <agent>   agent whose process table is traced (default $AGENT)\n");
+}
+
+// -----------------------------------------------------------------------------
+// Trace loading
+
+struct Trace
+{
+	PROC_TRACE_HEADER hdr;
+	vector<PROC_TRACE_DATA> evt;
+
+	string name( const PROC_TRACE_DATA& e ) const
+	{
+		if( e.pindex >= 0 && e.pindex < PROC_TABLE_SIZE && hdr.pname[e.pindex][0] != 0
+				&& e.etype != PMAN_EVT_BEGIN && e.etype != PMAN_EVT_END )
+			return string(hdr.pname[e.pindex]);
+		return string(e.name, strnlen(e.name, PMAN_TRACE_NAME_LEN));
+	}
+};
+
+bool evtBefore( const PROC_TRACE_DATA& a, const PROC_TRACE_DATA& b )
+{
+	return a.etime < b.etime;
+}
+
+bool loadTrace( const char* file, Trace& trace )
+{
+	FILE* fin = fopen(file, "rb");
+	if( fin == NULL )
+	{
+		fprintf(stderr,"pmantrace: can't open %s\n", file);
+		return false;
+	}
+
+	if( fread(&trace.hdr, sizeof(trace.hdr), 1, fin) != 1 || trace.hdr.magic != PMAN_TRACE_MAGIC
+			|| trace.hdr.version != PMAN_TRACE_VERSION || trace.hdr.evt_size != (int)sizeof(PROC_TRACE_DATA)
+			|| trace.hdr.nprocs != PROC_TABLE_SIZE )
+	{
+		fprintf(stderr,"pmantrace: %s is not a PMAN trace (or was made by another version)\n", file);
+		fclose(fin);
+		return false;
+	}
+
+	PROC_TRACE_DATA e;
+	while( fread(&e, sizeof(e), 1, fin) == 1 )
+		trace.evt.push_back(e);
+	fclose(fin);
+
+	// Rings are drained one after the other, events are only ordered within a ring
+	stable_sort(trace.evt.begin(), trace.evt.end(), evtBefore);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// record
+
+int record( int agent, const char* file )
+{
+	int pmanstat = PMAN_init2(SHMEM_OCAM_PMAN_KEY + 2*agent, SEM_OCAM_PMAN_KEY + 2*agent, NULL, 0, PMAN_ATTACH);
+	if( pmanstat != 0 )
+	{
+		fprintf(stderr,"pmantrace: PMAN_init (PMAN_ATTACH) failed (return code %d)\n", pmanstat);
+		return 1;
+	}
+
+	int writer = PMAN_trace_start(file);
+	if( writer < 0 )
+	{
+		fprintf(stderr,"pmantrace: PMAN_trace_start failed (return code %d)\n", writer);
+		PMAN_close(PMAN_CLLEAVE);
+		return 1;
+	}
+
+	fprintf(stderr,"pmantrace: recording agent %d to %s, ctrl-c to stop\n", agent, file);
+	while( !EXIT )
+		pause();
+
+	PMAN_trace_stop(writer);
+	PMAN_close(PMAN_CLLEAVE);
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// json
+
+void jsonEvent( FILE* fout, bool& first, const char* ph, const string& name, int pid, int tid, long long ts )
+{
+	fprintf(fout, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%lld",
+			first ? "" : ",", name.c_str(), ph, pid, tid, ts);
+	first = false;
+}
+
+int exportJson( const char* file, const char* out )
+{
+	Trace trace;
+	if( !loadTrace(file, trace) )
+		return 1;
+
+	FILE* fout = fopen(out, "w");
+	if( fout == NULL )
+	{
+		fprintf(stderr,"pmantrace: can't create %s\n", out);
+		return 1;
+	}
+
+	fprintf(fout, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+
+	map<int, long long> activated;		// pindex -> activation time at the tick
+	map<int, bool> pend;				// pindex -> instance waiting for its predecessors
+	map<int, long long> released;		// pindex -> release time of the running instance
+	map<int, string> threads;			// tid -> name
+
+	long long t0 = trace.evt.empty() ? 0 : trace.evt[0].etime;
+	for( unsigned i = 0; i < trace.evt.size(); i++ )
+	{
+		const PROC_TRACE_DATA& e = trace.evt[i];
+		string name = trace.name(e);
+		long long ts = e.etime - t0;
+
+		if( threads.find(e.tid) == threads.end() )
+			threads[e.tid] = (e.pindex >= 0 || e.tid != e.pid) ? name : string("main");
+
+		switch( e.etype )
+		{
+		case PMAN_EVT_ACTIV:
+			activated[e.pindex] = ts;
+			pend[e.pindex] = false;
+			break;
+		case PMAN_EVT_PEND:
+			pend[e.pindex] = true;
+			break;
+		case PMAN_EVT_RELEASE:
+			if( pend[e.pindex] && activated.count(e.pindex) )
+			{
+				jsonEvent(fout, first, "X", "blocked", e.pid, e.tid, activated[e.pindex]);
+				fprintf(fout, ",\"dur\":%lld}", ts - activated[e.pindex]);
+			}
+			pend[e.pindex] = false;
+			released[e.pindex] = ts;
+			break;
+		case PMAN_EVT_EPILOG:
+			if( released.count(e.pindex) )
+			{
+				jsonEvent(fout, first, "X", name, e.pid, e.tid, released[e.pindex]);
+				fprintf(fout, ",\"dur\":%lld}", ts - released[e.pindex]);
+				released.erase(e.pindex);
+			}
+			break;
+		case PMAN_EVT_WAKEUP:
+			jsonEvent(fout, first, "i", "wakeup", e.pid, e.tid, ts);
+			fprintf(fout, ",\"s\":\"t\"}");
+			break;
+		case PMAN_EVT_MISS:
+			jsonEvent(fout, first, "i", "deadline miss", e.pid, e.tid, ts);
+			fprintf(fout, ",\"s\":\"p\"}");
+			break;
+		case PMAN_EVT_SKIP:
+			jsonEvent(fout, first, "i", "skipped", e.pid, e.tid, ts);
+			fprintf(fout, ",\"s\":\"p\"}");
+			break;
+		case PMAN_EVT_BEGIN:
+			jsonEvent(fout, first, "B", name, e.pid, e.tid, ts);
+			fprintf(fout, "}");
+			break;
+		case PMAN_EVT_END:
+			jsonEvent(fout, first, "E", name, e.pid, e.tid, ts);
+			fprintf(fout, "}");
+			break;
+		}
+	}
+
+	for( map<int, string>::iterator it = threads.begin(); it != threads.end(); it++ )
+	{
+		fprintf(fout, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",", it->first, it->first, it->second.c_str());
+		first = false;
+	}
+
+	fprintf(fout, "\n]}\n");
+	fclose(fout);
+
+	fprintf(stderr,"pmantrace: %u events written to %s\n", (unsigned)trace.evt.size(), out);
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// stats
+
+struct Series
+{
+	vector<double> v;
+
+	void add( double x ) { v.push_back(x); }
+	double mean() const
+	{
+		double s = 0;
+		for( unsigned i = 0; i < v.size(); i++ ) s += v[i];
+		return v.empty() ? 0 : s / v.size();
+	}
+	double stdev() const
+	{
+		double m = mean(), s = 0;
+		for( unsigned i = 0; i < v.size(); i++ ) s += (v[i]-m)*(v[i]-m);
+		return v.size() < 2 ? 0 : sqrt(s / (v.size()-1));
+	}
+	double pct( double p ) const
+	{
+		if( v.empty() ) return 0;
+		vector<double> s(v);
+		sort(s.begin(), s.end());
+		return s[(unsigned)((s.size()-1) * p / 100.0 + 0.5)];
+	}
+	double max() const { return v.empty() ? 0 : *max_element(v.begin(), v.end()); }
+	double min() const { return v.empty() ? 0 : *min_element(v.begin(), v.end()); }
+};
+
+struct ProcStats
+{
+	ProcStats() : lastRelease(-1), activated(-1), pend(false), released(-1), misses(0), skips(0) {}
+
+	long long lastRelease, activated;
+	bool pend;
+	long long released;
+	Series response;		// release to epilogue
+	Series period;			// release to release
+	Series wakeup;			// release to PMAN_wait_activation return
+	Series blocking;		// activation to release, instances that waited for predecessors
+	unsigned misses, skips;
+};
+
+int stats( const char* file )
+{
+	Trace trace;
+	if( !loadTrace(file, trace) )
+		return 1;
+	if( trace.evt.empty() )
+	{
+		fprintf(stderr,"pmantrace: %s has no events\n", file);
+		return 1;
+	}
+
+	map<int, ProcStats> procs;
+	map<string, Series> spans;
+	map<int, vector<long long> > open;		// tid -> begin times of the open spans
+
+	for( unsigned i = 0; i < trace.evt.size(); i++ )
+	{
+		const PROC_TRACE_DATA& e = trace.evt[i];
+
+		if( e.etype == PMAN_EVT_BEGIN )
+		{
+			open[e.tid].push_back(e.etime);
+			continue;
+		}
+		if( e.etype == PMAN_EVT_END )
+		{
+			if( !open[e.tid].empty() )
+			{
+				spans[trace.name(e)].add(e.etime - open[e.tid].back());
+				open[e.tid].pop_back();
+			}
+			continue;
+		}
+		if( e.pindex < 0 )
+			continue;
+
+		ProcStats& p = procs[e.pindex];
+		switch( e.etype )
+		{
+		case PMAN_EVT_ACTIV:
+			p.activated = e.etime;
+			p.pend = false;
+			break;
+		case PMAN_EVT_PEND:
+			p.pend = true;
+			break;
+		case PMAN_EVT_RELEASE:
+			if( p.pend && p.activated >= 0 )
+				p.blocking.add(e.etime - p.activated);
+			if( p.lastRelease >= 0 )
+				p.period.add(e.etime - p.lastRelease);
+			p.lastRelease = p.released = e.etime;
+			p.pend = false;
+			break;
+		case PMAN_EVT_WAKEUP:
+			if( p.released >= 0 )
+				p.wakeup.add(e.etime - p.released);
+			break;
+		case PMAN_EVT_EPILOG:
+			if( p.released >= 0 )
+				p.response.add(e.etime - p.released);
+			p.released = -1;
+			break;
+		case PMAN_EVT_MISS:
+			p.misses++;
+			break;
+		case PMAN_EVT_SKIP:
+			p.skips++;
+			break;
+		}
+	}
+
+	printf("Trace: %u events, %.3f s\n\n", (unsigned)trace.evt.size(),
+			(trace.evt.back().etime - trace.evt.front().etime) / 1e6);
+
+	printf("%-12s %6s %5s %5s | %8s %8s %8s %8s | %8s %8s %8s | %8s %8s | %6s %8s %8s\n",
+			"process", "inst", "miss", "skip",
+			"rt_avg", "rt_p99", "rt_max", "rt_jit",
+			"per_avg", "per_sd", "per_jit",
+			"wake_avg", "wake_max",
+			"blkd", "blk_avg", "blk_max");
+	for( map<int, ProcStats>::iterator it = procs.begin(); it != procs.end(); it++ )
+	{
+		ProcStats& p = it->second;
+		string name = (it->first < PROC_TABLE_SIZE && trace.hdr.pname[it->first][0]) ? trace.hdr.pname[it->first] : "?";
+		double perJitter = std::max(p.period.max() - p.period.mean(), p.period.mean() - p.period.min());
+
+		// all times in us
+		printf("%-12s %6u %5u %5u | %8.0f %8.0f %8.0f %8.0f | %8.0f %8.0f %8.0f | %8.0f %8.0f | %6u %8.0f %8.0f\n",
+				name.c_str(), (unsigned)p.response.v.size(), p.misses, p.skips,
+				p.response.mean(), p.response.pct(99), p.response.max(), p.response.max() - p.response.min(),
+				p.period.mean(), p.period.stdev(), perJitter,
+				p.wakeup.mean(), p.wakeup.max(),
+				(unsigned)p.blocking.v.size(), p.blocking.mean(), p.blocking.max());
+	}
+
+	if( !spans.empty() )
+	{
+		printf("\n%-20s %8s %8s %8s %8s\n", "span", "count", "avg", "p99", "max");
+		for( map<string, Series>::iterator it = spans.begin(); it != spans.end(); it++ )
+			printf("%-20s %8u %8.0f %8.0f %8.0f\n", it->first.c_str(), (unsigned)it->second.v.size(),
+					it->second.mean(), it->second.pct(99), it->second.max());
+	}
+
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+int main( int argc , char* argv[] )
+{
+	if( argc < 3 )
+	{
+		printHelp();
+		return 1;
+	}
+
+	if( strcmp(argv[1], "record") == 0 )
+	{
+		int agent = getenv("AGENT") ? atoi(getenv("AGENT")) : 0;
+		int arg = 2;
+		if( strcmp(argv[arg], "-a") == 0 && argc > arg+2 )
+		{
+			agent = atoi(argv[arg+1]);
+			arg += 2;
+		}
+
+		signal(SIGINT, closeMe);
+		signal(SIGTERM, closeMe);
+		return record(agent, argv[arg]);
+	}
+
+	if( strcmp(argv[1], "json") == 0 && argc == 4 )
+		return exportJson(argv[2], argv[3]);
+
+	if( strcmp(argv[1], "stats") == 0 )
+		return stats(argv[2]);
+
+	printHelp();
+	return 1;
+}
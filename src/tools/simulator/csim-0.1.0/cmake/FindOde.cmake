@@ -62,4 +62,11 @@ ELSE (NOT ODE_FOUND)
   APPEND_TO_CACHED_LIST(gazeboserver_link_libs 
                         ${gazeboserver_link_libs_desc} 
                         ${ODE_LDFLAGS})
+
+  # ODE 0.13 can step the islands of a world on its own threads
+  FIND_PATH (ode_threading_dir ode/threading_impl.h ${ODE_INCLUDE_DIRS} /usr/include /usr/local/include)
+  IF (ode_threading_dir)
+    ADD_DEFINITIONS (-DODE_THREADING)
+    MESSAGE (STATUS "ODE islands stepped on threads (islandThreads)")
+  ENDIF (ode_threading_dir)
 ENDIF (NOT ODE_FOUND)
@@ -103,6 +103,16 @@ MESSAGE (STATUS "Boost Libraries: ${boost_libraries}")
 ########################################
 # For Threadpool
 message (STATUS "Threadpool Include Path: ${threadpool_include_dirs}")
+IF (ENABLE_THREADPOOL)
+  STRING (REPLACE " " ";" threadpool_search_dirs "${threadpool_include_dirs}")
+  FIND_PATH (threadpool_header_dir boost/threadpool.hpp ${threadpool_search_dirs} /usr/include /usr/local/include)
+  IF (NOT threadpool_header_dir)
+    BUILD_ERROR("ENABLE_THREADPOOL is set but boost/threadpool.hpp was not found (http://threadpool.sourceforge.net), set threadpool_include_dirs")
+  ELSE (NOT threadpool_header_dir)
+    ADD_DEFINITIONS (-DUSE_THREADPOOL)
+    message (STATUS "Sensors updated on a thread pool")
+  ENDIF (NOT threadpool_header_dir)
+ENDIF (ENABLE_THREADPOOL)
 
 ########################################
 # Find libtool
@@ -140,9 +140,9 @@ void Client::ConnectWait(int serverId, int clientId)
     {
       simulationIface.Open(this,"default");
       // check realTime for updates
-      simulationIface.Lock(1);
-      double simTime0 = simulationIface.data->realTime;
-      simulationIface.Unlock();
+      SimulationStateData state;
+      simulationIface.ReadState(state);
+      double simTime0 = state.realTime;
       double simTime1 = simTime0;
 
       struct timeval tv;
@@ -153,9 +153,8 @@ void Client::ConnectWait(int serverId, int clientId)
       while(current_time - start_time < timeout)
       {
         usleep(200000);
-        simulationIface.Lock(1);
-        simTime1 = simulationIface.data->realTime;
-        simulationIface.Unlock();
+        simulationIface.ReadState(state);
+        simTime1 = state.realTime;
         if (simTime1 != simTime0)
         {
           simulationIfaceIsValid = true;
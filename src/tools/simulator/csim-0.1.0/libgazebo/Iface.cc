@@ -39,6 +39,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <sched.h>
 #include <sstream>
 
 #include "gazebo.h"
@@ -72,6 +73,9 @@ Iface::Iface(const std::string &type, size_t size)
   this->creator = false;
 
   this->mMap = NULL;
+
+  this->writeDepth = 0;
+  this->lockFree = false;
 }
 
 
@@ -159,7 +163,9 @@ void Iface::Create(Server *server, std::string id)
     throw(stream.str());
   }
 
-  this->Lock(1);
+  // Keep the clients out until the file is set up (the server lock below
+  // does not block them)
+  flock(this->mmapFd, LOCK_EX);
 
   // Set the file to the correct size
   if (ftruncate(this->mmapFd, this->size) < 0)
@@ -194,7 +200,7 @@ void Iface::Create(Server *server, std::string id)
 
   std::cout.flags(origFlags);
 
-  this->Unlock();
+  flock(this->mmapFd, LOCK_UN);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -350,6 +356,13 @@ void Iface::Close()
 // Lock the interface.
 bool Iface::Lock(int blocking)
 {
+  // The server is the single writer, it never waits for the clients
+  if (this->creator && this->lockFree)
+  {
+    this->BeginWrite();
+    return true;
+  }
+
   // Some 2.4 kernels seem to screw up the lock count somehow; keep an eye out
 
   //printf("  lock %p %s\n", this, this->filename);
@@ -377,6 +390,11 @@ bool Iface::Lock(int blocking)
 // Unlock the interface
 int Iface::Unlock()
 {
+  if (this->creator && this->lockFree)
+  {
+    this->EndWrite();
+    return 1;
+  }
 
   // Unlock the file
   if (flock(this->mmapFd, LOCK_UN) != 0)
@@ -392,6 +410,56 @@ int Iface::Unlock()
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// Start an update of the data
+void Iface::BeginWrite()
+{
+  if (this->writeDepth++ > 0)
+    return;
+
+  GazeboData *head = (GazeboData*)this->mMap;
+  head->seq = head->seq + 1;
+  GZ_MEMORY_BARRIER();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Publish the update
+void Iface::EndWrite()
+{
+  assert(this->writeDepth > 0);
+
+  if (--this->writeDepth > 0)
+    return;
+
+  GazeboData *head = (GazeboData*)this->mMap;
+  GZ_MEMORY_BARRIER();
+  head->seq = head->seq + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Start a lock-free read of the data
+unsigned int Iface::BeginRead() const
+{
+  const GazeboData *head = (const GazeboData*)this->mMap;
+  unsigned int seq;
+
+  // Spin while the server is in the middle of an update, it never waits
+  // for us
+  while ((seq = head->seq) & 1)
+    sched_yield();
+
+  GZ_MEMORY_BARRIER();
+  return seq;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Check a lock-free read
+bool Iface::EndRead(unsigned int seq) const
+{
+  GZ_MEMORY_BARRIER();
+  return ((const GazeboData*)this->mMap)->seq == seq;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Tell clients that new data is available
 void Iface::Post()
@@ -420,14 +488,9 @@ int Iface::GetOpenCount()
 {
   int result = 0;
 
+  // A plain read, the server must not wait for the clients here
   if (this->mMap)
-  {
-    if (this->Lock(1))
-    {
-      result = ((GazeboData*)this->mMap)->openCount;
-      this->Unlock();
-    }
-  }
+    result = ((GazeboData*)this->mMap)->openCount;
 
   return result;
 }
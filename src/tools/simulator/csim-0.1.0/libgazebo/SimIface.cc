@@ -22,6 +22,9 @@ SimulationIface::SimulationIface()
 
 {
   this->goAckThread = NULL;
+
+  // Clients only write the request ring, which has its own protocol
+  this->lockFree = true;
 }
 
 
@@ -38,26 +41,157 @@ SimulationIface::~SimulationIface()
 
 ////////////////////////////////////////////////////////////////////////////////
 // Wait for a return message
-bool SimulationIface::WaitForResponse()
+const SimulationRequestData *SimulationIface::WaitForResponse(unsigned int seq)
 {
+  const SimulationRequestData *response =
+    &(this->data->responses[(seq - 1) % GAZEBO_SIMULATION_MAX_REQUESTS]);
+
   // Wait for the response
   double timeout = 3.0;
   struct timeval t0, t1;
   gettimeofday(&t0, NULL);
   struct timespec sleeptime = {0, 1000000};
 
-  while(this->data->responseCount == 0)
+  while(response->seq != seq)
   {
     gettimeofday(&t1, NULL);
     if(((t1.tv_sec + t1.tv_usec/1e6) - (t0.tv_sec + t0.tv_usec/1e6)) 
         > timeout)
     {
-      return false;
+      return NULL;
     }
     nanosleep(&sleeptime, NULL);
   }
 
-  return true;
+  GZ_MEMORY_BARRIER();
+  return response;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reserve the next request slot
+SimulationRequestData *SimulationIface::PushRequest(
+    SimulationRequestData::Type type)
+{
+  // The file lock only serializes the clients, the server consumes the
+  // ring without it
+  this->Lock(1);
+
+  unsigned int head = this->data->requestHead;
+  if (head - this->data->requestTail >= GAZEBO_SIMULATION_MAX_REQUESTS)
+  {
+    this->Unlock();
+    printf("Simulation request ring full\n");
+    return NULL;
+  }
+
+  SimulationRequestData *request =
+    &(this->data->requests[head % GAZEBO_SIMULATION_MAX_REQUESTS]);
+  request->type = type;
+  request->seq = head + 1;
+
+  return request;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Hand a request to the server
+unsigned int SimulationIface::CommitRequest(SimulationRequestData *request)
+{
+  unsigned int seq = request->seq;
+
+  // The request must be complete before the server can see it
+  GZ_MEMORY_BARRIER();
+  this->data->requestHead = seq;
+
+  this->Unlock();
+
+  return seq;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Publish the time and state
+void SimulationIface::PublishState(double simTime, double pauseTime,
+                                   double realTime, int state)
+{
+  // Write the buffer that is not published, readers keep using the other
+  // one while the sequence counter is odd
+  unsigned int seq = this->data->head.seq;
+  SimulationStateData *buffer = &(this->data->states[((seq >> 1) + 1) & 1]);
+
+  this->data->head.seq = seq + 1;
+  GZ_MEMORY_BARRIER();
+
+  buffer->simTime = simTime;
+  buffer->pauseTime = pauseTime;
+  buffer->realTime = realTime;
+  buffer->state = state;
+
+  GZ_MEMORY_BARRIER();
+  this->data->head.seq = seq + 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the last published time and state
+void SimulationIface::ReadState(SimulationStateData &state) const
+{
+  unsigned int seq, end;
+
+  do
+  {
+    seq = this->data->head.seq;
+    GZ_MEMORY_BARRIER();
+
+    state = this->data->states[(seq >> 1) & 1];
+
+    GZ_MEMORY_BARRIER();
+    end = this->data->head.seq;
+
+    // The buffer read is only rewritten from the second update after the
+    // one that published it
+  } while (end - (seq & ~1u) >= 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Get the next pending request
+SimulationRequestData *SimulationIface::GetRequest()
+{
+  unsigned int tail = this->data->requestTail;
+
+  if (tail == this->data->requestHead)
+    return NULL;
+
+  // Read the request only after its head update
+  GZ_MEMORY_BARRIER();
+
+  return &(this->data->requests[tail % GAZEBO_SIMULATION_MAX_REQUESTS]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Get the response slot of a request
+SimulationRequestData *SimulationIface::GetResponse(
+    const SimulationRequestData *request)
+{
+  return &(this->data->responses[request - this->data->requests]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Publish a response
+void SimulationIface::PostResponse(const SimulationRequestData *request)
+{
+  SimulationRequestData *response = this->GetResponse(request);
+
+  response->type = request->type;
+
+  GZ_MEMORY_BARRIER();
+  response->seq = request->seq;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Release the request returned by GetRequest
+void SimulationIface::FinishRequest()
+{
+  // Done with the slot before the clients can reuse it
+  GZ_MEMORY_BARRIER();
+  this->data->requestTail = this->data->requestTail + 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,8 +209,8 @@ void SimulationIface::Create(Server *server, std::string id)
   Iface::Create(server,id); 
   this->data = (SimulationData*)((char*)this->mMap+sizeof(SimulationIface)); 
 
-  // Bad...get a more unique sem key
-  this->data->semKey = GZ_SEM_KEY - 10;
+  // Bad...get a more unique sem key (one per server, see Server::SemInit)
+  this->data->semKey = GZ_SEM_KEY - 10 - server->serverId;
 
   // Create a single semaphore
   this->data->semId = semget(this->data->semKey,1, IPC_CREAT | S_IRWXU);
@@ -126,66 +260,70 @@ void SimulationIface::BlockThread()
 /// Pause the simulation
 void SimulationIface::Pause()
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = 
-    &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::PAUSE;
-  this->Unlock();
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::PAUSE);
+  if (!request)
+    return;
+
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Unpause the simulation
 void SimulationIface::Unpause()
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = 
-    &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::UNPAUSE;
-  this->Unlock();
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::UNPAUSE);
+  if (!request)
+    return;
+
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Reset the simulation
 void SimulationIface::Reset()
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::RESET;
-  this->Unlock();
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::RESET);
+  if (!request)
+    return;
+
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Save the simulation
 void SimulationIface::Save()
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::SAVE;
-  this->Unlock();
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::SAVE);
+  if (!request)
+    return;
+
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Get the 3d pose of a model
 bool SimulationIface::GetPose3d(const char *modelName, Pose &pose)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_POSE3D;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_POSE3D);
+  if (!request)
+    return false;
+
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
-  this->Unlock();
 
-  if (!this->WaitForResponse())
+  unsigned int seq = this->CommitRequest(request);
+
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  pose = this->data->responses[0].modelPose;
+  pose = response->modelPose;
 
   return true;
 }
@@ -195,21 +333,22 @@ bool SimulationIface::GetPose3d(const char *modelName, Pose &pose)
 /// Get the 2d pose of a model
 bool SimulationIface::GetPose2d(const char *modelName, Pose &pose)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_POSE2D;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_POSE2D);
+  if (!request)
+    return false;
+
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  unsigned int seq = this->CommitRequest(request);
 
-  if (!this->WaitForResponse())
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  pose = this->data->responses[0].modelPose;
+  pose = response->modelPose;
 
   return true;
 
@@ -219,29 +358,28 @@ bool SimulationIface::GetPose2d(const char *modelName, Pose &pose)
 /// Set the 3d pose of a model
 void SimulationIface::SetPose3d(const char *modelName, const Pose &modelPose)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::SET_POSE3D);
+  if (!request)
+    return;
 
-  request->type = SimulationRequestData::SET_POSE3D;
   request->modelPose = modelPose;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Set the 2d pose of a model
 void SimulationIface::SetPose2d(const char *modelName, float x, float y, float yaw)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-
-  request->type = gazebo::SimulationRequestData::SET_POSE2D;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::SET_POSE2D);
+  if (!request)
+    return;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
@@ -251,18 +389,17 @@ void SimulationIface::SetPose2d(const char *modelName, float x, float y, float y
   request->modelPose.pos.y = y;
   request->modelPose.yaw = yaw;
 
-  this->Unlock();
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Set the 2d pose of a body
 void SimulationIface::bSetPose2d(const char* modelName, const char* bodyName, float x, float y, float yaw)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-
-  request->type = gazebo::SimulationRequestData::SET_B_POSE2D;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::SET_B_POSE2D);
+  if (!request)
+    return;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
@@ -274,7 +411,7 @@ void SimulationIface::bSetPose2d(const char* modelName, const char* bodyName, fl
   request->modelPose.pos.y = y;
   request->modelPose.yaw = yaw;
 
-  this->Unlock();
+  this->CommitRequest(request);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -283,11 +420,11 @@ void SimulationIface::SetState(const char *modelName, Pose &modelPose,
     Vec3 &linearVel, Vec3 &angularVel, Vec3 &linearAccel, 
     Vec3 &angularAccel )
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::SET_STATE);
+  if (!request)
+    return;
 
-  request->type = gazebo::SimulationRequestData::SET_STATE;
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
@@ -313,39 +450,39 @@ void SimulationIface::SetState(const char *modelName, Pose &modelPose,
   request->modelLinearAccel = linearAccel;
   request->modelAngularAccel = angularAccel;
 
-  this->Unlock();
+  this->CommitRequest(request);
 }
 //////////////////////////////////////////////////////////////////////////////////
 /// Get then children of a model
 void SimulationIface::GetChildInterfaces(const char *modelName)
 {
 
-  this->Lock(1);
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-
-  request->type = gazebo::SimulationRequestData::GET_MODEL_INTERFACES;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_MODEL_INTERFACES);
+  if (!request)
+    return;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  this->CommitRequest(request);
 
 }
 ///////////////////////////////////////////////////////////////////////////////////
 /// \brief Get the Type of a model e.g. "laser" "model" "fiducial"
 void SimulationIface::GetInterfaceType(const char *modelName)
 {
-  this->Lock(1);
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-
-  request->type = gazebo::SimulationRequestData::GET_INTERFACE_TYPE;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_INTERFACE_TYPE);
+  if (!request)
+    return;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  this->CommitRequest(request);
 }
 ///////////////////////////////////////////////////////////////////////////////
 /// Get the complete state of a model
@@ -353,27 +490,28 @@ bool SimulationIface::GetState(const char *modelName, Pose &modelPose,
               Vec3 &linearVel, Vec3 &angularVel, 
               Vec3 &linearAccel, Vec3 &angularAccel )
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_STATE);
+  if (!request)
+    return false;
 
-  request->type = gazebo::SimulationRequestData::GET_STATE;
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  unsigned int seq = this->CommitRequest(request);
 
-  if (!this->WaitForResponse())
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  modelPose = this->data->responses[0].modelPose;
+  modelPose = response->modelPose;
 
-  linearVel = this->data->responses[0].modelLinearVel;
-  angularVel = this->data->responses[0].modelAngularVel;
+  linearVel = response->modelLinearVel;
+  angularVel = response->modelAngularVel;
 
-  linearAccel = this->data->responses[0].modelLinearAccel;
-  angularAccel = this->data->responses[0].modelAngularAccel;
+  linearAccel = response->modelLinearAccel;
+  angularAccel = response->modelAngularAccel;
 
   return true;
 }
@@ -383,7 +521,6 @@ bool SimulationIface::GetState(const char *modelName, Pose &modelPose,
 // Wait for a post on the go ack semaphore
 void SimulationIface::GoAckWait()
 {
-  this->data->responseCount = 0;
   struct sembuf semoperation;
 
   semoperation.sem_num = 0;
@@ -397,8 +534,6 @@ void SimulationIface::GoAckWait()
 // Post the go ack semaphore
 void SimulationIface::GoAckPost()
 {
-  this->data->responseCount = 0;
-
   struct sembuf semoperation;
   semoperation.sem_num = 0;
   semoperation.sem_op = 1;
@@ -411,23 +546,22 @@ void SimulationIface::GoAckPost()
 /// Get the type of this model
 bool SimulationIface::GetModelType(const char *modelName, std::string &type)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_MODEL_TYPE);
+  if (!request)
+    return false;
 
-  SimulationRequestData *request;
- 
-  request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_MODEL_TYPE;
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
-  if (!this->WaitForResponse())
+  unsigned int seq = this->CommitRequest(request);
+
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  type = data->responses[0].strValue;
+  type = response->strValue;
 
   return true;
 }
@@ -437,21 +571,18 @@ bool SimulationIface::GetModelType(const char *modelName, std::string &type)
 /// Get the number of models 
 bool SimulationIface::GetNumModels(unsigned int &num)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-
-  SimulationRequestData *request;
- 
-  request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_NUM_MODELS;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_NUM_MODELS);
+  if (!request)
+    return false;
 
-  this->Unlock();
+  unsigned int seq = this->CommitRequest(request);
 
-  if (!this->WaitForResponse())
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  num = data->responses[0].uintValue;
+  num = response->uintValue;
 
   return true;
 }
@@ -461,24 +592,22 @@ bool SimulationIface::GetNumModels(unsigned int &num)
 /// Get the number of children a model has
 bool SimulationIface::GetNumChildren(const char *modelName, unsigned int &num)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_NUM_CHILDREN);
+  if (!request)
+    return false;
 
-  SimulationRequestData *request;
- 
-  request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_NUM_CHILDREN;
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  unsigned int seq = this->CommitRequest(request);
 
-  if (!this->WaitForResponse())
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  num = data->responses[0].uintValue;
+  num = response->uintValue;
 
   return true;
 }
@@ -487,22 +616,20 @@ bool SimulationIface::GetNumChildren(const char *modelName, unsigned int &num)
 /// Get the name of a child
 bool SimulationIface::GetModelName(unsigned int model,std::string &modelName)
 {
-  this->Lock(1);
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_MODEL_NAME);
+  if (!request)
+    return false;
 
-  this->data->responseCount = 0;
-  SimulationRequestData *request;
- 
-  request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_MODEL_NAME;
   request->uintValue = model;
 
-  this->Unlock();
+  unsigned int seq = this->CommitRequest(request);
 
-  if (!this->WaitForResponse())
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  modelName = data->responses[0].modelName;
+  modelName = response->modelName;
 
   return true;
 }
@@ -512,25 +639,23 @@ bool SimulationIface::GetModelName(unsigned int model,std::string &modelName)
 bool SimulationIface::GetChildName(const char *modelName, unsigned int child,
                                    std::string &childName)
 {
-  this->Lock(1);
-
-  this->data->responseCount = 0;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_CHILD_NAME);
+  if (!request)
+    return false;
 
-  SimulationRequestData *request;
- 
-  request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_CHILD_NAME;
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
   request->uintValue = child;
-  this->Unlock();
 
-  if (!this->WaitForResponse())
+  unsigned int seq = this->CommitRequest(request);
+
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  childName = data->responses[0].modelName;
+  childName = response->modelName;
 
   return true;
 
@@ -540,21 +665,22 @@ bool SimulationIface::GetChildName(const char *modelName, unsigned int child,
 /// Get the extents of a model
 bool SimulationIface::GetModelExtent(const char *modelName, Vec3 &ext)
 {
-  this->Lock(1);
-  this->data->responseCount = 0;
-  SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_MODEL_EXTENT;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_MODEL_EXTENT);
+  if (!request)
+    return false;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
-  this->Unlock();
 
-  if (!this->WaitForResponse())
+  unsigned int seq = this->CommitRequest(request);
+
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  ext = this->data->responses[0].vec3Value;
+  ext = response->vec3Value;
 
   return true;
 }
@@ -562,25 +688,22 @@ bool SimulationIface::GetModelExtent(const char *modelName, Vec3 &ext)
 /// Get the Fiducial ID of this model 
 bool SimulationIface::GetModelFiducialID(const char *modelName, unsigned int &id)
 {
-  this->Lock(1);
-
-  this->data->responseCount = 0;
-  SimulationRequestData *request;
- 
-  request = &(this->data->requests[this->data->requestCount++]);
-  request->type = SimulationRequestData::GET_MODEL_FIDUCIAL_ID;
+  SimulationRequestData *request =
+    this->PushRequest(SimulationRequestData::GET_MODEL_FIDUCIAL_ID);
+  if (!request)
+    return false;
 
   memset(request->modelName, 0, 512);
   strncpy(request->modelName, modelName, 512);
   request->modelName[511] = '\0';
 
-  this->Unlock();
+  unsigned int seq = this->CommitRequest(request);
 
-  if (!this->WaitForResponse())
+  const SimulationRequestData *response = this->WaitForResponse(seq);
+  if (!response)
     return false;
 
-  assert(this->data->responseCount == 1);
-  id = data->responses[0].uintValue;
+  id = response->uintValue;
 
   return true;
 }
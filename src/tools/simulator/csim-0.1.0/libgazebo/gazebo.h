@@ -53,7 +53,11 @@ namespace gazebo
 /// \{ 
 
 /// Interface version number
-#define LIBGAZEBO_VERSION 0x070
+#define LIBGAZEBO_VERSION 0x071
+
+/// Full memory barrier around the lock-free interface updates (the mmapped
+/// data is shared with other processes, so compiler and CPU ordering matter)
+#define GZ_MEMORY_BARRIER() __sync_synchronize()
 
 /// \}
 
@@ -328,6 +332,12 @@ class Iface
   public: virtual void Close();
 
   /// \brief Lock the interface. 
+  ///
+  /// Everybody takes the file lock, except the server on a lock-free
+  /// interface (the simulation iface, whose client data only goes through
+  /// the request ring): it never blocks on a client, its lock opens a
+  /// write section (BeginWrite) instead, and the clients lock only
+  /// serializes them against each other.
   /// \param blocking 1=caller should block, 0=no-block
   /// \return True if the lock is acquired
   public: bool Lock(int blocking);
@@ -335,6 +345,22 @@ class Iface
   /// \brief Unlock the interface
   public: int Unlock();
 
+  /// \brief Start an update of the data (server), the sequence counter
+  /// is odd until EndWrite
+  public: void BeginWrite();
+
+  /// \brief Publish the update started by BeginWrite
+  public: void EndWrite();
+
+  /// \brief Start a lock-free read of the data (client)
+  /// \return Sequence number to pass to EndRead
+  public: unsigned int BeginRead() const;
+
+  /// \brief Check a lock-free read, retry from BeginRead when false
+  /// \param seq Value returned by BeginRead
+  /// \return True if the data read is consistent
+  public: bool EndRead(unsigned int seq) const;
+
   /// \brief Tell clients that new data is available
   public: void Post();
 
@@ -370,9 +396,17 @@ class Iface
 
   protected: std::string id;
 
+  /// The server publishes the data with the sequence counter and never
+  /// takes the file lock; only for interfaces the clients don't write
+  /// under the lock
+  protected: bool lockFree;
+
   private: bool creator;
 
   private: size_t size;
+
+  /// Nesting depth of the server write sections
+  private: int writeDepth;
 };
 
 class GazeboData
@@ -380,6 +414,10 @@ class GazeboData
   /// Number of times the interface has been opened
   public: int openCount;
 
+  /// Sequence counter of the single writer (server), odd while an update
+  /// is in progress
+  public: volatile unsigned int seq;
+
   public: double time;
 
   public: int version;
@@ -457,13 +495,14 @@ class SimulationRequestData
   public: int nChildInterfaces;
   //public: char modelType[512];
 
+  /// Ticket of the request (ring position + 1), copied into the response
+  /// once the response is complete
+  public: volatile unsigned int seq;
 };
 
-/// \brief Simulation interface data
-class SimulationData
+/// \brief Simulation time and state, published by the server
+class SimulationStateData
 {
-  public: GazeboData head;
-
   /// Elapsed simulation time
   public: double simTime;
 
@@ -475,14 +514,25 @@ class SimulationData
 
   /// state of the simulation : 0 paused, 1 running -1 not_started/exiting
   public: int state;
+};
 
-  /// Array of requests to the simulator
+/// \brief Simulation interface data
+class SimulationData
+{
+  public: GazeboData head;
+
+  /// Double buffered time and state, the server writes the buffer that is
+  /// not published and flips it with head.seq (see SimulationIface::ReadState)
+  public: SimulationStateData states[2];
+
+  /// Ring of requests to the simulator. The clients (serialized by the file
+  /// lock) produce at requestHead, the server consumes at requestTail.
   public: SimulationRequestData requests[GAZEBO_SIMULATION_MAX_REQUESTS];
-  public: unsigned int requestCount;
+  public: volatile unsigned int requestHead;
+  public: volatile unsigned int requestTail;
 
-  /// Array of request responses from the simulator
+  /// Request responses from the simulator, in the slot of their request
   public: SimulationRequestData responses[GAZEBO_SIMULATION_MAX_REQUESTS];
-  public: unsigned int responseCount;
 
   public: int semId;
   public: int semKey;
@@ -514,11 +564,13 @@ class SimulationIface : public Iface
           void Go(unsigned int us,T subscriber)
           {
             // Send the go command to Gazebo
-            this->Lock(1);
-            SimulationRequestData *request = &(this->data->requests[this->data->requestCount++]);
-            request->type = SimulationRequestData::GO;
-            request->runTime = us;
-            this->Unlock();
+            SimulationRequestData *request =
+              this->PushRequest(SimulationRequestData::GO);
+            if (request)
+            {
+              request->runTime = us;
+              this->CommitRequest(request);
+            }
 
             {
               if (this->currentConnection.connected())
@@ -601,10 +653,41 @@ class SimulationIface : public Iface
   public: void GoAckWait();
   public: void GoAckPost();
 
+  /// \brief Publish the time and state (server), never blocks
+  public: void PublishState(double simTime, double pauseTime,
+                            double realTime, int state);
+
+  /// \brief Read the last published time and state (client)
+  public: void ReadState(SimulationStateData &state) const;
+
+  /// \brief Get the next pending request (server)
+  /// \return NULL when the ring is empty
+  public: SimulationRequestData *GetRequest();
+
+  /// \brief Get the response slot of a request (server)
+  public: SimulationRequestData *GetResponse(
+              const SimulationRequestData *request);
+
+  /// \brief Publish the response written in the slot of a request (server)
+  public: void PostResponse(const SimulationRequestData *request);
+
+  /// \brief Release the request returned by GetRequest (server)
+  public: void FinishRequest();
+
   private: void BlockThread();
 
-  /// \brief Wait for a return message
-  private: bool WaitForResponse();
+  /// \brief Reserve the next request slot (client), holds the producer
+  /// lock until CommitRequest
+  /// \return NULL when the ring is full
+  private: SimulationRequestData *PushRequest(SimulationRequestData::Type type);
+
+  /// \brief Hand a request reserved by PushRequest to the server
+  /// \return The request ticket, to wait for its response
+  private: unsigned int CommitRequest(SimulationRequestData *request);
+
+  /// \brief Wait for the response of a request
+  /// \return The response, NULL on timeout
+  private: const SimulationRequestData *WaitForResponse(unsigned int seq);
 
   private: boost::signal<void (void)> goAckSignal;
   private: boost::signals::connection currentConnection;
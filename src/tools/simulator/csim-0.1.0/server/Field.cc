@@ -27,6 +27,9 @@
  
 #include "Field.hh"
 
+#include <algorithm>
+#include <cmath>
+
 #include "GazeboError.hh"
 #include "XMLConfig.hh"
 
@@ -82,49 +85,113 @@ void Field::Load(XMLConfigNode *node){
 
 std::vector<Point> Field::Intersect( Ray ray ){
   
-  std::vector<LineSegment>::iterator iter = this->fieldSegments->begin();
-  std::vector<Point> intersections(0);
-  
-  // TODO: better understanding of this algorithm...
-  
-  // go through all line segments..
-  for( ; iter != this->fieldSegments->end(); ++iter ){
-    
-    // ray equation:  p = R0 + t * Rdir, t >= 0
-    // line equation: p = P0 + s * (P1 - P0), s any real number
-    //
-    // (R0x,R0y) + t * (Rdirx, Rdiry) = (P0x, P0y) + s * ( P1x-P0x, P1y-P0y )
-    // { R0x + t * Tdirx = P0x + s * (P1x-P0x)
-    // { R0y + t * Tdiry = P0y + s * (P1y-P0y)
-    
-    Point d1 = (*iter).pointB - (*iter).pointA;   //  Segment: PointB - PointA
-    Point d2 = ray.y - ray.x;           //      Ray: PointB - PointA
+  std::vector<Point> intersections( this->fieldSegments->size() );
+
+  intersections.resize( this->Intersect( ray, &intersections[0], intersections.size() ) );
+  return intersections;
+}
+
+unsigned int Field::Intersect( const Ray& ray, Point* hits, unsigned int maxHits,
+                               const std::vector<unsigned short>* segs ) const {
+
+  unsigned int n = segs ? segs->size() : this->fieldSegments->size();
+  unsigned int nHits = 0;
+
+  // ray equation:  p = R0 + t * Rdir
+  // line equation: p = P0 + s * (P1 - P0), 0 <= s <= 1
+  //
+  // (R0x,R0y) + t * (Rdirx, Rdiry) = (P0x, P0y) + s * ( P1x-P0x, P1y-P0y )
+  // { R0x + t * Tdirx = P0x + s * (P1x-P0x)
+  // { R0y + t * Tdiry = P0y + s * (P1y-P0y)
+  //
+  // t is not limited, the ray is the whole line through R0
+  Point d2 = ray.y - ray.x;           //      Ray: PointB - PointA
+
+  for( unsigned int i = 0; i < n && nHits < maxHits; i++ ){
+
+    unsigned int s = segs ? (*segs)[i] : i;
+    const LineSegment& seg = (*this->fieldSegments)[s];
+    const Point& d1 = this->segmentDirections[s];   //  Segment: PointB - PointA
 
     // Calculo do determinante..
     float det = d1.x*d2.y - d2.x*d1.y;
+    if ( fabs(det) < 1e-5f ) continue;
 
-    Point dp = ray.x - (*iter).pointA;
+    Point dp = ray.x - seg.pointA;
     float tau= (d2.y*dp.x - d2.x*dp.y)/det;
-    
-    if ( fabs(det) < 1e-5f ) continue;
+    if ( tau< 0.0f || tau>1.0f) continue;
 
+    // intersection point
+    hits[nHits++] = seg.pointA * (1.0f-tau)  + seg.pointB * tau;
+  }
 
+  return nHits;
+}
 
-    // intersection point
-    Point is =  (*iter).pointA * (1.0f-tau)  + (*iter).pointB * tau;
-    float t;
-    
-    if ( (*iter).pointA.x != (*iter).pointB.x)
-      t = ( is.x - (*iter).pointA.x ) / ( (*iter).pointB.x - (*iter).pointA.x );
-    else
-      t = ( is.y - (*iter).pointA.y ) / ( (*iter).pointB.y - (*iter).pointA.y );
-  
-    if ( tau< 0.0f || tau>1.0f) continue;
-    
-    intersections.push_back( is );
-  }  
+void Field::CullFan( const Point& origin, LineFan& fan ) const {
 
-  return intersections;
+  // Interval widening: lines on the limits are kept, Intersect decides
+  const double kMargin = 1e-3;
+  unsigned int nLines = fan.Size();
+  unsigned int i, j;
+
+  for ( i = 0; i < nLines; i++ )
+    fan.candidates[i].clear();
+
+  for ( unsigned short s = 0; s < this->fieldSegments->size(); s++ ){
+
+    const LineSegment& seg = (*this->fieldSegments)[s];
+    double ax = seg.pointA.x - origin.x, ay = seg.pointA.y - origin.y;
+    double bx = seg.pointB.x - origin.x, by = seg.pointB.y - origin.y;
+
+    // Signed angle from A to B seen from origin
+    double delta = atan2( ax*by - ay*bx, ax*bx + ay*by );
+    double start = atan2( ay, ax ) + (delta < 0 ? delta : 0);
+    double width = fabs( delta );
+
+    // Origin on (or very near) the segment: every line crosses it
+    if ( width > M_PI - kMargin || ax*ax + ay*ay < kMargin*kMargin || bx*bx + by*by < kMargin*kMargin ){
+      for ( i = 0; i < nLines; i++ )
+        fan.candidates[i].push_back( s );
+      continue;
+    }
+
+    // A line and its opposite are the same: fold into [0, pi)
+    start = fmod( start - kMargin, M_PI );
+    if ( start < 0 ) start += M_PI;
+    double end = start + width + 2*kMargin;
+
+    unsigned int first = std::lower_bound( fan.sortedAngles.begin(), fan.sortedAngles.end(), (float)start ) - fan.sortedAngles.begin();
+    for ( j = first; j < nLines && fan.sortedAngles[j] <= end; j++ )
+      fan.candidates[ fan.order[j] ].push_back( s );
+
+    // interval going over pi, up to where the first range started (a width
+    // near pi wraps onto it)
+    for ( j = 0; j < first && fan.sortedAngles[j] <= end - M_PI; j++ )
+      fan.candidates[ fan.order[j] ].push_back( s );
+  }
+}
+
+// Line fan angles
+void LineFan::Init( const std::vector<float>& angles ){
+
+  std::vector< std::pair<float, unsigned int> > sorted;
+  unsigned int i;
+
+  this->directions.clear();
+  for ( i = 0; i < angles.size(); i++ ){
+    this->directions.push_back( Point( std::cos(angles[i]), std::sin(angles[i]) ) );
+    sorted.push_back( std::make_pair( angles[i], i ) );
+  }
+  std::sort( sorted.begin(), sorted.end() );
+
+  this->sortedAngles.resize( sorted.size() );
+  this->order.resize( sorted.size() );
+  for ( i = 0; i < sorted.size(); i++ ){
+    this->sortedAngles[i] = sorted[i].first;
+    this->order[i] = sorted[i].second;
+  }
+  this->candidates.assign( angles.size(), std::vector<unsigned short>() );
 }
 
 // Init Field
@@ -316,6 +383,10 @@ void Field::Init(){
   a[1] = -(-flh + .5);
   a[0] = fwh;
   this->fieldSegments->push_back( csim::LineSegment( a, b ) );
+
+  this->segmentDirections.clear();
+  for ( i = 0; i < this->fieldSegments->size(); i++ )
+    this->segmentDirections.push_back( (*this->fieldSegments)[i].pointB - (*this->fieldSegments)[i].pointA );
 }
 
 
@@ -63,6 +63,34 @@ namespace csim {
   };
   
   
+  /// A fan of lines through one point.
+  /**
+      The lines are given by their angles in [0, pi) and keep the order
+      they were given in. Field::CullFan fills, for each line, the field
+      segments it may cross, so that Field::Intersect only tests those.
+  */
+  class LineFan {
+
+  public:
+    /// Set the line angles (radians, in [0, pi)).
+    void Init( const std::vector<float>& angles );
+    /// Number of lines.
+    unsigned int Size() const { return this->directions.size(); }
+
+    /// Unit direction of each line.
+    std::vector<Point> directions;
+    /// Candidate segments of each line, in field segment order.
+    std::vector< std::vector<unsigned short> > candidates;
+
+  private:
+    friend class Field;
+    /// Line angles, sorted, and the index of the line of each one.
+    std::vector<float> sortedAngles;
+    std::vector<unsigned int> order;
+
+  };
+
+
   /// The game field.
   /**
       The game field is defined by its dimensions and rule lines. Those dimensions and
@@ -93,6 +121,23 @@ namespace csim {
         It return a vector with all the points where an intersection occurs.
     */
     std::vector<Point> Intersect( Ray ray );
+
+    /// Ray casting on the field, into a caller buffer.
+    /**
+        Same as Intersect( Ray ), without allocations. Only the segments in
+        segs are tested (all of them if segs is NULL) and at most maxHits
+        points are stored in hits. Returns the number of points stored.
+    */
+    unsigned int Intersect( const Ray& ray, Point* hits, unsigned int maxHits,
+                            const std::vector<unsigned short>* segs = NULL ) const;
+
+    /// Find the segments each line of a fan through origin may cross.
+    /**
+        Each segment is seen from origin within an angle interval, only the
+        lines inside it get the segment as candidate (binary search on the
+        sorted line angles).
+    */
+    void CullFan( const Point& origin, LineFan& fan ) const;
     
     /*** Field Properties ***/
     // Create Getters and Setters for all the properties would a PITA...
@@ -117,6 +162,8 @@ namespace csim {
     
   private:
     std::vector<LineSegment>* fieldSegments;
+    /// Direction (pointB - pointA) of each segment, set by Init()
+    std::vector<Point> segmentDirections;
     
   }; /* @end of class */
   
@@ -80,6 +80,4 @@
 
 #define ROUND(x) ( (int)( floor((x)+0.5) ) )
 
-#undef USE_THREADPOOL
-
 #endif
@@ -395,10 +395,6 @@ void Model::Update()
 
   //DiagnosticTimer timer("Model[" + this->GetName() + "] Update ");
 
-#ifdef USE_THREADPOOL
-  World::Instance()->GetPhysicsEngine()->InitForThread();
-#endif
-
   std::map<std::string, Body* >::iterator bodyIter;
   std::map<std::string, Controller* >::iterator contIter;
   JointContainer::iterator jointIter;
@@ -415,12 +411,7 @@ void Model::Update()
     {
       if (bodyIter->second)
       {
-#ifdef USE_THREADPOOL
-        World::Instance()->threadPool->schedule(
-            boost::bind(&Body::Update,(bodyIter->second)));
-#else
         bodyIter->second->Update();
-#endif
       }
     }
   }
@@ -432,11 +423,7 @@ void Model::Update()
     {
       if (contIter->second)
       {
-#ifdef USE_THREADPOOL
-        World::Instance()->threadPool->schedule(boost::bind(&Controller::Update,(contIter->second)));
-#else
         contIter->second->Update();
-#endif
       }
     }
   }
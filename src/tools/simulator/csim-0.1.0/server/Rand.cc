@@ -25,11 +25,19 @@
  */
 
 #include <ctime>
+#include <cmath>
 #include "Rand.hh"
 
+// Philox4x32 multipliers and Weyl sequence (key schedule)
+#define PHILOX_M0  0xD2511F53u
+#define PHILOX_M1  0xCD9E8D57u
+#define PHILOX_W0  0x9E3779B9u
+#define PHILOX_W1  0xBB67AE85u
+
 using namespace gazebo;
 
-GeneratorType *Rand::randGenerator = new GeneratorType(std::time(0));
+unsigned int Rand::seed = std::time(0);
+GeneratorType *Rand::randGenerator = new GeneratorType(Rand::seed);
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constructor
@@ -43,6 +51,21 @@ Rand::~Rand()
 {
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/// Restart the generator from a seed
+void Rand::SetSeed(unsigned int seed)
+{
+  Rand::seed = seed;
+  randGenerator->seed(seed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Seed of the run
+unsigned int Rand::GetSeed()
+{
+  return Rand::seed;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Get a double from a uniform distribution
 double Rand::GetDblUniform(double min, double max)
@@ -78,3 +101,101 @@ int Rand::GetIntNormal(int mean, int sigma)
  
   return (int)(gen()); 
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+CounterRand::CounterRand()
+{
+  this->key[0] = 0;
+  this->key[1] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Set the key
+void CounterRand::SetKey(unsigned int seed, unsigned int stream)
+{
+  this->key[0] = seed;
+  this->key[1] = stream;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Philox4x32-10, 10 rounds of multiply and xor, no state besides the key
+void CounterRand::Block(const uint32_t ctr[4], uint32_t out[4]) const
+{
+  uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  uint32_t k0 = this->key[0], k1 = this->key[1];
+
+  for (int r = 0; r < 10; r++)
+  {
+    uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+    uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+
+    c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (uint32_t)p1;
+    c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (uint32_t)p0;
+
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Fill an array with doubles from a uniform distribution in (0,1)
+void CounterRand::GetDblUniform(unsigned int step, unsigned int batch,
+                                double *out, unsigned int n) const
+{
+  uint32_t ctr[4], word[4];
+  unsigned int i, k;
+
+  ctr[1] = batch;
+  ctr[2] = step;
+  ctr[3] = 0;
+
+  // One block gives 4 draws, the blocks are independent of each other
+  for (i = 0; i < n; i += 4)
+  {
+    ctr[0] = i / 4;
+    this->Block(ctr, word);
+
+    for (k = 0; k < 4 && i + k < n; k++)
+      out[i + k] = (word[k] + 0.5) * (1.0 / 4294967296.0);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Fill an array with doubles from a standard normal distribution
+void CounterRand::GetDblNormal(unsigned int step, unsigned int batch,
+                               double *out, unsigned int n) const
+{
+  unsigned int i;
+
+  if (n == 0)
+    return;
+
+  // Box-Muller, in place over pairs of uniforms
+  this->GetDblUniform(step, batch, out, n);
+
+  for (i = 0; i + 1 < n; i += 2)
+  {
+    double r = std::sqrt(-2.0 * std::log(out[i]));
+    double t = 2.0 * M_PI * out[i + 1];
+
+    out[i]     = r * std::cos(t);
+    out[i + 1] = r * std::sin(t);
+  }
+
+  // Odd count, the pair of the last one comes from a counter past the array
+  if (n % 2)
+  {
+    uint32_t ctr[4], word[4];
+
+    ctr[0] = 0; ctr[1] = batch; ctr[2] = step; ctr[3] = 1;
+    this->Block(ctr, word);
+
+    out[n - 1] = std::sqrt(-2.0 * std::log(out[n - 1])) *
+                 std::cos(2.0 * M_PI * (word[0] + 0.5) * (1.0 / 4294967296.0));
+  }
+}
@@ -27,6 +27,7 @@
 #ifndef RAND_HH
 #define RAND_HH
 
+#include <stdint.h>
 #include <boost/random.hpp>
 
 namespace gazebo
@@ -49,6 +50,13 @@ namespace gazebo
 
     /// \brief Destructor
     private: virtual ~Rand();
+
+    /// \brief Restart the generator from a seed (reproducible runs)
+    /// \param seed Seed of the generator
+    public: static void SetSeed(unsigned int seed);
+
+    /// \brief Seed of the run (set or from the clock)
+    public: static unsigned int GetSeed();
  
     /// \brief Get a double from a uniform distribution
     /// \param min Minimum bound for the random number
@@ -72,6 +80,41 @@ namespace gazebo
   
     // The random number generator
     private: static GeneratorType *randGenerator;
+
+    // Seed of randGenerator
+    private: static unsigned int seed;
+  };
+
+  /// \brief Counter based random number generator (Philox4x32-10)
+  ///
+  /// A draw is a function of the key and of its position only (step,
+  /// batch, index), not of the draws made before it, so a sensor gets the
+  /// same numbers whatever the order the sensors are updated in
+  class CounterRand
+  {
+    /// \brief Constructor
+    public: CounterRand();
+
+    /// \brief Set the key
+    /// \param seed Seed of the run
+    /// \param stream Stream of the user, e.g. robot id
+    public: void SetKey(unsigned int seed, unsigned int stream);
+
+    /// \brief Fill an array with doubles from a uniform distribution in (0,1)
+    /// \param step Update counter of the user
+    /// \param batch Kind of draws within the update
+    /// \param out Array of n draws, out[i] is the draw (step, batch, i)
+    public: void GetDblUniform(unsigned int step, unsigned int batch,
+                               double *out, unsigned int n) const;
+
+    /// \brief Fill an array with doubles from a standard normal distribution
+    public: void GetDblNormal(unsigned int step, unsigned int batch,
+                              double *out, unsigned int n) const;
+
+    /// \brief Get 4 random words of the counter ctr
+    private: void Block(const uint32_t ctr[4], uint32_t out[4]) const;
+
+    private: uint32_t key[2];
   };
   
 }
@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <sys/time.h>
 #include <boost/bind.hpp>
 #include <boost/thread/recursive_mutex.hpp>
@@ -55,9 +56,12 @@
 #include "GazeboMessage.hh"
 #include "Global.hh"
 #include "Referee.hh"
+#include "MatchStats.hh"
 #include "Visual.hh"
 #include "Simulator.hh"
 
+#include "rtdb_sim.h"
+
 using namespace gazebo;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -76,6 +80,8 @@ Simulator::Simulator()
   userQuit(false),
   physicsEnabled(true),
   timeout(-1),
+  timeControl(true),
+  lockStep(false),
   selectedEntity(NULL),
   selectedBody(NULL)
 {
@@ -270,16 +276,28 @@ void Simulator::MainLoop()
   Time lastTime = 0;
   struct timespec timeSpec;
   double freq = 50.0; // used to be 80
+  double minFreq = 5.0;
+
+  // The gui runs at up to freq, and backs off (down to minFreq) while the
+  // physics falls behind real time
+  double period = 1.0/freq;
+  double lag = 0, lastLag = 0;
 
   this->physicsThread = new boost::thread( 
                          boost::bind(&Simulator::PhysicsLoop, this));
 
+  // Headless: the physics loop also loads the new entities
+  if (this->lockStep)
+  {
+    this->physicsThread->join();
+    return;
+  }
 
   // Update the gui
   while (!this->userQuit)
   {
     currTime = this->GetWallTime();
-    if ( currTime - lastTime > 1.0/freq)
+    if ( currTime - lastTime > period)
     {
       lastTime = this->GetWallTime();
       
@@ -290,9 +308,18 @@ void Simulator::MainLoop()
 
       World::Instance()->ProcessEntitiesToLoad();
 
-      if (currTime - lastTime < 1/freq)
+      // Physics lagging more than at the last frame: skip frames
+      lag = (this->GetRealTime() - this->GetSimTime() -
+             this->GetPauseTime()).Double();
+      if (lag > lastLag + period)
+        period = std::min(period * 2.0, 1.0/minFreq);
+      else
+        period = std::max(period * 0.5, 1.0/freq);
+      lastLag = lag;
+
+      if (currTime - lastTime < period)
       {
-        Time sleepTime = ( Time(1.0/freq) - (currTime - lastTime));
+        Time sleepTime = ( Time(period) - (currTime - lastTime));
         timeSpec.tv_sec = sleepTime.sec;
         timeSpec.tv_nsec = sleepTime.nsec;
 
@@ -301,7 +328,7 @@ void Simulator::MainLoop()
     }
     else
     {
-      Time sleepTime = ( Time(1.0/freq) - (currTime - lastTime));
+      Time sleepTime = ( Time(period) - (currTime - lastTime));
       timeSpec.tv_sec = sleepTime.sec;
       timeSpec.tv_nsec = sleepTime.nsec;
       nanosleep(&timeSpec, NULL);
@@ -353,6 +380,14 @@ void Simulator::SetSimTime(Time t)
   this->simTime = t;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Move the simulation time, the difference is accounted as pause time
+void Simulator::RewindSimTime(Time t)
+{
+  this->pauseTime += this->simTime - t;
+  this->simTime = t;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Get the pause time
 gazebo::Time Simulator::GetPauseTime() const
@@ -425,6 +460,47 @@ bool Simulator::GetPhysicsEnabled() const
   return this->physicsEnabled;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Set whether the physics loop sleeps to keep the update rate
+void Simulator::SetTimeControl( bool enabled )
+{
+  this->timeControl = enabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RTDB clock of the lock step mode
+static long long LockStepClock()
+{
+  return Simulator::Instance()->GetVirtualClock();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run headless, in lock step with the agents
+void Simulator::SetLockStep( bool enabled )
+{
+  this->lockStep = enabled;
+  if (enabled)
+    this->timeControl = false;
+
+  // Records written here must age like the ones written by the agents
+  DB_set_clock( enabled ? LockStepClock : NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Get the lock step mode
+bool Simulator::GetLockStep() const
+{
+  return this->lockStep;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Virtual clock of the lock step mode (us)
+long long Simulator::GetVirtualClock() const
+{
+  Time t = this->startTime + this->simTime;
+  return (long long)t.sec * 1000000LL + t.nsec / 1000;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Set the selected entity
 void Simulator::SetSelectedEntity( Entity *ent )
@@ -491,6 +567,8 @@ void Simulator::PhysicsLoop()
   bool userStepped;
   Time diffTime;
   Time currTime;
+  Time stepEnd;
+  MatchStats *matchStats = MatchStats::Instance();
   Time lastTime = this->GetRealTime();
   struct timespec req, rem;
 
@@ -519,10 +597,22 @@ void Simulator::PhysicsLoop()
 
     {
       boost::recursive_mutex::scoped_lock lock(*this->mutex);
+      if (this->lockStep)
+        world->ProcessEntitiesToLoad();
       world->Update();
       //referee->ApplyRules();
     }
 
+    stepEnd = this->GetRealTime();
+
+    // Wait for the agents activated in this step
+    if (this->lockStep)
+      this->stepEndSignal();
+
+    if (matchStats->IsEnabled())
+      matchStats->Update((stepEnd - lastTime).Double(),
+                         (this->GetRealTime() - stepEnd).Double());
+
     currTime = this->GetRealTime();
 
     // Set a default sleep time
@@ -551,7 +641,8 @@ void Simulator::PhysicsLoop()
       req.tv_nsec = diffTime.nsec;
     }
 
-    nanosleep(&req, &rem);
+    if (this->timeControl)
+      nanosleep(&req, &rem);
 
     {
       //DiagnosticTimer timer("PhysicsLoop UpdateSimIfaces ");
@@ -560,7 +651,8 @@ void Simulator::PhysicsLoop()
       world->UpdateSimulationIface();
     }
 
-    if (this->timeout > 0 && this->GetRealTime() > this->timeout)
+    if (this->timeout > 0 && (this->lockStep ? this->GetSimTime()
+                                               : this->GetRealTime()) > this->timeout)
     {
       this->userQuit = true;
       break;
@@ -117,6 +117,10 @@ namespace gazebo
     /// \brief Set the sim time
     public: void SetSimTime(Time t);
 
+    /// \brief Move the simulation time to a snapshot time (World::GotoTime),
+    ///        keeping the real time pacing
+    public: void RewindSimTime(Time t);
+
     /// Get the pause time
     /// \return The pause time
     public: Time GetPauseTime() const;
@@ -152,6 +156,24 @@ namespace gazebo
     /// \brief Get the physics enabled/disabled
     public: bool GetPhysicsEnabled() const;
 
+    /// \brief Set whether the physics loop sleeps to keep the update rate
+    public: void SetTimeControl(bool enabled);
+
+    /// \brief Run headless, in lock step with the agents
+    ///
+    /// Every physics step waits for the agents activated during the step
+    /// (step end signal) and the time seen by the agents and the RTDB is
+    /// virtual, so a game runs as fast as the CPUs allow. Implies no time
+    /// control, the timeout is counted in simulation time.
+    public: void SetLockStep(bool enabled);
+
+    /// \brief Get the lock step mode
+    public: bool GetLockStep() const;
+
+    /// \brief Virtual clock of the lock step mode: start wall time plus
+    ///        simulation time (us)
+    public: long long GetVirtualClock() const;
+
     /// \brief Set the selected entity
     public: void SetSelectedEntity( Entity *ent );
 
@@ -179,6 +201,14 @@ namespace gazebo
             {
               pauseSignal.connect(subscriber);
             }
+
+    /// \brief Connect a boost::slot the the step end signal, emitted
+    ///        after every physics step in lock step mode
+    public: template<typename T>
+            boost::signals::connection ConnectStepEndSignal( T subscriber )
+            {
+              return stepEndSignal.connect(subscriber);
+            }
  
     /// \brief Function to run gui. Used by guiThread
     private: void PhysicsLoop();
@@ -218,6 +248,12 @@ namespace gazebo
     /// Length of time the simulation should run
     private: double timeout;
 
+    /// True if the physics loop sleeps to keep the update rate
+    private: bool timeControl;
+
+    /// True if running in lock step with the agents
+    private: bool lockStep;
+
     /// Length of time the simulator is allowed to run
     private: double updateTime;
 
@@ -234,6 +270,8 @@ namespace gazebo
 
     private: boost::signal<void (bool)> pauseSignal;
 
+    private: boost::signal<void ()> stepEndSignal;
+
     //Singleton implementation
     private: friend class DestroyerT<Simulator>;
     private: friend class SingletonT<Simulator>;
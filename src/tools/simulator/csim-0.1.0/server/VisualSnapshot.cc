@@ -0,0 +1,95 @@
+/*
+ *  CSim - CAMBADA Simulator
+ *  Copyright (C) 2010  Universidade de Aveiro
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "VisualSnapshot.hh"
+
+// Bit of VisualSnapshot::middle set by the writer, cleared by the reader
+#define VISUAL_FRESH   4
+
+using namespace gazebo;
+
+////////////////////////////////////////////////////////////////////////////////
+// Pose of a model by name
+const VisualPose *VisualFrame::GetModelPose(const std::string &name) const
+{
+  for (unsigned int i = 0; i < this->modelNames.size(); i++)
+    if (this->modelNames[i] == name)
+      return &this->modelPoses[i];
+
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+VisualSnapshot::VisualSnapshot()
+  : middle(1), back(0), front(2), counter(0)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    this->frames[i].layout = 0;
+    this->frames[i].index = 0;
+    this->frames[i].simTime = 0;
+    this->frames[i].realTime = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame to fill
+VisualFrame *VisualSnapshot::GetBackFrame()
+{
+  return &this->frames[this->back];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Publish the back frame
+void VisualSnapshot::Publish()
+{
+  this->frames[this->back].index = ++this->counter;
+
+  // The exchange is only an acquire barrier, the frame must be complete
+  // before the reader can get it
+  __sync_synchronize();
+  this->back = __sync_lock_test_and_set(&this->middle,
+                                        this->back | VISUAL_FRESH) & 3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// True if a frame is waiting
+bool VisualSnapshot::HasNewFrame() const
+{
+  return (this->middle & VISUAL_FRESH) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Newest published frame
+const VisualFrame *VisualSnapshot::Read()
+{
+  // The old front frame is handed back to the writer, done reading it
+  if (this->middle & VISUAL_FRESH)
+  {
+    __sync_synchronize();
+    this->front = __sync_lock_test_and_set(&this->middle, this->front) & 3;
+  }
+
+  if (this->frames[this->front].index == 0)
+    return NULL;
+
+  return &this->frames[this->front];
+}
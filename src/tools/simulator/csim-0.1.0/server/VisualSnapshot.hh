@@ -0,0 +1,103 @@
+/*
+ *  CSim - CAMBADA Simulator
+ *  Copyright (C) 2010  Universidade de Aveiro
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ *  @Desc   Visual snapshots: what the GUI draws, published by the physics
+ *          thread after each step through a lock-free triple buffer, so
+ *          rendering never touches the live world nor its mutex
+ *
+ */
+
+#ifndef _VISUALSNAPSHOT_HH_
+#define _VISUALSNAPSHOT_HH_
+
+#include <string>
+#include <vector>
+
+namespace gazebo
+{
+  /// \brief Static description of a drawn geom
+  struct GeomVisual
+  {
+    int shape;                // Shape::Type (sphere, cylinder, box)
+    float size[3];            // radius / radius, length / sides
+    float color[3];
+    int model;                // index in VisualFrame::modelNames
+  };
+
+  /// \brief Absolute pose of a geom or of a model (canonical body)
+  struct VisualPose
+  {
+    float pos[3];
+    float rot[4];             // u, x, y, z
+  };
+
+  /// \brief One published frame
+  ///
+  /// geoms and modelNames only change with the layout (models added or
+  /// removed), the poses are rewritten every step.
+  struct VisualFrame
+  {
+    unsigned int layout;      // layout version of geoms and modelNames
+    unsigned int index;       // publication counter
+    double simTime;
+    double realTime;
+    std::vector<GeomVisual> geoms;
+    std::vector<std::string> modelNames;
+    std::vector<VisualPose> geomPoses;
+    std::vector<VisualPose> modelPoses;
+
+    /// \brief Pose of a model by name
+    /// \return NULL if the model isn't in the frame
+    const VisualPose *GetModelPose(const std::string &name) const;
+  };
+
+  /// \brief Triple buffer of visual frames, one writer (physics thread)
+  /// and one reader (GUI thread), neither ever waits for the other
+  class VisualSnapshot
+  {
+    public: VisualSnapshot();
+
+    /// \brief Frame to fill (writer), it keeps the content it had when it
+    /// was last written, so the layout is only copied when it changed
+    public: VisualFrame *GetBackFrame();
+
+    /// \brief Publish the frame returned by GetBackFrame
+    public: void Publish();
+
+    /// \brief True if a frame was published since the last Read
+    public: bool HasNewFrame() const;
+
+    /// \brief Newest published frame (reader), valid until the next Read
+    /// \return NULL if nothing was published yet
+    public: const VisualFrame *Read();
+
+    private: VisualFrame frames[3];
+
+    /// Buffer exchanged between both sides, with VISUAL_FRESH set when
+    /// it holds a frame the reader hasn't seen
+    private: volatile int middle;
+    private: int back;
+    private: int front;
+    private: unsigned int counter;
+  };
+}
+
+#endif
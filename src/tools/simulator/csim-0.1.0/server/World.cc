@@ -40,6 +40,8 @@
 #include <sstream>
 #include <fstream>
 #include <sys/time.h> //gettimeofday
+#include <math.h>
+#include <algorithm>
 
 #include "Body.hh"
 #include "Factory.hh"
@@ -56,6 +58,10 @@
 #include "World.hh"
 
 #include "Geom.hh"
+#include "Shape.hh"
+#include "SphereShape.hh"
+#include "CylinderShape.hh"
+#include "BoxShape.hh"
 
 using namespace gazebo;
 
@@ -81,6 +87,11 @@ World::World()
   this->saveStateBufferSizeP = new ParamT<unsigned int>("saveStateBufferSize",1000,0);
   Param::End();
 
+  this->snapshotLayoutValid = false;
+  this->snapshotCurrent = -1;
+
+  this->visualSnapshot = NULL;
+  this->visualLayout = 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -131,6 +142,12 @@ void World::Close()
     this->factory = NULL;
   }
 
+  if (this->visualSnapshot)
+  {
+    delete this->visualSnapshot;
+    this->visualSnapshot = NULL;
+  }
+
   if (this->saveStateTimeoutP)
     delete this->saveStateTimeoutP;
   this->saveStateTimeoutP = NULL;
@@ -211,10 +228,6 @@ void World::Load(XMLConfigNode *rootNode, unsigned int serverId)
   this->saveStateTimeoutP->Load(rootNode);
   this->saveStateBufferSizeP->Load(rootNode);
 
-  this->worldStates.resize(**this->saveStateBufferSizeP);
-  this->worldStatesInsertIter = this->worldStates.begin();
-  this->worldStatesEndIter = this->worldStates.begin();
-  this->worldStatesCurrentIter = this->worldStatesInsertIter;
 
 
 #ifdef USE_THREADPOOL
@@ -270,7 +283,6 @@ void World::Init()
   this->toLoadEntities.clear();
 
   this->factory->Init();
-  this->saveStateTimer.Start();
   
   this->SaveState();
 }
@@ -301,23 +313,16 @@ void World::Update()
       if ( !Simulator::Instance()->IsPaused() ){
           // Update all the models
           std::vector< Model* >::iterator miter;
+          // (controllers use the RTDB and PMAN, models are updated serially)
           for (miter=this->models.begin(); miter!=this->models.end(); miter++)
           {
-#ifdef USE_THREADPOOL
-              this->threadPool->schedule(boost::bind(&Model::Update,(*miter)));
-#else
               (*miter)->Update();
-#endif
           }
-
-#ifdef USE_THREADPOOL
-          this->threadPool->wait();
-#endif
       }
 
   }
 
-  /// Update all the sensors
+  /// Update all the sensors (on the thread pool with USE_THREADPOOL)
   SensorManager::Instance()->Update();
 
   if (!Simulator::Instance()->IsPaused() &&
@@ -328,16 +333,149 @@ void World::Update()
       this->physicsEngine->UpdatePhysics();
     }
 
-    /*if (this->saveStateTimer.GetElapsed() > **this->saveStateTimeoutP)
-    {
-      this->SaveState();
-      this->saveStateTimer.Start();
-    }*/
+    this->CaptureSnapshot();
   }
 
+  if (this->visualSnapshot)
+    this->PublishVisual();
+
   this->factory->Update();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Publish frames for the GUI
+void World::EnableVisualSnapshot()
+{
+  if (this->visualSnapshot == NULL)
+    this->visualSnapshot = new VisualSnapshot();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frames for the GUI
+VisualSnapshot *World::GetVisualSnapshot()
+{
+  return this->visualSnapshot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill and publish a visual frame
+void World::PublishVisual()
+{
+  VisualFrame *frame = this->visualSnapshot->GetBackFrame();
+  std::vector< Model* >::iterator miter;
+
+  // The layout (geoms, shapes and colors) is only rebuilt when models were
+  // added or removed since this buffer was last written
+  if (frame->layout != this->visualLayout)
+  {
+    frame->geoms.clear();
+    frame->modelNames.clear();
+
+    for (miter=this->models.begin(); miter!=this->models.end(); miter++)
+    {
+      Model *model = *miter;
+      if (model->GetType() == "empty")
+        continue;
+
+      const std::map<std::string, Body*> *bodies = model->GetBodies();
+      std::map<std::string, Body*>::const_iterator biter;
+      for (biter = bodies->begin(); biter != bodies->end(); biter++)
+      {
+        const std::map<std::string, Geom*> *geoms = biter->second->GetGeoms();
+        std::map<std::string, Geom*>::const_iterator giter;
+        for (giter = geoms->begin(); giter != geoms->end(); giter++)
+        {
+          Shape *shape = giter->second->GetShape();
+          GeomVisual visual;
+
+          visual.shape = shape->GetType();
+          visual.size[0] = visual.size[1] = visual.size[2] = 0;
+
+          switch (visual.shape)
+          {
+            case Shape::SPHERE:
+              visual.size[0] = ((SphereShape*)shape)->GetSize();
+              break;
+            case Shape::CYLINDER:
+              {
+                Vector2<double> size = ((CylinderShape*)shape)->GetSize();
+                visual.size[0] = size.x;
+                visual.size[1] = size.y;
+              }
+              break;
+            case Shape::BOX:
+              {
+                Vector3 size = ((BoxShape*)shape)->GetSize();
+                visual.size[0] = size.x;
+                visual.size[1] = size.y;
+                visual.size[2] = size.z;
+              }
+              break;
+            default:
+              continue;   // not drawn
+          }
+
+          Vector3 rgb = giter->second->GetPigment();
+          visual.color[0] = rgb.x;
+          visual.color[1] = rgb.y;
+          visual.color[2] = rgb.z;
+          visual.model = frame->modelNames.size();
+
+          frame->geoms.push_back(visual);
+        }
+      }
+
+      frame->modelNames.push_back(model->GetName());
+    }
+
+    frame->geomPoses.resize(frame->geoms.size());
+    frame->modelPoses.resize(frame->modelNames.size());
+    frame->layout = this->visualLayout;
+  }
+
+  // Poses, in the same order as the layout
+  unsigned int g = 0, m = 0;
+  for (miter=this->models.begin(); miter!=this->models.end(); miter++)
+  {
+    Model *model = *miter;
+    if (model->GetType() == "empty")
+      continue;
+
+    const std::map<std::string, Body*> *bodies = model->GetBodies();
+    std::map<std::string, Body*>::const_iterator biter;
+    for (biter = bodies->begin(); biter != bodies->end(); biter++)
+    {
+      const std::map<std::string, Geom*> *geoms = biter->second->GetGeoms();
+      std::map<std::string, Geom*>::const_iterator giter;
+      for (giter = geoms->begin(); giter != geoms->end(); giter++)
+      {
+        int type = giter->second->GetShape()->GetType();
+        if (type != Shape::SPHERE && type != Shape::CYLINDER &&
+            type != Shape::BOX)
+          continue;
+
+        Pose3d pose = giter->second->GetAbsPose();
+        VisualPose &vp = frame->geomPoses[g++];
+        vp.pos[0] = pose.pos.x; vp.pos[1] = pose.pos.y; vp.pos[2] = pose.pos.z;
+        vp.rot[0] = pose.rot.u; vp.rot[1] = pose.rot.x;
+        vp.rot[2] = pose.rot.y; vp.rot[3] = pose.rot.z;
+      }
+    }
+
+    Body *body = model->GetCanonicalBody();
+    Pose3d pose = body ? body->GetAbsPose() : model->GetAbsPose();
+    VisualPose &vp = frame->modelPoses[m++];
+    vp.pos[0] = pose.pos.x; vp.pos[1] = pose.pos.y; vp.pos[2] = pose.pos.z;
+    vp.rot[0] = pose.rot.u; vp.rot[1] = pose.rot.x;
+    vp.rot[2] = pose.rot.y; vp.rot[3] = pose.rot.z;
+  }
+
+  frame->simTime = Simulator::Instance()->GetSimTime().Double();
+  frame->realTime = Simulator::Instance()->GetRealTime().Double();
+
+  this->visualSnapshot->Publish();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Finilize the world
 void World::Fini()
@@ -503,6 +641,8 @@ Model *World::LoadModel(XMLConfigNode *node, Model *parent, bool removeDuplicate
 
   // Add the model to our list
   this->models.push_back(model);
+  this->snapshotLayoutValid = false;
+  this->visualLayout++;
 
   if (Simulator::Instance()->GetSimTime() > 0)
     model->Init();
@@ -671,41 +811,22 @@ void World::RegisterBody( Body *body )
 // Update the simulation interface
 void World::UpdateSimulationIface()
 {
+  SimulationRequestData *req = NULL;
   SimulationRequestData *response = NULL;
 
   //TODO: Move this method to simulator? Hard because of the models
-  this->simIface->Lock(1);
 
-  /* This call releases our lock, which can lead to hard-to-track-down
-   * synchronization bugs.  Besides, it's a small optimization at best
-  if (this->simIface->GetOpenCount() <= 0)
-  {
-    this->simIface->Unlock();
-    return;
-  }
-  */
-
-  response = this->simIface->data->responses;
-
-  this->simIface->data->simTime = Simulator::Instance()->GetSimTime().Double();
-  this->simIface->data->pauseTime = Simulator::Instance()->GetPauseTime().Double();
-  this->simIface->data->realTime = Simulator::Instance()->GetRealTime().Double();
-  this->simIface->data->state = !Simulator::Instance()->IsPaused();
-
-  unsigned int requestCount = this->simIface->data->requestCount;
-
-  // Make sure the request count is valid
-  if (this->simIface->data->requestCount > GAZEBO_SIMULATION_MAX_REQUESTS)
-  {
-    gzerr(0) << "Request count[" << this->simIface->data->requestCount << "] greater than max allowable[" << GAZEBO_SIMULATION_MAX_REQUESTS << "]\n";
-
-    requestCount = GAZEBO_SIMULATION_MAX_REQUESTS;
-  }
+  // Nothing here waits for a client: the time is published double buffered
+  // and the requests are drained from the client ring
+  this->simIface->PublishState(Simulator::Instance()->GetSimTime().Double(),
+      Simulator::Instance()->GetPauseTime().Double(),
+      Simulator::Instance()->GetRealTime().Double(),
+      !Simulator::Instance()->IsPaused());
 
   // Process all the requests
-  for (unsigned int i=0; i < requestCount; i++)
+  while ((req = this->simIface->GetRequest()) != NULL)
   {
-    SimulationRequestData *req = &(this->simIface->data->requests[i]);
+    response = this->simIface->GetResponse(req);
 
     switch (req->type)
     {
@@ -807,8 +928,7 @@ void World::UpdateSimulationIface()
         {
           response->type= req->type;
           response->uintValue = this->models.size();
-          response++;
-          this->simIface->data->responseCount += 1;
+          this->simIface->PostResponse(req);
           break;
         }
 
@@ -820,8 +940,7 @@ void World::UpdateSimulationIface()
           {
             response->type= req->type;
             response->uintValue = model->GetChildren().size();
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
           }
           else
             gzerr(0) << "Invalid model name[" << req->modelName << "] in simulation interface Get Num Children.\n";
@@ -840,8 +959,7 @@ void World::UpdateSimulationIface()
             strncpy(response->modelName, model->GetName().c_str(), 512);
             response->strValue[511] = '\0';
 
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
           }
           else
             gzerr(0) << "Invalid model name[" << req->modelName << "] in simulation interface Get Model Name.\n";
@@ -868,8 +986,7 @@ void World::UpdateSimulationIface()
               strncpy(response->modelName, ent->GetName().c_str(), 512);
               response->strValue[511] = '\0';
 
-              response++;
-              this->simIface->data->responseCount += 1;
+              this->simIface->PostResponse(req);
             }
             else
             gzerr(0) << "Invalid child  index in simulation interface Get Num Children.\n";
@@ -887,8 +1004,7 @@ void World::UpdateSimulationIface()
           {
             response->type = req->type;
             response->uintValue = model->GetLaserFiducialId();
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
             break;
           } 
         }
@@ -903,8 +1019,7 @@ void World::UpdateSimulationIface()
             strncpy(response->strValue, model->GetType().c_str(), 512);
             response->strValue[511] = '\0';
 
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
           }
           else
             gzerr(0) << "Invalid model name[" << req->modelName << "] in simulation interface Get Model Type.\n";
@@ -925,8 +1040,7 @@ void World::UpdateSimulationIface()
             response->vec3Value.y = max.y - min.y;
             response->vec3Value.z = max.z - min.z;
 
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
           }
           else
             gzerr(0) << "Invalid model name[" << req->modelName << "] in simulation interface Get Model Extent.\n";
@@ -979,8 +1093,7 @@ void World::UpdateSimulationIface()
             response->modelAngularAccel.y = angularAccel.y;
             response->modelAngularAccel.z = angularAccel.z;
 
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
           }
           else
             gzerr(0) << "Invalid model name[" << req->modelName << "] in simulation interface Get State Request.\n";
@@ -1007,8 +1120,7 @@ void World::UpdateSimulationIface()
             response->modelPose.pitch = rot.y;
             response->modelPose.yaw = rot.z;
 
-            response++;
-            this->simIface->data->responseCount += 1;
+            this->simIface->PostResponse(req);
           }
           else
           {
@@ -1089,8 +1201,7 @@ void World::UpdateSimulationIface()
 
           //printf("-> modeltype: %s \n", response->modelType);
 
-          response++;
-          this->simIface->data->responseCount += 1;
+          this->simIface->PostResponse(req);
 
           break;
         }
@@ -1216,8 +1327,7 @@ void World::UpdateSimulationIface()
             }
           }
 
-          response++;
-          this->simIface->data->responseCount += 1;
+          this->simIface->PostResponse(req);
 
           break;  
         }
@@ -1287,11 +1397,9 @@ void World::UpdateSimulationIface()
         break;
     }
 
-    this->simIface->data->requestCount = 0;
+    this->simIface->FinishRequest();
   }
 
-  this->simIface->Unlock();
-
   // Remove and delete all models that are marked for deletion
   std::vector< Model* >::iterator miter;
   for (miter=this->toDeleteModels.begin();
@@ -1301,6 +1409,8 @@ void World::UpdateSimulationIface()
     this->models.erase(
         std::remove(this->models.begin(), this->models.end(), *miter) );
     delete *miter;
+    this->snapshotLayoutValid = false;
+    this->visualLayout++;
   }
 
   this->toDeleteModels.clear();
@@ -1319,64 +1429,178 @@ void World::GetInterfaceNames(Entity* en, std::vector<std::string>& list)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Save the state of the world
-void World::SaveState()
+// Build the list of dynamic bodies
+void World::UpdateSnapshotLayout()
 {
-
   std::vector<Model*>::iterator mIter;
-  
+  std::vector<std::string> names;
+
+  this->snapshotBodies.clear();
+  this->snapshotModels.clear();
+
   for (mIter = this->models.begin(); mIter != this->models.end(); mIter++){
-  
+
     if ( (*mIter)->IsStatic() ) continue;
-  
-    this->modelAbsPose[(*mIter)->GetName()]     = (*mIter)->GetAbsPose();
-    this->modelLinearVel[(*mIter)->GetName()]   = (*mIter)->GetLinearVel();
-    this->modelLinearAccel[(*mIter)->GetName()] = (*mIter)->GetLinearAccel();
-    this->modelAngularVel[(*mIter)->GetName()]  = (*mIter)->GetAngularVel();
-    this->modelAngularAccel[(*mIter)->GetName()]= (*mIter)->GetAngularAccel();
+
+    const std::map<std::string, Body*> *bodies = (*mIter)->GetBodies();
+    std::map<std::string, Body*>::const_iterator bIter;
+    for (bIter = bodies->begin(); bIter != bodies->end(); bIter++){
+      if (bIter->second == NULL) continue;
+      this->snapshotBodies.push_back(bIter->second);
+      this->snapshotModels.push_back(*mIter);
+      names.push_back((*mIter)->GetName() + "::" + bIter->first);
+    }
   }
 
-#if 0
-  std::vector<Model*>::iterator mIter;
-  std::vector<Body*>::iterator bIter;
-  std::vector<Geom*>::iterator gIter;
+  // Old snapshots don't match the new body ids
+  this->snapshots.Reset(**this->saveStateBufferSizeP, names);
+  this->snapshotCurrent = -1;
+  this->savedState.assign(this->snapshotBodies.size(), BodySnapshot());
+  this->savedStateValid.assign(this->snapshotBodies.size(), false);
+  this->snapshotLayoutValid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Save the state of the dynamic bodies
+void World::GetState(BodySnapshot *bodies)
+{
+  for (unsigned int i = 0; i < this->snapshotBodies.size(); i++){
+
+    Body *body = this->snapshotBodies[i];
+    BodySnapshot &b = bodies[i];
+    Pose3d pose = body->GetAbsPose();
+    Vector3 v;
+
+    b.pos[0] = pose.pos.x; b.pos[1] = pose.pos.y; b.pos[2] = pose.pos.z;
+    b.rot[0] = pose.rot.u; b.rot[1] = pose.rot.x; b.rot[2] = pose.rot.y; b.rot[3] = pose.rot.z;
+
+    v = body->GetLinearVel();
+    b.linearVel[0] = v.x; b.linearVel[1] = v.y; b.linearVel[2] = v.z;
+    v = body->GetAngularVel();
+    b.angularVel[0] = v.x; b.angularVel[1] = v.y; b.angularVel[2] = v.z;
+    v = body->GetLinearAccel();
+    b.linearAccel[0] = v.x; b.linearAccel[1] = v.y; b.linearAccel[2] = v.z;
+    v = body->GetAngularAccel();
+    b.angularAccel[0] = v.x; b.angularAccel[1] = v.y; b.angularAccel[2] = v.z;
+  }
+}
 
-  WorldState *ws = &(*this->worldStatesInsertIter);
-  for (mIter = this->models.begin(); mIter != this->models.end(); mIter++)
-    ws->modelPoses[(*mIter)->GetName()] = (*mIter)->GetRelativePose();
+////////////////////////////////////////////////////////////////////////////////
+// Set the state of the dynamic bodies
+void World::SetState(const BodySnapshot *bodies)
+{
+  unsigned int i;
 
-  for (bIter = this->bodies.begin(); bIter !=this->bodies.end(); bIter++)
-    ws->bodyPoses[(*bIter)->GetName()] = (*bIter)->GetRelativePose();
+  // The model follows its canonical body, set it first so that the
+  // bodies are placed relative to the restored model pose
+  for (i = 0; i < this->snapshotBodies.size(); i++){
+    const BodySnapshot &b = bodies[i];
+    if ( !WorldSnapshotRing::IsKnown(b) ) continue;
+    if ( this->snapshotModels[i]->GetCanonicalBody() != this->snapshotBodies[i] ) continue;
 
-  for (gIter = this->geometries.begin(); gIter !=this->geometries.end(); 
-       gIter++)
-    ws->geomPoses[(*gIter)->GetName()] = (*gIter)->GetRelativePose();
+    this->snapshotModels[i]->SetAbsPose( Pose3d( Vector3(b.pos[0], b.pos[1], b.pos[2]),
+                                         Quatern(b.rot[0], b.rot[1], b.rot[2], b.rot[3]) ), false );
+  }
 
-  this->worldStatesInsertIter++;
-  if (this->worldStatesInsertIter == this->worldStates.end())
-    this->worldStatesInsertIter = this->worldStates.begin();
+  for (i = 0; i < this->snapshotBodies.size(); i++){
+    const BodySnapshot &b = bodies[i];
+    Body *body = this->snapshotBodies[i];
+    if ( !WorldSnapshotRing::IsKnown(b) ) continue;
+
+    body->SetAbsPose( Pose3d( Vector3(b.pos[0], b.pos[1], b.pos[2]),
+                              Quatern(b.rot[0], b.rot[1], b.rot[2], b.rot[3]) ) );
+    body->SetLinearVel( Vector3(b.linearVel[0], b.linearVel[1], b.linearVel[2]) );
+    body->SetAngularVel( Vector3(b.angularVel[0], b.angularVel[1], b.angularVel[2]) );
+    body->SetLinearAccel( Vector3(b.linearAccel[0], b.linearAccel[1], b.linearAccel[2]) );
+    body->SetAngularAccel( Vector3(b.angularAccel[0], b.angularAccel[1], b.angularAccel[2]) );
+    body->SetEnabled(true);
+  }
 
-  if (this->worldStatesInsertIter == this->worldStatesEndIter)
-  {
-    this->worldStatesEndIter++;
-    if (this->worldStatesEndIter == this->worldStates.end())
-    {
-      this->worldStatesEndIter = this->worldStates.begin();
-    }
+  // Tell the agents their robots were moved
+  Model *last = NULL;
+  for (i = 0; i < this->snapshotModels.size(); i++){
+    if ( this->snapshotModels[i] == last ) continue;
+    last = this->snapshotModels[i];
+    last->Restore();
   }
-#endif
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Save the state of the world
+void World::SaveState()
+{
+  if ( !this->snapshotLayoutValid )
+    this->UpdateSnapshotLayout();
+
+  if ( this->savedState.empty() ) return;
+  this->GetState( &this->savedState[0] );
+  this->savedStateValid.assign( this->savedState.size(), true );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Save the state of one model
 void World::SaveModelState(Model* model){
 
   if ( model->IsStatic() ) return;
-  
-  this->modelAbsPose[model->GetName()]     = model->GetAbsPose();
-  this->modelLinearVel[model->GetName()]   = model->GetLinearVel();
-  this->modelLinearAccel[model->GetName()] = model->GetLinearAccel();
-  this->modelAngularVel[model->GetName()]  = model->GetAngularVel();
-  this->modelAngularAccel[model->GetName()]= model->GetAngularAccel();
 
+  if ( !this->snapshotLayoutValid )
+    this->UpdateSnapshotLayout();
+
+  if ( this->savedState.empty() ) return;
+
+  // Current state of everything, kept only for the bodies of the model
+  std::vector<BodySnapshot> current( this->savedState.size() );
+  this->GetState( &current[0] );
+  for (unsigned int i = 0; i < this->snapshotModels.size(); i++)
+    if ( this->snapshotModels[i] == model ){
+      this->savedState[i] = current[i];
+      this->savedStateValid[i] = true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Add a snapshot to the rewind ring
+void World::CaptureSnapshot()
+{
+  Time simTime = Simulator::Instance()->GetSimTime();
+
+  if ( **this->saveStateBufferSizeP == 0 )
+    return;
+
+  if ( this->snapshotLayoutValid && this->snapshots.GetSize() > 0 &&
+       simTime - this->lastSnapshotTime < **this->saveStateTimeoutP )
+    return;
+
+  if ( !this->snapshotLayoutValid )
+    this->UpdateSnapshotLayout();
+
+  BodySnapshot *bodies = this->snapshots.Push( simTime.Double() );
+  if ( bodies != NULL && !this->snapshotBodies.empty() )
+    this->GetState( bodies );
+  this->lastSnapshotTime = simTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write the snapshot ring to a file
+int World::ExportSnapshots(const std::string &file)
+{
+  if ( !this->snapshotLayoutValid )
+    this->UpdateSnapshotLayout();
+
+  return this->snapshots.Export( file );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Load the snapshot ring from a file
+int World::ImportSnapshots(const std::string &file)
+{
+  if ( !this->snapshotLayoutValid )
+    this->UpdateSnapshotLayout();
+
+  int n = this->snapshots.Import( file );
+  if ( n > 0 )
+    this->GotoTime( 1.0 );
+  return n;
 }
 
 Json::Value World::GetDynamicModelsState(){
@@ -1529,81 +1753,48 @@ void World::SetDynamicModelsState(const Json::Value& root){
 // Restore the state of the world
 void World::RestoreState(){
 
-  std::vector<Model*>::iterator mIter;
-  
-  for (mIter = this->models.begin(); mIter != this->models.end(); mIter++){
-  
-    if ( (*mIter)->IsStatic() ) continue;
-    
-    (*mIter)->SetAbsPose( this->modelAbsPose[(*mIter)->GetName()] );
-    (*mIter)->SetLinearVel(this->modelLinearVel[(*mIter)->GetName()] );
-    (*mIter)->SetLinearAccel(this->modelLinearAccel[(*mIter)->GetName()] );
-    (*mIter)->SetAngularVel(this->modelAngularVel[(*mIter)->GetName()] );
-    (*mIter)->SetAngularAccel(this->modelAngularAccel[(*mIter)->GetName()] );
-    
-    (*mIter)->GetCanonicalBody()->SetEnabled(true);
-    (*mIter)->Restore();
-  }
-
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// Set the state of the world to the pos pointed to by the iterator
-void World::SetState(std::deque<WorldState>::iterator iter)
-{
-
-#if 0
-  std::vector<Model*>::iterator mIter;
-  std::vector<Body*>::iterator bIter;
-  std::vector<Geom*>::iterator gIter;
-
-  WorldState *ws = &(*iter);
-  for (mIter = this->models.begin(); mIter != this->models.end(); mIter++)
-    (*mIter)->SetRelativePose( ws->modelPoses[(*mIter)->GetName()] );
-
-  for (bIter = this->bodies.begin(); bIter !=this->bodies.end(); bIter++)
-    (*bIter)->SetRelativePose( ws->bodyPoses[(*bIter)->GetName()] );
+  if ( !this->snapshotLayoutValid || this->savedState.empty() )
+    return;
 
-  for (gIter = this->geometries.begin(); gIter !=this->geometries.end(); 
-       gIter++)
-    (*gIter)->SetRelativePose( ws->geomPoses[(*gIter)->GetName()] );
+  // Bodies never saved keep their state
+  std::vector<BodySnapshot> state( this->savedState );
+  for (unsigned int i = 0; i < state.size(); i++)
+    if ( !this->savedStateValid[i] )
+      state[i].pos[0] = NAN;
 
-  this->worldStatesCurrentIter = iter;
-#endif
+  this->SetState( &state[0] );
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////
 /// Goto a position in time
 void World::GotoTime(double pos)
 {
-  Simulator::Instance()->SetPaused(true);
-
-  this->worldStatesCurrentIter = this->worldStatesInsertIter;
+  unsigned int size = this->snapshots.GetSize();
 
-  int diff = this->worldStatesInsertIter - this->worldStatesEndIter;
+  if ( !this->snapshotLayoutValid || size == 0 )
+    return;
 
-  int i = (int)(diff * (1.0-pos));
+  Simulator::Instance()->SetPaused(true);
 
-  if (this->worldStatesCurrentIter == this->worldStates.begin())
-    this->worldStatesCurrentIter = this->worldStates.end()--;
+  pos = std::max( 0.0, std::min( 1.0, pos ) );
+  this->snapshotCurrent = (int)( pos * (size - 1) + 0.5 );
 
-  for (;i>=0; i--, this->worldStatesCurrentIter--)
-  {
-    if (this->worldStatesCurrentIter == this->worldStatesEndIter)
-      break;
+  this->SetState( this->snapshots.GetBodies( this->snapshotCurrent ) );
 
-    if (this->worldStatesCurrentIter == this->worldStates.begin())
-      this->worldStatesCurrentIter = this->worldStates.end()-1;
-  }
-
-  this->SetState(this->worldStatesCurrentIter);
+  Time t = this->snapshots.GetFrame( this->snapshotCurrent )->simTime;
+  Simulator::Instance()->RewindSimTime( t );
+  this->lastSnapshotTime = t;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Pause callback
 void World::PauseSlot(bool p)
 {
-  if (!p)
-    this->worldStatesInsertIter = this->worldStatesCurrentIter;
+  // Resuming after GotoTime: the snapshots after it belong to another
+  // history
+  if (!p && this->snapshotCurrent >= 0)
+  {
+    this->snapshots.Truncate( this->snapshotCurrent + 1 );
+    this->snapshotCurrent = -1;
+  }
 }
@@ -61,6 +61,8 @@
 #include "Entity.hh"
 #include "Global.hh"
 #include "Timer.hh"
+#include "WorldSnapshot.hh"
+#include "VisualSnapshot.hh"
 
 #include "json/json.h"
 
@@ -78,7 +80,6 @@ namespace gazebo
   class PhysicsEngine;
   class XMLConfigNode;
   class Factory;
-  class WorldState;
   class Timer;
   class Time;
    
@@ -180,11 +181,27 @@ class World : public SingletonT<World>
   public: void RegisterBody(Body *body);
 
   /// \brief Goto a position in time
+  /// \param pos Position in the snapshot ring, 0 is the oldest snapshot
+  ///        and 1 the newest; the simulation is paused there and, when
+  ///        resumed, goes on from that state (newer snapshots are dropped)
   public: void GotoTime(double pos);
 
-  /// \brief Save the state of the world
+  /// \brief Save the state of the world (one checkpoint, see RestoreState)
   public: void SaveState();
 
+  /// \brief Add a snapshot of the dynamic bodies to the ring (every
+  ///        saveStateResolution of simulation time, saveStateBufferSize
+  ///        snapshots)
+  public: void CaptureSnapshot();
+
+  /// \brief Write the snapshot ring to a (memory mapped) file
+  /// \return 0 on success, -1 on error
+  public: int ExportSnapshots(const std::string &file);
+
+  /// \brief Load the snapshot ring from a file and go to its newest state
+  /// \return Number of snapshots loaded, -1 on error
+  public: int ImportSnapshots(const std::string &file);
+
   /// \brief Return a json object with the state of all dynamic models.
   public: Json::Value GetDynamicModelsState();
 
@@ -196,8 +213,26 @@ class World : public SingletonT<World>
   /// \brief Restore the state of the world
   public: void RestoreState();
 
-  /// \breif Set the state of the world to the pos pointed to by the iterator
-  public: void SetState(std::deque<WorldState>::iterator iter);
+  /// \brief Set the state of the dynamic bodies
+  /// \param bodies One state per body of snapshotBodies
+  public: void SetState(const BodySnapshot *bodies);
+
+  /// \brief Save the state of the dynamic bodies
+  private: void GetState(BodySnapshot *bodies);
+
+  /// \brief Build the list of dynamic bodies (body ids of the snapshots)
+  private: void UpdateSnapshotLayout();
+
+  /// \brief Publish frames for the GUI after every update; called before
+  ///        the physics thread starts, which tests the snapshot unlocked
+  public: void EnableVisualSnapshot();
+
+  /// \brief Frames for the GUI (the renderer never locks the world)
+  /// \return NULL unless EnableVisualSnapshot was called
+  public: VisualSnapshot *GetVisualSnapshot();
+
+  /// \brief Fill and publish a visual frame
+  private: void PublishVisual();
   
 
   /// \brief Pause callback
@@ -276,31 +311,32 @@ class World : public SingletonT<World>
   private: boost::signal<void (Entity*)> addEntitySignal;
 
   // SAVE WORLD STATE
-  // TODO: Create structure
-  private: std::map<std::string, Pose3d> modelAbsPose;
-  private: std::map<std::string, Vector3> modelLinearVel;
-  private: std::map<std::string, Vector3> modelLinearAccel;
-  private: std::map<std::string, Vector3> modelAngularVel;
-  private: std::map<std::string, Vector3> modelAngularAccel;
-  
-
-  private: std::deque<WorldState> worldStates;
-  private: std::deque<WorldState>::iterator worldStatesInsertIter;
-  private: std::deque<WorldState>::iterator worldStatesEndIter;
-  private: std::deque<WorldState>::iterator worldStatesCurrentIter;
+  /// Dynamic bodies (the index is the body id of the snapshots) and
+  /// their models; rebuilt when models are added or removed
+  private: std::vector<Body*> snapshotBodies;
+  private: std::vector<Model*> snapshotModels;
+  private: bool snapshotLayoutValid;
+
+  /// Checkpoint of SaveState/RestoreState
+  private: std::vector<BodySnapshot> savedState;
+  private: std::vector<bool> savedStateValid;
+
+  /// Rewind ring, the snapshot GotoTime went to (-1 if none) and the
+  /// time of the last capture
+  private: WorldSnapshotRing snapshots;
+  private: int snapshotCurrent;
+  private: Time lastSnapshotTime;
 
-  private: Timer saveStateTimer;
   private: ParamT<Time> *saveStateTimeoutP;
   private: ParamT<unsigned int> *saveStateBufferSizeP;
-};
 
-class WorldState
-{
-  public: std::map<std::string, Pose3d> modelPoses;
-  public: std::map<std::string, Pose3d> bodyPoses;
-  public: std::map<std::string, Pose3d> geomPoses;
+  /// GUI frames (NULL when headless) and the version of the set of
+  /// models, bumped when models are added or removed
+  private: VisualSnapshot *visualSnapshot;
+  private: unsigned int visualLayout;
 };
 
+
 /// \}
 }
 
@@ -0,0 +1,232 @@
+/*
+ *  CSim - CAMBADA Simulator
+ *  Copyright (C) 2010  Universidade de Aveiro
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <map>
+
+#include "GazeboMessage.hh"
+#include "WorldSnapshot.hh"
+
+using namespace gazebo;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+WorldSnapshotRing::WorldSnapshotRing()
+  : frameSize(sizeof(SnapshotFrame)), capacity(0), first(0), size(0), counter(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Clear the ring
+void WorldSnapshotRing::Reset(unsigned int capacity, const std::vector<std::string> &bodyNames)
+{
+  this->names = bodyNames;
+  this->frameSize = sizeof(SnapshotFrame) + bodyNames.size() * sizeof(BodySnapshot);
+  this->capacity = capacity;
+  this->data.resize(capacity * this->frameSize);
+  this->first = 0;
+  this->size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame i, 0 is the oldest
+char *WorldSnapshotRing::FrameAt(unsigned int i) const
+{
+  return (char*)&this->data[((this->first + i) % this->capacity) * this->frameSize];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Add a frame
+BodySnapshot *WorldSnapshotRing::Push(double simTime)
+{
+  if (this->capacity == 0)
+    return NULL;
+
+  if (this->size < this->capacity)
+    this->size++;
+  else
+    this->first = (this->first + 1) % this->capacity;
+
+  SnapshotFrame *frame = (SnapshotFrame*)this->FrameAt(this->size - 1);
+  frame->simTime = simTime;
+  frame->index = this->counter++;
+  frame->pad = 0;
+
+  return (BodySnapshot*)(frame + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame header
+const SnapshotFrame *WorldSnapshotRing::GetFrame(unsigned int i) const
+{
+  if (i >= this->size)
+    return NULL;
+  return (const SnapshotFrame*)this->FrameAt(i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame bodies
+const BodySnapshot *WorldSnapshotRing::GetBodies(unsigned int i) const
+{
+  if (i >= this->size)
+    return NULL;
+  return (const BodySnapshot*)(this->FrameAt(i) + sizeof(SnapshotFrame));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Drop the newest frames
+void WorldSnapshotRing::Truncate(unsigned int size)
+{
+  if (size < this->size)
+    this->size = size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write the frames to a memory mapped file
+int WorldSnapshotRing::Export(const std::string &file) const
+{
+  size_t namesSize = this->names.size() * SNAPSHOT_NAME_LEN;
+  size_t length = sizeof(SnapshotFileHeader) + namesSize + this->size * this->frameSize;
+
+  int fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    gzerr(0) << "Can't create snapshot file " << file << "\n";
+    return -1;
+  }
+
+  if (ftruncate(fd, length) != 0)
+  {
+    gzerr(0) << "Can't resize snapshot file " << file << "\n";
+    close(fd);
+    return -1;
+  }
+
+  char *map = (char*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    gzerr(0) << "Can't map snapshot file " << file << "\n";
+    return -1;
+  }
+
+  SnapshotFileHeader *header = (SnapshotFileHeader*)map;
+  header->magic = SNAPSHOT_MAGIC;
+  header->version = SNAPSHOT_VERSION;
+  header->nBodies = this->names.size();
+  header->nFrames = this->size;
+
+  char *p = map + sizeof(SnapshotFileHeader);
+  memset(p, 0, namesSize);
+  for (unsigned int b = 0; b < this->names.size(); b++, p += SNAPSHOT_NAME_LEN)
+    strncpy(p, this->names[b].c_str(), SNAPSHOT_NAME_LEN - 1);
+
+  // oldest first, the ring may wrap around
+  for (unsigned int i = 0; i < this->size; i++, p += this->frameSize)
+    memcpy(p, this->FrameAt(i), this->frameSize);
+
+  msync(map, length, MS_SYNC);
+  munmap(map, length);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Load the frames of a memory mapped file
+int WorldSnapshotRing::Import(const std::string &file)
+{
+  struct stat st;
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotFileHeader))
+  {
+    gzerr(0) << "Can't read snapshot file " << file << "\n";
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+
+  const char *map = (const char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    gzerr(0) << "Can't map snapshot file " << file << "\n";
+    return -1;
+  }
+
+  const SnapshotFileHeader *header = (const SnapshotFileHeader*)map;
+  size_t fileFrameSize = sizeof(SnapshotFrame) + header->nBodies * sizeof(BodySnapshot);
+  const char *names = map + sizeof(SnapshotFileHeader);
+  const char *frames = names + header->nBodies * SNAPSHOT_NAME_LEN;
+
+  if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+      (size_t)st.st_size < (size_t)(frames - map) + header->nFrames * fileFrameSize)
+  {
+    gzerr(0) << "Invalid snapshot file " << file << "\n";
+    munmap((void*)map, st.st_size);
+    return -1;
+  }
+
+  // Body of the file for each of our bodies
+  std::map<std::string, int> byName;
+  for (unsigned int b = 0; b < header->nBodies; b++)
+    byName[std::string(names + b * SNAPSHOT_NAME_LEN, strnlen(names + b * SNAPSHOT_NAME_LEN, SNAPSHOT_NAME_LEN))] = b;
+
+  std::vector<int> source(this->names.size(), -1);
+  for (unsigned int b = 0; b < this->names.size(); b++)
+  {
+    std::map<std::string, int>::iterator it = byName.find(this->names[b].substr(0, SNAPSHOT_NAME_LEN - 1));
+    if (it != byName.end())
+      source[b] = it->second;
+    else
+      gzerr(0) << "Snapshot file " << file << " has no state for " << this->names[b] << "\n";
+  }
+
+  // Keep the newest frames if the file has more than the ring holds
+  unsigned int skip = header->nFrames > this->capacity ? header->nFrames - this->capacity : 0;
+  this->first = 0;
+  this->size = 0;
+  for (unsigned int i = skip; i < header->nFrames; i++)
+  {
+    const SnapshotFrame *in = (const SnapshotFrame*)(frames + i * fileFrameSize);
+    const BodySnapshot *inBodies = (const BodySnapshot*)(in + 1);
+    BodySnapshot *bodies = this->Push(in->simTime);
+
+    for (unsigned int b = 0; b < this->names.size(); b++)
+      if (source[b] >= 0)
+        bodies[b] = inBodies[source[b]];
+      else
+        bodies[b].pos[0] = NAN;
+  }
+
+  munmap((void*)map, st.st_size);
+  return this->size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Body not in the imported file
+bool WorldSnapshotRing::IsKnown(const BodySnapshot &body)
+{
+  return !isnan(body.pos[0]);
+}
@@ -0,0 +1,126 @@
+/*
+ *  CSim - CAMBADA Simulator
+ *  Copyright (C) 2010  Universidade de Aveiro
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+ 
+/*
+ *  @Desc   World snapshots: plain data state of the dynamic bodies, kept
+ *          in a fixed size ring for rewind (World::GotoTime) and saved
+ *          to / loaded from memory mapped files
+ *
+ */
+
+#ifndef _WORLDSNAPSHOT_HH_
+#define _WORLDSNAPSHOT_HH_
+
+#include <string>
+#include <vector>
+
+// Snapshot file: SnapshotFileHeader, body names (SNAPSHOT_NAME_LEN each),
+// then the frames, oldest first (SnapshotFrame + BodySnapshot[nBodies])
+#define SNAPSHOT_MAGIC      0x504e5343    // "CSNP"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_NAME_LEN   64
+
+namespace gazebo
+{
+  /// \brief State of one dynamic body
+  struct BodySnapshot
+  {
+    double pos[3];            // absolute pose
+    double rot[4];            // u, x, y, z
+    double linearVel[3];
+    double angularVel[3];
+    double linearAccel[3];
+    double angularAccel[3];
+  };
+
+  /// \brief Frame header, followed by one BodySnapshot per body
+  struct SnapshotFrame
+  {
+    double simTime;           // seconds
+    unsigned int index;       // capture counter
+    unsigned int pad;
+  };
+
+  /// \brief Snapshot file header
+  struct SnapshotFileHeader
+  {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int nBodies;
+    unsigned int nFrames;
+  };
+
+  /// \brief Fixed size ring of world snapshots
+  ///
+  /// The bodies are identified by their position in the body list given
+  /// to Reset (the body id); every frame is one contiguous block.
+  class WorldSnapshotRing
+  {
+    public: WorldSnapshotRing();
+
+    /// \brief Clear the ring and set its capacity and body list
+    public: void Reset(unsigned int capacity, const std::vector<std::string> &bodyNames);
+
+    /// \brief Add a frame, dropping the oldest one if the ring is full
+    /// \return The body array of the new frame, to be filled
+    public: BodySnapshot *Push(double simTime);
+
+    /// \brief Number of frames
+    public: unsigned int GetSize() const { return this->size; }
+
+    /// \brief Number of bodies of each frame
+    public: unsigned int GetBodyCount() const { return this->names.size(); }
+
+    /// \brief Frame header (0 is the oldest frame)
+    public: const SnapshotFrame *GetFrame(unsigned int i) const;
+
+    /// \brief Frame bodies (0 is the oldest frame)
+    public: const BodySnapshot *GetBodies(unsigned int i) const;
+
+    /// \brief Drop the frames after the first size ones
+    public: void Truncate(unsigned int size);
+
+    /// \brief Write all the frames to a file
+    /// \return 0 on success, -1 on error
+    public: int Export(const std::string &file) const;
+
+    /// \brief Replace the frames by the ones of a file (written by Export)
+    ///
+    /// Bodies are matched by name, the ones missing in the file are
+    /// marked as unknown (see IsKnown)
+    /// \return Number of frames loaded, -1 on error
+    public: int Import(const std::string &file);
+
+    /// \brief False for bodies of an imported frame that weren't in the file
+    public: static bool IsKnown(const BodySnapshot &body);
+
+    private: char *FrameAt(unsigned int i) const;
+
+    private: std::vector<std::string> names;
+    private: std::vector<char> data;
+    private: unsigned int frameSize;
+    private: unsigned int capacity;
+    private: unsigned int first;
+    private: unsigned int size;
+    private: unsigned int counter;
+  };
+}
+
+#endif
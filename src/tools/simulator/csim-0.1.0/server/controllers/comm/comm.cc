@@ -29,14 +29,22 @@
 #include "gazebo.h"
 //#undef  Vec
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
 #include "Global.hh"
 #include "XMLConfig.hh"
 #include "Model.hh"
 #include "World.hh"
+#include "Simulator.hh"
 #include "GazeboError.hh"
+#include "GazeboMessage.hh"
 #include "ControllerFactory.hh"
 #include "IfaceFactory.hh"
 #include "comm.hh"
+#include "MatchStats.hh"
 
 #include "rtdb.h"
 #include "rtdb_sim.h"
@@ -53,10 +61,29 @@ GZ_REGISTER_STATIC_CONTROLLER("comm", Comm);
 
 int Comm::commLoaded = 0;
 
+// Header of the frames of the team comm daemon (src/comm/comm.cpp), only
+// its size is used: it counts in the frame budget
+struct CommFrameHeader
+{
+  unsigned char number;
+  unsigned int counter;
+  char stateTable[MAX_AGENTS];
+  int noRecs;
+};
+
+// Record header in a frame: id, size and life
+#define COMM_RECORD_HEADER ( 3 * (int)sizeof(int) )
+
+// Header of a fragment datagram after the frame header: id, size, life,
+// offset and length (records that don't fit in the frame, see src/comm)
+#define COMM_FRAGMENT_HEADER ( 5 * (int)sizeof(int) )
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 Comm::Comm(Entity *parent )
-    : Controller(parent)
+    : Controller(parent),
+      uniform(rng, UniformRealDist(0, 1)),
+      normal(rng, NormalRealDist(0, 1))
 {
   this->myParent = dynamic_cast<Model*>(this->parent);
 
@@ -72,6 +99,8 @@ Comm::Comm(Entity *parent )
   this->rtdbNum = Comm::commLoaded;
   Comm::commLoaded += 1;
   this->fRTDB = false;
+  this->deliverySeq = 0;
+  this->lastTime = -1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,7 +116,71 @@ void Comm::LoadChild(XMLConfigNode *node)
   // Force "Always on"
   this->alwaysOnP->SetValue( true );
   this->rtdbConfigFile = node->GetFilename("rtdbConf", std::string(), 0);
-  
+
+  // Link layer, the defaults are those of the team comm daemon: 10 Hz
+  // TDMA round, 1400 bytes frames and 2 ms of travel time. Times in ms
+  this->period = node->GetDouble("period", 100, 0) / 1e3;
+  this->frameBudget = node->GetInt("frameBudget", 1400, 0);
+  this->fragmentPeriod = node->GetInt("fragmentPeriod", 5, 0);
+  this->seed = node->GetInt("seed", -1, 0);
+
+  if ( this->period < 0 )
+    gzthrow("Comm period must not be negative");
+  if ( this->frameBudget <= (int)sizeof(CommFrameHeader) + COMM_FRAGMENT_HEADER )
+    gzthrow("Comm frameBudget is smaller than the fragment headers");
+  if ( this->fragmentPeriod < 1 )
+    gzthrow("Comm fragmentPeriod must be at least 1");
+
+  CommLink def;
+  def.latency = 0.002;
+  def.jitter = 0;
+  def.distribution = CommLink::NORMAL;
+  def.loss = 0;
+  def.burstLoss = 0;
+  def.burstEnter = 0;
+  def.burstExit = 1;
+  this->LoadLink(node, def, def);
+
+  this->links.assign(N_AGENTS * N_AGENTS, def);
+
+  // Per link overrides, a missing end stands for every agent
+  for (XMLConfigNode *lNode = node->GetChild("link"); lNode; lNode = lNode->GetNext("link"))
+  {
+    int from = lNode->GetInt("from", -1, 0);
+    int to = lNode->GetInt("to", -1, 0);
+
+    for (int ag1 = 0; ag1 < N_AGENTS; ag1++)
+      for (int ag2 = 0; ag2 < N_AGENTS; ag2++)
+        if ( ag1 != ag2 && (from < 0 || from == ag1) && (to < 0 || to == ag2) )
+          this->LoadLink(lNode, this->links[ag1 * N_AGENTS + ag2], this->links[ag1 * N_AGENTS + ag2]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Load the impairment of a link
+void Comm::LoadLink(XMLConfigNode *node, const CommLink &def, CommLink &link)
+{
+  CommLink l = def;
+
+  l.latency    = node->GetDouble("latency", def.latency * 1e3, 0) / 1e3;
+  l.jitter     = node->GetDouble("jitter", def.jitter * 1e3, 0) / 1e3;
+  l.loss       = node->GetDouble("loss", def.loss, 0);
+  l.burstLoss  = node->GetDouble("burstLoss", def.burstLoss, 0);
+  l.burstEnter = node->GetDouble("burstEnter", def.burstEnter, 0);
+  l.burstExit  = node->GetDouble("burstExit", def.burstExit, 0);
+  l.bad = false;
+
+  std::string dist = node->GetString("distribution", std::string(), 0);
+  if ( dist == "normal" )
+    l.distribution = CommLink::NORMAL;
+  else if ( dist == "uniform" )
+    l.distribution = CommLink::UNIFORM;
+  else if ( dist == "exponential" )
+    l.distribution = CommLink::EXPONENTIAL;
+  else if ( dist != "" )
+    gzthrow("Unknown comm latency distribution " + dist);
+
+  link = l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -108,54 +201,313 @@ void Comm::InitChild()
   
   // Flag rtdb clean up
   this->fRTDB = true;
+
+  this->nextSlot.assign(N_AGENTS, 0);
+  this->rounds.assign(N_AGENTS, 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Update the controller
 void Comm::UpdateChild()
 {
+  double now = Simulator::Instance()->GetSimTime().Double();
 
-  // Share robots World State
-  Robot rws;
-	CoachInfo cInfo;
-  FormationInfo fInfo;
-  KickCalibAppData kcAppData;
-  KickCalibRobData kcRobData;
-  GridView gv;
-  
+  // First update, or the world was rewound
+  if ( this->lastTime < 0 || now < this->lastTime )
+    this->ResetLink( now );
+  this->lastTime = now;
+
+  // Each agent sends one frame per round in its slot
+  for(int ag = 0; ag < N_AGENTS; ag++) {
+    if ( now < this->nextSlot[ag] )
+      continue;
+
+    this->Transmit( ag, now );
+
+    if ( this->period > 0 )
+      this->nextSlot[ag] += this->period * ( floor( (now - this->nextSlot[ag]) / this->period ) + 1 );
+  }
+
+  this->Deliver( now );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Restart the TDMA round and drop the frames in flight
+void Comm::ResetLink(double now)
+{
+  // The seed is drawn from Rand on the first update, after -R is applied
+  if ( this->lastTime < 0 )
+  {
+    if ( this->seed >= 0 )
+      this->rng.seed( (unsigned int)(this->seed + this->rtdbNum) );
+    else
+      this->rng.seed( (unsigned int)Rand::GetIntUniform(0, INT_MAX) );
+    this->normal.distribution().reset();
+  }
+
+  while ( !this->deliveries.empty() )
+    this->deliveries.pop();
+
+  this->freeFrames.clear();
+  for (unsigned int i = 0; i < this->frames.size(); i++)
+  {
+    this->frames[i].pending = 0;
+    this->freeFrames.push_back(i);
+  }
+
+  for (unsigned int i = 0; i < this->links.size(); i++)
+    this->links[i].bad = false;
+
+  // Slots evenly spread over the round, as RA-TDMA with every agent running
+  for (int ag = 0; ag < N_AGENTS; ag++)
+  {
+    this->nextSlot[ag] = now + ag * this->period / N_AGENTS;
+    this->rounds[ag] = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pack the shared records of an agent and queue its deliveries
+void Comm::Transmit(int from, double now)
+{
   int offset;
-  unsigned int FINFO_Lifetime;
   if ( this->rtdbNum == 1 )
     offset = MAX_AGENTS;
   else
     offset = 0;
-  
-  // Fetch coach data
-  DB_get_from(0 + offset, 0, COACH_INFO, (void*)&cInfo);
-  FINFO_Lifetime = DB_get_from(0 + offset, 0, FORMATION_INFO, (void*)&fInfo);
-  DB_get_from(0 + offset, 0, KICKCALIB_APP, (void*)&kcAppData);
 
-//  fprintf(stderr,"csim_comm finfo size %d fid %d msg %s\n", sizeof(fInfo), fInfo.formationID, fInfo.setplayMessage);
+  int f = this->NewFrame( from, now, this->frameBudget );
+
+  // Records larger than what is left of the frame follow it in fragments,
+  // every fragmentPeriod rounds, as the comm daemon does
+  bool fragmentRound = ( this->rounds[from]++ % this->fragmentPeriod == 0 );
+
+  if ( from == 0 ) {
+    // Coach data
+    CoachInfo cInfo;
+    FormationInfo fInfo;
+    KickCalibAppData kcAppData;
+
+    DB_get_from(0 + offset, 0, COACH_INFO, (void*)&cInfo);
+    unsigned int FINFO_Lifetime = DB_get_from(0 + offset, 0, FORMATION_INFO, (void*)&fInfo);
+    DB_get_from(0 + offset, 0, KICKCALIB_APP, (void*)&kcAppData);
+
+    this->Send(f, fragmentRound, COACH_INFO, &cInfo, sizeof(cInfo), 0);
+    if ( FINFO_Lifetime < 1000 )
+      this->Send(f, fragmentRound, FORMATION_INFO, &fInfo, sizeof(fInfo), 0);
+    this->Send(f, fragmentRound, KICKCALIB_APP, &kcAppData, sizeof(kcAppData), 0);
+  }
+  else {
+    // Robots World State
+    Robot rws;
+    KickCalibRobData kcRobData;
+    GridView gv;
+
+    int lt = DB_get_from(from + offset, from, ROBOT_WS, (void*)&rws);
+    int lt2 = DB_get_from(from + offset, from, KICKCALIB_ROB, (void*)&kcRobData);
+    int lt3 = DB_get_from(from + offset, from, GRIDVIEW, (void*)&gv);
+
+    this->Send(f, fragmentRound, ROBOT_WS, &rws, sizeof(rws), lt);
+    this->Send(f, fragmentRound, KICKCALIB_ROB, &kcRobData, sizeof(kcRobData), lt2);
+
+    // Frames not yet written (or corrupted) are not relayed
+    if( GridViewDecoder::check(gv) )
+      this->Send(f, fragmentRound, GRIDVIEW, &gv, sizeof(gv), lt3);
+  }
+
+  this->Queue( f, 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pack a record in the frame or send it in fragments
+void Comm::Send(int f, bool fragmentRound, int id, const void *value, int size, int life)
+{
+  if ( this->Pack(this->frames[f], id, value, size, life) || !fragmentRound )
+    return;
+
+  // The record travels alone, in as many datagrams as it needs, and only
+  // arrives if every one of them does
+  int fragmentData = this->frameBudget - (int)sizeof(CommFrameHeader) - COMM_FRAGMENT_HEADER;
+  int fragments = ( size + fragmentData - 1 ) / fragmentData;
 
-  for(int ag1=1; ag1 < N_AGENTS; ag1++) {
-    DB_put_in(ag1 + offset , 0, COACH_INFO, (void*)&cInfo,0);
-    if(FINFO_Lifetime < 1000){    
-	DB_put_in(ag1 + offset, 0, FORMATION_INFO, (void*)&fInfo,0);
+  int length = sizeof(CommFrameHeader) + COMM_RECORD_HEADER + size;
+  int r = this->NewFrame( this->frames[f].from, this->frames[f].sendTime, length );
+  CommFrame &record = this->frames[r];
+  record.length = sizeof(CommFrameHeader);
+  char *p = &record.data[record.length];
+  memcpy(p, &id, sizeof(int));
+  memcpy(p + sizeof(int), &size, sizeof(int));
+  memcpy(p + 2 * sizeof(int), &life, sizeof(int));
+  memcpy(p + COMM_RECORD_HEADER, value, size);
+  record.length = length;
+
+  this->Queue( r, fragments );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame to fill, reused if one is free
+int Comm::NewFrame(int from, double now, int size)
+{
+  int f;
+  if ( this->freeFrames.empty() )
+  {
+    this->frames.push_back( CommFrame() );
+    f = this->frames.size() - 1;
+  }
+  else
+  {
+    f = this->freeFrames.back();
+    this->freeFrames.pop_back();
+  }
+
+  CommFrame &frame = this->frames[f];
+  if ( (int)frame.data.size() < size )
+    frame.data.resize( size );
+  frame.from = from;
+  frame.sendTime = now;
+  frame.pending = 0;
+  frame.length = sizeof(CommFrameHeader);
+
+  return f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queue the deliveries of a frame sent in a number of datagrams
+void Comm::Queue(int f, int datagrams)
+{
+  CommFrame &frame = this->frames[f];
+
+  for(int to = 0; to < N_AGENTS; to++) {
+    if ( to == frame.from )
+      continue;
+
+    CommLink &link = this->links[frame.from * N_AGENTS + to];
+    int lost = 0;
+    double latency = 0;
+    for (int k = 0; k < datagrams; k++) {
+      if ( this->Lost(link) )
+        lost++;
+      else
+        latency = std::max( latency, this->Latency(link) );
+    }
+
+    if ( lost > 0 ) {
+      MatchStats::Instance()->CommLost( lost );
+      continue;
     }
-    DB_put_in(ag1 + offset, 0, KICKCALIB_APP, (void*)&kcAppData,0);
-
-    int lt = DB_get_from(ag1 + offset, ag1, ROBOT_WS, (void*)&rws);
-    int lt2 = DB_get_from(ag1 + offset, ag1, KICKCALIB_ROB, (void*)&kcRobData);
-    //int lt3 = DB_get_from(ag1 + offset, ag1, GRIDVIEW, (void*)&gv);
-    for(int ag2=0; ag2 < N_AGENTS; ag2++) {
-      if(ag1!=ag2) {
-        DB_put_in(ag2 + offset, ag1, ROBOT_WS, (void*)&rws, lt );
-        DB_put_in(ag2 + offset, ag1, KICKCALIB_ROB, (void*)&kcRobData, lt2 );
-        //DB_put_in(ag2 + offset, ag1, GRIDVIEW, (void*)&gv, lt3 );
-      }
-    } // end for( ag2 )
-  } // end for( ag1 )
 
+    CommDelivery d;
+    d.time = frame.sendTime + latency;
+    d.seq = this->deliverySeq++;
+    d.frame = f;
+    d.to = to;
+    this->deliveries.push(d);
+    frame.pending++;
+  }
+
+  if ( frame.pending == 0 )
+    this->freeFrames.push_back(f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write the frames arrived until now
+void Comm::Deliver(double now)
+{
+  int offset;
+  if ( this->rtdbNum == 1 )
+    offset = MAX_AGENTS;
+  else
+    offset = 0;
+
+  while ( !this->deliveries.empty() && this->deliveries.top().time <= now )
+  {
+    CommDelivery d = this->deliveries.top();
+    this->deliveries.pop();
+
+    CommFrame &frame = this->frames[d.frame];
+
+    // Records age on arrival: their age when sent plus the time in flight
+    int age = (int)( (now - frame.sendTime) * 1e3 + 0.5 );
+
+    int i = sizeof(CommFrameHeader);
+    while ( i < frame.length ) {
+      int id, size, life;
+      memcpy(&id, &frame.data[i], sizeof(int));
+      memcpy(&size, &frame.data[i + sizeof(int)], sizeof(int));
+      memcpy(&life, &frame.data[i + 2 * sizeof(int)], sizeof(int));
+      void *value = &frame.data[i + COMM_RECORD_HEADER];
+      i += COMM_RECORD_HEADER + size;
+
+      // The robots heightmaps are only displayed in the base station
+      if ( id == GRIDVIEW && d.to != 0 )
+        continue;
+
+      DB_put_in(d.to + offset, frame.from, id, value, life + age);
+
+      // World states relayed to the other robots and their age
+      if ( id == ROBOT_WS )
+        MatchStats::Instance()->CommRelay( 1, life + age );
+    }
+
+    if ( --frame.pending == 0 )
+      this->freeFrames.push_back(d.frame);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Append a record to a frame
+bool Comm::Pack(CommFrame &frame, int id, const void *value, int size, int life)
+{
+  if ( frame.length + COMM_RECORD_HEADER + size > this->frameBudget )
+    return false;
+
+  char *p = &frame.data[frame.length];
+  memcpy(p, &id, sizeof(int));
+  memcpy(p + sizeof(int), &size, sizeof(int));
+  memcpy(p + 2 * sizeof(int), &life, sizeof(int));
+  memcpy(p + COMM_RECORD_HEADER, value, size);
+  frame.length += COMM_RECORD_HEADER + size;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Link latency of a frame
+double Comm::Latency(const CommLink &link)
+{
+  double spread = 0;
+
+  if ( link.jitter > 0 ) {
+    switch ( link.distribution ) {
+      case CommLink::NORMAL:
+        spread = this->normal() * link.jitter;
+        break;
+      case CommLink::UNIFORM:
+        spread = ( 2 * this->uniform() - 1 ) * link.jitter;
+        break;
+      case CommLink::EXPONENTIAL:
+        // Retransmissions tail
+        spread = -log( 1 - this->uniform() ) * link.jitter;
+        break;
+    }
+  }
+
+  return std::max( 0.0, link.latency + spread );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Advance the burst state of the link and draw the loss of a frame
+bool Comm::Lost(CommLink &link)
+{
+  // Gilbert-Elliott channel, the state changes before each frame
+  if ( link.bad ) {
+    if ( this->uniform() < link.burstExit )
+      link.bad = false;
+  }
+  else if ( this->uniform() < link.burstEnter )
+    link.bad = true;
+
+  return this->uniform() < ( link.bad ? link.burstLoss : link.loss );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
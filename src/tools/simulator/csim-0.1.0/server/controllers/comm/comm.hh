@@ -28,9 +28,13 @@
 #ifndef _COMM_HH_
 #define _COMM_HH_
 
+#include <queue>
+#include <vector>
+
 #include "gazebo.h"
 #include "Controller.hh"
 #include "Entity.hh"
+#include "Rand.hh"
 
 namespace gazebo
 { 
@@ -45,7 +49,55 @@ namespace gazebo
   \{
 */
 
-/// \brief A stubbed out controller.
+/// \brief Impairment of the link from one agent to another
+struct CommLink
+{
+  /// Latency distribution of the spread over the base latency
+  enum Distribution { NORMAL, UNIFORM, EXPONENTIAL };
+
+  /// Base latency and its spread (s)
+  double latency, jitter;
+  Distribution distribution;
+
+  /// Loss probability in the good and in the bad (burst) state
+  double loss, burstLoss;
+
+  /// Gilbert-Elliott transitions, per frame: good to bad and bad to good
+  double burstEnter, burstExit;
+
+  /// The link is in the bad state
+  bool bad;
+};
+
+/// \brief Frame sent by an agent in its TDMA slot, records packed as in src/comm
+struct CommFrame
+{
+  int from;
+  double sendTime;
+
+  /// Deliveries of the frame still queued
+  int pending;
+
+  /// Used bytes of data: (id, size, life, record data) per record
+  int length;
+  std::vector<char> data;
+};
+
+/// \brief Delivery of a frame to an agent, ordered by time of arrival
+struct CommDelivery
+{
+  double time;
+  unsigned int seq;
+  int frame;
+  int to;
+
+  /// Reversed, the top of a priority_queue is the next arrival
+  bool operator<(const CommDelivery& d) const
+  { return this->time > d.time || (this->time == d.time && this->seq > d.seq); }
+};
+
+/// \brief Relays the shared records between the agents RTDB areas
+/// through a simulated TDMA wireless link (latency, jitter, loss, burst loss)
 class Comm : public Controller
 {
   /// Constructor
@@ -71,6 +123,38 @@ class Comm : public Controller
   /// \return 0 on success
   protected: virtual void FiniChild();
 
+  /// Load the impairment of a link, missing parameters are taken from def
+  private: void LoadLink(XMLConfigNode *node, const CommLink &def, CommLink &link);
+
+  /// Restart the TDMA round and drop the frames in flight
+  private: void ResetLink(double now);
+
+  /// Pack the shared records of an agent and queue a delivery per receiver
+  private: void Transmit(int from, double now);
+
+  /// Write the frames arrived until now in the receivers RTDB areas
+  private: void Deliver(double now);
+
+  /// Append a record to a frame, false if it does not fit the frame budget
+  private: bool Pack(CommFrame &frame, int id, const void *value, int size, int life);
+
+  /// Pack a record in frame f or, if it does not fit and this is a
+  /// fragment round, send it in its own fragments
+  private: void Send(int f, bool fragmentRound, int id, const void *value, int size, int life);
+
+  /// Frame to fill with at least size bytes of data (index in frames)
+  private: int NewFrame(int from, double now, int size);
+
+  /// Draw the loss and latency of a frame sent in a number of datagrams
+  /// and queue a delivery per receiver
+  private: void Queue(int f, int datagrams);
+
+  /// Link latency of a frame (s)
+  private: double Latency(const CommLink &link);
+
+  /// Advance the burst state of the link and draw the loss of a frame
+  private: bool Lost(CommLink &link);
+
   private:
     /// The parent Model
     Model *myParent;
@@ -84,6 +168,39 @@ class Comm : public Controller
     
     // Control resources to be released0
     bool fRTDB;
+
+    /// TDMA round (s, 0 relays on every update) and frame budget (bytes)
+    double period;
+    int frameBudget;
+
+    /// Rounds between two sends of the records that don't fit in a frame
+    int fragmentPeriod;
+
+    /// Frames sent by each agent since the link was reset
+    std::vector<unsigned int> rounds;
+
+    /// Links impairment, from * N_AGENTS + to
+    std::vector<CommLink> links;
+
+    /// Next TDMA slot of each agent (s)
+    std::vector<double> nextSlot;
+
+    /// Frames in flight and free frames, reused between rounds
+    std::vector<CommFrame> frames;
+    std::vector<int> freeFrames;
+
+    std::priority_queue<CommDelivery> deliveries;
+    unsigned int deliverySeq;
+
+    /// Link random generator, own stream so that comm does not shift
+    /// the other consumers of Rand
+    int seed;
+    GeneratorType rng;
+    URealGen uniform;
+    NRealGen normal;
+
+    /// Simulation time of the last update (s), negative before the first one
+    double lastTime;
 };
 
 /** \} */
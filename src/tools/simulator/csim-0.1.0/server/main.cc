@@ -58,6 +58,10 @@ where [options] is one or more of the following:
 - -t &lt;sec&gt;      : Timeout and quit after &lt;sec&gt; seconds
 - -l &lt;logfile&gt;  : Log messages to &lt;logfile&gt
 - -n                  : Do not do any time control
+- -L                  : Headless lock step with the agents, on a virtual clock (implies -r -n, -t counts simulation time)
+- -R &lt;seed&gt;     : Seed of the simulator random number generator
+- -o &lt;file&gt;     : Write the match statistics to &lt;file&gt; when the simulation ends (csim_batch)
+- -i &lt;instance&gt; : Instance namespace of the RTDB, PMAN and libgazebo identifiers (default $CAMBADA_INSTANCE or 0), also the default server id
 
 The server prints some diagnostic information to the console before
 starting the main simulation loop.  Check carefully for any warnings
@@ -121,7 +125,12 @@ home directory, or to the log file specified with the -l command line option.
 #include <config.h>
 #include "Simulator.hh"
 #include "Referee.hh"
+#include "MatchStats.hh"
+#include "World.hh"
 #include "Visual.hh"
+#include "Rand.hh"
+
+#include "rtdbdefs.h"
 #include "GazeboError.hh"
 #include "Global.hh"
 
@@ -129,6 +138,8 @@ home directory, or to the log file specified with the -l command line option.
 const char *worldFileName;
 const char *optLogFileName = NULL;
 unsigned int optServerId = 0;
+bool optServerIdSet = false;
+const char *optInstance = NULL;
 bool optServerForce = true;
 bool optRenderEngineEnabled = true;
 double optTimeout = -1;
@@ -136,6 +147,11 @@ unsigned int optMsgLevel = 1;
 int optTimeControl = 1;
 bool optPhysicsEnabled  = true;
 bool optPaused = false;
+bool optLockStep = false;
+const char *optStatsFile = NULL;
+const char *optSnapshotOut = NULL;
+const char *optSnapshotIn = NULL;
+const char *optSeed = NULL;
 
 ////////////////////////////////////////////////////////////////////////////////
 // TODO: Implement these options
@@ -150,6 +166,12 @@ void PrintUsage()
   fprintf(stderr, "  -r            : Run without a rendering engine\n");
   fprintf(stderr, "  -l <logfile>  : Log to indicated file.\n");
   fprintf(stderr, "  -n            : Do not do any time control\n");
+  fprintf(stderr, "  -L            : Headless lock step with the agents (implies -r -n, -t in sim time)\n");
+  fprintf(stderr, "  -R <seed>     : Seed of the random number generator\n");
+  fprintf(stderr, "  -o <file>     : Write the match statistics to <file> at the end\n");
+  fprintf(stderr, "  -S <file>     : Write the world snapshots (rewind buffer) to <file> at the end\n");
+  fprintf(stderr, "  -G <file>     : Start from the newest world snapshot of <file> (see -S)\n");
+  fprintf(stderr, "  -i <instance> : Instance namespace (RTDB, PMAN and libgazebo ids), default $%s or 0\n", INSTANCE_ENV);
   fprintf(stderr, "  -p            : Run without physics engine\n");
   fprintf(stderr, "  -u            : Start the simulation paused\n");
   fprintf(stderr, "  <worldfile>   : load the the indicated world file\n");
@@ -178,7 +200,7 @@ int ParseArgs(int argc, char **argv)
 {
   int ch;
 
-  char *flags = (char*)("l:hd:s:fxt:nqperu");
+  char *flags = (char*)("l:hd:s:fxt:nqperuLR:i:o:S:G:");
 
   // Get letter options
   while ((ch = getopt(argc, argv, flags)) != -1)
@@ -206,9 +228,27 @@ int ParseArgs(int argc, char **argv)
       case 's':
         // Server id
         optServerId = atoi(optarg);
+        optServerIdSet = true;
         optServerForce = false;
         break;
 
+      case 'o':
+        optStatsFile = optarg;
+        break;
+
+      case 'S':
+        optSnapshotOut = optarg;
+        break;
+
+      case 'G':
+        optSnapshotIn = optarg;
+        break;
+
+      case 'i':
+        // Instance namespace
+        optInstance = optarg;
+        break;
+
       case 't':
         // Timeout and quit after x seconds
         optTimeout = atof(optarg);
@@ -222,6 +262,16 @@ int ParseArgs(int argc, char **argv)
         optRenderEngineEnabled = false;
         break;
 
+      case 'L':
+        optLockStep = true;
+        optRenderEngineEnabled = false;
+        optTimeControl = 0;
+        break;
+
+      case 'R':
+        optSeed = optarg;
+        break;
+
       case 'p':
         optPhysicsEnabled = false;
         break;
@@ -236,6 +286,16 @@ int ParseArgs(int argc, char **argv)
   argc -= optind;
   argv += optind;
 
+  // The RTDB and PMAN libraries read the instance from the environment
+  if (optInstance != NULL)
+    setenv(INSTANCE_ENV, optInstance, 1);
+  else
+    optInstance = getenv(INSTANCE_ENV);
+
+  // One libgazebo server per instance
+  if (optInstance != NULL && !optServerIdSet)
+    optServerId = atoi(optInstance);
+
   if (argc < 1)
   {
     PrintUsage();
@@ -290,6 +350,11 @@ int main(int argc, char **argv)
     gazebo::Simulator::Instance()->SetTimeout(optTimeout);
     gazebo::Simulator::Instance()->SetPhysicsEnabled(optPhysicsEnabled);
     gazebo::Simulator::Instance()->SetPaused(optPaused);
+    gazebo::Simulator::Instance()->SetTimeControl(optTimeControl != 0);
+    gazebo::Simulator::Instance()->SetLockStep(optLockStep);
+
+    if ( optSeed != NULL )
+      gazebo::Rand::SetSeed( strtoul(optSeed, NULL, 0) );
     
     visual::VisualApp::Instance()->SetEnabled( optRenderEngineEnabled );
   }
@@ -306,8 +371,20 @@ int main(int argc, char **argv)
   {
     gazebo::Simulator::Instance()->Init();
     gazebo::Referee::Instance()->Init();
+    if ( optStatsFile != NULL )
+      gazebo::MatchStats::Instance()->SetOutput( optStatsFile );
+    gazebo::MatchStats::Instance()->Init();
+    if ( optSnapshotIn != NULL ){
+      if ( gazebo::World::Instance()->ImportSnapshots( optSnapshotIn ) <= 0 )
+        gzthrow( "Couldn't load the world snapshots of " << optSnapshotIn );
+      // GotoTime pauses
+      gazebo::Simulator::Instance()->SetPaused( optPaused );
+    }
     if ( optRenderEngineEnabled )
+    {
+      gazebo::World::Instance()->EnableVisualSnapshot();
       visual::VisualApp::Instance()->Init();
+    }
 
   }
   catch (gazebo::GazeboError e)
@@ -339,6 +416,10 @@ int main(int argc, char **argv)
   // Finalization and clean up
   try
   {
+    // Before the sensors release the PMAN tables
+    gazebo::MatchStats::Instance()->Fini();
+    if ( optSnapshotOut != NULL )
+      gazebo::World::Instance()->ExportSnapshots( optSnapshotOut );
     visual::VisualApp::Instance()->Fini();  
     gazebo::Simulator::Instance()->Fini();
     gazebo::Referee::Instance()->Fini();
@@ -361,10 +361,6 @@ void Body::Update()
 {
   //DiagnosticTimer timer("Body[" + this->GetName() +"] Update");
 
-#ifdef USE_THREADPOOL
-  // If calling Body::Update in threadpool
-  World::Instance()->GetPhysicsEngine()->InitForThread();
-#endif
   std::map< std::string, Geom* >::iterator geomIter;
   Vector3 vel;
   Vector3 avel;
@@ -381,11 +377,7 @@ void Body::Update()
     for (geomIter=this->geoms.begin();
         geomIter!=this->geoms.end(); geomIter++)
     {
-#ifdef USE_THREADPOOL
-      World::Instance()->threadpool->schedule(boost::bind(&Geom::Update, (geomIter->second)));
-#else
       geomIter->second->Update();
-#endif
     }
   }
   
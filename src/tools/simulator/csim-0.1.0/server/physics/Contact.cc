@@ -79,6 +79,7 @@ const Contact &Contact::operator=(const Contact &contact)
   this->forces.clear();
   this->positions.clear();
   this->normals.clear();
+  this->depths.clear();
 
   std::copy(contact.forces.begin(), contact.forces.end(), 
             std::back_inserter(this->forces));
@@ -89,6 +90,8 @@ const Contact &Contact::operator=(const Contact &contact)
   std::copy(contact.depths.begin(), contact.depths.end(), 
             std::back_inserter(this->depths));
 
+  this->time = contact.time;
+
   return *this;
 }
 
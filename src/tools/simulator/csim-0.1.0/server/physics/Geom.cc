@@ -68,6 +68,7 @@ Geom::Geom( Body *body )
   this->shape = NULL;
 
   this->contactsEnabled = false;
+  this->contactCount = 0;
 
   Param::Begin(&this->parameters);
   this->massP = new ParamT<double>("mass",0.001,0);
@@ -323,7 +324,12 @@ void Geom::AddContact(const Contact &contact)
   if (this->GetType() == Shape::RAY || this->GetType() == Shape::PLANE)
     return;
 
-  this->contacts.push_back( contact.Clone() );
+  if (this->contactCount == this->contacts.size())
+    this->contacts.push_back( contact );
+  else
+    this->contacts[this->contactCount] = contact;
+  this->contactCount++;
+
   this->contactSignal( contact );
 }
 
@@ -331,21 +337,21 @@ void Geom::AddContact(const Contact &contact)
 /// Clear all contact info
 void Geom::ClearContacts()
 {
-  this->contacts.clear();
+  this->contactCount = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Get the number of contacts
 unsigned int Geom::GetContactCount() const
 {
-  return this->contacts.size();
+  return this->contactCount;
 }
             
 ////////////////////////////////////////////////////////////////////////////////
 /// Get a specific contact
 Contact Geom::GetContact(unsigned int i) const
 {
-  if (i < this->contacts.size())
+  if (i < this->contactCount)
     return this->contacts[i];
   else
     gzerr(0) << "Invalid contact index\n";
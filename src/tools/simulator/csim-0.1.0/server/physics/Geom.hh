@@ -170,7 +170,10 @@ namespace gazebo
     ///  Contact parameters
     public: SurfaceParams *surface; 
 
+    /// Contacts of the step, the first contactCount entries are valid
+    /// and the others keep their storage for the next steps
     public: std::vector<Contact> contacts;
+    private: unsigned int contactCount;
  
     /// The body this geom belongs to
     protected: Body *body;
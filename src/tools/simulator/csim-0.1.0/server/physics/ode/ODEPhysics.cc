@@ -37,6 +37,9 @@
  */
 
 #include <assert.h>
+#include <algorithm>
+
+#include <boost/bind.hpp>
 
 #include "Timer.hh"
 #include "PhysicsFactory.hh"
@@ -101,12 +104,40 @@ ODEPhysics::ODEPhysics()
   this->quickStepWP = new ParamT<double>("quickStepW", 1.3, 0);  /// over_relaxation value for SOR
   this->contactMaxCorrectingVelP = new ParamT<double>("contactMaxCorrectingVel", 10.0, 0);
   this->contactSurfaceLayerP = new ParamT<double>("contactSurfaceLayer", 0.01, 0);
+  this->maxContactsP = new ParamT<int>("maxContacts", 32, 0);
+  this->parallelCollisionP = new ParamT<bool>("parallelCollision", false, 0);
+  this->islandThreadsP = new ParamT<int>("islandThreads", 1, 0);
+  this->randomSeedP = new ParamT<int>("randomSeed", 0, 0);
   Param::End();
 
+#ifdef ODE_THREADING
+  this->threadingImpl = NULL;
+  this->threadingPool = NULL;
+#endif
+
+  // Contact points kept for each pair of shapes: a single point is exact
+  // for a sphere, flat faces resting on each other need four
+  for (int i = 0; i < Shape::TYPE_COUNT; i++)
+    for (int j = 0; j < Shape::TYPE_COUNT; j++)
+      this->contactLimits[i][j] = 5;
+
+  for (int i = 0; i < Shape::TYPE_COUNT; i++)
+  {
+    this->SetContactLimit(Shape::SPHERE, (Shape::Type)i, 1);
+    this->SetContactLimit(Shape::RAY, (Shape::Type)i, 1);
+    this->SetContactLimit(Shape::MULTIRAY, (Shape::Type)i, 1);
+  }
+  this->SetContactLimit(Shape::CYLINDER, Shape::PLANE, 4);
+  this->SetContactLimit(Shape::CYLINDER, Shape::CYLINDER, 4);
+  this->SetContactLimit(Shape::CYLINDER, Shape::BOX, 4);
+  this->SetContactLimit(Shape::BOX, Shape::PLANE, 4);
+  this->SetContactLimit(Shape::BOX, Shape::BOX, 4);
+
   this->contactFeedbacks.resize(100);
+  this->contactFeedbackCount = 0;
 
-  // Reset the contact pointer
-  this->contactFeedbackIter = this->contactFeedbacks.begin();
+  this->jointFeedbacks.resize(500);
+  this->jointFeedbackCount = 0;
 }
 
 
@@ -114,6 +145,16 @@ ODEPhysics::ODEPhysics()
 // Destructor
 ODEPhysics::~ODEPhysics()
 {
+#ifdef ODE_THREADING
+  if (this->threadingImpl)
+  {
+    dThreadingImplementationShutdownProcessing(this->threadingImpl);
+    dThreadingFreeThreadPool(this->threadingPool);
+    dWorldSetStepThreadingImplementation(this->worldId, NULL, NULL);
+    dThreadingFreeImplementation(this->threadingImpl);
+  }
+#endif
+
   dCloseODE();
 
   if (this->spaceId)
@@ -132,6 +173,10 @@ ODEPhysics::~ODEPhysics()
   delete this->quickStepWP;
   delete this->contactMaxCorrectingVelP;
   delete this->contactSurfaceLayerP;
+  delete this->maxContactsP;
+  delete this->parallelCollisionP;
+  delete this->islandThreadsP;
+  delete this->randomSeedP;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -152,6 +197,10 @@ void ODEPhysics::Load(XMLConfigNode *node)
   this->quickStepWP->Load(cnode);
   this->contactMaxCorrectingVelP->Load(cnode);
   this->contactSurfaceLayerP->Load(cnode);
+  this->maxContactsP->Load(cnode);
+  this->parallelCollisionP->Load(cnode);
+  this->islandThreadsP->Load(cnode);
+  this->randomSeedP->Load(cnode);
 
   // Help prevent "popping of deeply embedded object
   dWorldSetContactMaxCorrectingVel(this->worldId, contactMaxCorrectingVelP->GetValue());
@@ -176,6 +225,10 @@ void ODEPhysics::Save(std::string &prefix, std::ostream &stream)
   stream << prefix << "  " << *(this->quickStepWP) << "\n";
   stream << prefix << "  " << *(this->contactMaxCorrectingVelP) << "\n";
   stream << prefix << "  " << *(this->contactSurfaceLayerP) << "\n";
+  stream << prefix << "  " << *(this->maxContactsP) << "\n";
+  stream << prefix << "  " << *(this->parallelCollisionP) << "\n";
+  stream << prefix << "  " << *(this->islandThreadsP) << "\n";
+  stream << prefix << "  " << *(this->randomSeedP) << "\n";
   stream << prefix << "</physics:ode>\n";
 }
 
@@ -189,6 +242,35 @@ void ODEPhysics::Init()
   dWorldSetERP(this->worldId, this->globalERPP->GetValue());
   dWorldSetQuickStepNumIterations(this->worldId, this->quickStepItersP->GetValue() );
   dWorldSetQuickStepW(this->worldId, this->quickStepWP->GetValue() );
+
+  // Meshes keep every point up to maxContacts, no pair above it
+  int maxContacts = std::max(1, this->maxContactsP->GetValue());
+  this->SetContactLimit(Shape::TRIMESH, Shape::TRIMESH, maxContacts);
+  for (int i = 0; i < Shape::TYPE_COUNT; i++)
+    for (int j = 0; j < Shape::TYPE_COUNT; j++)
+      this->contactLimits[i][j] = std::min(this->contactLimits[i][j], maxContacts);
+
+  this->contactGeoms.resize(maxContacts);
+
+  // ODE steps each island of bodies on its own, let its threads do it
+  int islandThreads = this->islandThreadsP->GetValue();
+#ifdef ODE_THREADING
+  if (islandThreads > 1 && this->threadingImpl == NULL)
+  {
+    this->threadingImpl = dThreadingAllocateMultiThreadedImplementation();
+    this->threadingPool = dThreadingAllocateThreadPool(islandThreads, 0,
+        dAllocateFlagBasicData, NULL);
+    dThreadingThreadPoolServeMultiThreadedImplementation(this->threadingPool,
+        this->threadingImpl);
+    dWorldSetStepThreadingImplementation(this->worldId,
+        dThreadingImplementationGetFunctions(this->threadingImpl),
+        this->threadingImpl);
+    dWorldSetStepIslandsProcessingMaxThreadCount(this->worldId, islandThreads);
+  }
+#else
+  if (islandThreads > 1)
+    gzerr(0) << "islandThreads needs ODE 0.13 or newer, the islands are stepped by one thread\n";
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -203,50 +285,203 @@ void ODEPhysics::InitForThread()
 void ODEPhysics::UpdateCollision()
 {
   //DiagnosticTimer timer("ODEPhysics Collision Update");
-  std::vector<ContactFeedback>::iterator iter;
-  std::vector<dJointFeedback>::iterator jiter;
- 
   //timer.Start();
 
   // Do collision detection; this will add contacts to the contact group
   this->LockMutex(); 
-  dSpaceCollide( this->spaceId, this, CollisionCallback );
+
+  if (**this->parallelCollisionP)
+  {
+    // Broad phase, then the narrow phase of each island
+    this->collisionPairs.clear();
+    dSpaceCollide( this->spaceId, this, PairCallback );
+
+    this->BuildIslands();
+
+#ifdef USE_THREADPOOL
+    boost::threadpool::pool *pool = World::Instance()->threadPool;
+    for (unsigned int i = 0; i + 1 < this->islandStarts.size(); i++)
+      pool->schedule( boost::bind(&ODEPhysics::CollideIsland, this, i) );
+    pool->wait();
+#else
+    for (unsigned int i = 0; i + 1 < this->islandStarts.size(); i++)
+      this->CollideIsland(i);
+#endif
+
+    // The joints are created by one thread, island by island and in broad
+    // phase order inside each island: the same order on every run
+    for (unsigned int i = 0; i < this->islandPairs.size(); i++)
+    {
+      const CollisionPair &pair = this->collisionPairs[this->islandPairs[i]];
+      if (pair.count > 0)
+        this->CreateContacts(pair.o1, pair.o2,
+            &this->pairContactGeoms[pair.offset], pair.count);
+    }
+  }
+  else
+    dSpaceCollide( this->spaceId, this, CollisionCallback );
+
   this->UnlockMutex(); 
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Find the island node of a geom, -1 for static geoms
+static int FindIslandNode(const std::vector<dSpaceID> &nodes, dGeomID o)
+{
+  if (dGeomGetBody(o) == NULL)
+    return -1;
+
+  std::vector<dSpaceID>::const_iterator iter;
+  iter = std::lower_bound(nodes.begin(), nodes.end(), dGeomGetSpace(o));
+  return iter - nodes.begin();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Union-find root of an island node
+static int FindIslandRoot(std::vector<int> &parents, int node)
+{
+  while (parents[node] != node)
+  {
+    parents[node] = parents[parents[node]];
+    node = parents[node];
+  }
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Partition the collected pairs in islands
+void ODEPhysics::BuildIslands()
+{
+  unsigned int i, islands, offset;
+
+  // The nodes are the model spaces of the moving geoms (a robot is one
+  // node), the static geoms (field, goals) do not join islands
+  this->islandNodes.clear();
+  for (i = 0; i < this->collisionPairs.size(); i++)
+  {
+    if (dGeomGetBody(this->collisionPairs[i].o1))
+      this->islandNodes.push_back( dGeomGetSpace(this->collisionPairs[i].o1) );
+    if (dGeomGetBody(this->collisionPairs[i].o2))
+      this->islandNodes.push_back( dGeomGetSpace(this->collisionPairs[i].o2) );
+  }
+  std::sort(this->islandNodes.begin(), this->islandNodes.end());
+  this->islandNodes.erase( std::unique(this->islandNodes.begin(),
+        this->islandNodes.end()), this->islandNodes.end() );
+
+  this->islandParents.resize(this->islandNodes.size());
+  for (i = 0; i < this->islandParents.size(); i++)
+    this->islandParents[i] = i;
+
+  for (i = 0; i < this->collisionPairs.size(); i++)
+  {
+    int n1 = FindIslandNode(this->islandNodes, this->collisionPairs[i].o1);
+    int n2 = FindIslandNode(this->islandNodes, this->collisionPairs[i].o2);
+
+    if (n1 >= 0 && n2 >= 0)
+      this->islandParents[FindIslandRoot(this->islandParents, n1)] =
+        FindIslandRoot(this->islandParents, n2);
+  }
+
+  // Islands numbered by their first pair, a pair of static geoms is an
+  // island of its own. Each pair gets its slice of contact points
+  this->islandIds.assign(this->islandNodes.size(), -1);
+  islands = 0;
+  offset = 0;
+  for (i = 0; i < this->collisionPairs.size(); i++)
+  {
+    CollisionPair &pair = this->collisionPairs[i];
+    int node = FindIslandNode(this->islandNodes, pair.o1);
+    if (node < 0)
+      node = FindIslandNode(this->islandNodes, pair.o2);
+
+    if (node < 0)
+      pair.island = islands++;
+    else
+    {
+      int root = FindIslandRoot(this->islandParents, node);
+      if (this->islandIds[root] < 0)
+        this->islandIds[root] = islands++;
+      pair.island = this->islandIds[root];
+    }
+
+    pair.offset = offset;
+    pair.count = 0;
+    offset += pair.limit;
+  }
+
+  if (this->pairContactGeoms.size() < offset)
+    this->pairContactGeoms.resize(offset);
+
+  // Pairs grouped by island (counting sort, broad phase order kept)
+  this->islandStarts.assign(islands + 1, 0);
+  for (i = 0; i < this->collisionPairs.size(); i++)
+    this->islandStarts[this->collisionPairs[i].island + 1]++;
+  for (i = 1; i <= islands; i++)
+    this->islandStarts[i] += this->islandStarts[i - 1];
+
+  this->islandPairs.resize(this->collisionPairs.size());
+  for (i = 0; i < this->collisionPairs.size(); i++)
+    this->islandPairs[ this->islandStarts[this->collisionPairs[i].island]++ ] = i;
+
+  // The starts moved to the ends, shift them back
+  for (i = islands; i > 0; i--)
+    this->islandStarts[i] = this->islandStarts[i - 1];
+  this->islandStarts[0] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Narrow phase of the pairs of an island
+void ODEPhysics::CollideIsland(unsigned int island)
+{
+  // ODE collision data of the worker thread
+  this->InitForThread();
+
+  for (unsigned int i = this->islandStarts[island];
+       i < this->islandStarts[island + 1]; i++)
+  {
+    CollisionPair &pair = this->collisionPairs[this->islandPairs[i]];
 
-  // Process all the contacts, get the feedback info, and call the geom
-  // callbacks
-  for (iter = this->contactFeedbacks.begin(); 
-       iter != this->contactFeedbackIter; iter++)
+    pair.count = dCollide(pair.o1, pair.o2, pair.limit,
+        &this->pairContactGeoms[pair.offset], sizeof(dContactGeom));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Copy the joint feedback to the contacts and hand them to the geoms
+void ODEPhysics::UpdateContacts()
+{
+  for (unsigned int i = 0; i < this->contactFeedbackCount; i++)
   {
-    if ((*iter).contact.geom1 == NULL)
+    ContactFeedback &cf = this->contactFeedbacks[i];
+
+    if (cf.contact.geom1 == NULL)
       gzerr(0) << "collision update Geom1 is null\n";
 
-    if ((*iter).contact.geom2 == NULL)
+    if (cf.contact.geom2 == NULL)
       gzerr(0) << "Collision update Geom2 is null\n";
 
-    (*iter).contact.forces.clear();
-
     // Copy all the joint forces to the contact
-    for (jiter = (*iter).feedbacks.begin(); jiter != (*iter).feedbacks.end();
-        jiter++)
+    cf.contact.forces.resize(cf.feedbackCount);
+    for (unsigned int j = 0; j < cf.feedbackCount; j++)
     {
-      JointFeedback feedback;
-      feedback.body1Force.Set( (*jiter).f1[0], (*jiter).f1[1], (*jiter).f1[2] );
-      feedback.body2Force.Set( (*jiter).f2[0], (*jiter).f2[1], (*jiter).f2[2] );
+      const dJointFeedback &f = this->jointFeedbacks[cf.feedbackStart + j];
+      JointFeedback &feedback = cf.contact.forces[j];
 
-      feedback.body1Torque.Set((*jiter).t1[0], (*jiter).t1[1], (*jiter).t1[2]);
-      feedback.body2Torque.Set((*jiter).t2[0], (*jiter).t2[1], (*jiter).t2[2]);
+      feedback.body1Force.Set( f.f1[0], f.f1[1], f.f1[2] );
+      feedback.body2Force.Set( f.f2[0], f.f2[1], f.f2[2] );
 
-      (*iter).contact.forces.push_back(feedback);
+      feedback.body1Torque.Set( f.t1[0], f.t1[1], f.t1[2] );
+      feedback.body2Torque.Set( f.t2[0], f.t2[1], f.t2[2] );
     }
 
     // Add the contact to each geom
-    (*iter).contact.geom1->AddContact( (*iter).contact );
-    (*iter).contact.geom2->AddContact( (*iter).contact );
+    cf.contact.geom1->AddContact( cf.contact );
+    cf.contact.geom2->AddContact( cf.contact );
   }
 
-  // Reset the contact pointer
-  this->contactFeedbackIter = this->contactFeedbacks.begin();
+  // Reuse the contacts and the feedback in the next step
+  this->contactFeedbackCount = 0;
+  this->jointFeedbackCount = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -261,6 +496,12 @@ void ODEPhysics::UpdatePhysics()
 
   //DiagnosticTimer timer("ODEPhysics Step Update");
 
+  // The quick step constraint order is random, seed it from the step so
+  // a replayed step (rewind) gives the same result
+  dRandSetSeed( this->randomSeedP->GetValue() +
+      (unsigned long)(Simulator::Instance()->GetSimTime().Double() /
+                      (**this->stepTimeP).Double() + 0.5) );
+
   // Update the dynamical model
   if (**this->quickStepP)
   {
@@ -276,6 +517,8 @@ void ODEPhysics::UpdatePhysics()
 
   this->UnlockMutex(); 
 
+  // The contact forces are those of this step
+  this->UpdateContacts();
 }
 
 
@@ -409,6 +652,14 @@ Joint *ODEPhysics::CreateJoint(Joint::Type type)
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Set the contact points kept for a pair of shapes
+void ODEPhysics::SetContactLimit(Shape::Type t1, Shape::Type t2, int limit)
+{
+  this->contactLimits[t1][t2] = limit;
+  this->contactLimits[t2][t1] = limit;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Return the space id
 dSpaceID ODEPhysics::GetSpaceId() const
@@ -416,18 +667,22 @@ dSpaceID ODEPhysics::GetSpaceId() const
   return this->spaceId;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Get the gazebo geom of an ODE geom
+ODEGeom *ODEPhysics::GetGeom(dGeomID o)
+{
+  if (dGeomGetClass(o) == dGeomTransformClass)
+    return (ODEGeom*) dGeomGetData(dGeomTransformGetGeom(o));
+  else
+    return (ODEGeom*) dGeomGetData(o);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Handle a collision
 void ODEPhysics::CollisionCallback( void *data, dGeomID o1, dGeomID o2)
 {
-  int maxContacts = 10000;
   ODEPhysics *self;
-  ODEGeom *geom1 = NULL;
-  ODEGeom *geom2 = NULL;
-  int i;
   int numc = 0;
-  dContactGeom contactGeoms[maxContacts];
-  dContact contact;
 
   self = (ODEPhysics*) data;
 
@@ -438,121 +693,156 @@ void ODEPhysics::CollisionCallback( void *data, dGeomID o1, dGeomID o2)
   if (b1 && b2 && dAreConnectedExcluding(b1,b2,dJointTypeContact))
     return;
 
-  // Check if either are spaces
+  // Check if either are spaces, the model spaces are one level below the
+  // world space so this recurses once
   if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
   {
     dSpaceCollide2(o1, o2, self, &CollisionCallback);
+    return;
+  }
+
+  // We should never test two geoms in the same space
+  assert(dGeomGetSpace(o1) != dGeomGetSpace(o2));
+
+  int numContacts = self->contactLimits[GetGeom(o1)->GetType()][GetGeom(o2)->GetType()];
+
+  numc = dCollide(o1, o2, numContacts, &self->contactGeoms[0],
+                  sizeof(self->contactGeoms[0]));
+
+  if (numc != 0)
+    self->CreateContacts(o1, o2, &self->contactGeoms[0], numc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Collect the geom pairs to collide
+void ODEPhysics::PairCallback( void *data, dGeomID o1, dGeomID o2)
+{
+  ODEPhysics *self = (ODEPhysics*) data;
+
+  dBodyID b1 = dGeomGetBody(o1);
+  dBodyID b2 = dGeomGetBody(o2);
+
+  if (b1 && b2 && dAreConnectedExcluding(b1,b2,dJointTypeContact))
+    return;
+
+  if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
+  {
+    dSpaceCollide2(o1, o2, self, &PairCallback);
+    return;
+  }
+
+  assert(dGeomGetSpace(o1) != dGeomGetSpace(o2));
+
+  CollisionPair pair;
+  pair.o1 = o1;
+  pair.o2 = o2;
+  pair.island = 0;
+  pair.limit = self->contactLimits[GetGeom(o1)->GetType()][GetGeom(o2)->GetType()];
+  pair.count = 0;
+  pair.offset = 0;
+  self->collisionPairs.push_back(pair);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Create the contact joints of two colliding geoms
+void ODEPhysics::CreateContacts(dGeomID o1, dGeomID o2,
+                                const dContactGeom *contactGeoms, int numc)
+{
+  ODEGeom *geom1 = GetGeom(o1);
+  ODEGeom *geom2 = GetGeom(o2);
+  dBodyID b1 = dGeomGetBody(o1);
+  dBodyID b2 = dGeomGetBody(o2);
+  dContact contact;
+  int i;
+
+  // Contacts recorded for the geoms, reusing the storage of the last steps
+  ContactFeedback *cf = NULL;
+  if (geom1->GetContactsEnabled() || geom2->GetContactsEnabled())
+  {
+    if (this->contactFeedbackCount == this->contactFeedbacks.size())
+      this->contactFeedbacks.resize( this->contactFeedbacks.size() + 100 );
+
+    cf = &this->contactFeedbacks[this->contactFeedbackCount++];
+    cf->contact.Reset();
+    cf->contact.geom1 = geom1;
+    cf->contact.geom2 = geom2;
+    cf->contact.time = Simulator::Instance()->GetSimTime();
+    cf->feedbackStart = this->jointFeedbackCount;
+    cf->feedbackCount = 0;
+  }
+
+  //contact.surface.mode = dContactSlip1 | dContactSlip2 | 
+  //                       dContactSoftERP | dContactSoftCFM |  
+  //                       dContactBounce | dContactMu2 | dContactApprox1;
+  contact.surface.mode =  dContactSlip1 | dContactSlip2 | dContactSoftERP | 
+                         dContactSoftCFM | dContactApprox1 |  dContactBounce ;
+  // with dContactSoftERP | dContactSoftCFM the test_pr2_collision overshoots the cup
+
+  // Compute the CFM and ERP by assuming the two bodies form a
+  // spring-damper system.
+  double h, kp, kd;
+  h = (**this->stepTimeP).Double();
+  kp = 1.0 / (1.0 / geom1->surface->kp + 1.0 / geom2->surface->kp);
+  kd = geom1->surface->kd + geom2->surface->kd;
+  contact.surface.soft_erp = h * kp / (h * kp + kd);
+  contact.surface.soft_cfm = 1.0 / (h * kp + kd);
+
+  if (geom1->surface->enableFriction && geom2->surface->enableFriction)
+  {
+    contact.surface.mu = std::min(geom1->surface->mu1, 
+        geom2->surface->mu1);
+    contact.surface.mu2 = std::min(geom1->surface->mu2, 
+        geom2->surface->mu2);
+    contact.surface.slip1 = std::min(geom1->surface->slip1, 
+        geom2->surface->slip1);
+    contact.surface.slip2 = std::min(geom1->surface->slip2, 
+        geom2->surface->slip2);
   }
   else
   {
-    // We should never test two geoms in the same space
-    assert(dGeomGetSpace(o1) != dGeomGetSpace(o2));
+    contact.surface.mu = 0; 
+    contact.surface.mu2 = 0;
+    contact.surface.slip1 = 0.1;
+    contact.surface.slip2 = 0.1;
+  }
+  contact.fdir1[0] = 0; contact.fdir1[1] = 0; contact.fdir1[2] = 1;
+  contact.surface.bounce = std::min(geom1->surface->bounce, 
+                               geom2->surface->bounce);
+  contact.surface.bounce_vel = std::min(geom1->surface->bounceVel, 
+                                   geom2->surface->bounceVel);
 
-    // Get pointers to the underlying geoms
-    if (dGeomGetClass(o1) == dGeomTransformClass)
-      geom1 = (ODEGeom*) dGeomGetData(dGeomTransformGetGeom(o1));
-    else
-      geom1 = (ODEGeom*) dGeomGetData(o1);
+  for (i=0; i<numc; i++)
+  {
+    // skip negative depth contacts
+    if(contactGeoms[i].depth < 0)
+      continue;
 
-    if (dGeomGetClass(o2) == dGeomTransformClass)
-      geom2 = (ODEGeom*) dGeomGetData(dGeomTransformGetGeom(o2));
-    else
-      geom2 = (ODEGeom*) dGeomGetData(o2);
+    contact.geom = contactGeoms[i];
 
-    int numContacts = 5;
+    dJointID c = dJointCreateContact (this->worldId,
+                                      this->contactGroup, &contact);
 
-    if (geom1->GetType() == Shape::TRIMESH && geom2->GetType()==Shape::TRIMESH)
-      numContacts = maxContacts;
-      
+    Vector3 contactPos(contact.geom.pos[0], contact.geom.pos[1], 
+                       contact.geom.pos[2]);
+    Vector3 contactNorm(contact.geom.normal[0], contact.geom.normal[1], 
+                        contact.geom.normal[2]);
 
-    numc = dCollide(o1,o2,numContacts, contactGeoms, sizeof(contactGeoms[0]));
+    this->AddContactVisual(contactPos, contactNorm);
 
-    if (numc != 0)
+    // Store the contact info 
+    if (cf)
     {
-      (*self->contactFeedbackIter).contact.Reset();
-      (*self->contactFeedbackIter).contact.geom1 = geom1;
-      (*self->contactFeedbackIter).contact.geom2 = geom2;
-      (*self->contactFeedbackIter).feedbacks.resize(numc);
-
-      for (i=0; i<numc; i++)
-      {
-        double h, kp, kd;
-
-        // skip negative depth contacts
-        if(contactGeoms[i].depth < 0)
-          continue;
-
-        contact.geom = contactGeoms[i];
-        //contact.surface.mode = dContactSlip1 | dContactSlip2 | 
-        //                       dContactSoftERP | dContactSoftCFM |  
-        //                       dContactBounce | dContactMu2 | dContactApprox1;
-        contact.surface.mode =  dContactSlip1 | dContactSlip2 | dContactSoftERP | 
-                               dContactSoftCFM | dContactApprox1 |  dContactBounce ;
-        // with dContactSoftERP | dContactSoftCFM the test_pr2_collision overshoots the cup
-
-        // Compute the CFM and ERP by assuming the two bodies form a
-        // spring-damper system.
-        h = (**self->stepTimeP).Double();
-        kp = 1.0 / (1.0 / geom1->surface->kp + 1.0 / geom2->surface->kp);
-        kd = geom1->surface->kd + geom2->surface->kd;
-        contact.surface.soft_erp = h * kp / (h * kp + kd);
-        contact.surface.soft_cfm = 1.0 / (h * kp + kd);
-
-        if (geom1->surface->enableFriction && geom2->surface->enableFriction)
-        {
-          contact.surface.mu = std::min(geom1->surface->mu1, 
-              geom2->surface->mu1);
-          contact.surface.mu2 = std::min(geom1->surface->mu2, 
-              geom2->surface->mu2);
-            contact.surface.slip1 = std::min(geom1->surface->slip1, 
-              geom2->surface->slip1);
-            contact.surface.slip2 = std::min(geom1->surface->slip2, 
-              geom2->surface->slip2);
-        }
-        else
-        {
-          contact.surface.mu = 0; 
-          contact.surface.mu2 = 0;
-          contact.surface.slip1 = 0.1;
-          contact.surface.slip2 = 0.1;
-        }
-        contact.fdir1[0] = 0; contact.fdir1[1] = 0; contact.fdir1[2] = 1;
-        contact.surface.bounce = std::min(geom1->surface->bounce, 
-                                     geom2->surface->bounce);
-        contact.surface.bounce_vel = std::min(geom1->surface->bounceVel, 
-                                         geom2->surface->bounceVel);
-        dJointID c = dJointCreateContact (self->worldId,
-                                          self->contactGroup, &contact);
-
-        Vector3 contactPos(contact.geom.pos[0], contact.geom.pos[1], 
-                           contact.geom.pos[2]);
-        Vector3 contactNorm(contact.geom.normal[0], contact.geom.normal[1], 
-                            contact.geom.normal[2]);
-
-        self->AddContactVisual(contactPos, contactNorm);
-
-        // Store the contact info 
-        if (geom1->GetContactsEnabled() ||
-            geom2->GetContactsEnabled())
-        {
-          (*self->contactFeedbackIter).contact.depths.push_back(
-              contact.geom.depth);
-          (*self->contactFeedbackIter).contact.positions.push_back(contactPos);
-          (*self->contactFeedbackIter).contact.normals.push_back(contactNorm);
-          (*self->contactFeedbackIter).contact.time = 
-            Simulator::Instance()->GetSimTime();
-          dJointSetFeedback(c, &((*self->contactFeedbackIter).feedbacks[i]));
-        }
-
-        dJointAttach (c, b1, b2);
-      }
-
-      if (geom1->GetContactsEnabled() || geom2->GetContactsEnabled())
-      {
-        self->contactFeedbackIter++;
-        if (self->contactFeedbackIter == self->contactFeedbacks.end())
-          self->contactFeedbacks.resize( self->contactFeedbacks.size() + 100);
-      }
+      cf->contact.depths.push_back(contact.geom.depth);
+      cf->contact.positions.push_back(contactPos);
+      cf->contact.normals.push_back(contactNorm);
+
+      if (this->jointFeedbackCount == this->jointFeedbacks.size())
+        this->jointFeedbacks.push_back( dJointFeedback() );
+
+      dJointSetFeedback(c, &this->jointFeedbacks[this->jointFeedbackCount++]);
+      cf->feedbackCount++;
     }
+
+    dJointAttach (c, b1, b2);
   }
 }
@@ -48,12 +48,20 @@
 #include "PhysicsEngine.hh"
 #include "Shape.hh"
 
+#include <deque>
+#include <vector>
+
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 
+#ifdef ODE_THREADING
+#include <ode/threading_impl.h>
+#endif
+
 namespace gazebo
 {
   class Entity;
+  class ODEGeom;
   class XMLConfigNode;
 
 /// \addtogroup gazebo_physics_engine
@@ -75,6 +83,23 @@ The \c param:physics tag is used to specify certain parameters for the ODE phyic
   - Default: 0.2
   - Range: 0 to 1.0
   - Recommended Range: 0.1 to 0.8
+- maxContacts (int)
+  - Contact points kept for a pair of geoms, the limit of each pair of
+    shapes is lower (one for spheres, four for flat faces)
+  - Default: 32
+- parallelCollision (bool)
+  - Group the colliding geoms in islands (robots, ball) and run the narrow
+    phase of each island on the world thread pool. The contacts are
+    created in a fixed island order, the results do not depend on the
+    number of threads
+  - Default: false
+- islandThreads (int)
+  - Threads stepping the islands of the world (needs ODE 0.13)
+  - Default: 1
+- randomSeed (int)
+  - Seed of the ODE random generator (quick step constraint order), set
+    again on every step so a replayed step gives the same result
+  - Default: 0
 - stepTime (float)
   - Time, in seconds, that elapse for each iteration of the physics engine
   - Default: 0.025
@@ -155,6 +180,29 @@ class ODEPhysics : public PhysicsEngine
   /// \brief Do collision detection
   private: static void CollisionCallback( void *data, dGeomID o1, dGeomID o2);
 
+  /// \brief Collect the geom pairs to collide (broad phase only)
+  private: static void PairCallback( void *data, dGeomID o1, dGeomID o2);
+
+  /// \brief Partition the collected pairs in islands
+  private: void BuildIslands();
+
+  /// \brief Narrow phase of the pairs of an island
+  private: void CollideIsland(unsigned int island);
+
+  /// \brief Create the contact joints of two colliding geoms
+  private: void CreateContacts(dGeomID o1, dGeomID o2,
+                               const dContactGeom *contactGeoms, int numc);
+
+  /// \brief Get the gazebo geom of an ODE geom
+  private: static ODEGeom *GetGeom(dGeomID o);
+
+  /// \brief Copy the joint feedback of the step to the contacts and hand
+  ///        them to the geoms
+  private: void UpdateContacts();
+
+  /// \brief Set the contact points kept for a pair of shapes
+  private: void SetContactLimit(Shape::Type t1, Shape::Type t2, int limit);
+
   /// \brief Top-level world for all bodies
   private: dWorldID worldId;
 
@@ -171,15 +219,69 @@ class ODEPhysics : public PhysicsEngine
   private: ParamT<double> *quickStepWP; 
   private: ParamT<double> *contactMaxCorrectingVelP;
   private: ParamT<double> *contactSurfaceLayerP;
+  private: ParamT<int> *maxContactsP;
+  private: ParamT<bool> *parallelCollisionP;
+  private: ParamT<int> *islandThreadsP;
+  private: ParamT<int> *randomSeedP;
+
+  /// \brief Contact points kept for each pair of shapes
+  private: int contactLimits[Shape::TYPE_COUNT][Shape::TYPE_COUNT];
+
+  /// \brief Contact points of the pair being collided (maxContacts)
+  private: std::vector<dContactGeom> contactGeoms;
+
+  /// \brief Joint feedback of the step. ODE keeps pointers to the
+  ///        entries until the step, a deque keeps them valid while it grows
+  private: std::deque<dJointFeedback> jointFeedbacks;
+  private: unsigned int jointFeedbackCount;
 
   private: class ContactFeedback
            {
              public: Contact contact;
-             public: std::vector<dJointFeedback> feedbacks;
+             /// Entries of jointFeedbacks of the contact
+             public: unsigned int feedbackStart;
+             public: unsigned int feedbackCount;
            };
 
+  /// \brief Recorded contacts of the step, reused between steps
   private: std::vector<ContactFeedback> contactFeedbacks;
-  private: std::vector<ContactFeedback>::iterator contactFeedbackIter;
+  private: unsigned int contactFeedbackCount;
+
+  /// \brief Pair of geoms found by the broad phase
+  private: class CollisionPair
+           {
+             public: dGeomID o1, o2;
+             /// Island of the pair
+             public: unsigned int island;
+             /// Contact points: limit, found and first in pairContactGeoms
+             public: int limit;
+             public: int count;
+             public: unsigned int offset;
+           };
+
+  /// \brief Pairs of the step in broad phase order
+  private: std::vector<CollisionPair> collisionPairs;
+
+  /// \brief Contact points of every pair of the step
+  private: std::vector<dContactGeom> pairContactGeoms;
+
+  /// \brief Island nodes (model spaces of the moving geoms, sorted) and
+  ///        their union-find parents
+  private: std::vector<dSpaceID> islandNodes;
+  private: std::vector<int> islandParents;
+
+  /// \brief Island of each node root, numbered by first pair
+  private: std::vector<int> islandIds;
+
+  /// \brief Pairs grouped by island, and the first entry of each island
+  private: std::vector<unsigned int> islandPairs;
+  private: std::vector<unsigned int> islandStarts;
+
+#ifdef ODE_THREADING
+  /// \brief ODE threads stepping the islands
+  private: dThreadingImplementationID threadingImpl;
+  private: dThreadingThreadPoolID threadingPool;
+#endif
 
   private: std::map<std::string, dSpaceID> spaces;
 };
@@ -0,0 +1,238 @@
+/*
+ *  CSim - CAMBADA Simulator
+ *  Copyright (C) 2010  Universidade de Aveiro
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+ 
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+
+#include "GazeboMessage.hh"
+#include "Simulator.hh"
+#include "World.hh"
+#include "PhysicsEngine.hh"
+#include "Model.hh"
+#include "Body.hh"
+#include "Field.hh"
+#include "Referee.hh"
+#include "MatchStats.hh"
+
+// CAMBADA include
+#include "pman.h"
+
+using namespace gazebo;
+
+static int TeamIndex(const std::string& team){
+  if ( team == "magenta" ) return TEAM_MAGENTA;
+  if ( team == "cyan" )    return TEAM_CYAN;
+  return TEAM_NONE;
+}
+
+void MatchStats::SetOutput(const std::string& filename){
+  this->filename = filename;
+  this->enabled  = !filename.empty();
+}
+
+void MatchStats::Init(){
+
+  if ( !this->enabled ) return;
+
+  Model* ballModel = World::Instance()->GetModelByName( Referee::Instance()->GetBallModelName() );
+  if ( ballModel == NULL ){
+    gzerr(0) << "Ball model not found. Match statistics disabled" << std::endl;
+    this->enabled = false;
+    return;
+  }
+  this->ball = ballModel->GetBody();
+
+  // Robots have an id and a team
+  std::vector<Model*>& models = World::Instance()->GetModels();
+  for ( unsigned int i = 0; i < models.size(); i++ ){
+    if ( models[i]->GetSelfID() > 0 && !models[i]->GetTeam().empty() )
+      this->robots.push_back( models[i] );
+  }
+}
+
+void MatchStats::Update(double stepTime, double waitTime){
+
+  if ( !this->enabled ) return;
+
+  double dt   = World::Instance()->GetPhysicsEngine()->GetStepTime().Double();
+  double now  = Simulator::Instance()->GetSimTime().Double();
+  csim::Field* field = World::Instance()->GetField();
+
+  // Performance
+  this->steps++;
+  this->stepSum += stepTime;
+  this->waitSum += waitTime;
+  if ( stepTime > this->stepMax ) this->stepMax = stepTime;
+  if ( waitTime > this->waitMax ) this->waitMax = waitTime;
+
+  Vector3 ballPos = this->ball->GetAbsPose().pos;
+
+  // Goals and ball out, counted once until the ball is back in the field
+  bool inside = std::fabs(ballPos.x) <= field->fieldWidth*0.5 &&
+                std::fabs(ballPos.y) <= field->fieldLength*0.5;
+  if ( !inside && this->ballInside ){
+    if ( std::fabs(ballPos.y) > field->fieldLength*0.5 &&
+         std::fabs(ballPos.x) < MATCH_GOAL_WIDTH*0.5 ){
+      if ( ballPos.y > 0 ) this->goalsNorth++;
+      else                 this->goalsSouth++;
+    }else{
+      this->ballOut++;
+    }
+  }
+  this->ballInside = inside;
+
+  // Possession: the closest robot within MATCH_POSSESSION_DIST
+  int owner = -1, ownerTeam = TEAM_NONE;
+  double best = MATCH_POSSESSION_DIST;
+  for ( unsigned int i = 0; i < this->robots.size(); i++ ){
+    Vector3 rpos = this->robots[i]->GetAbsPose().pos;
+    double d = std::sqrt( (rpos.x - ballPos.x)*(rpos.x - ballPos.x) +
+                          (rpos.y - ballPos.y)*(rpos.y - ballPos.y) );
+    if ( d < best ){
+      best = d;
+      owner = this->robots[i]->GetSelfID();
+      ownerTeam = TeamIndex( this->robots[i]->GetTeam() );
+    }
+  }
+  this->possession[ownerTeam] += dt;
+
+  if ( owner > 0 ){
+    if ( this->timeToBall[ownerTeam] < 0 )
+      this->timeToBall[ownerTeam] = now;
+
+    // Ball handed over since the last owner: a pass, or lost to the other team
+    if ( this->owner > 0 && owner != this->owner ){
+      if ( ownerTeam == this->ownerTeam ) this->passes++;
+      else                                this->passesLost++;
+    }
+    this->owner = owner;
+    this->ownerTeam = ownerTeam;
+  }
+}
+
+void MatchStats::CommRelay(int records, int ageSum){
+  if ( !this->enabled ) return;
+  this->commRelays += records;
+  this->commAgeSum += ageSum;
+}
+
+void MatchStats::CommLost(int frames){
+  if ( !this->enabled ) return;
+  this->commLost += frames;
+}
+
+// Agent cycle times from the PMAN tables (activation to epilogue, wall clock)
+void MatchStats::AgentStats(std::ostream& out){
+
+  PROC_TYPE proc;
+  unsigned int n = 0, ndm = 0, nact = 0;
+  long long sum = 0;
+  int rtMax = 0, p95 = 0, pct;
+
+  for ( unsigned int i = 0; i < this->robots.size(); i++ ){
+    pman_switch_id( this->robots[i]->GetSelfID() );
+    if ( p_table == NULL ) continue;
+
+    for ( int reset = 1; PMAN_query( &proc, reset ) == 0; reset = 0 ){
+      if ( proc.PROC_rt_n == 0 ) continue;
+      n    += proc.PROC_rt_n;
+      sum  += proc.PROC_rt_sum;
+      nact += proc.PROC_nact;
+      ndm  += proc.PROC_ndm;
+      if ( proc.PROC_rt_max > rtMax ) rtMax = proc.PROC_rt_max;
+      if ( (pct = PMAN_rt_percentile( &proc, 95 )) > p95 ) p95 = pct;
+    }
+  }
+
+  out << "agent_cycles "      << n << "\n"
+      << "agent_cycle_mean_us " << (n ? sum / n : 0) << "\n"
+      << "agent_cycle_max_us " << rtMax << "\n"
+      << "agent_cycle_p95_us " << p95 << "\n"
+      << "agent_activations " << nact << "\n"
+      << "agent_deadline_misses " << ndm << "\n";
+}
+
+void MatchStats::Fini(){
+
+  if ( !this->enabled ) return;
+
+  std::ofstream out( this->filename.c_str() );
+  if ( !out ){
+    gzerr(0) << "Unable to write the match statistics to " << this->filename << std::endl;
+    return;
+  }
+
+  double simTime = Simulator::Instance()->GetSimTime().Double();
+
+  out << std::fixed << std::setprecision(6);
+  out << "sim_time "          << simTime << "\n"
+      << "real_time "         << Simulator::Instance()->GetRealTime().Double() << "\n"
+      << "goals_north "       << this->goalsNorth << "\n"
+      << "goals_south "       << this->goalsSouth << "\n"
+      << "ball_out "          << this->ballOut << "\n"
+      << "possession_magenta " << (simTime > 0 ? this->possession[TEAM_MAGENTA] / simTime : 0) << "\n"
+      << "possession_cyan "   << (simTime > 0 ? this->possession[TEAM_CYAN] / simTime : 0) << "\n"
+      << "passes "            << this->passes << "\n"
+      << "passes_lost "       << this->passesLost << "\n"
+      << "pass_success "      << ( (this->passes + this->passesLost) ?
+                                   (double)this->passes / (this->passes + this->passesLost) : 0 ) << "\n"
+      << "time_to_ball_magenta " << this->timeToBall[TEAM_MAGENTA] << "\n"
+      << "time_to_ball_cyan " << this->timeToBall[TEAM_CYAN] << "\n"
+      << "steps "             << this->steps << "\n"
+      << "step_mean_us "      << (this->steps ? this->stepSum / this->steps * 1e6 : 0) << "\n"
+      << "step_max_us "       << this->stepMax * 1e6 << "\n"
+      << "agent_wait_mean_us " << (this->steps ? this->waitSum / this->steps * 1e6 : 0) << "\n"
+      << "agent_wait_max_us " << this->waitMax * 1e6 << "\n"
+      << "comm_relays "       << this->commRelays << "\n"
+      << "comm_age_mean_ms "  << (this->commRelays ? this->commAgeSum / this->commRelays : 0) << "\n"
+      << "comm_lost "         << this->commLost << "\n";
+
+  this->AgentStats( out );
+}
+
+/* Private functions ..*/
+
+MatchStats::MatchStats(){
+  this->enabled = false;
+  this->ball    = NULL;
+
+  this->goalsNorth = this->goalsSouth = 0;
+  this->ballOut    = 0;
+  this->ballInside = true;
+  this->owner      = -1;
+  this->ownerTeam  = TEAM_NONE;
+  this->passes     = this->passesLost = 0;
+  for ( int i = 0; i < 3; i++ ){
+    this->possession[i] = 0;
+    this->timeToBall[i] = -1;
+  }
+
+  this->steps   = 0;
+  this->stepSum = this->stepMax = 0;
+  this->waitSum = this->waitMax = 0;
+  this->commRelays = 0;
+  this->commAgeSum = 0;
+  this->commLost = 0;
+}
+
+MatchStats::~MatchStats(){
+
+}
@@ -0,0 +1,107 @@
+/*
+ *  CSim - CAMBADA Simulator
+ *  Copyright (C) 2010  Universidade de Aveiro
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+ 
+/*
+ *  @Desc   Match outcome and performance statistics (csim -o),
+ *          one "key value" line per metric, collected by csim_batch
+ *
+ */
+
+#ifndef __MATCHSTATS_H__
+#define __MATCHSTATS_H__
+
+#include <string>
+#include <vector>
+
+#include "SingletonT.hh"
+
+// A robot closer than this to the ball (centers, m) owns it
+#define MATCH_POSSESSION_DIST  0.40
+// Goal mouth width (m), not part of the field description
+#define MATCH_GOAL_WIDTH       2.0
+
+namespace gazebo {
+
+  class Model;
+  class Body;
+
+  class MatchStats : public SingletonT<MatchStats> {
+
+  public:
+
+    /// \brief Statistics file, the statistics are only collected when set
+    void SetOutput(const std::string& filename);
+
+    /// \brief Find the ball and the robots (after the world is initialized)
+    void Init();
+
+    /// \brief Write the statistics file
+    void Fini();
+
+    /// \brief Sample the match after a physics step
+    /// \param stepTime Wall time of the world update (s)
+    /// \param waitTime Wall time waiting for the agents, lock step (s)
+    void Update(double stepTime, double waitTime);
+
+    /// \brief Records relayed by the Comm controller and their age (ms)
+    void CommRelay(int records, int ageSum);
+
+    /// \brief Frames lost on the simulated comm link
+    void CommLost(int frames);
+
+    bool IsEnabled() const { return this->enabled; }
+
+  private:
+
+    MatchStats();
+    virtual ~MatchStats();
+
+    void AgentStats(std::ostream& out);
+
+    std::string filename;
+    bool enabled;
+
+    Body* ball;
+    std::vector<Model*> robots;
+
+    // Outcome
+    int goalsNorth, goalsSouth;
+    int ballOut;
+    bool ballInside;
+    int owner, ownerTeam;            // selfID and team (index) of the last owner
+    double possession[3];            // TEAM_NONE, TEAM_MAGENTA, TEAM_CYAN (s)
+    int passes, passesLost;
+    double timeToBall[3];            // first possession (sim time, s), -1 = never
+
+    // Performance
+    unsigned int steps;
+    double stepSum, stepMax;
+    double waitSum, waitMax;
+    unsigned int commRelays;
+    double commAgeSum;
+    unsigned int commLost;
+
+    friend class DestroyerT<MatchStats>;
+    friend class SingletonT<MatchStats>;
+  };
+
+}
+
+#endif /* __MATCHSTATS_H__ */
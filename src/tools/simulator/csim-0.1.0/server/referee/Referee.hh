@@ -65,6 +65,8 @@ namespace gazebo {
     void Fini();
     
     void ApplyRules();
+
+    const std::string& GetBallModelName() const { return this->ballModelName; }
   
   private:
 
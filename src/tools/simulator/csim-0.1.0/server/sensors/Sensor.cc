@@ -48,6 +48,7 @@ Sensor::Sensor(Body *body)
   this->body = body;
   this->controller = NULL;
   this->active = true;
+  this->updateDue = false;
 
   this->world = World::Instance();
   this->simulator = Simulator::Instance();
@@ -127,12 +128,43 @@ void Sensor::Update()
 {
   //DiagnosticTimer timer("Sensor[" + this->GetName() + "] Update");
 
+  this->PrepareUpdate();
+  this->ParallelUpdate();
+  this->FinishUpdate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// First part of the update
+void Sensor::PrepareUpdate()
+{
   Time physics_dt = this->world->GetPhysicsEngine()->GetStepTime();
 
-  if (((this->simulator->GetSimTime() - this->lastUpdate - this->updatePeriod)/physics_dt) >= 0)
-  {
+  this->updateDue = (((this->simulator->GetSimTime() - this->lastUpdate - this->updatePeriod)/physics_dt) >= 0);
+  if (!this->updateDue)
+    return;
+
+  this->PrepareChild();
+  if (!this->IsParallel())
     this->UpdateChild();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Second part of the update
+void Sensor::ParallelUpdate()
+{
+  if (this->IsParallelDue())
+    this->UpdateChild();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Last part of the update
+void Sensor::FinishUpdate()
+{
+  if (this->updateDue)
+  {
+    this->PublishChild();
     this->lastUpdate = this->simulator->GetSimTime();
+    this->updateDue = false;
   }
 
   // update any controllers that are children of sensors, e.g. ros_bumper
@@ -140,6 +172,13 @@ void Sensor::Update()
     this->controller->Update();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Due and parallel
+bool Sensor::IsParallelDue() const
+{
+  return this->updateDue && this->IsParallel();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Finalize the sensor
 void Sensor::Fini()
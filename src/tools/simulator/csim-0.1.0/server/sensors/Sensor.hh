@@ -67,6 +67,22 @@ namespace gazebo
   
     /// \brief  Update the sensor
     public: void Update();
+
+    /// \brief First (serial) part of the update: checks if the sensor is
+    ///        due, prepares it and updates the sensors that can't run in
+    ///        parallel with the others
+    public: void PrepareUpdate();
+
+    /// \brief Second part of the update, the one that may run on a
+    ///        thread pool along with the other sensors
+    public: void ParallelUpdate();
+
+    /// \brief Last (serial) part of the update: publishes the results
+    public: void FinishUpdate();
+
+    /// \brief True if the sensor has to be updated in this step and
+    ///        its update can run concurrently with the other sensors
+    public: bool IsParallelDue() const;
   
     /// \brief  Finalize the sensor
     public: void Fini();
@@ -92,6 +108,16 @@ namespace gazebo
   
     /// \brief  Update the child
     protected: virtual void UpdateChild() {};
+
+    /// \brief True if UpdateChild only reads the world state saved by
+    ///        PrepareChild, so it can run concurrently with other sensors
+    protected: virtual bool IsParallel() const { return false; }
+
+    /// \brief Save the world state used by UpdateChild (serial)
+    protected: virtual void PrepareChild() {};
+
+    /// \brief Publish the results of UpdateChild (serial, sensor order)
+    protected: virtual void PublishChild() {};
   
     /// \brief Finalize the child
     protected: virtual void FiniChild() {};
@@ -115,6 +141,7 @@ namespace gazebo
     protected: ParamT<bool> *logDataP;
     protected: Time updatePeriod;
     protected: Time lastUpdate;
+    protected: bool updateDue;
     protected: std::string typeName;
   };
   /// \}
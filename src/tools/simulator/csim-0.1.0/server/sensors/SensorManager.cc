@@ -28,6 +28,11 @@
 #include "Sensor.hh"
 #include "SensorManager.hh"
 
+#ifdef USE_THREADPOOL
+#include <boost/bind.hpp>
+#include "World.hh"
+#endif
+
 using namespace gazebo;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,9 +53,24 @@ SensorManager::~SensorManager()
 void SensorManager::Update()
 {
   std::list<Sensor*>::iterator iter;
+
+  // Sensors that can't run in parallel, and the world state the others use
+  for (iter = this->sensors.begin(); iter != this->sensors.end(); iter++)
+    (*iter)->PrepareUpdate();
+
+#ifdef USE_THREADPOOL
+  for (iter = this->sensors.begin(); iter != this->sensors.end(); iter++)
+    if ((*iter)->IsParallelDue())
+      World::Instance()->threadPool->schedule(boost::bind(&Sensor::ParallelUpdate, *iter));
+  World::Instance()->threadPool->wait();
+#else
+  for (iter = this->sensors.begin(); iter != this->sensors.end(); iter++)
+    (*iter)->ParallelUpdate();
+#endif
+
+  // Results are published in sensor order, whichever finished first
   for (iter = this->sensors.begin(); iter != this->sensors.end(); iter++)
-    (*iter)->Update();
-    
+    (*iter)->FinishUpdate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
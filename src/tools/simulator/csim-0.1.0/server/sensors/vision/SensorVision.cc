@@ -26,6 +26,7 @@
  */
 
 #include <sstream>
+#include <boost/bind.hpp>
 #include "XMLConfig.hh"
 #include "Global.hh"
 #include "GazeboMessage.hh"
@@ -38,10 +39,11 @@
 #include "Rand.hh"
 
 #include <vector>
+#include <algorithm>
 #include <list>
 #include <cmath>
+#include <unistd.h>
 
-#include "Timer.hh"
 #include "SensorFactory.hh"
 #include "SensorVision.hh"
 
@@ -58,6 +60,15 @@
 
 using namespace gazebo;
 
+// Draw batches of one vision update (see CounterRand)
+#define NOISE_FRAME           0
+#define NOISE_BALL            1
+#define NOISE_BALL_DROP       2
+#define NOISE_WHITE           3
+#define NOISE_WHITE_DROP      4
+#define NOISE_OBSTACLE        5
+#define NOISE_OBSTACLE_DROP   6
+
 GZ_REGISTER_STATIC_SENSOR("vision", SensorVision);
 
 
@@ -83,6 +94,8 @@ SensorVision::SensorVision(Body *body)
 {
   this->omniQueue = NULL;
   this->typeName  = "vision";
+  this->noiseStep = 0;
+  this->frameMissed = false;
 }
 
 
@@ -112,8 +125,30 @@ void SensorVision::LoadChild( XMLConfigNode *node )
   this->noisyBall     = node->GetBool("noisyBall",      false, 0);
   this->noisyObstacles= node->GetBool("noisyObstacles", false, 0);
 
+  // Noise model: sigma of the distance (m) and of the angle (rad) as
+  // polynomials of the distance, ghost, missed and dropped detections
+  Vector3 sigma = node->GetVector3("rhoSigma", Vector3(0.0082489, -0.0033775, 0.007199));
+  this->rhoSigma[0] = sigma.x; this->rhoSigma[1] = sigma.y; this->rhoSigma[2] = sigma.z;
+  sigma = node->GetVector3("thetaSigma", Vector3(6.5933e-04, -5.3490e-03, 2.4949e-02));
+  this->thetaSigma[0] = sigma.x; this->thetaSigma[1] = sigma.y; this->thetaSigma[2] = sigma.z;
+  this->falsePositive = node->GetDouble("falsePositive", 0.0, 0);
+  this->falseNegative = node->GetDouble("falseNegative", 0.0, 0);
+  this->missedFrame   = node->GetDouble("missedFrame", 0.0, 0);
+  this->noiseSeed     = node->GetInt("noiseSeed", -1, 0);
+
   this->PMANConfigFile = node->GetFilename("PMANConf", std::string(), 0);
   if ( this->PMANConfigFile == "" ) this->PMANConfigFile = std::string("../config/pman.conf"); 
+  // Apply the QoS of pman.conf (scheduling policy, cpusets) to the agents
+  this->PMANQoS = node->GetBool("PMANQoS", false, 0);
+  // PMAN binary trace, one file per robot (<PMANTrace>.R<id>), empty to disable
+  this->PMANTraceFile = node->GetString("PMANTrace", std::string(), 0);
+  this->PMANTraceWriter = -1;
+  // Lock step (csim -L): longest wait for the agents of one step (s, wall clock)
+  this->PMANWaitTimeout = node->GetDouble("PMANWaitTimeout", 1.0, 0);
+  // Lock step: wall time to wait for the agent to attach before the first step (s)
+  this->PMANAttachTimeout = node->GetDouble("PMANAttachTimeout", 30.0, 0);
+  this->pmanTicked = false;
+  this->agentAttached = false;
 
   this->selfID = this->GetParentModel()->GetSelfID();
   
@@ -127,6 +162,14 @@ void SensorVision::LoadChild( XMLConfigNode *node )
     
   if ( this->radialPasses <= 0 )
     this->radialPasses = 2;
+
+  // Radial sensor lines, in the order they are checked
+  std::vector<float> angles;
+  float angleStep = M_PI / (float) this->radialSensors;
+  for ( int k = 0; k < this->radialPasses ; k++ )
+    for ( float angle = k*angleStep ; angle < (M_PI - angleStep*0.5) ; angle += angleStep*this->radialPasses )
+      angles.push_back( angle );
+  this->whiteFan.Init( angles );
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -139,6 +182,9 @@ void SensorVision::InitChild()
     gzerr(0) << "Agent ID is missing, Vision will not update\n";
     return;
   }
+
+  // The run seed is only known after loading (csim -R)
+  this->noise.SetKey( this->noiseSeed < 0 ? Rand::GetSeed() : (unsigned int)this->noiseSeed, this->selfID );
   
   Model* ballModel = World::Instance()->GetModelByName( this->ballModelName );
   
@@ -153,6 +199,7 @@ void SensorVision::InitChild()
   
   // Keep a reference of the field
   this->field = World::Instance()->GetField();
+  this->whiteHits.resize( this->field->GetSegments()->size() );
   // Get all black models
   this->FillObstacleList();
   
@@ -167,13 +214,12 @@ void SensorVision::InitChild()
   }
   
   // Init PMAN
-  FILE *fpPman = NULL;
-	int pmanstat, pprio;
+	int pmanstat;
 
   this->fPMAN = false;
 	// PMAN initializations
   pmanstat = PMAN_init2(SHMEM_OCAM_PMAN_KEY + 2*this->selfID, SEM_OCAM_PMAN_KEY + 2*this->selfID,
-                       (void *)dummyShed, sizeof(pprio), PMAN_NEW);
+                       this->PMANQoS ? (void *)linux_qos : (void *)dummyShed, sizeof(PMAN_QOS_DATA), PMAN_NEW);
 
 	if( pmanstat < 0 ) {
 	 /* 
@@ -196,22 +242,27 @@ void SensorVision::InitChild()
     this->fPMAN = true;
     pman_save_ids( this->selfID );
     
-		if(!(fpPman = fopen( this->PMANConfigFile.c_str() , "r"))) {
-  		gzthrow("Couldn't open PMAN configuration file");
+		// Agent periods are counted in vision updates
+		if ( this->updatePeriod.Double() > 0.0 )
+			PMAN_tick_length( (int)(this->updatePeriod.Double() * 1e6) );
+
+		// process- {name, period, phase, deadline, priority [, policy, runtime, cpus [, cpuset]]}
+		if( PMAN_conf_load( this->PMANConfigFile.c_str() ) < 0 ) {
+  		gzthrow("Couldn't load PMAN configuration file");
 		}
-		else {
-			do {
-				char pname[32];
-				int pper, ppha, pddln, pprio;
-				// process- {name, period, phase, deadline, priority}
-				int nv = fscanf(fpPman,"%s %d %d %d %d",pname,&pper,&ppha,&pddln,&pprio);
-				if( nv == 5 ) {
-					PMAN_procadd(pname,PMAN_NOPID,pper,ppha,pddln,&pprio,sizeof(pprio));
-				}
-			} while( !feof(fpPman) );
-
-			fclose(fpPman);
+
+		if ( this->PMANTraceFile != "" ){
+			std::ostringstream traceFile;
+			traceFile << this->PMANTraceFile << ".R" << this->selfID;
+			this->PMANTraceWriter = PMAN_trace_start( traceFile.str().c_str() );
+			if ( this->PMANTraceWriter < 0 )
+				gzerr(0) << "PMAN_trace_start(" << traceFile.str() << ") failed (" << this->PMANTraceWriter << ")\n";
 		}
+
+		// Lock step: the step is not over until this robot's agent finishes
+		if ( Simulator::Instance()->GetLockStep() )
+			this->stepEndConnection = Simulator::Instance()->ConnectStepEndSignal(
+					boost::bind(&SensorVision::WaitAgent, this) );
 	}
 	// end PAMN init
 	
@@ -222,28 +273,60 @@ void SensorVision::InitChild()
 void SensorVision::FiniChild(){
   
   if ( this->fPMAN ){
+    this->stepEndConnection.disconnect();
     pman_switch_id( this->selfID );
-    PMAN_close(PMAN_CLFREE);
+    PMAN_close(PMAN_CLFREE);    // also stops the trace writer
   }
 
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Each robot has its own noise draws, the vision is always updated in parallel
+bool SensorVision::IsParallel() const
+{
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Save the world state used by the update
+void SensorVision::PrepareChild()
+{
+  if ( this->selfID < 1 ) return;
+
+  this->selfPose = this->body->GetAbsPose();
+  if ( this->ball != NULL )
+    this->ballPose = this->ball->GetAbsPose();
+
+  // the bounding box may be computed on demand by the physics engine
+  this->obstacles.resize( this->obstacleList.size() );
+  for ( unsigned int i = 0; i < this->obstacleList.size(); i++ ){
+    this->obstacles[i].pose = this->obstacleList[i]->GetAbsPose();
+    this->obstacleList[i]->GetBoundingBox( this->obstacles[i].aabbMin, this->obstacles[i].aabbMax );
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Update the drawing
 void SensorVision::UpdateChild()
 {
-  DiagnosticTimer dt("Vision update");
-  dt.Start();
-  
   // Withour ID define it will not update
   if ( this->selfID < 1 ) return;
 
+#ifndef USE_THREADPOOL
+  // PMAN is bound to one robot at a time, no spans from the thread pool
+  pman_switch_id( this->selfID );
+  PMAN_span_begin("sim_vision");
+#endif
+
+  this->noiseStep++;
+
   // Detect obstacles before anything else
   // as it is needed to do Ball and White-points occlusion.
   this->DetectOcclusions();
   this->DetectObstacle();
   this->DetectBall();
   this->DetectWhite();
+  this->FrameNoise();
   
   if ( this->omniQueue != NULL ){
     
@@ -251,20 +334,84 @@ void SensorVision::UpdateChild()
     this->visionInfo = omniQueue->front();
     omniQueue->pop_front();
   }
-  
-  // Send data to RTDB
-  DB_put_in( this->selfID, this->selfID, VISION_INFO, &(this->visionInfo), 0 );
-  
-  // awake Agent
+
+#ifndef USE_THREADPOOL
+  PMAN_span_end("sim_vision");
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Publish the vision
+void SensorVision::PublishChild()
+{
+  if ( this->selfID < 1 ) return;
+
   pman_switch_id( this->selfID );
+
+  // Send data to RTDB, a missed frame leaves the previous one there
+  if ( !this->frameMissed )
+    DB_put_in( this->selfID, this->selfID, VISION_INFO, &(this->visionInfo), 0 );
+
+  // Lock step: the agent sees the time of the step that produced its vision
+  if ( Simulator::Instance()->GetLockStep() ){
+    if ( !this->agentAttached )
+      this->WaitAgentAttach();
+    PMAN_vclock_set( Simulator::Instance()->GetVirtualClock() );
+    this->pmanTicked = true;
+  }
+
+  // awake Agent
   PMAN_tick();
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Wait for the agent activated in this step (lock step mode)
+void SensorVision::WaitAgent()
+{
+  if ( !this->pmanTicked ) return;
+  this->pmanTicked = false;
+
+  // All the robots were ticked during the step, so the agents run in parallel
+  // and only the slowest one is waited for
+  pman_switch_id( this->selfID );
+  if ( PMAN_wait_idle( (int)(this->PMANWaitTimeout * 1e6) ) == -2 )
+    gzerr(0) << "Robot " << this->selfID << ": agent didn't finish within "
+             << this->PMANWaitTimeout << "s, lock step broken\n";
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Hold the simulation until the agent of this robot is attached (lock step
+// mode), so that a match doesn't depend on how fast the agents start
+void SensorVision::WaitAgentAttach()
+{
+  std::ostringstream name;
+  name << "agent" << this->selfID;
+
+  Time start = Simulator::Instance()->GetRealTime();
+  while ( (Simulator::Instance()->GetRealTime() - start).Double() < this->PMANAttachTimeout ){
+    PROC_TYPE proc;
+    int reset = 1;
+    while ( PMAN_query( &proc, reset ) == 0 ){
+      reset = 0;
+      if ( name.str() == proc.PROC_name && proc.PROC_id != PMAN_NOPID ){
+        this->agentAttached = true;
+        return;
+      }
+    }
+    usleep( 10000 );
+  }
+
+  // Run anyway, the agent may still attach later
+  this->agentAttached = true;
+  gzerr(0) << "Robot " << this->selfID << ": " << name.str() << " didn't attach within "
+           << this->PMANAttachTimeout << "s\n";
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Detect occlusions
 void SensorVision::DetectOcclusions(){
 
-  std::vector<Body*>::iterator it = this->obstacleList.begin();
+  std::vector<ObstacleState>::iterator it = this->obstacles.begin();
   
   Vector3 aabb_min, aabb_max;
   Vector3 location;
@@ -273,13 +420,13 @@ void SensorVision::DetectOcclusions(){
   Pose3d opose; // Obstacle pose
   Pose3d rpose; // Relative pose
   // Parent pose
-  Pose3d ppose = this->body->GetAbsPose();
+  Pose3d ppose = this->selfPose;
   ppose.pos.z = 0;
   
   this->occlusion.clear();
-  for( ; it != this->obstacleList.end(); it++){
+  for( ; it != this->obstacles.end(); it++){
     
-    opose = (*it)->GetAbsPose();
+    opose = (*it).pose;
     opose.pos.z = 0; // ground level ...
     // Get the relative position
     rpose = opose - ppose;
@@ -288,7 +435,8 @@ void SensorVision::DetectOcclusions(){
     // assume that every obstacle has the shape of a cylinder,
     // therefore i can use the axis-align bounding box to obtain
     // the obstacle radius.
-    (*it)->GetBoundingBox( aabb_min, aabb_max );
+    aabb_min = (*it).aabbMin;
+    aabb_max = (*it).aabbMax;
     radius = (aabb_max.x - aabb_min.x) * 0.5;
     radius = (aabb_max.y - aabb_min.y) * 0.5 > radius ? 
              (aabb_max.y - aabb_min.y) * 0.5 : radius ;
@@ -313,6 +461,34 @@ void SensorVision::DetectOcclusions(){
     this->occlusion.push_back( oa );
   }  
 
+  // Sorted spans for OnOcclusionArea, the ones going over 2pi are split
+  this->occlusionSpans.clear();
+  std::vector<OcclusionArea>::iterator oit = this->occlusion.begin();
+  for ( ; oit != this->occlusion.end(); oit++ ){
+    cambada::geom::Angle a, b;
+    a.set_rad( (*oit).angles.first );
+    b.set_rad( (*oit).angles.second );
+
+    OcclusionSpan span;
+    span.distance = (*oit).distance;
+    span.height   = (*oit).height;
+    span.start = a.get_rad();
+    if ( b.get_rad() >= a.get_rad() ){
+      span.end = b.get_rad();
+      this->occlusionSpans.push_back( span );
+    }else{
+      span.end = 2*M_PI;
+      this->occlusionSpans.push_back( span );
+      span.start = 0;
+      span.end = b.get_rad();
+      this->occlusionSpans.push_back( span );
+    }
+  }
+  std::sort( this->occlusionSpans.begin(), this->occlusionSpans.end() );
+  for ( unsigned int i = 0; i < this->occlusionSpans.size(); i++ )
+    this->occlusionSpans[i].reach = ( i > 0 && this->occlusionSpans[i-1].reach > this->occlusionSpans[i].end ) ?
+                                    this->occlusionSpans[i-1].reach : this->occlusionSpans[i].end;
+
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -326,9 +502,9 @@ void SensorVision::DetectBall(){
   //this->frontVisionInfo.ball.cyclesNotVisible = 10000;
   
   // Parent pose
-  Pose3d ppose = this->body->GetAbsPose();
+  Pose3d ppose = this->selfPose;
   // Ball pose
-  Pose3d bpose = this->ball->GetAbsPose();
+  Pose3d bpose = this->ballPose;
   // Save ball distance from the ground 
   float ballAltitude = std::max(bpose.pos.z - this->ballRadius, 0.0);
   
@@ -367,14 +543,14 @@ void SensorVision::DetectBall(){
   float groundDistance = (this->height * distance) / ( this->height - ballAltitude );
   ballRelPosition.pos *= (groundDistance / distance) ;
   
-  // noisy or not...
-  if (this->noisyBall)
-      this->NoisyPosition(ballRelPosition.pos);
-
   // Update vision info -- Ball section
   this->visionInfo.ball[0].position.x = ballRelPosition.pos.x;
   this->visionInfo.ball[0].position.y = ballRelPosition.pos.y;
-  this->visionInfo.nBalls = 1;
+  this->visionInfo.nBalls = this->DropPoints( &this->visionInfo.ball[0].position, 1, NOISE_BALL_DROP );
+
+  // noisy or not...
+  if (this->noisyBall)
+      this->AddNoise( &this->visionInfo.ball[0].position, this->visionInfo.nBalls, NOISE_BALL, 1.0 );
 
 /*  std::cout << "BALL " << Simulator::Instance()->GetSimTime().Double()
             << " "     << (ballRelPosition + ppose).pos
@@ -386,40 +562,29 @@ void SensorVision::DetectBall(){
 // Detect white points
 void SensorVision::DetectWhite(){
 
-  unsigned int i;
-  int k;
-        
-  // Resolve White Points...
-  float angle;
-  float angleStep;
-  unsigned int   totalWhite;
-  std::vector<csim::Point> allWhite;
+  unsigned int i, r, n;
+  unsigned int totalWhite;
   
   // Parent pose
-  Pose3d ppose = this->body->GetAbsPose();
+  Pose3d ppose = this->selfPose;
   ppose.pos.z = 0;
 
   csim::Point robotPosition( ppose.pos.x , ppose.pos.y);
   
-  // Radial sensors 
+  // Radial sensors, each one only tested against the segments it may cross
+  this->field->CullFan( robotPosition, this->whiteFan );
+
   totalWhite = 0;
-  angleStep = M_PI / (float) this->radialSensors;
-  
-  for ( k = 0; k < this->radialPasses ; k++ )
-  for ( angle = k*angleStep ; angle < (M_PI - angleStep*0.5) ; angle += angleStep*this->radialPasses ){
+  for ( r = 0; r < this->whiteFan.Size() && totalWhite < this->maxWhitePoints; r++ ){
 
-    csim::Point prot( std::cos(angle), std::sin(angle) );
-    csim::Ray ray( robotPosition, robotPosition + prot );
-    std::vector<csim::Point> white = this->field->Intersect( ray );
+    csim::Ray ray( robotPosition, robotPosition + this->whiteFan.directions[r] );
+    n = this->field->Intersect( ray, &this->whiteHits[0], this->whiteHits.size(), &this->whiteFan.candidates[r] );
     
     // Check for occlusion and max distance
-    std::vector<csim::Point>::iterator it = white.begin();
-    for( ; it != white.end(); it++ ){
+    for( i = 0; i < n && totalWhite < this->maxWhitePoints; i++ ){
       
-      Vector3 pos = Vector3( (*it).x, (*it).y, 0.0 );
-      //Vector3 rel = pos - Vector3( robotPosition.x, robotPosition.y, 0 );
       // Calculate points relative to robot position..
-      Pose3d white( pos, Quatern() );
+      Pose3d white( Vector3( this->whiteHits[i].x, this->whiteHits[i].y, 0.0 ), Quatern() );
       Pose3d relPosition = white - ppose;
 
       if( relPosition.pos.GetLength() >= 12.0 )
@@ -427,32 +592,17 @@ void SensorVision::DetectWhite(){
 
       if ( this->OnOcclusionArea( relPosition.pos )  )
         continue; // White point is not visible
-      
-      allWhite.push_back( *it );
-      totalWhite++;
-      
-      if ( totalWhite == this->maxWhitePoints )
-        break;
+
+      this->visionInfo.lines.point[totalWhite++] = Vec( relPosition.pos.x * 1000, relPosition.pos.y * 1000 );
     }
-    
-    if ( totalWhite == this->maxWhitePoints )
-      break;
 
-  } // for "angle"
+  } // for "r"
   
-  for ( i = 0; i < totalWhite; i++ ){
-    
-    // Calculate points relative to robot position..
-    Pose3d white( Vector3( allWhite[i].x  , allWhite[i].y , 0.0), Quatern() );
-    Pose3d relPosition = white - ppose;
-
-    // noisy or not...
-    if (this->noisyWhite)
-        this->NoisyPosition(relPosition.pos, true);
+  // noisy or not, all the points at once
+  totalWhite = this->DropPoints( this->visionInfo.lines.point, totalWhite, NOISE_WHITE_DROP );
+  if (this->noisyWhite)
+      this->AddNoise( this->visionInfo.lines.point, totalWhite, NOISE_WHITE, 1000.0 );
 
-    this->visionInfo.lines.point[i] = Vec( relPosition.pos.x * 1000, relPosition.pos.y * 1000 );
-  }
-  
   this->visionInfo.lines.nPoints = totalWhite;
 }
 
@@ -460,21 +610,21 @@ void SensorVision::DetectWhite(){
 // Detect obstacles - new algorithm
 void SensorVision::DetectObstacle(void){
 
-  std::list<Vec> black;
+  std::vector<Vec> black;
   float angleStep = DTOR( 1.5 );
 
   // Parent pose
-  Pose3d ppose = this->body->GetAbsPose();
+  Pose3d ppose = this->selfPose;
   ppose.pos.z = 0;
 
-  std::vector<Body*>::iterator oit = this->obstacleList.begin();
-  for( ; oit != this->obstacleList.end(); oit++){
+  std::vector<ObstacleState>::iterator oit = this->obstacles.begin();
+  for( ; oit != this->obstacles.end(); oit++){
 
     Vector3 aabb_min, aabb_max;
     Pose3d opose; // Obstacle pose
     Pose3d rpose; // Relative pose
 
-    opose = (*oit)->GetAbsPose();
+    opose = (*oit).pose;
     opose.pos.z = 0; // ground level ...
     // Get the relative position
     rpose = opose - ppose;
@@ -484,7 +634,8 @@ void SensorVision::DetectObstacle(void){
     // assume that every obstacle has the shape of a cylinder,
     // therefore i can use the axis-align bounding box to obtain
     // the obstacle radius.
-    (*oit)->GetBoundingBox( aabb_min, aabb_max );
+    aabb_min = (*oit).aabbMin;
+    aabb_max = (*oit).aabbMax;
     radius = (aabb_max.x - aabb_min.x) * 0.5;
     radius = (aabb_max.y - aabb_min.y) * 0.5 > radius ?
              (aabb_max.y - aabb_min.y) * 0.5 : radius;
@@ -525,32 +676,25 @@ void SensorVision::DetectObstacle(void){
             maybeBlack = ip[1];
 
         Vector3 pos = Vector3( maybeBlack.x, maybeBlack.y, 0.0 );
-        if (! this->OnOcclusionArea( pos )  ){
-            if(this->noisyObstacles){
-                this->NoisyPosition(pos);
-                maybeBlack.x = pos.x;
-                maybeBlack.y = pos.y;
-            }
-
+        if (! this->OnOcclusionArea( pos )  )
             black.push_back( maybeBlack );
-        }
 
       } // end if ( ip.size() == 1 )
     } // end for
 
   }// end for all obstacles
 
-  black.sort( comparePosByAngle );
+  unsigned int n = std::min( black.size(), (size_t) MAX_POINTS );
+  std::copy( black.begin(), black.begin() + n, this->visionInfo.obstacles.point );
 
-  unsigned int i = 0;
-  std::list<Vec>::iterator it;
+  // noisy or not, before sorting as the vision does
+  n = this->DropPoints( this->visionInfo.obstacles.point, n, NOISE_OBSTACLE_DROP );
+  if (this->noisyObstacles)
+    this->AddNoise( this->visionInfo.obstacles.point, n, NOISE_OBSTACLE, 1.0 );
 
-  for ( it = black.begin() ; it != black.end(); it++ ){
-    this->visionInfo.obstacles.point[i] = (*it);
-    i++;
-  }
+  std::stable_sort( this->visionInfo.obstacles.point, this->visionInfo.obstacles.point + n, comparePosByAngle );
 
-  this->visionInfo.obstacles.nPoints = i;
+  this->visionInfo.obstacles.nPoints = n;
 
 }
 
@@ -587,86 +731,114 @@ void SensorVision::FillObstacleList(){
 bool SensorVision::OnOcclusionArea(Vector3 position){
  
   // Check for occlusion
-  //float partial = 1.0;
   float distance = Vector3( position.x, position.y, 0.0).GetLength();
   float height   = position.z;
   
-  std::vector<OcclusionArea>::iterator it = this->occlusion.begin();
-  for ( ; it != this->occlusion.end(); it++ ){
-  
-    if ( distance < (*it).distance )
-      continue; // The ball is between the robot and the obstacle.
-    
-    if ( height > (*it).height )
-      continue; // the ball is above the obstacle, so it is visible
-    
-    cambada::geom::Angle angle;
+  if ( this->occlusionSpans.empty() )
+    return false;
 
-    cambada::geom::Angle a;
-    cambada::geom::Angle b;
+  cambada::geom::Angle angle;
+  angle.set_rad( std::atan2( position.x, position.y ) );
 
-    angle.set_rad( std::atan2( position.x, position.y ) );
-    a.set_rad( (*it).angles.first  );
-    b.set_rad( (*it).angles.second );
+  // Spans starting at or before the angle, back to the first one that
+  // can't reach it
+  OcclusionSpan key;
+  key.start = angle.get_rad();
+  std::vector<OcclusionSpan>::iterator it = std::upper_bound( this->occlusionSpans.begin(), this->occlusionSpans.end(), key );
+  while ( it != this->occlusionSpans.begin() ){
+    --it;
+    if ( (*it).reach < key.start )
+      break;
 
-    if ( angle.in_between( a, b ) ){
-        return true;
-    }
+    if ( (*it).end < key.start )
+      continue; // doesn't reach the angle
 
-//    float angle = std::atan2( position.x, position.y ) ;
-//    float a = (*it).angles.first;
-//    float b = (*it).angles.second;
-//    if ( b >= a ){
-//      // a <= angle <= b
-//      if ( ( a <= angle ) && ( angle <= b ) ){
-//          std::cout << "OCLUDED a " <<  (*it).distance << " a1 " << a << " a2 " << b << std::endl;
-//        return true;
-//      } // end if ( a <= angle <= b )
+    if ( distance < (*it).distance )
+      continue; // The point is between the robot and the obstacle.
     
-//    }else{
-//      //  a <= angle OR angle <= b
-//      if ( ( a <= angle ) || ( angle <= b ) ){
-//          std::cout << "OCLUDED b " <<  (*it).distance << " a1 " << a << " a2 " << b << std::endl;
-//        return true;
-//      } // end if ( a <= angle OR angle <= b )
-//    }
-  
-//    // Side partials...
+    if ( height > (*it).height )
+      continue; // the point is above the obstacle, so it is visible
+
+    return true;
   }
-  
-  return false;
 
+  return false;
 }
 
-void SensorVision::NoisyPosition(Vector3 &pos, bool noTheta){
+//////////////////////////////////////////////////////////////////////////////
+// Add the measurement noise to an array of points (robot relative, meters
+// times scale). The loop has no calls but sqrt/sin/cos and no dependence
+// between points, the compiler vectorizes it.
+void SensorVision::AddNoise( Vec* points, unsigned int n, unsigned int batch, double scale ){
 
     // X polyfit 0.0017563   0.0100797   0.0141694
     // Y polyfit 0.0084655  -0.0203064   0.0244877
 
-    Vec helper;
-    double var, rho, theta;
-    double distance;
+    if ( n == 0 )
+      return;
 
-    helper.x = pos.x; helper.y = pos.y;
-    distance = helper.length();
+    // Distance and angle noise of each point
+    this->noiseDraws.resize( 2*n );
+    this->noise.GetDblNormal( this->noiseStep, batch, &this->noiseDraws[0], 2*n );
 
-    // 0.0082489  -0.0033775   0.007199
-    var = 0.0082489*distance*distance - 0.0033775*distance +   0.007199;
-    rho = distance + Rand::GetDblNormal( 0.0, var );
+    const double* draw = &this->noiseDraws[0];
+    const double* rs = this->rhoSigma;
+    const double* ts = this->thetaSigma;
 
-    var   = (6.5933e-04)*distance*distance - (5.3490e-03)*distance + 2.4949e-02;
-    theta = std::atan2( pos.y, pos.x ) +  Rand::GetDblNormal( 0.0, var);
+    for ( unsigned int i = 0; i < n; i++ ){
+      double x = points[i].x / scale;
+      double y = points[i].y / scale;
+      double distance = std::sqrt( x*x + y*y );
 
-    pos.x = rho * std::cos( theta );
-    pos.y = rho * std::sin( theta );
+      double rho   = distance + ( rs[0]*distance*distance + rs[1]*distance + rs[2] ) * draw[2*i];
+      double theta = ( ts[0]*distance*distance + ts[1]*distance + ts[2] ) * draw[2*i + 1];
 
-//    double dX = helper.x; double dY = helper.y;
-//    double XSigma = dX * dX * 0.0017563 + dX *  0.0100797 + 0.0141694;
-//    double YSigma = dY * dY * 0.0084655 + dY * -0.0203064 + 0.0244877;
+      // Stretch to rho and rotate by theta, no atan2 needed
+      double k = distance > 0.0 ? scale * rho / distance : 0.0;
+      double c = k * std::cos( theta );
+      double s = k * std::sin( theta );
 
-//    if ( noTheta == true ){
-//        pos.x += Rand::GetDblNormal( 0.0, XSigma);
-//        pos.y += Rand::GetDblNormal( 0.0, YSigma);
-//    }
+      points[i].x = x*c - y*s;
+      points[i].y = x*s + y*c;
+    }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// False negatives: drop points of an array, returns how many are kept
+unsigned int SensorVision::DropPoints( Vec* points, unsigned int n, unsigned int batch ){
+
+    if ( this->falseNegative <= 0.0 || n == 0 )
+      return n;
+
+    this->noiseDraws.resize( n );
+    this->noise.GetDblUniform( this->noiseStep, batch, &this->noiseDraws[0], n );
+
+    unsigned int kept = 0;
+    for ( unsigned int i = 0; i < n; i++ )
+      if ( this->noiseDraws[i] >= this->falseNegative )
+        points[kept++] = points[i];
+
+    return kept;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Missed frame and false positives: a ghost ball when none is seen and a
+// ghost white point, anywhere in sight
+void SensorVision::FrameNoise(){
+
+    double draw[7];
+    this->noise.GetDblUniform( this->noiseStep, NOISE_FRAME, draw, 7 );
+
+    this->frameMissed = draw[0] < this->missedFrame;
+
+    if ( this->visionInfo.nBalls == 0 && draw[1] < this->falsePositive ){
+      float r = this->seeDistance * std::sqrt( draw[2] );
+      this->visionInfo.ball[0].position = Vec( r * std::cos( 2*M_PI*draw[3] ), r * std::sin( 2*M_PI*draw[3] ) );
+      this->visionInfo.nBalls = 1;
+    }
+
+    if ( draw[4] < this->falsePositive && (unsigned int) this->visionInfo.lines.nPoints < this->maxWhitePoints ){
+      float r = this->seeDistance * std::sqrt( draw[5] ) * 1000;
+      this->visionInfo.lines.point[this->visionInfo.lines.nPoints++] = Vec( r * std::cos( 2*M_PI*draw[6] ), r * std::sin( 2*M_PI*draw[6] ) );
+    }
+}
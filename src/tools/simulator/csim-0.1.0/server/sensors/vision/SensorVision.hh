@@ -32,10 +32,12 @@
 #include <vector>
 #include <deque>
 #include <utility>
+#include <boost/signal.hpp>
 
 #include "Body.hh"
 #include "Sensor.hh"
 #include "Field.hh"
+#include "Rand.hh"
 
 // CAMBADA include
 #include "VisionInfo.h"
@@ -55,6 +57,25 @@ namespace gazebo
     BetweenAngles angles;   // pair of angles that confines the occlusion area
 
   };
+
+  // Occlusion area as a plain angle interval, kept sorted by start to
+  // find the areas of a direction with a binary search
+  struct OcclusionSpan {
+    double start;           // interval start, in [0, 2pi)
+    double end;             // interval end, start <= end <= 2pi
+    double reach;           // largest end of this span and the ones before it
+    float  distance;
+    float  height;
+
+    bool operator<( const OcclusionSpan& other ) const { return start < other.start; }
+  };
+
+  // Obstacle state saved before the (parallel) vision update
+  struct ObstacleState {
+    Pose3d  pose;
+    Vector3 aabbMin;
+    Vector3 aabbMax;
+  };
   
 /// \addtogroup gazebo_sensor
 /// \brief Stubbed out sensor
@@ -81,9 +102,18 @@ class SensorVision : public Sensor
   /// \brief Initialize the camera
   protected: virtual void InitChild();
 
+  /// \brief Vision runs in parallel with the other robots
+  protected: virtual bool IsParallel() const;
+
+  /// \brief Save the robot, ball and obstacle poses
+  protected: virtual void PrepareChild();
+
   /// \brief Update the sensor information
   protected: virtual void UpdateChild();
 
+  /// \brief Send the vision to the RTDB and tick the agent
+  protected: virtual void PublishChild();
+
   /// Finalize the camera
   protected: virtual void FiniChild();
 
@@ -96,8 +126,12 @@ class SensorVision : public Sensor
     void DetectObstacle();
     
     void FillObstacleList();
+    void WaitAgent();
+    void WaitAgentAttach();
     bool OnOcclusionArea(Vector3 position);
-    void NoisyPosition(Vector3& pos, bool noTheta = false);
+    void AddNoise(Vec* points, unsigned int n, unsigned int batch, double scale);
+    unsigned int DropPoints(Vec* points, unsigned int n, unsigned int batch);
+    void FrameNoise();
     
     int cycleDelay;
     float seeDistance;
@@ -106,9 +140,24 @@ class SensorVision : public Sensor
     bool noisyWhite;
     bool noisyBall;
     bool noisyObstacles;
+
+    // Noise model, the draws are keyed by the run seed and the robot and
+    // counted by vision update, so they don't depend on the update order
+    CounterRand noise;
+    int noiseSeed;            // -1 for the seed of the run
+    unsigned int noiseStep;
+    double rhoSigma[3];       // sigma of the distance: [0]*d^2 + [1]*d + [2]
+    double thetaSigma[3];     // sigma of the angle
+    double falsePositive;     // probability of a ghost ball / white point per frame
+    double falseNegative;     // probability of missing the ball or a point
+    double missedFrame;       // probability of a frame not sent to the agent
+    bool frameMissed;
+    std::vector<double> noiseDraws;
     
     int radialSensors;  // Number of radial sensors
     int radialPasses;   // Number of passes.
+    csim::LineFan whiteFan;               // radial sensor lines
+    std::vector<csim::Point> whiteHits;   // field intersections of one line
     unsigned int maxWhitePoints;
     // Robot ID
     int selfID;
@@ -122,15 +171,31 @@ class SensorVision : public Sensor
     csim::Field* field;
     // Keep a list of all obstacles
     std::vector<Body*> obstacleList;
+    // World state used by the update (see PrepareChild)
+    Pose3d selfPose;
+    Pose3d ballPose;
+    std::vector<ObstacleState> obstacles;
     // Occlusion area using "in between angles"
     std::vector< OcclusionArea > occlusion;
+    std::vector< OcclusionSpan > occlusionSpans;
     
     // Omni vision Update queue
     std::deque<VisionInfo> *omniQueue;
     
     // PMAN config file
     std::string PMANConfigFile;
+    bool PMANQoS;
     bool fPMAN;
+    // PMAN trace file prefix and writer
+    std::string PMANTraceFile;
+    int PMANTraceWriter;
+    // Lock step: agent ticked in this step, wait timeout and step end slot
+    bool pmanTicked;
+    double PMANWaitTimeout;
+    // Lock step: agent attached to PMAN and how long to wait for it
+    bool agentAttached;
+    double PMANAttachTimeout;
+    boost::signals::connection stepEndConnection;
 };
 
 /// \}
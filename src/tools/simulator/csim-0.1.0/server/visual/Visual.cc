@@ -64,15 +64,18 @@ void VisualApp::ProcessEvents( ){
   if ( this->enabled == false)
     return;
     
-  // maybe try try_lock here instead
-  boost::recursive_mutex::scoped_lock lock(
-        *Simulator::Instance()->GetMRMutex());
-
-  if ( this->QTapp->hasPendingEvents() )
+  // Events (drags, keys) change the world: the mutex is only taken when
+  // there are some
+  if ( this->QTapp->hasPendingEvents() ){
+    boost::recursive_mutex::scoped_lock lock(
+          *Simulator::Instance()->GetMRMutex());
     this->QTapp->processEvents();
+  }
     
-  // Render
-  this->mw->updateVisual();
+  // Render the newest frame published by the physics thread, without
+  // the mutex; nothing to do if there is none
+  if ( World::Instance()->GetVisualSnapshot()->HasNewFrame() )
+    this->mw->updateVisual();
   
 }
 
@@ -26,6 +26,7 @@ namespace visual {
     bool UserQuit();
     
     Body* GetBall(){ return this->ball; };
+    const std::string& GetBallModelName(){ return this->ballModelName; };
    
   private:
 
@@ -41,6 +41,7 @@
 #include "RenderWidget.hh"
 #include "internal.h"
 #include "Visual.hh"
+#include "VisualSnapshot.hh"
 
 #include <ode/ode.h>
 
@@ -94,6 +95,10 @@ RenderWidget::RenderWidget(QWidget* parent) : QGLWidget(parent)
   this->speedMode   = false;
   
   this->lastTimer = 0;
+
+  this->snapshot  = World::Instance()->GetVisualSnapshot();
+  this->frame     = NULL;
+  this->fieldList = 0;
   
   setFocusPolicy(Qt::StrongFocus);
 }
@@ -109,88 +114,51 @@ void RenderWidget::paintGL()
 {
   makeCurrent();
 
+  // Newest frame published by the physics thread, the live world isn't
+  // touched (nor locked) while drawing
+  this->frame = this->snapshot->Read();
+
   //draw scene here
   dsDrawFrame( this->w, this->h );
   HandleView();
-  
-  std::vector<Model*> models = World::Instance()->GetModels();
-  std::vector<Model*>::const_iterator m_iter = models.begin();
-  
-  const std::map< std::string, Body* > *bodies;
-  const std::map<std::string, Geom*> *geoms;
-  Model* m     = NULL;
-  Geom* geom   = NULL;
-  Shape* shape = NULL;
-  
-  dReal p[3];
+
+  unsigned int ngeoms = ( this->frame ) ? this->frame->geoms.size() : 0;
+
   dReal r[12];
   dReal q[4];
   
-  for ( ; m_iter != models.end(); m_iter++ ){
+  for ( unsigned int i = 0; i < ngeoms; i++ ){
     
-    m = *m_iter;
-    if ( m->GetType().compare("empty") == 0 ) continue;
+    const GeomVisual& visual = this->frame->geoms[i];
+    const VisualPose& pose   = this->frame->geomPoses[i];
     
-    // Find all Bodies
-    bodies = m->GetBodies();
-    std::map< std::string, Body* >::const_iterator b_iter = bodies->begin();
+    dsSetColor( visual.color[0], visual.color[1], visual.color[2] );
     
-    for ( ; b_iter != bodies->end(); b_iter++ ){
-      geoms = b_iter->second->GetGeoms();
-      std::map<std::string, Geom*>::const_iterator g_iter = geoms->begin();
-      
-      for ( ; g_iter != geoms->end(); g_iter++ ){
-        geom = g_iter->second;
-        
-        Vector3 rgb = geom->GetPigment();
-        dsSetColor( rgb.x, rgb.y, rgb.z );
-        
-        shape= geom->GetShape();
-        // Body Pose
-        Pose3d pose = geom->GetAbsPose();
-        
-        p[0] = pose.pos.x;
-        p[1] = pose.pos.y;
-        p[2] = pose.pos.z;
-        
-        q[0] = pose.rot.u;
-        q[1] = pose.rot.x;
-        q[2] = pose.rot.y;
-        q[3] = pose.rot.z;
-        
-        dQtoR( q, r );
+    q[0] = pose.rot[0];
+    q[1] = pose.rot[1];
+    q[2] = pose.rot[2];
+    q[3] = pose.rot[3];
+    
+    dQtoR( q, r );
+    
+    switch ( visual.shape ){
+      case Shape::SPHERE:
+        dsDrawSphere( pose.pos, r , visual.size[0]);
+        break;
         
-        switch ( shape->GetType() ){
-          case Shape::SPHERE:
-            dsDrawSphere( p, r , ((SphereShape*)shape)->GetSize());
-            break;
-            
-          case Shape::CYLINDER:
-          {
-            //cylinder dimension
-            Vector2<double>  cyldim = ((CylinderShape*)shape)->GetSize();
-            dsDrawCylinder( p, r, cyldim.y, cyldim.x );
-          }
-            break;
-            
-          case Shape::BOX:
-          {
-            float s[3];
-            Vector3 v = ((BoxShape*)shape)->GetSize();
-            s[0] = v.x; s[1] = v.y; s[2] = v.z;
-            dsDrawBox( p, r, s);
-          }
-            break;
-          
-          default:
-            break;
-        }// end Switch geom
+      case Shape::CYLINDER:
+        dsDrawCylinder( pose.pos, r, visual.size[1], visual.size[0] );
+        break;
         
-      } // end for geom..
+      case Shape::BOX:
+        dsDrawBox( pose.pos, r, visual.size );
+        break;
       
-    } // end for bodies
+      default:
+        break;
+    }// end Switch geom
     
-  } // end for models 
+  } // end for geoms
   
   //dsSetColor (1, 1, 1);
 
@@ -609,16 +577,18 @@ void RenderWidget::HandleView(){
         dReal dpos[3];
         dReal dlook[4];
         
+        if ( this->frame == NULL ) return;
+
         std::stringstream ss;
         ss << "robbie_" << this->watchThisRobot;
-        Model* m = World::Instance()->GetModelByName( ss.str() );
-        if ( m == NULL ){
+        const VisualPose* vp = this->frame->GetModelPose( ss.str() );
+        if ( vp == NULL ){
             // default to ball
-            m = VisualApp::Instance()->GetBall()->GetParentModel() ;
+            vp = this->frame->GetModelPose( VisualApp::Instance()->GetBallModelName() );
         }
+        if ( vp == NULL ) return;
 
-        Body* body = m->GetCanonicalBody();
-        Pose3d bpose = body->GetAbsPose();
+        Pose3d bpose = this->ToPose( *vp );
         
         double rotation = bpose.rot.GetYaw();
 
@@ -651,11 +621,13 @@ void RenderWidget::HandleView(){
   case RenderWidget::kBallView:
   { 
     // Ball position
-    Body* ball = VisualApp::Instance()->GetBall();
+    const VisualPose* ball = NULL;
+    if ( this->frame != NULL )
+      ball = this->frame->GetModelPose( VisualApp::Instance()->GetBallModelName() );
     if ( ball != NULL ){
       dReal dpos[3];
       dReal dlook[4];
-      Pose3d bpose = ball->GetAbsPose();
+      Pose3d bpose = this->ToPose( *ball );
       
       dpos[0] = bpose.pos.x;
       dpos[1] = bpose.pos.y;
@@ -708,11 +680,15 @@ void RenderWidget::DrawField(){
     // not quite on the ground
   a[2] = b[2] = lh;
   
+  // Selected model, from the frame being drawn
+  const VisualPose* mpos = NULL;
+  if ( (this->selectedModel) && (this->frame) )
+    mpos = this->frame->GetModelPose( this->selectedModel->GetName() );
+
     // should this been done here ???
-  if ( (this->dragMode == true) && (this->selectedModel) ){
+  if ( (this->dragMode == true) && (mpos) ){
 
-    Pose3d mpos = this->selectedModel->GetAbsPose();
-    a[0] = mpos.pos.x; a[1] = mpos.pos.y;
+    a[0] = mpos->pos[0]; a[1] = mpos->pos[1];
     b[0] = this->fx; b[1] = this->fy; 
     
     dsSetColor (1, 0, 0);
@@ -720,9 +696,8 @@ void RenderWidget::DrawField(){
   }
   
     // should this been done here ???
-  if ( (this->rotateMode == true) && (this->selectedModel) ){
-    Pose3d mpos  = this->selectedModel->GetAbsPose();
-    a[0] = mpos.pos.x; a[1] = mpos.pos.y; // Model center
+  if ( (this->rotateMode == true) && (mpos) ){
+    a[0] = mpos->pos[0]; a[1] = mpos->pos[1]; // Model center
     b[0] = this->fx;
     b[1] = this->fy;    
     dsSetColor (1, 1, 0);
@@ -730,32 +705,36 @@ void RenderWidget::DrawField(){
   }
   
       // should this been done here ???
-  if ( (this->speedMode == true) && (this->selectedModel) ){
-    Pose3d mpos  = this->selectedModel->GetAbsPose();
-    a[0] = mpos.pos.x; a[1] = mpos.pos.y; // Model center
+  if ( (this->speedMode == true) && (mpos) ){
+    a[0] = mpos->pos[0]; a[1] = mpos->pos[1]; // Model center
     b[0] = this->fx;
     b[1] = this->fy;    
     dsSetColor (0, 1, 1);
     dsDrawLine(a, b);
   }
   
-  // White lines
-  dsSetColor (1, 1, 1);
+  // White lines, static: recorded once in a display list
+  if ( this->fieldList == 0 ){
+    this->fieldList = glGenLists(1);
+    glNewList( this->fieldList, GL_COMPILE_AND_EXECUTE );
 
-  std::vector<csim::LineSegment>::iterator iter = this->field->GetSegments()->begin();
-  
+    dsSetColor (1, 1, 1);
 
-  
-  for ( ; iter != this->field->GetSegments()->end(); ++iter )
-  {
-    a[0] = (*iter).pointA.x; a[1] = (*iter).pointA.y;
-    b[0] = (*iter).pointB.x; b[1] = (*iter).pointB.y;
-    
-    dsDrawLine(a, b);
+    std::vector<csim::LineSegment>::iterator iter = this->field->GetSegments()->begin();
+
+    for ( ; iter != this->field->GetSegments()->end(); ++iter )
+    {
+      a[0] = (*iter).pointA.x; a[1] = (*iter).pointA.y;
+      b[0] = (*iter).pointB.x; b[1] = (*iter).pointB.y;
+
+      dsDrawLine(a, b);
+    }
+
+    glEndList();
+  } else {
+    glCallList( this->fieldList );
   }
-  
 
-  
   return;
 }
 
@@ -793,6 +772,14 @@ void RenderWidget::drawInstructions(QPainter *painter, const QString& text)
                        Qt::AlignLeft | Qt::TextWordWrap, text);
  }
 
+Pose3d RenderWidget::ToPose(const VisualPose& vp)
+{
+  Pose3d pose;
+  pose.pos.Set( vp.pos[0], vp.pos[1], vp.pos[2] );
+  pose.rot.Set( vp.rot[0], vp.rot[1], vp.rot[2], vp.rot[3] );
+  return pose;
+}
+
 bool RenderWidget::prefix(const char *pre, const char *str)
 {
     return strncmp(pre, str, strlen(pre)) == 0;
@@ -11,6 +11,10 @@
 
 namespace gazebo {
   class Model;
+  class Pose3d;
+  class VisualSnapshot;
+  struct VisualFrame;
+  struct VisualPose;
 }
 
 
@@ -49,6 +53,7 @@ private:
     void HandleView();
     void drawInstructions(QPainter *painter, const QString& text);
     bool prefix(const char *pre, const char *str);
+    gazebo::Pose3d ToPose(const gazebo::VisualPose& vp);
 
     csim::Field* field;
     gazebo::Model* selectedModel;
@@ -82,6 +87,12 @@ private:
     float camsmooth[3];
     float camlooksmooth[3];
 
+    // Frames published by the physics thread, the one being drawn and
+    // the display list of the field lines
+    gazebo::VisualSnapshot* snapshot;
+    const gazebo::VisualFrame* frame;
+    GLuint fieldList;
+
 };
 
 #endif // GLWIDGET_H
@@ -58,6 +58,7 @@ manage openGL state changes better
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <map>
 #include "drawstuff.h"
 #include "internal.h"
 
@@ -815,6 +816,55 @@ static void drawCylinder (float l, float r, float zoffset)
   glEnd();
 }
 
+// boxes and cylinders are drawn from display lists, compiled the first time
+// a shape of a given size and color is drawn (the models don't change
+// shape, so there are only a few of them)
+
+enum { LIST_BOX, LIST_CYLINDER };
+
+struct ShapeListKey {
+  int type;
+  float size[3];
+  float color[4];
+
+  bool operator< (const ShapeListKey &k) const
+  {
+    if (type != k.type) return type < k.type;
+    int c = memcmp (size,k.size,sizeof(size));
+    if (c) return c < 0;
+    return memcmp (color,k.color,sizeof(color)) < 0;
+  }
+};
+
+static std::map<ShapeListKey,GLuint> shape_lists;
+
+static void drawShapeList (int type, float a, float b, float c)
+{
+  ShapeListKey key;
+  key.type = type;
+  key.size[0] = a;
+  key.size[1] = b;
+  key.size[2] = c;
+  memcpy (key.color,color,sizeof(color));
+
+  std::map<ShapeListKey,GLuint>::iterator it = shape_lists.find (key);
+  if (it != shape_lists.end()) {
+    glCallList (it->second);
+    return;
+  }
+
+  GLuint listnum = glGenLists (1);
+  glNewList (listnum,GL_COMPILE_AND_EXECUTE);
+  if (type == LIST_BOX) {
+    drawBox (key.size);
+  }
+  else {
+    drawCylinder (a,b,c);
+  }
+  glEndList();
+  shape_lists[key] = listnum;
+}
+
 //***************************************************************************
 // motion model
 
@@ -1321,14 +1371,14 @@ extern "C" void dsDrawBox (const float pos[3], const float R[12],
   setupDrawingMode();
   glShadeModel (GL_FLAT);
   setTransform (pos,R);
-  drawBox (sides);
+  drawShapeList (LIST_BOX,sides[0],sides[1],sides[2]);
   glPopMatrix();
 
   if (use_shadows) {
     setShadowDrawingMode();
     setShadowTransform();
     setTransform (pos,R);
-    drawBox (sides);
+    drawShapeList (LIST_BOX,sides[0],sides[1],sides[2]);
     glPopMatrix();
     glPopMatrix();
     glDepthRange (0,1);
@@ -1415,14 +1465,14 @@ extern "C" void dsDrawCylinder (const float pos[3], const float R[12],
   setupDrawingMode();
   glShadeModel (GL_SMOOTH);
   setTransform (pos,R);
-  drawCylinder (length,radius,0);
+  drawShapeList (LIST_CYLINDER,length,radius,0);
   glPopMatrix();
 
   if (use_shadows) {
     setShadowDrawingMode();
     setShadowTransform();
     setTransform (pos,R);
-    drawCylinder (length,radius,0);
+    drawShapeList (LIST_CYLINDER,length,radius,0);
     glPopMatrix();
     glPopMatrix();
     glDepthRange (0,1);
@@ -10,11 +10,11 @@ module Genworld
 
   @@conf = nil
 
-  def self.generate yamlconf
+  def self.generate yamlconf, confdir = CAMBADA_CONF
     @@conf = yamlconf
     
-    worldfile = SIM_WORLDS + 'CAMBADA.world'
-    self.load_field if @@conf['field']['getfromCAMBADA']
+    worldfile = confdir + 'worlds' + 'CAMBADA.world'
+    self.load_field confdir if @@conf['field']['getfromCAMBADA']
     template = ERB.new XMLDATA
     simconf = @@conf
     File.open( worldfile.to_s, 'w' ).puts template.result(binding)
@@ -23,7 +23,7 @@ module Genworld
   
   private
   
-  def self.load_field
+  def self.load_field confdir
     require 'rexml/document'
     toCollect = [ "ball_diameter",
                   "center_circle_radius",
@@ -37,7 +37,7 @@ module Genworld
                   "theNorth"]
 
 
-    cambada = CAMBADA_CONF + 'cambada.conf.xml'
+    cambada = confdir + 'cambada.conf.xml'
     xmlFile = File.new( cambada )
     xmlDoc  = REXML::Document.new xmlFile
 
@@ -115,9 +115,14 @@ XMLDATA = <<ENDDATA
     <static>true</static>
     
     <controller:comm name="comm">
-      <updateRate>10</updateRate>
+      <updateRate>0</updateRate>
       <withIFace>false</withIFace>
-    </controller:comm>
+<% comm = simconf['comm'] || {}
+   %w(period frameBudget seed latency jitter distribution loss burstLoss burstEnter burstExit).each do |k|
+     next unless comm.has_key? k %>      <<%= k %>><%= comm[k] %></<%= k %>>
+<% end
+   (comm['links'] || []).each do |l| %>      <link <%= l.map { |k, v| k.to_s + '=' + v.to_s.inspect }.join(' ') %>/>
+<% end %>    </controller:comm>
   </model:empty>
 
   <model:physical name="plane1_model">
@@ -8,7 +8,8 @@ require 'ctty'
 
 # this is like ./../../../
 CAMBADA_PREFIX= Pathname.new(__FILE__).realpath.dirname.parent.parent.parent.parent.parent
-CAMBADA_CONF= CAMBADA_PREFIX + 'config'
+# the configuration tree may be given as argument (csim_batch runs)
+CAMBADA_CONF= ARGV[0] ? Pathname.new(ARGV[0]).realpath : CAMBADA_PREFIX + 'config'
 SIM_WORLDS= CAMBADA_CONF + 'worlds'
 
 require 'fileutils.rb'
@@ -38,7 +39,7 @@ def generate
     say "Generating CAMBADA.world"
     yamlconf = YAML.load_file yamlfile.to_s
     require 'gen_world'
-    Genworld.generate yamlconf
+    Genworld.generate yamlconf, CAMBADA_CONF
   end
 
 end
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA UTILITIES
+ *
+ * CAMBADA UTILITIES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA UTILITIES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AllocCounter.h"
+#include <stdlib.h>
+#include <new>
+
+// Dynamic exception specifications are gone since C++17
+#if __cplusplus < 201103L
+#define ALLOC_THROW		throw (std::bad_alloc)
+#define ALLOC_NOTHROW	throw ()
+#else
+#define ALLOC_THROW
+#define ALLOC_NOTHROW	noexcept
+#endif
+
+static unsigned long nAllocs = 0;
+
+static void* countedAlloc(size_t size)
+{
+	__sync_fetch_and_add(&nAllocs, 1);
+	void* p = malloc(size ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size) ALLOC_THROW
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size) ALLOC_THROW
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) ALLOC_NOTHROW
+{
+	free(p);
+}
+
+void operator delete[](void* p) ALLOC_NOTHROW
+{
+	free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void* p, std::size_t) ALLOC_NOTHROW
+{
+	free(p);
+}
+
+void operator delete[](void* p, std::size_t) ALLOC_NOTHROW
+{
+	free(p);
+}
+#endif
+
+namespace cambada {
+namespace util {
+
+unsigned long allocCount()
+{
+	return nAllocs;
+}
+
+}
+} /* namespace cambada */
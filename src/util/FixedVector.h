@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA UTILITIES
+ *
+ * CAMBADA UTILITIES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA UTILITIES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIXEDVECTOR_H_
+#define FIXEDVECTOR_H_
+
+#include <assert.h>
+
+namespace cambada {
+namespace util {
+
+/**
+ * \brief Vector with a compile time capacity and inline storage
+ *
+ * Subset of the std::vector interface for per-cycle data with a known bound
+ * (robots, balls, vision points), so it never touches the heap. Elements
+ * beyond the capacity are dropped (push_back returns false).
+ */
+template<typename T, unsigned int N>
+class FixedVector {
+public:
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	FixedVector() : n(0) {}
+
+	bool push_back(const T& v)
+	{
+		if (n >= N)
+			return false;
+		items[n++] = v;
+		return true;
+	}
+
+	void pop_back() { assert(n > 0); n--; }
+
+	iterator erase(iterator it)
+	{
+		assert(it >= begin() && it < end());
+		for (iterator i = it; i + 1 < end(); i++)
+			*i = *(i + 1);
+		n--;
+		return it;
+	}
+
+	void clear() { n = 0; }
+	unsigned int size() const { return n; }
+	static unsigned int capacity() { return N; }
+	bool empty() const { return n == 0; }
+	bool full() const { return n == N; }
+
+	T& operator[](unsigned int i) { return items[i]; }
+	const T& operator[](unsigned int i) const { return items[i]; }
+	T& at(unsigned int i) { assert(i < n); return items[i]; }
+	const T& at(unsigned int i) const { assert(i < n); return items[i]; }
+	T& front() { return at(0); }
+	T& back() { return at(n - 1); }
+
+	iterator begin() { return items; }
+	iterator end() { return items + n; }
+	const_iterator begin() const { return items; }
+	const_iterator end() const { return items + n; }
+	T* data() { return items; }
+
+private:
+	T items[N];
+	unsigned int n;
+};
+
+}
+} /* namespace cambada */
+#endif /* FIXEDVECTOR_H_ */
@@ -30,10 +30,12 @@ namespace util {
 HeightMap::HeightMap() {
 	map = new TCODHeightMap(SAMPLE_SCREEN_WIDTH,SAMPLE_SCREEN_LENGTH);
 	map->clear();
+	gridEncoder = NULL;
 }
 
 HeightMap::~HeightMap() {
 	delete map;
+	delete gridEncoder;
 }
 
 void HeightMap::calculate()
@@ -76,23 +78,23 @@ float HeightMap::world2grid(float val)
 
 void HeightMap::fillRtdb()
 {
-	if(Whoami() == 0)
-	{
-		GridView gv;
-		int count= 0;
-
-		for (int x=0; x < SAMPLE_SCREEN_WIDTH; x++ ) {
-			for (int y=0; y < SAMPLE_SCREEN_LENGTH; y++ ) {
-				gv.grid[count].pos = grid2world(x, y);
-				//fprintf(stderr, "FILL x %.2f %.2f\n", gv.grid[count].pos.x, gv.grid[count].pos.y);
-				gv.grid[count].val = map->getValue(x, y);
-				count++;
-			}
-		}
+	if(gridEncoder == NULL)
+		gridEncoder = new GridViewEncoder();
 
-		gv.count = count;
-		DB_put(GRIDVIEW, (void*)&gv);
+	float values[GRIDVIEW_MAX_CELLS];
+	int count = 0;
+
+	for (int x=0; x < SAMPLE_SCREEN_WIDTH; x++ ) {
+		for (int y=0; y < SAMPLE_SCREEN_LENGTH; y++ ) {
+			values[count++] = map->getValue(x, y);
+		}
 	}
+
+	// positions are implied by the grid geometry, cell (0,0) is at grid2world(0,0)
+	GridView gv;
+	Vec origin = grid2world(0, 0);
+	gridEncoder->encode(values, SAMPLE_SCREEN_WIDTH, SAMPLE_SCREEN_LENGTH, origin.x, origin.y, SCALE, gv);
+	DB_put(GRIDVIEW, (void*)&gv);
 }
 
 void HeightMap::clear() {
@@ -76,6 +76,9 @@ public:
 			const int *dy, const float *weight, float minLevel, float maxLevel);
 
 	TCODHeightMap* map;
+
+private:
+	GridViewEncoder* gridEncoder;	// keeps the key frame of the published GridView
 };
 
 }
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA UTILITIES
+ *
+ * CAMBADA UTILITIES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA UTILITIES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KickModel.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace cambada {
+namespace util {
+
+#define KM_MAGIC		0x4c4b4d43		// "CMKL"
+#define KM_VERSION		2
+
+#define KM_DIST_STEP	0.05			// distance table resolution (m)
+#define KM_DIST_N		401				// 0..20 m
+#define KM_HEIGHT_STEP	0.1				// height table resolution (m)
+#define KM_HEIGHT_N		31				// 0..3 m
+#define KM_SPEED_STEP	0.01			// speed table resolution (m/s)
+#define KM_SPEED_N		2001			// 0..20 m/s
+
+#define KM_BALL_OFFSET	0.27			// robot center -> ball center (m)
+#define KM_GRAVITY		9.8067
+
+struct KickModelFileHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int key;
+	int distN;
+	int heightN;
+	int speedN;
+	double angDeg;
+};
+
+KickModel::KickModel() : valid(false), angDeg(0.0)
+{
+}
+
+float KickModel::ballisticSpeed(float distance, float height) const
+{
+	double teta = (angDeg * M_PI) / 180.0;
+
+	// the ball must pass height meters above the ground at distance
+	double d = distance + height / tan(teta) - KM_BALL_OFFSET;
+	if (d <= 0.0)
+		return 0.0;
+
+	return (float)sqrt(d * KM_GRAVITY / sin(2 * teta));
+}
+
+void KickModel::build(const std::vector<double>& speedTable, int minPower, int powerStep, double angDeg,
+		const std::vector<KickSample>& samples)
+{
+	this->angDeg = angDeg;
+	valid = false;
+	if (speedTable.size() < 2)
+		return;
+
+	speedLut.resize(KM_DIST_N * KM_HEIGHT_N);
+	for (int d = 0; d < KM_DIST_N; d++)
+		for (int h = 0; h < KM_HEIGHT_N; h++)
+			speedLut[d * KM_HEIGHT_N + h] = ballisticSpeed(d * KM_DIST_STEP, h * KM_HEIGHT_STEP);
+
+	// (speed, power) points: measured speed of each power plus the calibration samples
+	std::vector<double> sv, sp;
+	for (unsigned int i = 0; i < speedTable.size(); i++)
+	{
+		sv.push_back(speedTable[i]);
+		sp.push_back(minPower + (int)i * powerStep);
+	}
+	for (unsigned int i = 0; i < samples.size(); i++)
+	{
+		float v = ballisticSpeed(samples[i].distance, samples[i].height);
+		if (v > 0.0)
+		{
+			sv.push_back(v);
+			sp.push_back(samples[i].power);
+		}
+	}
+
+	// least squares quadratic power(speed), only when there are samples to refine the table
+	double coef[3] = { 0.0, 0.0, 0.0 };
+	bool fitted = false;
+	if (samples.size() > 0 && sv.size() >= 3)
+	{
+		double s[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };		// sum of v^k
+		double t[3] = { 0.0, 0.0, 0.0 };				// sum of p*v^k
+		for (unsigned int i = 0; i < sv.size(); i++)
+		{
+			double vk = 1.0;
+			for (int k = 0; k < 5; k++)
+			{
+				s[k] += vk;
+				if (k < 3)
+					t[k] += sp[i] * vk;
+				vk *= sv[i];
+			}
+		}
+
+		// normal equations, Cramer's rule
+		double m[3][3] = { { s[0], s[1], s[2] }, { s[1], s[2], s[3] }, { s[2], s[3], s[4] } };
+		double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+				- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+				+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+		if (fabs(det) > 1e-9)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				double a[3][3];
+				memcpy(a, m, sizeof(a));
+				for (int r = 0; r < 3; r++)
+					a[r][c] = t[r];
+				coef[c] = (a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+						- a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+						+ a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0])) / det;
+			}
+			fitted = true;
+		}
+		else
+			fprintf(stderr, "KickModel: singular calibration fit, using the speed table\n");
+	}
+
+	powerLut.resize(KM_SPEED_N);
+	unsigned int n = speedTable.size();
+	for (int i = 0; i < KM_SPEED_N; i++)
+	{
+		double v = i * KM_SPEED_STEP;
+		if (fitted)
+		{
+			powerLut[i] = (float)(coef[0] + coef[1] * v + coef[2] * v * v);
+			continue;
+		}
+
+		// piecewise linear inversion of the speed table, extrapolating on both ends
+		// (above the last speed with the last segment, continuous at its end)
+		unsigned int seg = 1;
+		while (seg < n - 1 && v >= speedTable[seg])
+			seg++;
+		double mm = (speedTable[seg] - speedTable[seg - 1]) / powerStep;
+		double p0 = minPower + (int)(seg - 1) * powerStep;
+		if (fabs(mm) < 1e-9)
+			powerLut[i] = (float)((v > speedTable[seg - 1]) ? p0 + powerStep : p0);	// both powers give the same speed
+		else
+			powerLut[i] = (float)(p0 + (v - speedTable[seg - 1]) / mm);
+	}
+
+	valid = true;
+}
+
+float KickModel::getExitSpeed(float distance, float height) const
+{
+	if (distance < 0.0)
+		distance = 0.0;
+	if (height < 0.0)
+		height = 0.0;
+
+	float fd = distance / KM_DIST_STEP;
+	float fh = height / KM_HEIGHT_STEP;
+	int d = (int)fd;
+	int h = (int)fh;
+	if (d >= KM_DIST_N - 1 || h >= KM_HEIGHT_N - 1)
+		return ballisticSpeed(distance, height);	// outside the table
+
+	float wd = fd - d;
+	float wh = fh - h;
+	const float* row0 = &speedLut[d * KM_HEIGHT_N + h];
+	const float* row1 = row0 + KM_HEIGHT_N;
+
+	return (1 - wd) * ((1 - wh) * row0[0] + wh * row0[1]) + wd * ((1 - wh) * row1[0] + wh * row1[1]);
+}
+
+int KickModel::getPowerForSpeed(float speed) const
+{
+	float fs = speed / KM_SPEED_STEP;
+	if (fs <= 0.0)
+		return (int)powerLut[0];
+	if (fs >= KM_SPEED_N - 1)
+	{
+		// extrapolate with the slope of the last table segment
+		float slope = powerLut[KM_SPEED_N - 1] - powerLut[KM_SPEED_N - 2];
+		return (int)(powerLut[KM_SPEED_N - 1] + slope * (fs - (KM_SPEED_N - 1)));
+	}
+
+	int s = (int)fs;
+	float w = fs - s;
+	return (int)((1 - w) * powerLut[s] + w * powerLut[s + 1]);
+}
+
+int KickModel::getPower(float distance, float height, float vRobot) const
+{
+	if (!valid)
+		return 0;
+
+	double teta = (angDeg * M_PI) / 180.0;
+	return getPowerForSpeed(getExitSpeed(distance, height) - vRobot * cos(teta));
+}
+
+bool KickModel::save(const char* file, unsigned int key) const
+{
+	if (!valid)
+		return false;
+
+	FILE* fp = fopen(file, "wb");
+	if (fp == NULL)
+		return false;
+
+	KickModelFileHeader hdr;
+	hdr.magic = KM_MAGIC;
+	hdr.version = KM_VERSION;
+	hdr.key = key;
+	hdr.distN = KM_DIST_N;
+	hdr.heightN = KM_HEIGHT_N;
+	hdr.speedN = KM_SPEED_N;
+	hdr.angDeg = angDeg;
+
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+			&& fwrite(&speedLut[0], sizeof(float), speedLut.size(), fp) == speedLut.size()
+			&& fwrite(&powerLut[0], sizeof(float), powerLut.size(), fp) == powerLut.size();
+	fclose(fp);
+
+	return ok;
+}
+
+bool KickModel::load(const char* file, unsigned int key)
+{
+	FILE* fp = fopen(file, "rb");
+	if (fp == NULL)
+		return false;
+
+	KickModelFileHeader hdr;
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != KM_MAGIC || hdr.version != KM_VERSION
+			|| hdr.key != key || hdr.distN != KM_DIST_N || hdr.heightN != KM_HEIGHT_N
+			|| hdr.speedN != KM_SPEED_N)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	speedLut.resize(KM_DIST_N * KM_HEIGHT_N);
+	powerLut.resize(KM_SPEED_N);
+	valid = fread(&speedLut[0], sizeof(float), speedLut.size(), fp) == speedLut.size()
+			&& fread(&powerLut[0], sizeof(float), powerLut.size(), fp) == powerLut.size();
+	angDeg = hdr.angDeg;
+	fclose(fp);
+
+	return valid;
+}
+
+static unsigned int fnv1a(unsigned int h, const void* data, unsigned int size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for (unsigned int i = 0; i < size; i++)
+	{
+		h ^= p[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+unsigned int KickModel::sourcesKey(const std::vector<double>& speedTable, int minPower, int powerStep,
+		double angDeg, const std::vector<KickSample>& samples)
+{
+	unsigned int h = 2166136261u;
+	for (unsigned int i = 0; i < speedTable.size(); i++)
+		h = fnv1a(h, &speedTable[i], sizeof(double));
+	h = fnv1a(h, &minPower, sizeof(minPower));
+	h = fnv1a(h, &powerStep, sizeof(powerStep));
+	h = fnv1a(h, &angDeg, sizeof(angDeg));
+
+	// the constants of the ballistic table
+	double constants[2] = { KM_BALL_OFFSET, KM_GRAVITY };
+	h = fnv1a(h, constants, sizeof(constants));
+	for (unsigned int i = 0; i < samples.size(); i++)
+	{
+		h = fnv1a(h, &samples[i].distance, sizeof(float));
+		h = fnv1a(h, &samples[i].height, sizeof(float));
+		h = fnv1a(h, &samples[i].power, sizeof(int));
+	}
+	return h;
+}
+
+bool KickModel::loadSamples(const char* file, int robot, std::vector<KickSample>& samples)
+{
+	FILE* fp = fopen(file, "r");
+	if (fp == NULL)
+		return false;
+
+	char line[100];
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		int r;
+		KickSample s;
+		if (sscanf(line, "R%d %f %f %d", &r, &s.distance, &s.height, &s.power) == 4 && r == robot)
+			samples.push_back(s);
+	}
+	fclose(fp);
+
+	return true;
+}
+
+}
+} /* namespace cambada */
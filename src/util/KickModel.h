@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2009-2015,
+ * Intelligent Robotics and Intelligent Systems (IRIS) Lab
+ * CAMBADA robotic soccer team – http://robotica.ua.pt/CAMBADA/
+ * University of Aveiro, Portugal
+ *
+ * This file is part of the CAMBADA UTILITIES
+ *
+ * CAMBADA UTILITIES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CAMBADA UTILITIES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KICKMODEL_H_
+#define KICKMODEL_H_
+
+#include <vector>
+
+namespace cambada {
+namespace util {
+
+/**
+ * Kick calibration sample: power that sent the ball to distance (m) at
+ * height (m) with the robot stopped
+ */
+struct KickSample {
+	float distance;
+	float height;
+	int power;
+};
+
+/**
+ * \brief Continuous kick model: (distance, height, robot velocity) -> kick power
+ *
+ * The ball leaves the kicker with a fixed angle, so the exit speed needed
+ * for a target (distance, height) follows the ballistic equations, and the
+ * power depends only on the exit speed. Both relations are baked at load
+ * time in dense tables (bilinear/linear interpolation), so a query is
+ * constant time:
+ *  - exit speed(distance, height), 2D table
+ *  - power(exit speed), 1D table, from the measured speed of each power in
+ *    kicker.map, refitted with the calibration samples when available
+ * The tables can be saved to and loaded from a binary cache.
+ */
+class KickModel {
+public:
+	KickModel();
+
+	/**
+	 * Builds the tables
+	 * \param speedTable measured ball exit speed (m/s) for powers minPower, minPower+powerStep, ...
+	 * \param angDeg ball exit angle (degrees)
+	 * \param samples calibration samples (may be empty)
+	 */
+	void build(const std::vector<double>& speedTable, int minPower, int powerStep, double angDeg,
+			const std::vector<KickSample>& samples);
+
+	/**
+	 * Exit speed (m/s) needed to reach distance (m, from the robot center) at height (m)
+	 */
+	float getExitSpeed(float distance, float height) const;
+
+	/**
+	 * Kick power for an exit speed (m/s)
+	 */
+	int getPowerForSpeed(float speed) const;
+
+	/**
+	 * Kick power to reach distance (m, from the robot center) at height (m),
+	 * vRobot is the robot velocity contribution to the ball speed (m/s)
+	 */
+	int getPower(float distance, float height, float vRobot = 0.0) const;
+
+	double getAngleDeg() const { return angDeg; }
+	bool isValid() const { return valid; }
+
+	/**
+	 * Binary cache of the tables. The key identifies the sources the tables
+	 * were built from, load fails if it does not match.
+	 */
+	bool save(const char* file, unsigned int key) const;
+	bool load(const char* file, unsigned int key);
+
+	/**
+	 * Key of the model sources (see save/load)
+	 */
+	static unsigned int sourcesKey(const std::vector<double>& speedTable, int minPower, int powerStep,
+			double angDeg, const std::vector<KickSample>& samples);
+
+	/**
+	 * Reads the calibration samples of a robot (lines "R<robot> <distance> <height> <power>")
+	 */
+	static bool loadSamples(const char* file, int robot, std::vector<KickSample>& samples);
+
+private:
+	float ballisticSpeed(float distance, float height) const;
+
+	bool valid;
+	double angDeg;
+	std::vector<float> speedLut;	// DIST_N x HEIGHT_N, distance major
+	std::vector<float> powerLut;	// SPEED_N
+};
+
+}
+} /* namespace cambada */
+#endif /* KICKMODEL_H_ */
@@ -38,6 +38,7 @@ void KickerTable::addEntry(int distance, int power){
         distances.push_back(distance); // add entry in distances vector
 
     sort(distances.begin(), distances.end(), _distSort); // Sort distances table
+    lut.clear();
 }
 
 void KickerTable::delEntry(int distance){
@@ -47,6 +48,7 @@ void KickerTable::delEntry(int distance){
     }
 
     sort(distances.begin(), distances.end(), _distSort); // Sort distances table
+    lut.clear();
 }
 
 int KickerTable::size(){
@@ -59,40 +61,50 @@ void KickerTable::print(FILE* fout) {
     }
 }
 
-int KickerTable::getPower(int distance){
-    if(size() == 0)
-        return 0;
-    if(size() == 1)
-        return mapping[distances.at(0)];
-    else if(find(distances.begin(), distances.end(), distance) != distances.end()) // If that distance exists in the table
-        return mapping[distance];
-    else {
-        if(distances.at(0) > distance)                       // If distance is less than the first distance in the table
-            return mapping[distances.at(0)];                 // return that distance
+void KickerTable::buildLut(){
+    int first = distances.front();
+    lut.resize(distances.back() - first + 1);
 
-        int leftDistIdx = 0;
+    int leftDistIdx = 0;
+    for(int distance = first; distance <= distances.back(); distance++){
         while(leftDistIdx < size()-1 && distances.at(leftDistIdx+1) < distance)
             leftDistIdx++;
 
-        if(leftDistIdx == size()-1)                         // check if we reached the end
-            return mapping[distances.at(leftDistIdx)];      // In that case return the power for the highes distance
-        else {                                              // Else, we still have points to the right
-            int rightDistIdx = leftDistIdx+1;               // Then this is the point to the right
-
+        if(distance == distances.at(leftDistIdx) || leftDistIdx == size()-1)
+            lut[distance-first] = mapping[distances.at(leftDistIdx)];
+        else if(distance == distances.at(leftDistIdx+1))
+            lut[distance-first] = mapping[distances.at(leftDistIdx+1)];
+        else {
             float d1 = (float)distances.at(leftDistIdx);           // Distance 1
-            float d2 = (float)distances.at(rightDistIdx);          // Distance 2
+            float d2 = (float)distances.at(leftDistIdx+1);         // Distance 2
             float dDist = d2 - d1;                          // delta Distance
             float dPow = (float)mapping[d2] - (float)mapping[d1]; // delta Power
 
             float m = dPow/dDist;                           // Calc slope
             float b = (float)mapping[d1] - m*d1;            // calc b of the line
 
-            return (int)(m*distance + b);                   // Return the value of the line in that distance
+            lut[distance-first] = (int)(m*distance + b);    // Value of the line in that distance
         }
     }
 }
 
-KickerConf::KickerConf(int agentNumber, char* file)
+int KickerTable::getPower(int distance){
+    if(size() == 0)
+        return 0;
+    if(size() == 1)
+        return mapping[distances.at(0)];
+
+    if(distance <= distances.front())                       // If distance is less than the first distance in the table
+        return mapping[distances.front()];                  // return that distance
+    if(distance >= distances.back())                        // If we are past the end
+        return mapping[distances.back()];                   // return the power for the highest distance
+
+    if(lut.empty())
+        buildLut();
+    return lut[distance-distances.front()];                 // Linear interpolation between the table entries
+}
+
+KickerConf::KickerConf(int agentNumber, char* file, const char* calibFile)
 {
 	if(agentNumber < 1 || agentNumber > 6){
 		fprintf(stderr,"ERROR : KickerConf invalid agent (given %d)\n", agentNumber);
@@ -100,9 +112,9 @@ KickerConf::KickerConf(int agentNumber, char* file)
 	}
 	currentAgent = agentNumber;                                 // Save current agent number
 	load(file);
-	if (!loadThroughParab())
+	if (!loadThroughParab((char*)"../config/kicker.map", calibFile))
 	{
-		fprintf(stderr,"ERROR LOADING kicker.map\n");
+		fprintf(stderr,"ERROR LOADING kicker.map (samples %s)\n", calibFile);
 		exit(1);
 	}
 	world = NULL;
@@ -191,7 +203,7 @@ void KickerConf::print()
     }
 }
 
-bool KickerConf::loadThroughParab(char* file)
+bool KickerConf::loadThroughParab(char* file, const char* calibFile, const char* cacheFile)
 {
 	FILE *fp = fopen(file, "r");                                // Open config file for reading
 	char trash[100];
@@ -202,7 +214,7 @@ bool KickerConf::loadThroughParab(char* file)
 	float velContribution, vel15, vel20, vel25, vel30, vel35, vel40, vel45, vel50, ang, height;
 
 	/* this is for skipping the lines that are not needed in the conf file */
-	for(int i = 0; i < Whoami()-1; i++)
+	for(int i = 0; i < currentAgent-1; i++)
 	{
 		fgets (trash , 100 , fp);
 	}
@@ -210,6 +222,7 @@ bool KickerConf::loadThroughParab(char* file)
 
 	fclose(fp);
 
+	vel.clear();
 	vel.push_back(vel15);
 	vel.push_back(vel20);
 	vel.push_back(vel25);
@@ -223,25 +236,29 @@ bool KickerConf::loadThroughParab(char* file)
 	angDeg = ang;
 	velRobotContribution = velContribution;
 
-	return true;
+	/* the model tables are cached per robot and rebuilt when kicker.map or the calibration samples change */
+	std::vector<cambada::util::KickSample> samples;
+	cambada::util::KickModel::loadSamples(calibFile, currentAgent, samples);
+	unsigned int key = cambada::util::KickModel::sourcesKey(vel, KICK_MIN, KICK_STEP, angDeg, samples);
+
+	char cacheName[256];
+	snprintf(cacheName, sizeof(cacheName), "%s.R%d", cacheFile, currentAgent);
+	if (!model.load(cacheName, key))
+	{
+		model.build(vel, KICK_MIN, KICK_STEP, angDeg, samples);
+		if (!model.save(cacheName, key))
+			fprintf(stderr,"KickerConf: could not write %s\n", cacheName);
+	}
+
+	return model.isValid();
 }
 
 int KickerConf::getPowerThroughParab(float distance, float height)
 {
-	int kickPower;
-	double distOrig = distance;
-	double g = 9.8067;
-	double teta = (angDeg * M_PI) / 180.0;
-	double v0, vkick;
-	double mm=0.0, bb=0.0;
-	int i, kick;
-
 	//HACK "Correct" height according to XX speed
 	ClippedRamp xSpeedFactor = ClippedRamp(0.0, 1.0, 1.74, 0.5, 0.0, 1.0);
 	height *= xSpeedFactor.getValue(world->lowlevel.getVelX());
 
-	distance = distance + height / tan(teta); //for the ball to enter approx. height meters of the ground on the goal line
-
 	// for kicking purposes, directly use the odometry measured velocity
 	double vRobot_y;
 	vRobot_y = (world->lowlevel.getDY()/(MOTION_TICK/1000.0)) * velRobotContribution;
@@ -252,33 +269,12 @@ int KickerConf::getPowerThroughParab(float distance, float height)
 //	double actuationDelay = 0.08;	// 50 ms is mean, 80 ms is max
 //	distance = distance - vRobot_y * actuationDelay;
 
-	distance -= 0.27;	//0.27 is the robotCenter->ballCenter (following calcs are for the ball arc)
-
-	v0 = sqrt(distance * g / sin(2 * teta));
-	vkick = v0 - vRobot_y * cos(teta);
-
-	bool afterLast = true;
-	for(i = 1, kick = KICK_MIN; i < N_VALS; i++, kick += KICK_STEP)
-	{
-		if(vkick < vel.at(i))
-		{
-			mm = (vel.at(i)-vel.at(i-1)) / KICK_STEP;
-			bb = vel.at(i-1) - mm * kick;
-			afterLast = false;
-			break;
-		}
-	}
-	if(afterLast)
-	{
-		mm = (vel.at(vel.size()-1)-vel.at(vel.size()-2)) / KICK_STEP;
-		bb = vel.at(vel.size()-2) - mm * kick;
-	}
-
-	kickPower = (int)((vkick - bb) / mm);
+	// the ball enters approx. height meters of the ground at distance
+	int kickPower = model.getPower(distance, height, vRobot_y);
 
 #if false
-	printf("KICK_CALC dist=%5.3f / %5.3f, V0=%5.2f, vkick=%5.2f, vRobot=%5.3f (vX=%5.2f), KickPow=%d, justK:%d\n",
-			distOrig, distance, v0, vkick, vRobot_y, world->lowlevel.getDX()/(MOTION_TICK/1000.0),
+	printf("KICK_CALC dist=%5.3f, height=%5.3f, vRobot=%5.3f (vX=%5.2f), KickPow=%d, justK:%d\n",
+			distance, height, vRobot_y, world->lowlevel.getDX()/(MOTION_TICK/1000.0),
 			kickPower, world->me->justKicked);
 #endif
 
@@ -31,6 +31,7 @@
 #include "math.h"
 #include "WorldState.h"
 #include "ClippedRamp.h"
+#include "KickModel.h"
 
 #define N_VALS		8
 #define KICK_MIN	15
@@ -50,6 +51,9 @@ public:
     std::map<int,int> mapping;
 
 private:
+    void buildLut(); // dense power per cm between the first and last distances
+
+    std::vector<int> lut; // built on demand, cleared when the table changes
     struct distSort {
       bool operator() (int i,int j) { return (i<j);}
     } _distSort;
@@ -58,7 +62,7 @@ private:
 class KickerConf
 {
 public:
-	KickerConf(int agentNumber, char* file = (char*)"../config/kicker.conf");
+	KickerConf(int agentNumber, char* file = (char*)"../config/kicker.conf", const char* calibFile = "../config/kicker.calib");
 	KickerConf(WorldState* pointer, int agentNumber, char* file = (char*)"../config/kicker.conf");
 	bool load(char* file = (char*)"../config/kicker.conf");
 	bool save(char* file = (char*)"../config/kicker.conf");
@@ -67,8 +71,10 @@ public:
 	void setAgent(int agent);
 	void print();
 
-	bool loadThroughParab(char* file = (char*)"../config/kicker.map");
+	bool loadThroughParab(char* file = (char*)"../config/kicker.map",
+			const char* calibFile = "../config/kicker.calib", const char* cacheFile = "../config/kicker.lut");
 	int getPowerThroughParab(float distance, float height=defaultHeight);
+	const cambada::util::KickModel& getModel() { return model; }
 
 private:
 	KickerTable table[6];
@@ -80,6 +86,7 @@ private:
 	double angDeg;					/*!<Ball kick exit angle (mean of powers 25:50)*/
 	static double defaultHeight;	/*!<Height to which we want to kick (defined on config file and can be defined on the function call*/
 	double velRobotContribution;	/*!<Percentage of robot front velocity that contributes to ball exit velocity (default 0.5 on IRIS field)*/
+	cambada::util::KickModel model;	/*!<Precomputed distance/height -> power model (see KickModel)*/
 };
 
 #endif // KICKERCONF_H
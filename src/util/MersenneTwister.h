@@ -64,6 +64,7 @@
 #include <iostream>
 #include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <ctime>
 #include <cmath>
 
@@ -248,6 +249,10 @@ inline void MTRand::seed()
 {
 	// Seed the generator with an array from /dev/urandom if available
 	// Otherwise use a hash of time() and clock() values
+	// MTRAND_SEED in the environment forces a fixed seed (reproducible runs)
+	
+	const char* fixedSeed = getenv( "MTRAND_SEED" );
+	if( fixedSeed ) { seed( uint32( strtoul( fixedSeed, NULL, 10 ) ) );  return; }
 	
 	// First try getting an array from /dev/urandom
 	FILE* urandom = fopen( "/dev/urandom", "rb" );